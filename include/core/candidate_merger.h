@@ -0,0 +1,112 @@
+#pragma once
+
+#include "types.h"
+#include <string_view>
+#include <vector>
+#include <cstdint>
+
+namespace owcat {
+namespace core {
+
+/**
+ * 候选词视图
+ * 只引用来源列表中的字符串，合并期间来源必须保持有效
+ */
+struct CandidateView {
+    std::string_view text;      // 候选词文本
+    std::string_view pinyin;    // 拼音
+    double score;               // 得分
+    int frequency;              // 使用频率
+    bool is_prediction;         // 是否为AI预测结果
+
+    CandidateView() : score(0.0), frequency(0), is_prediction(false) {}
+
+    explicit CandidateView(const Candidate& candidate)
+        : text(candidate.text), pinyin(candidate.pinyin), score(candidate.score)
+        , frequency(candidate.frequency), is_prediction(candidate.is_prediction) {}
+};
+
+/**
+ * 候选词Top-K合并器
+ * 用定长小顶堆保留得分最高的K个候选词，按文本哈希去重（保留得分较高者）
+ * 所有缓冲区在构造时分配，合并过程不分配内存
+ */
+class CandidateMerger {
+public:
+    /**
+     * @param max_k 支持的最大K值
+     */
+    explicit CandidateMerger(size_t max_k);
+
+    /**
+     * 开始新一轮合并
+     * @param k 保留的候选词数量（不超过max_k）
+     */
+    void reset(size_t k);
+
+    /**
+     * 加入一个候选词
+     * @param candidate 候选词视图
+     * @return 是否进入当前Top-K
+     */
+    bool add(const CandidateView& candidate);
+
+    /**
+     * 批量加入候选词
+     * @param candidates 候选词列表
+     * @param count 最多加入的数量
+     */
+    void addAll(const CandidateList& candidates, size_t count = SIZE_MAX);
+
+    /**
+     * 按得分降序输出结果，同分时保持加入顺序
+     * 输出列表中已有的字符串容量会被复用，输出列表不能是加入过的来源
+     * @param out 输出列表
+     */
+    void finish(CandidateList& out);
+
+    /**
+     * 获取当前保留的候选词数量
+     * @return 数量
+     */
+    size_t size() const { return heap_size_; }
+
+private:
+    struct Slot {
+        CandidateView view;
+        uint64_t hash;
+        uint32_t order;         // 加入顺序，用于稳定排序
+        uint32_t heap_index;
+        uint32_t table_index;
+    };
+
+    static uint64_t hashText(std::string_view text);
+
+    // 堆顶是当前Top-K中最差的候选词
+    bool worse(uint32_t a, uint32_t b) const;
+    void siftUp(uint32_t index);
+    void siftDown(uint32_t index);
+    void swapHeap(uint32_t a, uint32_t b);
+
+    uint32_t findSlot(uint64_t hash, std::string_view text) const;
+    void insertTable(uint32_t slot);
+    void eraseTable(uint32_t slot);
+
+private:
+    static constexpr uint32_t EMPTY = UINT32_MAX;
+    static constexpr uint32_t TOMBSTONE = UINT32_MAX - 1;
+
+    size_t max_k_;
+    size_t k_;
+    size_t heap_size_;
+    uint32_t next_order_;
+    size_t tombstones_;
+    std::vector<Slot> slots_;
+    std::vector<uint32_t> heap_;        // 槽位下标
+    std::vector<uint32_t> table_;       // 开放寻址哈希表，存槽位下标
+    std::vector<uint32_t> free_slots_;
+    std::vector<uint32_t> sorted_;
+};
+
+} // namespace core
+} // namespace owcat
\ No newline at end of file
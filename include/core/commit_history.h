@@ -0,0 +1,59 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <cstddef>
+
+namespace owcat {
+namespace core {
+
+/**
+ * 最近提交文本的环形缓冲区
+ * 每个输入上下文（引擎会话）一个，作为候选词重排和AI预测的前文；焦点切换到其他输入框时清空
+ * 槽位固定，写满后覆盖最早的提交，槽位中的字符串容量在各次提交间复用
+ */
+class CommitHistory {
+public:
+    // 保留的提交次数
+    static constexpr size_t kCapacity = 8;
+
+    CommitHistory();
+
+    /**
+     * 记录一次提交
+     * @param text 提交的文本，为空时忽略
+     */
+    void push(std::string_view text);
+
+    /**
+     * 清空历史
+     */
+    void clear();
+
+    /**
+     * 检查是否为空
+     * @return 是否为空
+     */
+    bool empty() const;
+
+    /**
+     * 获取最近一次提交的文本
+     * @return 提交的文本，为空时返回空串
+     */
+    const std::string& last() const;
+
+    /**
+     * 按提交顺序拼接最近的文本作为前文
+     * @param max_bytes 最大字节数，超出时在UTF-8字符边界处丢弃最早的部分
+     * @return 前文
+     */
+    std::string getContext(size_t max_bytes) const;
+
+private:
+    std::string entries_[kCapacity];
+    size_t head_;       // 下一次写入的槽位
+    size_t size_;
+};
+
+} // namespace core
+} // namespace owcat
\ No newline at end of file
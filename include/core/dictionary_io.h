@@ -0,0 +1,202 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <memory>
+#include <functional>
+#include <cstdint>
+
+namespace owcat {
+namespace core {
+
+/**
+ * 词库文件格式
+ */
+enum class DictionaryFormat {
+    TXT,        // 每行 "词 拼音... [频率]"，也接受 "拼音 词 [频率]"
+    CSV,        // word,pinyin[,frequency]，可带表头
+    JSON,       // 对象数组 [{"word": "...", "pinyin": "..." 或 [...], "frequency": n}, ...]
+    LEXICON     // owcat-dictc编译的二进制词典
+};
+
+/**
+ * 解析格式名
+ * @param name 格式名（txt、csv、json、lex），为空或"auto"时按文件扩展名检测
+ * @param path 文件路径，用于检测格式
+ * @param format 输出格式
+ * @return 格式名是否有效
+ */
+bool parseDictionaryFormat(const std::string& name, const std::string& path, DictionaryFormat& format);
+
+/**
+ * 获取格式名
+ * @param format 格式
+ * @return 格式名
+ */
+const char* dictionaryFormatName(DictionaryFormat format);
+
+/**
+ * 读取到的一个词条
+ * 视图只在回调期间有效；拼音已规范为以空格分隔的音节
+ */
+struct DictionaryRecord {
+    std::string_view word;
+    std::string_view pinyin;
+    uint32_t frequency;
+
+    DictionaryRecord() : frequency(1) {}
+};
+
+/**
+ * 导入导出进度
+ */
+struct DictionaryProgress {
+    uint64_t processed = 0;     // 已处理量：文本格式为字节数，二进制词典和导出为条目数
+    uint64_t total = 0;         // 总量，单位与processed相同
+    size_t entries = 0;         // 已接受的词条数
+    size_t rejected = 0;        // 无法解析或被拒绝的词条数
+};
+
+/**
+ * 导入导出结果
+ */
+enum class DictionaryIoStatus {
+    OK,
+    CANCELLED,
+    FAILED
+};
+
+/**
+ * 进度回调，在执行导入导出的线程上调用
+ * @return 返回false时取消
+ */
+using DictionaryProgressCallback = std::function<bool(const DictionaryProgress&)>;
+
+/**
+ * 词条回调
+ * @return 是否接受该词条，不接受的计入rejected
+ */
+using DictionaryRecordVisitor = std::function<bool(const DictionaryRecord&)>;
+
+/**
+ * 流式读取词库文件
+ * 文本格式以内存映射方式逐行解析、JSON以SAX方式解析，内存占用与文件大小无关；
+ * 大约每处理1MB（二进制词典为每4096个条目）调用一次进度回调，并在结束时再调用一次
+ * @param path 文件路径
+ * @param format 文件格式
+ * @param visitor 词条回调
+ * @param progress 进度回调，可为空
+ * @param stats 输出统计
+ * @return 读取结果，取消时已读取的词条已交给visitor
+ */
+DictionaryIoStatus readDictionary(const std::string& path, DictionaryFormat format,
+                                  const DictionaryRecordVisitor& visitor,
+                                  const DictionaryProgressCallback& progress, DictionaryProgress& stats);
+
+/**
+ * 事务式词库写出器
+ * 按块缓冲写入<path>.tmp，commit()时同步到磁盘并替换目标文件；
+ * 未提交即销毁或中途失败时删除临时文件，目标文件保持原样
+ * 二进制词典格式先收集全部词条，提交时编译写出
+ */
+class DictionaryWriter {
+public:
+    /**
+     * @param path 目标文件路径
+     * @param format 文件格式
+     */
+    DictionaryWriter(const std::string& path, DictionaryFormat format);
+    ~DictionaryWriter();
+
+    // 禁用拷贝和移动
+    DictionaryWriter(const DictionaryWriter&) = delete;
+    DictionaryWriter& operator=(const DictionaryWriter&) = delete;
+    DictionaryWriter(DictionaryWriter&&) = delete;
+    DictionaryWriter& operator=(DictionaryWriter&&) = delete;
+
+    /**
+     * 创建临时文件
+     * @return 是否创建成功
+     */
+    bool open();
+
+    /**
+     * 写入一个词条
+     * @param word 词汇
+     * @param pinyin 以空格分隔的拼音
+     * @param frequency 频率
+     * @return 是否写入成功
+     */
+    bool write(std::string_view word, std::string_view pinyin, uint32_t frequency);
+
+    /**
+     * 完成写出并替换目标文件
+     * @return 是否提交成功
+     */
+    bool commit();
+
+    /**
+     * 放弃写出并删除临时文件
+     */
+    void abort();
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> pImpl;
+};
+
+/**
+ * 后台导入导出任务
+ * 在独立线程上执行，可以随时查询进度或取消；销毁时取消并等待线程结束
+ */
+class DictionaryTask {
+public:
+    /**
+     * 任务主体，收到的进度回调返回false时应尽快结束并返回CANCELLED
+     */
+    using Work = std::function<DictionaryIoStatus(const DictionaryProgressCallback&)>;
+
+    /**
+     * 启动任务
+     * @param work 任务主体
+     * @param progress 进度回调，在后台线程上调用，可为空
+     */
+    DictionaryTask(Work work, DictionaryProgressCallback progress);
+    ~DictionaryTask();
+
+    // 禁用拷贝和移动
+    DictionaryTask(const DictionaryTask&) = delete;
+    DictionaryTask& operator=(const DictionaryTask&) = delete;
+    DictionaryTask(DictionaryTask&&) = delete;
+    DictionaryTask& operator=(DictionaryTask&&) = delete;
+
+    /**
+     * 请求取消，任务在下一次报告进度时结束
+     */
+    void cancel();
+
+    /**
+     * 检查任务是否已结束
+     * @return 是否已结束
+     */
+    bool isFinished() const;
+
+    /**
+     * 等待任务结束
+     * @return 任务结果
+     */
+    DictionaryIoStatus wait();
+
+    /**
+     * 获取最近一次报告的进度
+     * @return 进度
+     */
+    DictionaryProgress getProgress() const;
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> pImpl;
+};
+
+} // namespace core
+} // namespace owcat
\ No newline at end of file
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "types.h"
+#include "dictionary_io.h"
 #include <string>
 #include <vector>
 #include <memory>
@@ -8,13 +9,23 @@
 namespace owcat {
 namespace core {
 
+class SentenceDecoder;
+
 /**
  * 词库管理器
  * 负责词库的加载、查询、更新和用户词汇学习
+ * 提供系统词典文件时，系统词从内存映射的Lexicon查询，否则从SQLite查询；
+ * 用户词和学习结果保存在叠加于系统词之上的UserDictionary中（<db_path>.user），修改在下一次查询即生效
  */
 class DictionaryManager {
 public:
-    explicit DictionaryManager(const std::string& db_path);
+    /**
+     * @param db_path 词库数据库路径，用户词库保存在其旁边
+     * @param lexicon_path 只读系统词典路径，为空或不存在时使用SQLite中的系统词
+     * @param ngram_path n-gram模型路径，与系统词典一起用于整句解码，为空或不存在时不提供整句候选
+     */
+    explicit DictionaryManager(const std::string& db_path, const std::string& lexicon_path = "",
+                               const std::string& ngram_path = "");
     ~DictionaryManager();
 
     // 禁用拷贝和移动
@@ -36,6 +47,7 @@ public:
 
     /**
      * 根据拼音查询候选词
+     * 系统词和用户词都支持简拼（如 "z g r"），用户词按音节首字母索引查询
      * @param pinyin 拼音字符串
      * @param max_results 最大结果数
      * @return 候选词列表
@@ -50,28 +62,84 @@ public:
      */
     CandidateList searchByPinyinSequence(const std::vector<std::string>& pinyins, int max_results = 10) const;
 
+    /**
+     * 整句解码：在音节序列上按n-gram模型搜索概率最高的词序列
+     * 只返回由多个词组成的整句，单个词已由searchByPinyin()提供
+     * @param syllables 音节序列（分割网格中的一条路径）
+     * @param complete 末尾音节是否完整，不完整时按前缀匹配
+     * @param max_results 最大结果数
+     * @return 整句候选词，得分与词库候选词可比，最优整句为满分
+     */
+    CandidateList searchSentence(const std::vector<std::string>& syllables, bool complete, int max_results = 3) const;
+    
+    /**
+     * 使用调用方持有的解码器做整句解码，解码器在连续调用间复用公共音节前缀的状态
+     * @param decoder 由createSentenceDecoder()创建的解码器，不能跨线程共享
+     * @param syllables 音节序列
+     * @param complete 末尾音节是否完整，不完整时按前缀匹配
+     * @param max_results 最大结果数
+     * @return 整句候选词
+     */
+    CandidateList searchSentence(SentenceDecoder& decoder, const std::vector<std::string>& syllables, bool complete,
+                                 int max_results = 3) const;
+    
+    /**
+     * 创建一个整句解码器，供单个输入会话增量解码使用
+     * 解码器引用本词典的系统词典和语言模型，必须在词典关闭前销毁
+     * @return 解码器，未加载n-gram模型时返回nullptr
+     */
+    std::unique_ptr<SentenceDecoder> createSentenceDecoder() const;
+    
+    /**
+     * 按前文对候选词重排：前文末尾的词与候选词在n-gram模型中的二元概率高于一元概率时加分
+     * 只查表不解码，可在每次按键时调用
+     * @param context 前文，如最近提交的文本
+     * @param candidates 候选词，有加分时按新得分降序稳定重排
+     * @return 得到加分的候选词数量，未加载n-gram模型或前文末尾不在词表中时为0
+     */
+    size_t rerankByContext(const std::string& context, CandidateList& candidates) const;
+    
+    /**
+     * 设置模糊音与拼写纠错规则，系统词典打开后立即重建展开表
+     * 启用后searchByPinyin()和filterByPinyin()都按模糊规则匹配；不能与查询并发调用
+     * @param config 模糊音规则
+     */
+    void setFuzzyPinyin(const FuzzyPinyinConfig& config);
+    
     /**
      * 模糊查询候选词
+     * 使用系统词典时按setFuzzyPinyin()设置的规则展开查询，否则在SQLite中按子串匹配
      * @param partial_pinyin 部分拼音
      * @param max_results 最大结果数
      * @return 候选词列表
      */
     CandidateList fuzzySearch(const std::string& partial_pinyin, int max_results = 10) const;
 
+    /**
+     * 从较短拼音的查询结果中筛选出匹配更长拼音的候选词，并按新拼音重新打分
+     * 拼音以原查询拼音为前缀时，结果是原结果的子集，无需再次查询
+     * @param candidates 较短拼音的查询结果（按频率降序）
+     * @param pinyin 新的拼音（空格分隔音节）
+     * @param max_results 最大结果数量
+     * @return 筛选后的候选词列表，保持原有顺序
+     */
+    CandidateList filterByPinyin(const CandidateList& candidates, const std::string& pinyin, int max_results = 10) const;
+
     /**
      * 添加用户词汇
      * @param word 词汇
      * @param pinyin 拼音
      * @param frequency 初始频率
-     * @return 是否添加成功
+     * @return 是否添加成功（立即生效，日志在后台批量同步到磁盘）
      */
     bool addUserWord(const std::string& word, const std::string& pinyin, int frequency = 1);
 
     /**
-     * 更新词汇使用频率
+     * 更新词汇使用频率，系统词记为用户层中的频率增量
+     * 用户层的频率按setFrequencyHalfLife()设置的半衰期随时间衰减，近期使用的词排在前面
      * @param word 词汇
      * @param pinyin 拼音
-     * @return 是否更新成功
+     * @return 是否更新成功（立即生效，日志在后台批量同步到磁盘）
      */
     bool updateWordFrequency(const std::string& word, const std::string& pinyin);
 
@@ -101,19 +169,49 @@ public:
 
     /**
      * 导入词库文件
+     * 以内存映射方式流式解析，内存占用与文件大小无关；取消时已导入的词保留
      * @param file_path 词库文件路径
-     * @param format 文件格式（"txt", "csv", "json"）
+     * @param format 文件格式（"txt", "csv", "json", "lex"），为空或"auto"时按扩展名检测
+     * @param progress 进度回调，在调用线程上执行，返回false时取消
      * @return 是否导入成功
      */
-    bool importDictionary(const std::string& file_path, const std::string& format = "txt");
+    bool importDictionary(const std::string& file_path, const std::string& format = "txt",
+                          const DictionaryProgressCallback& progress = nullptr);
 
     /**
      * 导出用户词库
+     * 写入临时文件后替换目标文件，取消或失败时目标文件保持原样
      * @param file_path 导出文件路径
-     * @param format 文件格式（"txt", "csv", "json"）
+     * @param format 文件格式（"txt", "csv", "json", "lex"），为空或"auto"时按扩展名检测
+     * @param progress 进度回调，在调用线程上执行，返回false时取消
      * @return 是否导出成功
      */
-    bool exportUserDictionary(const std::string& file_path, const std::string& format = "txt") const;
+    bool exportUserDictionary(const std::string& file_path, const std::string& format = "txt",
+                              const DictionaryProgressCallback& progress = nullptr) const;
+    
+    /**
+     * 在后台线程导入词库文件，不阻塞调用线程
+     * 返回的任务必须在DictionaryManager销毁前结束或销毁
+     * @param file_path 词库文件路径
+     * @param format 文件格式，为空时按扩展名检测
+     * @param progress 进度回调，在后台线程上执行
+     * @return 导入任务，格式无效时返回空
+     */
+    std::unique_ptr<DictionaryTask> importDictionaryAsync(const std::string& file_path,
+                                                          const std::string& format = "",
+                                                          DictionaryProgressCallback progress = nullptr);
+    
+    /**
+     * 在后台线程导出用户词库，不阻塞调用线程
+     * 返回的任务必须在DictionaryManager销毁前结束或销毁
+     * @param file_path 导出文件路径
+     * @param format 文件格式，为空时按扩展名检测
+     * @param progress 进度回调，在后台线程上执行
+     * @return 导出任务，格式无效时返回空
+     */
+    std::unique_ptr<DictionaryTask> exportUserDictionaryAsync(const std::string& file_path,
+                                                              const std::string& format = "",
+                                                              DictionaryProgressCallback progress = nullptr) const;
 
     /**
      * 获取词库统计信息
@@ -122,12 +220,33 @@ public:
     std::string getStatistics() const;
 
     /**
-     * 清理低频词汇
+     * 设置用户层频率的半衰期，查询时按此衰减，不改写已保存的数据
+     * @param days 半衰期（天），0表示不衰减
+     */
+    void setFrequencyHalfLife(double days);
+    
+    /**
+     * 清理低频用户词（按衰减后的频率），只修改内存并追加一条日志，不阻塞查询
      * @param min_frequency 最小频率阈值
      * @return 清理的词汇数量
      */
     int cleanupLowFrequencyWords(int min_frequency = 1);
 
+    /**
+     * 立即把用户词库日志中尚未同步的记录写入磁盘
+     * 日志默认由后台线程按批同步，过长时压缩为快照；shutdown时会自动同步并压缩
+     * @return 是否写入成功
+     */
+    bool flushPendingWrites();
+
+    /**
+     * 获取用户层修订号
+     * 添加、删除、导入、清理用户词和修改半衰期时递增，缓存查询结果的调用方据此判断结果是否过期；
+     * updateWordFrequency()的学习加权不计入，由调用方按所学的词自行失效
+     * @return 修订号
+     */
+    uint64_t getUserRevision() const;
+
 private:
     /**
      * 创建数据库表
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+
+namespace owcat {
+namespace core {
+
+/**
+ * 双拼方案的键位表
+ * 每个音节固定由两个键输入：第一个键为声母（zh/ch/sh各占一个键，零声母音节按方案规定），
+ * 第二个键为韵母。方案以文本形式的键位数据描述，加载时展开为 26×27 的两键→音节ID表，
+ * 解码一个音节只需一次查表，不存在分割歧义
+ */
+class DoublePinyin {
+public:
+    // 第二个键可以是 a-z 或 ';'（微软双拼的 ing）
+    static constexpr size_t kKeyCount = 27;
+
+    // 表中没有对应音节的键位
+    static constexpr uint16_t kNoSyllable = UINT16_MAX;
+
+    DoublePinyin();
+
+    /**
+     * 加载内置方案
+     * @param scheme 方案名：microsoft、xiaohe、ziranma
+     * @param syllables 有序音节表，下标即音节ID
+     * @return 是否加载成功，方案不存在时保持原状
+     */
+    bool load(std::string_view scheme, const std::vector<std::string>& syllables);
+
+    /**
+     * 卸载方案
+     */
+    void clear();
+
+    /**
+     * 检查是否已加载方案
+     * @return 是否已加载
+     */
+    bool isLoaded() const;
+
+    /**
+     * 获取当前方案名
+     * @return 方案名，未加载时为空
+     */
+    const std::string& getName() const;
+
+    /**
+     * 检查按键能否作为音节的第一个键
+     * @param key 按键
+     * @return 是否可以
+     */
+    bool isFirstKey(char key) const;
+
+    /**
+     * 解码两个键
+     * @param first 第一个键
+     * @param second 第二个键
+     * @return 音节ID，没有对应音节时返回-1
+     */
+    int decode(char first, char second) const;
+
+    /**
+     * 获取只输入了第一个键时的拼音前缀：声母，零声母键为该键本身
+     * @param key 第一个键
+     * @return 拼音前缀，不能作为第一个键时为空
+     */
+    std::string_view getPrefix(char key) const;
+
+    /**
+     * 获取所有内置方案名
+     * @return 方案名列表
+     */
+    static std::vector<std::string> getSchemeNames();
+
+private:
+    /**
+     * 按键在表中的下标
+     * @return 下标，无效按键返回-1
+     */
+    static int keyIndex(char key);
+
+    std::string name_;
+    uint16_t table_[26 * kKeyCount];    // [第一个键][第二个键] → 音节ID
+    std::string prefixes_[26];          // 各第一个键的拼音前缀，为空表示不能作为第一个键
+};
+
+} // namespace core
+} // namespace owcat
\ No newline at end of file
@@ -3,6 +3,7 @@
 #include "types.h"
 #include <memory>
 #include <string>
+#include <map>
 
 namespace owcat {
 namespace core {
@@ -18,6 +19,16 @@ class PredictionEngine;
 class Engine {
 public:
     explicit Engine(const EngineConfig& config = EngineConfig{});
+
+    /**
+     * 使用共享的词库和预测引擎构造，供同一进程内的多个输入会话共用一份词库和模型
+     * 共享组件由调用方初始化和关闭；词库管理器只能在单个线程中使用
+     * @param config 引擎配置
+     * @param dictionary_manager 共享的词库管理器
+     * @param prediction_engine 共享的预测引擎，可为空
+     */
+    Engine(const EngineConfig& config, std::shared_ptr<DictionaryManager> dictionary_manager,
+           std::shared_ptr<PredictionEngine> prediction_engine);
     ~Engine();
 
     // 禁用拷贝和移动
@@ -28,6 +39,7 @@ public:
 
     /**
      * 初始化引擎
+     * 拼音表和词库同步就绪后即返回，AI模型在后台线程中加载
      * @return 是否初始化成功
      */
     bool initialize();
@@ -46,9 +58,10 @@ public:
 
     /**
      * 获取当前候选词列表
+     * 预测结果可能随时由后台线程合并，返回加锁复制的快照
      * @return 候选词列表
      */
-    const CandidateList& getCandidates() const;
+    CandidateList getCandidates() const;
 
     /**
      * 获取当前组合字符串（拼音）
@@ -80,8 +93,30 @@ public:
      */
     void clearComposition();
 
+    /**
+     * 输入焦点切换到其他输入框时调用：清空当前输入和提交历史，之前的文本不再作为前文
+     */
+    void resetContext();
+
+    /**
+     * 按当前应用切换配置（EngineConfig::profiles），通常在平台焦点变化时调用
+     * 切换过的配置在LRU中保持预热：候选词缓存、领域词典和预测会话的KV缓存切换回来时仍然有效
+     * @param application 应用标识（进程名、Bundle ID或窗口标题）
+     * @return 生效的配置名，没有匹配的配置时为空
+     */
+    std::string switchProfile(const std::string& application);
+
+    /**
+     * 设置系统负载采样回调，AI预测按CPU占用和电池状态减少线程数、生成长度或暂停调用模型
+     * 与其他引擎共享预测引擎时对所有共享者生效
+     * @param provider 采样回调，通常为platform::createSystemLoadProvider()，为空时只按预测延迟调节
+     */
+    void setSystemLoadProvider(SystemLoadProvider provider);
+    
     /**
      * 设置候选词回调
+     * 词库候选词在按键处理中立即回调；启用AI预测时，预测结果合并后会从
+     * 预测线程再次回调，界面需要自行切换到UI线程
      * @param callback 回调函数
      */
     void setCandidateCallback(CandidateCallback callback);
@@ -110,6 +145,38 @@ public:
      */
     const EngineConfig& getConfig() const;
 
+    /**
+     * 检查AI预测是否已就绪
+     * 模型在后台线程中加载，initialize()返回后可能仍需等待一段时间
+     * @return 模型已加载并预热完成时为true
+     */
+    bool isPredictionAvailable() const;
+
+    /**
+     * 获取候选词缓存统计，用于调整缓存大小
+     * @return 命中、筛选和未命中次数
+     */
+    CandidateCacheStats getCandidateCacheStats() const;
+
+    /**
+     * 获取各处理阶段的按键延迟统计（p50/p99/max）
+     * @return 统计项名称到显示文本的映射
+     */
+    std::map<std::string, std::string> getLatencyStatistics() const;
+
+    /**
+     * 开启或关闭逐事件延迟追踪记录
+     * @param enabled 是否开启
+     */
+    void setLatencyTraceEnabled(bool enabled);
+
+    /**
+     * 将最近的延迟追踪事件导出为Chrome Trace/Perfetto JSON
+     * @param file_path 输出文件路径
+     * @return 是否导出成功
+     */
+    bool dumpLatencyTrace(const std::string& file_path) const;
+
 private:
     class Impl;
     std::unique_ptr<Impl> pImpl;
@@ -0,0 +1,172 @@
+#pragma once
+
+#include "types.h"
+#include <memory>
+#include <string>
+#include <cstddef>
+#include <cstdint>
+
+namespace owcat {
+namespace core {
+
+/**
+ * 引擎守护进程服务端
+ * 持有唯一的词库管理器和预测模型，为每个前端连接创建一个共享这些组件的Engine会话
+ * 前端通过共享内存中的环形缓冲区发送输入事件，用命名信号量（Windows为命名事件）唤醒对方
+ */
+class EngineServer {
+public:
+    static constexpr size_t MAX_SESSIONS = 32;
+
+    /**
+     * @param config 引擎配置，所有会话共用
+     */
+    explicit EngineServer(const EngineConfig& config = EngineConfig{});
+    ~EngineServer();
+
+    // 禁用拷贝和移动
+    EngineServer(const EngineServer&) = delete;
+    EngineServer& operator=(const EngineServer&) = delete;
+    EngineServer(EngineServer&&) = delete;
+    EngineServer& operator=(EngineServer&&) = delete;
+
+    /**
+     * 初始化共享组件，创建共享内存通道并启动服务线程
+     * 模型在后台加载，加载完成前各会话只提供词库候选词
+     * @return 是否启动成功（已有其他守护进程在运行时失败）
+     */
+    bool start();
+
+    /**
+     * 设置系统负载采样回调，共享的预测引擎按CPU占用和电池状态调节，需在start()之前调用
+     * @param provider 采样回调，为空时只按预测延迟调节
+     */
+    void setSystemLoadProvider(SystemLoadProvider provider);
+    
+    /**
+     * 停止服务，关闭所有会话并释放共享内存通道
+     */
+    void stop();
+
+    /**
+     * 检查服务是否在运行
+     * @return 是否在运行
+     */
+    bool isRunning() const;
+
+    /**
+     * 获取当前连接的会话数量
+     * @return 会话数量
+     */
+    size_t getSessionCount() const;
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> pImpl;
+};
+
+/**
+ * 连接引擎守护进程的前端代理
+ * 接口与Engine一致；候选词、提交和状态回调在接收线程中调用
+ */
+class RemoteEngine {
+public:
+    RemoteEngine();
+    ~RemoteEngine();
+
+    // 禁用拷贝和移动
+    RemoteEngine(const RemoteEngine&) = delete;
+    RemoteEngine& operator=(const RemoteEngine&) = delete;
+    RemoteEngine(RemoteEngine&&) = delete;
+    RemoteEngine& operator=(RemoteEngine&&) = delete;
+
+    /**
+     * 连接守护进程并申请会话
+     * @return 是否连接成功（守护进程未运行或会话已满时失败，前端应改用进程内Engine）
+     */
+    bool connect();
+
+    /**
+     * 断开连接并释放会话
+     */
+    void disconnect();
+
+    /**
+     * 检查是否已连接
+     * @return 是否已连接
+     */
+    bool isConnected() const;
+
+    /**
+     * 处理输入事件，等待守护进程返回处理结果
+     * @param event 输入事件
+     * @return 是否处理了该事件，守护进程无响应时返回false并断开连接
+     */
+    bool processInput(const InputEvent& event);
+
+    /**
+     * 选择候选词
+     * @param index 候选词索引
+     * @return 是否选择成功
+     */
+    bool selectCandidate(int index);
+
+    /**
+     * 清空当前输入
+     */
+    void clearComposition();
+
+    /**
+     * 清空当前输入和提交历史，见Engine::resetContext()
+     */
+    void resetContext();
+
+    /**
+     * 按当前应用切换配置，见Engine::switchProfile()
+     * @param application 应用标识
+     */
+    void switchProfile(const std::string& application);
+
+    /**
+     * 获取最近一次收到的候选词
+     * @return 候选词列表副本
+     */
+    CandidateList getCandidates() const;
+
+    /**
+     * 获取最近一次收到的输入状态
+     * @return 输入状态
+     */
+    InputState getState() const;
+
+    /**
+     * 设置等待守护进程响应的超时
+     * @param timeout_ms 超时时间（毫秒）
+     */
+    void setResponseTimeout(int timeout_ms);
+
+    /**
+     * 设置候选词更新回调
+     * @param callback 回调函数
+     */
+    void setCandidateCallback(CandidateCallback callback);
+
+    /**
+     * 设置文本提交回调
+     * @param callback 回调函数
+     */
+    void setCommitCallback(CommitCallback callback);
+
+    /**
+     * 设置状态变化回调
+     * @param callback 回调函数
+     */
+    void setStateChangeCallback(StateChangeCallback callback);
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> pImpl;
+};
+
+} // namespace core
+} // namespace owcat
\ No newline at end of file
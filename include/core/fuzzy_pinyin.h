@@ -0,0 +1,175 @@
+#pragma once
+
+#include "types.h"
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+
+namespace owcat {
+namespace core {
+
+/**
+ * 模糊音与拼写纠错展开表
+ * 启动时按规则把每个音节预先展开为替代音节ID集合，查询时只需按集合枚举，
+ * 不再扫描词库；每个音节的替代数和每次查询的展开组合数都有上限
+ *
+ * 展开分两类：
+ *   模糊音：声母 z/zh、c/ch、s/sh、n/l，韵母 an/ang、en/eng、in/ing 互换，替代音节也必须是有效音节
+ *   纠错：相邻字母颠倒或误按键盘上相邻的键，只用于本身不是有效音节的输入
+ */
+class FuzzyPinyin {
+public:
+    // 单次查询最多包含的音节数
+    static constexpr size_t kMaxQuerySyllables = 32;
+
+    // 音节最大长度
+    static constexpr size_t kMaxSyllableLength = 6;
+
+    // 模糊音规则的替代代价
+    static constexpr uint8_t kFuzzyPenalty = 1;
+
+    // 拼写纠错的替代代价
+    static constexpr uint8_t kTypoPenalty = 2;
+
+    // 一个替代音节
+    struct Alternative {
+        uint16_t syllable_id;
+        uint8_t penalty;            // 替代代价，原音节为0
+    };
+
+    /**
+     * 展开后的一条查询：完整音节ID序列加末尾的音节前缀
+     */
+    struct Query {
+        uint16_t syllable_ids[kMaxQuerySyllables];
+        uint8_t syllable_count;
+        uint8_t last_length;
+        char last[kMaxSyllableLength + 1];  // 末尾音节前缀，以'\0'结尾
+        uint8_t penalty;                    // 各音节替代代价之和
+
+        std::string_view lastSyllable() const { return std::string_view(last, last_length); }
+    };
+
+    FuzzyPinyin();
+
+    /**
+     * 按规则构建展开表
+     * @param syllables 有序音节表，下标即音节ID，必须与查询的词典一致
+     * @param config 模糊音规则
+     */
+    void build(const std::vector<std::string>& syllables, const FuzzyPinyinConfig& config);
+
+    /**
+     * 清空展开表
+     */
+    void clear();
+
+    /**
+     * 检查是否启用了任何规则
+     * @return 是否启用
+     */
+    bool isEnabled() const;
+
+    /**
+     * 获取音节的替代音节（不含自身），按代价升序
+     * @param syllable_id 音节ID
+     * @param count 输出替代音节数量
+     * @return 替代音节数组，没有时为nullptr
+     */
+    const Alternative* getAlternatives(uint16_t syllable_id, size_t& count) const;
+
+    /**
+     * 获取无效音节的纠错结果
+     * @param token 输入的字母串
+     * @param count 输出结果数量
+     * @return 纠错后的音节，没有时为nullptr
+     */
+    const Alternative* getCorrections(std::string_view token, size_t& count) const;
+
+    /**
+     * 把空格分隔的拼音展开为查询，末尾音节作为前缀
+     * 第一条为原始查询（输入有效时），其余按代价升序
+     * @param pinyin 拼音，如 "zi shi"
+     * @param out 输出缓冲区
+     * @param max_queries 输出缓冲区大小
+     * @return 查询数量，有无法纠正的无效音节时为0
+     */
+    size_t expand(std::string_view pinyin, Query* out, size_t max_queries) const;
+
+    /**
+     * 计算词的拼音能否由输入拼音经模糊匹配得到
+     * @param word_pinyin 词的完整拼音，音节以空格分隔
+     * @param pinyin 输入拼音，末尾音节作为前缀
+     * @return 替代代价，不匹配时返回-1
+     */
+    int matchPenalty(std::string_view word_pinyin, std::string_view pinyin) const;
+
+private:
+    // 一个字母串最多的规则变体数（声母和韵母各一种替换的组合）
+    static constexpr size_t kMaxVariants = 3;
+
+    // 每个位置最多的选择数
+    static constexpr size_t kMaxChoices = 8;
+
+    // 展开组合的最大总代价
+    static constexpr uint8_t kMaxPenalty = 2 * kTypoPenalty;
+
+    // 一个位置上的一种选择：完整音节ID，或末尾位置的音节前缀
+    struct Choice {
+        uint16_t syllable_id;
+        uint8_t penalty;
+        uint8_t prefix_length;
+        char prefix[kMaxSyllableLength + 1];
+    };
+
+    // 纠错表的一项，按输入字母串排序，对应 correction_pool_ 中的 [begin, end)
+    struct Correction {
+        std::string token;
+        uint32_t begin;
+        uint32_t end;
+    };
+
+    // expand()在栈上的工作区：各位置的选择及其后缀能达到的最大代价
+    struct Expansion {
+        Choice choices[kMaxQuerySyllables][kMaxChoices];
+        uint8_t choice_counts[kMaxQuerySyllables];
+        uint8_t suffix_max_penalty[kMaxQuerySyllables + 1];
+        size_t position_count;
+    };
+
+    int findSyllable(std::string_view syllable) const;
+    bool isSyllablePrefix(std::string_view prefix) const;
+
+    /**
+     * 按模糊音规则列出字母串的变体（不含自身）
+     * @return 变体数量，最多kMaxVariants个
+     */
+    size_t ruleVariants(std::string_view text, bool is_prefix, std::string* out, uint8_t* penalties) const;
+
+    /**
+     * 列出一个位置上的选择，原始输入在前，其余按代价升序
+     * @return 选择数量，为0表示该位置无法匹配
+     */
+    size_t positionChoices(std::string_view token, bool is_last, Choice* out) const;
+
+    /**
+     * 深度优先枚举代价恰好为target的组合
+     */
+    void enumerate(const Expansion& expansion, size_t position, uint8_t target, Query& current,
+                   Query* out, size_t max_queries, size_t& written) const;
+
+    FuzzyPinyinConfig config_;
+    bool enabled_;
+    std::vector<std::string> syllables_;
+
+    // 按音节ID索引的替代区间 [alternative_begin_[id], alternative_begin_[id + 1])
+    std::vector<uint32_t> alternative_begin_;
+    std::vector<Alternative> alternatives_;
+
+    std::vector<Correction> corrections_;
+    std::vector<Alternative> correction_pool_;
+};
+
+} // namespace core
+} // namespace owcat
\ No newline at end of file
@@ -0,0 +1,172 @@
+#pragma once
+
+#include <string>
+#include <map>
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+
+namespace owcat {
+namespace core {
+
+/**
+ * 按键处理阶段
+ */
+enum class LatencyStage {
+    PLATFORM_KEY,       // 平台适配器按键处理（包含引擎处理）
+    ENGINE_INPUT,       // Engine::processInput
+    DICTIONARY_LOOKUP,  // 词库查询
+    SENTENCE_DECODE,    // n-gram整句解码
+    CONTEXT_RERANK,     // 按前文重排候选词
+    PREDICTION,         // AI预测（后台线程）
+    CANDIDATE_RENDER,   // 候选词窗口绘制
+    COUNT
+};
+
+/**
+ * 阶段延迟统计快照（单位：微秒）
+ */
+struct LatencyStats {
+    uint64_t count;     // 样本数量
+    double p50_us;      // 中位数
+    double p99_us;      // 99分位
+    double max_us;      // 最大值
+
+    LatencyStats() : count(0), p50_us(0.0), p99_us(0.0), max_us(0.0) {}
+};
+
+/**
+ * 按键延迟追踪器
+ * 常开的轻量级计时：每个阶段一个原子对数直方图，记录路径不加锁、不分配内存
+ * 开启追踪后额外把每次计时写入定长环形缓冲区，可导出为Chrome Trace/Perfetto JSON
+ *
+ * 引擎与平台适配器、界面分属不同模块，通过instance()共享同一个追踪器
+ */
+class LatencyTracker {
+public:
+    static constexpr size_t TRACE_CAPACITY = 4096;
+
+    /**
+     * 获取进程内共享的追踪器
+     * @return 追踪器实例
+     */
+    static LatencyTracker& instance();
+
+    LatencyTracker();
+    ~LatencyTracker();
+
+    // 禁用拷贝和移动
+    LatencyTracker(const LatencyTracker&) = delete;
+    LatencyTracker& operator=(const LatencyTracker&) = delete;
+
+    /**
+     * 开始一次新的输入事件，之后本线程的计时都归属该事件
+     * @return 事件ID
+     */
+    uint64_t beginEvent();
+
+    /**
+     * 获取本线程当前的输入事件ID
+     * @return 事件ID，尚未开始事件时为0
+     */
+    static uint64_t currentEvent();
+
+    /**
+     * 设置本线程当前的输入事件ID（后台线程处理某个事件的任务时使用）
+     * @param event_id 事件ID
+     */
+    static void setCurrentEvent(uint64_t event_id);
+
+    /**
+     * 记录一次阶段耗时
+     * @param stage 阶段
+     * @param event_id 事件ID
+     * @param start_ns 开始时间（steady_clock纳秒）
+     * @param duration_ns 耗时（纳秒）
+     */
+    void record(LatencyStage stage, uint64_t event_id, uint64_t start_ns, uint64_t duration_ns);
+
+    /**
+     * 获取阶段统计
+     * @param stage 阶段
+     * @return 统计快照
+     */
+    LatencyStats getStats(LatencyStage stage) const;
+
+    /**
+     * 获取所有阶段的统计摘要，可直接用于界面显示
+     * @return 统计项名称到显示文本的映射
+     */
+    std::map<std::string, std::string> getSummary() const;
+
+    /**
+     * 开启或关闭追踪事件记录
+     * @param enabled 是否开启
+     */
+    void setTraceEnabled(bool enabled);
+
+    /**
+     * 检查是否开启追踪事件记录
+     * @return 是否开启
+     */
+    bool isTraceEnabled() const;
+
+    /**
+     * 将环形缓冲区中的追踪事件导出为Chrome Trace JSON
+     * @param path 输出文件路径
+     * @return 是否导出成功
+     */
+    bool writeChromeTrace(const std::string& path) const;
+
+    /**
+     * 清空统计和追踪事件
+     */
+    void reset();
+
+    /**
+     * 获取阶段名称
+     * @param stage 阶段
+     * @return 名称
+     */
+    static const char* getStageName(LatencyStage stage);
+
+    /**
+     * 获取当前单调时钟时间
+     * @return 纳秒
+     */
+    static uint64_t nowNs();
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> pImpl;
+};
+
+/**
+ * 作用域计时器，析构时把耗时记录到共享追踪器
+ * 未指定事件ID时在析构时取本线程当前事件，
+ * 因此外层计时（如平台按键处理）会归属到内层Engine::processInput开始的事件
+ */
+class ScopedLatency {
+public:
+    explicit ScopedLatency(LatencyStage stage)
+        : stage_(stage), event_id_(0), start_ns_(LatencyTracker::nowNs()) {}
+
+    ScopedLatency(LatencyStage stage, uint64_t event_id)
+        : stage_(stage), event_id_(event_id), start_ns_(LatencyTracker::nowNs()) {}
+
+    ~ScopedLatency() {
+        const uint64_t event_id = event_id_ != 0 ? event_id_ : LatencyTracker::currentEvent();
+        LatencyTracker::instance().record(stage_, event_id, start_ns_, LatencyTracker::nowNs() - start_ns_);
+    }
+
+    ScopedLatency(const ScopedLatency&) = delete;
+    ScopedLatency& operator=(const ScopedLatency&) = delete;
+
+private:
+    LatencyStage stage_;
+    uint64_t event_id_;
+    uint64_t start_ns_;
+};
+
+} // namespace core
+} // namespace owcat
\ No newline at end of file
@@ -0,0 +1,243 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <cstdint>
+
+namespace owcat {
+namespace core {
+
+/**
+ * 词典条目视图
+ * 指向内存映射文件中的数据，生命周期与所属Lexicon相同，不分配内存
+ */
+struct LexiconEntry {
+    std::string_view text;          // 词汇文本（UTF-8）
+    uint32_t frequency;             // 反量化后的频率
+    const uint16_t* syllable_ids;   // 音节ID序列
+    uint16_t syllable_count;        // 音节数量
+
+    LexiconEntry() : frequency(0), syllable_ids(nullptr), syllable_count(0) {}
+};
+
+/**
+ * 只读二进制系统词典
+ * 以内存映射方式加载，条目按音节ID序列分组，每组内按频率降序预排序
+ * 另有按各音节首字母序列分组的简拼索引，每组只保留频率最高的前K个多音节词
+ * 键表和简拼键表各带一棵最高频率树，前缀查询只访问可能进入结果的键
+ *
+ * 文件布局（小端，4字节对齐）：
+ *   Header | 音节表 | 键表 | 键音节ID池 | 条目表 | 简拼键表 | 简拼条目表 | 键最高频率树 | 简拼最高频率树 | 字符串池
+ * 版本1的文件没有简拼索引，版本2的文件没有最高频率树，都仍可加载
+ */
+class Lexicon {
+public:
+    static constexpr uint32_t kMagic = 0x584c574f;  // "OWLX"
+    static constexpr uint32_t kVersion = 3;
+
+    Lexicon();
+    ~Lexicon();
+
+    // 禁用拷贝和移动
+    Lexicon(const Lexicon&) = delete;
+    Lexicon& operator=(const Lexicon&) = delete;
+    Lexicon(Lexicon&&) = delete;
+    Lexicon& operator=(Lexicon&&) = delete;
+
+    /**
+     * 打开并映射词典文件
+     * 默认只校验文件头和各段边界，启动开销接近零；来源不可信的文件应开启verify，
+     * 逐一检查每个键、条目和简拼记录的区间，越界时拒绝打开
+     * @param path 词典文件路径
+     * @param verify 是否完整校验所有记录
+     * @return 是否打开成功
+     */
+    bool open(const std::string& path, bool verify = false);
+
+    /**
+     * 关闭词典并解除映射
+     */
+    void close();
+
+    /**
+     * 检查词典是否已打开
+     * @return 是否已打开
+     */
+    bool isOpen() const;
+
+    /**
+     * 查找音节ID
+     * @param syllable 音节字符串
+     * @return 音节ID，不存在返回-1
+     */
+    int findSyllableId(std::string_view syllable) const;
+
+    /**
+     * 查找以指定前缀开头的音节ID区间
+     * @param prefix 音节前缀
+     * @param begin 输出区间起点
+     * @param end 输出区间终点（不含）
+     * @return 区间是否非空
+     */
+    bool findSyllablePrefixRange(std::string_view prefix, int& begin, int& end) const;
+
+    /**
+     * 获取音节字符串
+     * @param syllable_id 音节ID
+     * @return 音节字符串，ID无效时为空
+     */
+    std::string_view getSyllable(int syllable_id) const;
+
+    /**
+     * 按完整音节ID序列精确查询
+     * @param syllable_ids 音节ID序列
+     * @param count 音节数量
+     * @param out 输出缓冲区
+     * @param max_results 输出缓冲区大小
+     * @return 写入的条目数量（按频率降序）
+     */
+    size_t lookup(const uint16_t* syllable_ids, size_t count, LexiconEntry* out, size_t max_results) const;
+
+    /**
+     * 按空格分隔的拼音查询，末尾音节按前缀匹配，并包含更长的词
+     * 末尾之前的音节也可以只输入声母或音节前缀（简拼），此时通过简拼索引查询
+     * 完全匹配的词排在前面，其余按频率降序
+     * @param pinyin 拼音，如 "zhong g"、"z g r"、"zhong g r"
+     * @param out 输出缓冲区
+     * @param max_results 输出缓冲区大小
+     * @return 写入的条目数量
+     */
+    size_t lookupPinyin(std::string_view pinyin, LexiconEntry* out, size_t max_results) const;
+
+    /**
+     * 按已编码的完整音节加末尾音节前缀查询，语义与lookupPinyin()相同
+     * @param syllable_ids 末尾音节之前的音节ID序列
+     * @param count 音节数量（不超过32）
+     * @param last 末尾音节前缀
+     * @param out 输出缓冲区
+     * @param max_results 输出缓冲区大小
+     * @return 写入的条目数量
+     */
+    size_t lookupPrefix(const uint16_t* syllable_ids, size_t count, std::string_view last,
+                        LexiconEntry* out, size_t max_results) const;
+
+    /**
+     * 按键顺序遍历所有条目
+     * @param visitor 访问回调
+     */
+    void forEachEntry(const std::function<void(const LexiconEntry&)>& visitor) const;
+
+    /**
+     * 获取音节数量
+     * @return 音节数量
+     */
+    size_t getSyllableCount() const;
+
+    /**
+     * 获取键（音节序列）数量
+     * @return 键数量
+     */
+    size_t getKeyCount() const;
+
+    /**
+     * 获取条目数量
+     * @return 条目数量
+     */
+    size_t getEntryCount() const;
+
+    /**
+     * 获取简拼索引的键（首字母序列）数量
+     * @return 键数量，版本1的文件为0
+     */
+    size_t getAbbreviationCount() const;
+    
+    /**
+     * 将频率量化为16位对数刻度
+     * @param frequency 原始频率
+     * @return 量化值
+     */
+    static uint16_t quantizeFrequency(uint32_t frequency);
+
+    /**
+     * 将量化值还原为频率
+     * @param quantized 量化值
+     * @return 近似频率
+     */
+    static uint32_t dequantizeFrequency(uint16_t quantized);
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> pImpl;
+};
+
+/**
+ * 二进制词典构建器
+ * 收集词条，去重并按音节ID序列分组排序后写出Lexicon文件
+ */
+class LexiconBuilder {
+public:
+    /**
+     * @param syllables 有序音节表，下标即音节ID
+     */
+    explicit LexiconBuilder(const std::vector<std::string>& syllables);
+    ~LexiconBuilder();
+
+    // 禁用拷贝和移动
+    LexiconBuilder(const LexiconBuilder&) = delete;
+    LexiconBuilder& operator=(const LexiconBuilder&) = delete;
+    LexiconBuilder(LexiconBuilder&&) = delete;
+    LexiconBuilder& operator=(LexiconBuilder&&) = delete;
+
+    /**
+     * 添加词条
+     * @param word 词汇
+     * @param syllables 音节序列
+     * @param frequency 频率
+     * @return 是否添加成功（音节无效时失败）
+     */
+    bool addEntry(const std::string& word, const std::vector<std::string>& syllables, uint32_t frequency);
+
+    /**
+     * 添加已编码为音节ID的词条
+     * @param word 词汇
+     * @param syllable_ids 音节ID序列
+     * @param frequency 频率
+     * @return 是否添加成功
+     */
+    bool addEncodedEntry(const std::string& word, const std::vector<uint16_t>& syllable_ids, uint32_t frequency);
+
+    /**
+     * 设置每个音节序列保留的最大条目数
+     * @param max_entries 最大条目数
+     */
+    void setMaxEntriesPerKey(size_t max_entries);
+
+    /**
+     * 设置简拼索引中每个首字母序列保留的最大条目数
+     * @param max_entries 最大条目数
+     */
+    void setMaxEntriesPerAbbreviation(size_t max_entries);
+    
+    /**
+     * 获取已添加的词条数量（去重前）
+     * @return 词条数量
+     */
+    size_t getEntryCount() const;
+
+    /**
+     * 写出词典文件
+     * @param path 输出路径
+     * @return 是否写出成功
+     */
+    bool write(const std::string& path) const;
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> pImpl;
+};
+
+} // namespace core
+} // namespace owcat
\ No newline at end of file
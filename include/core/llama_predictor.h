@@ -1,19 +1,55 @@
 #pragma once
 
+#include "types.h"
 #include <string>
 #include <vector>
 #include <memory>
+#include <unordered_map>
+#include <cstdint>
+#include <cstddef>
 
 namespace owcat {
 namespace core {
 
+/**
+ * 受拼音约束的生成结果
+ */
+struct ConstrainedPrediction {
+    std::string text;                   // 生成的汉字（UTF-8）
+    std::vector<uint16_t> syllable_ids; // 每个汉字对应的音节ID
+    float log_prob;                     // 生成各token的累计对数概率
+
+    ConstrainedPrediction() : log_prob(0.0f) {}
+};
+
+/**
+ * 推理吞吐量测量结果
+ */
+struct LlamaThroughput {
+    int prompt_tokens;      // prompt的token数
+    int generated_tokens;   // 实际解码的token数
+    double prefill_ms;      // prompt评估耗时（毫秒）
+    double decode_ms;       // 逐token解码耗时（毫秒）
+
+    LlamaThroughput() : prompt_tokens(0), generated_tokens(0), prefill_ms(0.0), decode_ms(0.0) {}
+};
+
 /**
  * Llama.cpp预测器
  * 封装llama.cpp库，提供AI预测功能
+ * 多个会话共享同一个llama上下文：每个会话占用一个序列，各会话同时提交的解码步骤合并进同一个batch
+ * 不同会话的调用可以并发，同一会话的调用串行执行
  */
 class LlamaPredictor {
 public:
-    explicit LlamaPredictor(const std::string& model_path);
+    // 可同时推理的会话数，会话0为默认会话
+    static constexpr int MAX_SESSIONS = 64;
+
+    /**
+     * @param model_path 模型文件路径
+     * @param config 推理配置（上下文大小、线程数、GPU offload等）
+     */
+    explicit LlamaPredictor(const std::string& model_path, const ModelConfig& config = ModelConfig());
     ~LlamaPredictor();
 
     // 禁用拷贝和移动
@@ -39,26 +75,114 @@ public:
      * @param max_tokens 最大生成token数
      * @param temperature 温度参数（控制随机性）
      * @param top_p 核采样参数
-     * @return 生成的文本列表
+     * @param is_cancelled 取消检查回调，每个token解码前调用，返回true时提前结束
+     * @param session 会话ID（0到MAX_SESSIONS-1）
+     * @return 生成的文本列表，被取消时为空
      */
     std::vector<std::string> generateText(
         const std::string& prompt,
         int max_tokens = 50,
         float temperature = 0.7f,
-        float top_p = 0.9f
+        float top_p = 0.9f,
+        const CancelCallback& is_cancelled = nullptr,
+        int session = 0
     ) const;
 
     /**
-     * 获取下一个词的概率分布
+     * 批量计算候选词接在上下文之后的对数概率
+     * 上下文只解码一次，各候选词从共享前缀分叉后在同一个batch中打分
      * @param context 上下文
      * @param candidates 候选词列表
-     * @return 每个候选词的概率
+     * @param session 会话ID
+     * @return 每个候选词的自然对数概率，无法打分时为-inf
      */
     std::vector<float> getNextWordProbabilities(
         const std::string& context,
-        const std::vector<std::string>& candidates
+        const std::vector<std::string>& candidates,
+        int session = 0
+    ) const;
+
+    /**
+     * 设置汉字读音表，并据此建立音节到词表token的索引
+     * 只有全部由已知读音汉字组成的token才能参与受约束的生成
+     * @param readings Unicode码点 -> 可能的音节ID
+     * @return 是否建立成功（模型未加载时失败）
+     */
+    bool setCharacterReadings(const std::unordered_map<uint32_t, std::vector<uint16_t>>& readings);
+
+    /**
+     * 受拼音约束的生成
+     * 每一步只允许读音与对应位置音节一致的汉字token，直到覆盖全部音节
+     * @param prompt 提示文本
+     * @param allowed_syllables 每个音节位置允许的音节ID（升序），末尾不完整音节可包含多个
+     * @param max_results 最大结果数量
+     * @param is_cancelled 取消检查回调
+     * @param session 会话ID
+     * @return 覆盖全部音节的生成结果，按对数概率降序
+     */
+    std::vector<ConstrainedPrediction> generateConstrained(
+        const std::string& prompt,
+        const std::vector<std::vector<uint16_t>>& allowed_syllables,
+        int max_results = 5,
+        const CancelCallback& is_cancelled = nullptr,
+        int session = 0
     ) const;
 
+    /**
+     * 设置推测解码的草稿短语（如高频词、用户词库），替换已有短语
+     * 开启推测解码（ModelConfig::speculative_tokens > 0）时，
+     * 自由生成每步从会话已有内容和这些短语中查找n-gram延续作为草稿，在一次解码中批量验证
+     * @param phrases 短语列表
+     */
+    void setDraftPhrases(const std::vector<std::string>& phrases);
+
+    /**
+     * 追加一条草稿短语，如用户刚提交的文本
+     * @param phrase 短语
+     */
+    void addDraftPhrase(const std::string& phrase);
+
+    /**
+     * 释放会话在KV缓存中占用的空间
+     * 会话结束时调用；之后仍可继续使用该会话ID，prompt会重新评估
+     * @param session 会话ID
+     */
+    void releaseSession(int session);
+
+    /**
+     * 设置每个会话最多占用的KV单元数
+     * 上下文容量不足时淘汰最久未用的空闲会话的缓存
+     * @param tokens KV单元数，0表示使用默认值（上下文大小的一半）
+     */
+    void setSessionKvBudget(size_t tokens);
+
+    /**
+     * 测量prompt评估与逐token解码的吞吐量
+     * 使用默认会话并清空其KV缓存
+     * @param prompt 提示文本
+     * @param decode_tokens 解码的token数
+     * @param result 输出测量结果
+     * @return 是否测量成功（模型未加载时失败）
+     */
+    bool measureThroughput(const std::string& prompt, int decode_tokens, LlamaThroughput& result);
+
+    /**
+     * 自动调优推理线程数
+     * 对若干线程数分别测量prompt评估与逐token解码的每token耗时，两者各自选用最快的设置
+     * 结果按模型文件、上下文大小、GPU层数和CPU核心数缓存，之后直接读取缓存
+     * 会清空默认会话的KV缓存，应在开始预测前调用
+     * @param cache_path 调优结果缓存文件，为空时不缓存
+     * @return 是否应用了调优结果（模型未加载或测量失败时为false）
+     */
+    bool autoTune(const std::string& cache_path);
+
+    /**
+     * 限制推理线程数，在配置或调优得到的线程数上取较小值，不改变调优结果
+     * 可在预测进行中调用，从下一次解码起生效
+     * @param max_threads 最大线程数，0表示不限制
+     */
+    void setThreadLimit(int max_threads);
+    
     /**
      * 计算文本的困惑度
      * @param text 文本
@@ -88,6 +212,7 @@ public:
 
     /**
      * 预热模型（进行一次推理以加载到GPU内存）
+     * initialize()不再自动预热，调用方可在后台线程中单独调用
      * @return 是否预热成功
      */
     bool warmup();
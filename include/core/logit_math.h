@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace owcat {
+namespace core {
+
+/**
+ * 一个token及其logit
+ */
+struct TokenLogit {
+    int32_t id;
+    float logit;
+};
+
+/*
+ * 词表上的logit运算
+ * AI预测每生成或打分一个token都要在整个词表（Qwen约15万项）上执行这些运算，
+ * 按编译目标选择AVX2、SSE2或NEON实现，没有SIMD时使用标量实现
+ */
+
+/**
+ * 求最大logit
+ * @param logits logit数组
+ * @param size 元素数，必须大于0
+ * @return 最大值
+ */
+float maxLogit(const float* logits, size_t size);
+
+/**
+ * 求log(Σexp(logits[i]))，单个token的对数概率即logits[t] - logSumExp()，无需计算整个softmax
+ * @param logits logit数组
+ * @param size 元素数，必须大于0
+ * @return 对数配分函数
+ */
+float logSumExp(const float* logits, size_t size);
+
+/**
+ * 选出logit最大的k个token
+ * 扫描时只把超过当前门限的token放入out，out满时用nth_element压缩回k项并提高门限；
+ * out作为调用方复用的暂存区，容量在调用间保留，稳定后不再分配内存
+ * @param logits logit数组
+ * @param size 元素数
+ * @param k 保留的token数，为0或不小于size时按下标顺序返回全部token
+ * @param out 输出，k有效时按logit降序排列
+ * @return 写入的token数
+ */
+size_t selectTopK(const float* logits, size_t size, size_t k, std::vector<TokenLogit>& out);
+
+/**
+ * 在已有的token列表中保留logit最大的k个，并按logit降序排列
+ * @param items token列表
+ * @param k 保留的token数，为0时保留全部
+ * @return 保留的token数
+ */
+size_t selectTopK(std::vector<TokenLogit>& items, size_t k);
+
+/**
+ * 获取当前编译使用的实现名称，用于日志
+ * @return "avx2"、"sse2"、"neon"或"scalar"
+ */
+const char* logitKernelName();
+
+} // namespace core
+} // namespace owcat
\ No newline at end of file
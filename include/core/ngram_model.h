@@ -0,0 +1,155 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+namespace owcat {
+namespace core {
+
+/**
+ * 只读二进制n-gram词语言模型（一元到三元，Katz回退）
+ * 由词典编译器根据语料生成，以内存映射方式加载；词ID是词在有序词表中的下标
+ *
+ * 文件布局（小端，4字节对齐）：
+ *   Header | 词表 | 一元表 | 二元区间索引 | 二元表 | 三元表
+ */
+class NgramModel {
+public:
+    static constexpr uint32_t kMagic = 0x474e574f;  // "OWNG"
+    static constexpr uint32_t kVersion = 1;
+    static constexpr uint32_t kNoWord = UINT32_MAX;  // 无上下文或词表外的词
+
+    NgramModel();
+    ~NgramModel();
+
+    // 禁用拷贝和移动
+    NgramModel(const NgramModel&) = delete;
+    NgramModel& operator=(const NgramModel&) = delete;
+    NgramModel(NgramModel&&) = delete;
+    NgramModel& operator=(NgramModel&&) = delete;
+
+    /**
+     * 打开并映射模型文件
+     * @param path 模型文件路径
+     * @return 是否打开成功
+     */
+    bool open(const std::string& path);
+
+    /**
+     * 关闭模型并解除映射
+     */
+    void close();
+
+    /**
+     * 检查模型是否已打开
+     * @return 是否已打开
+     */
+    bool isOpen() const;
+
+    /**
+     * 查找词ID
+     * @param text 词汇文本（UTF-8）
+     * @return 词ID，不在词表中时返回kNoWord
+     */
+    uint32_t findWord(std::string_view text) const;
+
+    /**
+     * 获取句首标记的词ID，作为第一个词的上下文
+     * @return 句首词ID
+     */
+    uint32_t sentenceBegin() const;
+
+    /**
+     * 计算条件对数概率 ln P(word | prev2 prev1)，缺少的高阶n-gram按回退权重降阶
+     * @param prev2 前第二个词，kNoWord表示无
+     * @param prev1 前一个词，kNoWord表示无
+     * @param word 当前词，kNoWord时返回词表外词的对数概率
+     * @return 自然对数概率
+     */
+    float logProb(uint32_t prev2, uint32_t prev1, uint32_t word) const;
+
+    /**
+     * 获取词表大小（不含句首标记）
+     * @return 词数量
+     */
+    size_t getWordCount() const;
+
+    /**
+     * 获取二元组数量
+     * @return 二元组数量
+     */
+    size_t getBigramCount() const;
+
+    /**
+     * 获取三元组数量
+     * @return 三元组数量
+     */
+    size_t getTrigramCount() const;
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> pImpl;
+};
+
+/**
+ * n-gram模型构建器
+ * 先添加词表（带先验频率），再逐行统计语料，最后估计回退概率并写出NgramModel文件
+ */
+class NgramModelBuilder {
+public:
+    NgramModelBuilder();
+    ~NgramModelBuilder();
+
+    // 禁用拷贝和移动
+    NgramModelBuilder(const NgramModelBuilder&) = delete;
+    NgramModelBuilder& operator=(const NgramModelBuilder&) = delete;
+    NgramModelBuilder(NgramModelBuilder&&) = delete;
+    NgramModelBuilder& operator=(NgramModelBuilder&&) = delete;
+
+    /**
+     * 添加词表中的词，重复添加时累加频率
+     * 必须在addText()之前添加完整的词表
+     * @param word 词汇
+     * @param frequency 词典频率，作为一元概率的先验
+     * @return 是否添加成功
+     */
+    bool addWord(const std::string& word, uint32_t frequency);
+
+    /**
+     * 统计一行语料
+     * 以空白分隔的词直接计数，未分词的文本按词表正向最大匹配切分；
+     * 词表外的字符（如标点）截断n-gram，其后的词重新以句首为上下文
+     * @param line 一行语料（UTF-8）
+     * @return 计入的词数量
+     */
+    size_t addText(std::string_view line);
+
+    /**
+     * 获取词表大小
+     * @return 词数量
+     */
+    size_t getWordCount() const;
+
+    /**
+     * 获取已统计的语料词数
+     * @return 词数量
+     */
+    uint64_t getTokenCount() const;
+
+    /**
+     * 写出模型文件
+     * @param path 输出路径
+     * @return 是否写出成功
+     */
+    bool write(const std::string& path) const;
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> pImpl;
+};
+
+} // namespace core
+} // namespace owcat
\ No newline at end of file
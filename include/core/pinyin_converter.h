@@ -1,16 +1,32 @@
 #pragma once
 
 #include "types.h"
+#include "double_pinyin.h"
 #include <string>
 #include <vector>
-#include <map>
+#include <string_view>
+#include <cstdint>
 
 namespace owcat {
 namespace core {
 
+/**
+ * 拼音分割方案
+ * 分割网格中的一条路径，末尾可能是尚未输入完整的音节，中间可能是只输入了声母的简拼
+ */
+struct PinyinSegmentation {
+    std::vector<std::string> syllables;     // 音节序列，简拼音节只有声母
+    std::vector<int> syllable_ids;          // 音节ID，简拼和未完整的末尾音节为-1
+    double score;                           // 路径得分（音节对数概率之和）
+    bool complete;                          // 是否所有音节都完整（没有简拼也没有未完整的末尾音节）
+
+    PinyinSegmentation() : score(0.0), complete(true) {}
+};
+
 /**
  * 拼音转换器
  * 负责将键盘输入转换为拼音，并提供拼音分割功能
+ * 全拼输入在按键级的分割网格上分割；双拼输入每两个键查表得到一个音节，只有唯一的分割
  */
 class PinyinConverter {
 public:
@@ -25,13 +41,13 @@ public:
 
     /**
      * 添加字符到当前拼音缓冲区
-     * @param ch 输入字符
+     * @param ch 输入字符，双拼方案下还可以是 ';'
      * @return 是否添加成功
      */
     bool addChar(char ch);
 
     /**
-     * 删除最后一个字符
+     * 删除最后一个字符（双拼方案下为最后一个按键）
      * @return 是否删除成功
      */
     bool removeLastChar();
@@ -43,16 +59,50 @@ public:
 
     /**
      * 获取当前拼音字符串
+     * 双拼方案下为解码后的全拼，末尾只输入了一个键时为其声母
      * @return 拼音字符串
      */
     const std::string& getCurrentPinyin() const;
 
     /**
-     * 获取所有可能的拼音分割方案
-     * @return 拼音分割方案列表
+     * 获取得分最高的完整拼音分割方案
+     * @return 拼音分割方案列表，最多kMaxLatticePaths个
      */
     std::vector<std::vector<std::string>> getPinyinSegments() const;
 
+    /**
+     * 从分割网格中获取得分最高的N条路径
+     * 当前输入无法完整分割时，末尾音节以前缀形式给出
+     * @param max_paths 最大路径数量（不超过kMaxLatticePaths）
+     * @return 按得分降序排列的分割方案
+     */
+    std::vector<PinyinSegmentation> getBestSegmentations(size_t max_paths = 1) const;
+
+    /**
+     * 设置音节的对数概率，用于分割路径打分
+     * @param log_probs 按音节ID索引的对数概率，为空时恢复均匀分布
+     */
+    void setSyllableLogProbs(const std::vector<float>& log_probs);
+
+    /**
+     * 设置是否允许简拼：声母（如 "zgr"、"zhongg r" 中的 g r）可以代替完整音节
+     * @param enabled 是否允许
+     */
+    void setAbbreviationEnabled(bool enabled);
+    
+    /**
+     * 设置双拼方案，切换方案会清空当前输入
+     * @param scheme 方案名（microsoft、xiaohe、ziranma），为空时使用全拼
+     * @return 是否设置成功，方案不存在时保持原方案
+     */
+    bool setDoublePinyinScheme(std::string_view scheme);
+    
+    /**
+     * 检查是否使用双拼输入
+     * @return 是否使用双拼
+     */
+    bool isDoublePinyin() const;
+    
     /**
      * 验证拼音是否有效
      * @param pinyin 拼音字符串
@@ -74,6 +124,87 @@ public:
      */
     std::string normalizePinyin(const std::string& pinyin) const;
 
+    /**
+     * 获取音节ID（音节在有序音节表中的下标）
+     * @param syllable 音节字符串
+     * @return 音节ID，无效音节返回-1
+     */
+    int getSyllableId(std::string_view syllable) const;
+
+    /**
+     * 根据音节ID获取音节字符串
+     * @param syllable_id 音节ID
+     * @return 音节字符串，ID无效时返回空字符串
+     */
+    const std::string& getSyllable(int syllable_id) const;
+
+    /**
+     * 获取音节表大小
+     * @return 音节数量
+     */
+    size_t getSyllableCount() const;
+
+    // 分割网格中每个位置保留的最优路径数
+    static constexpr size_t kMaxLatticePaths = 8;
+
+private:
+    // 音节字典树节点，子树内的音节在有序音节表中占据连续区间 [range_begin, range_end)
+    struct TrieNode {
+        int16_t children[26];
+        int16_t syllable_id;
+        uint8_t depth;
+        bool is_initial;            // 是否为声母（b p m f ... zh ch sh），可作简拼音节
+        uint16_t range_begin;
+        uint16_t range_end;
+    };
+
+    // 网格中简拼边的音节ID
+    static constexpr int16_t kAbbreviatedSyllable = -2;
+    
+    // 一个音节内最多6个字母，因此同一位置上最多只有6个活跃节点
+    static constexpr size_t kMaxActiveNodes = 8;
+
+    // 每次按键后的匹配状态：当前位置所有可能处于的字典树节点
+    struct MatchState {
+        uint8_t count;
+        int16_t nodes[kMaxActiveNodes];
+    };
+
+    // 网格中的一条部分路径，通过 prev_pos/prev_rank 回溯
+    struct LatticeEntry {
+        float score;
+        uint16_t prev_pos;
+        uint8_t prev_rank;
+        int16_t syllable_id;
+    };
+
+    // 网格列：以某个字节位置结尾的前N条完整音节路径，按得分降序
+    struct LatticeColumn {
+        uint8_t count;
+        LatticeEntry entries[kMaxLatticePaths];
+    };
+
+    /**
+     * 构建音节字典树
+     */
+    void buildSyllableTrie();
+
+    /**
+     * 沿字典树匹配字符串
+     * @param text 字符串
+     * @return 匹配到的节点下标，不存在时返回-1
+     */
+    int findNode(std::string_view text) const;
+
+    /**
+     * 计算输入一个字符后的匹配状态
+     * @param state 当前状态
+     * @param ch 输入字符
+     * @param next 输出的新状态
+     * @return 新状态是否非空
+     */
+    bool advanceState(const MatchState& state, char ch, MatchState& next) const;
+
 private:
     /**
      * 加载拼音数据
@@ -82,24 +213,48 @@ private:
     bool loadPinyinData();
 
     /**
-     * 递归分割拼音
-     * @param pinyin 待分割的拼音
-     * @param start 起始位置
-     * @param current 当前分割结果
-     * @param results 所有分割结果
+     * 根据新的匹配状态计算网格的下一列
+     * @param state 输入字符后的匹配状态
+     * @param column 输出的网格列
+     */
+    void extendLattice(const MatchState& state, LatticeColumn& column) const;
+
+    /**
+     * 获取音节的对数概率
+     * @param syllable_id 音节ID
+     * @return 对数概率
+     */
+    float syllableLogProb(int syllable_id) const;
+
+    /**
+     * 双拼方案下添加一个按键
+     * @param key 按键
+     * @return 是否添加成功
+     */
+    bool addDoublePinyinKey(char key);
+    
+    /**
+     * 双拼方案下的唯一分割方案
+     * @return 分割方案
+     */
+    PinyinSegmentation getDoublePinyinSegmentation() const;
+    
+    /**
+     * 用当前设置重新输入已有的按键
      */
-    void segmentPinyinRecursive(
-        const std::string& pinyin,
-        size_t start,
-        std::vector<std::string>& current,
-        std::vector<std::vector<std::string>>& results
-    ) const;
+    void rebuild();
 
 private:
     std::string current_pinyin_;                    // 当前拼音缓冲区
-    std::vector<std::string> valid_pinyins_;        // 有效拼音列表
-    std::map<std::string, bool> pinyin_map_;        // 拼音映射表
-    std::map<char, bool> valid_chars_;              // 有效字符映射
+    std::vector<std::string> valid_pinyins_;        // 有效拼音列表（有序，下标即音节ID）
+    std::vector<TrieNode> trie_nodes_;              // 音节字典树，0号为根节点
+    std::vector<MatchState> match_states_;          // 每个按键后的匹配状态栈
+    std::vector<LatticeColumn> lattice_;            // 分割网格，第i列对应前i个字符
+    std::vector<float> syllable_log_probs_;         // 音节对数概率
+    bool abbreviation_enabled_;                     // 是否允许简拼
+    DoublePinyin double_pinyin_;                    // 双拼键位表，未加载时为全拼输入
+    std::string double_pinyin_keys_;                // 双拼方案下的原始按键
+    std::vector<uint16_t> double_pinyin_syllables_; // 双拼方案下已解码的音节ID
 };
 
 } // namespace core
@@ -0,0 +1,117 @@
+#pragma once
+
+#include "types.h"
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <cstdint>
+
+namespace owcat {
+namespace core {
+
+/**
+ * 缓存的一条模型输出
+ * 只保存文本和拼音，得分在命中时按当前的用户习惯和阈值重新计算
+ */
+struct CachedPrediction {
+    std::string text;       // 预测的汉字
+    std::string pinyin;     // 拼音
+
+    CachedPrediction() = default;
+    CachedPrediction(const std::string& t, const std::string& p) : text(t), pinyin(p) {}
+};
+
+/**
+ * 预测结果LRU缓存
+ * 以（拼音、上下文、结果数）的64位哈希为键，命中时再比较原始键排除哈希冲突
+ * 可持久化到磁盘，文件记录模型标识，模型变化后的旧文件不会被加载
+ * 所有方法都是线程安全的
+ */
+class PredictionCache {
+public:
+    /**
+     * @param capacity 最大条目数，0表示禁用
+     */
+    explicit PredictionCache(size_t capacity = 0);
+
+    /**
+     * 设置最大条目数，超出的最久未用条目被淘汰
+     * @param capacity 最大条目数，0表示禁用
+     */
+    void setCapacity(size_t capacity);
+
+    /**
+     * 查找缓存的模型输出，命中时更新为最近使用
+     * @param pinyin 拼音序列
+     * @param context 上下文
+     * @param max_results 请求的结果数
+     * @param results 输出缓存的模型输出
+     * @return 是否命中
+     */
+    bool lookup(const std::string& pinyin, const std::string& context, int max_results,
+                std::vector<CachedPrediction>& results);
+
+    /**
+     * 插入或替换一条缓存
+     * @param pinyin 拼音序列
+     * @param context 上下文
+     * @param max_results 请求的结果数
+     * @param results 模型输出
+     */
+    void insert(const std::string& pinyin, const std::string& context, int max_results,
+                std::vector<CachedPrediction> results);
+
+    /**
+     * 清空缓存（统计计数保留）
+     */
+    void clear();
+
+    /**
+     * 从文件加载缓存，模型标识不一致或文件损坏时不加载
+     * @param path 缓存文件路径
+     * @param model_id 当前模型标识
+     * @return 是否加载成功
+     */
+    bool load(const std::string& path, const std::string& model_id);
+
+    /**
+     * 把缓存写入文件，自上次加载或保存后没有变化时跳过
+     * @param path 缓存文件路径
+     * @param model_id 当前模型标识
+     * @return 是否写入成功（无需写入时也返回true）
+     */
+    bool save(const std::string& path, const std::string& model_id);
+
+    /**
+     * 获取缓存统计
+     * @return 统计信息
+     */
+    PredictionCacheStats getStats() const;
+
+private:
+    struct Entry {
+        uint64_t key;
+        std::string pinyin;
+        std::string context;
+        int max_results;
+        std::vector<CachedPrediction> results;
+    };
+
+    static uint64_t hashKey(const std::string& pinyin, const std::string& context, int max_results);
+
+    void insertLocked(Entry entry);
+    void evictLocked();
+
+    std::list<Entry> entries_;      // 最近使用的在前
+    std::unordered_map<uint64_t, std::list<Entry>::iterator> index_;
+    size_t capacity_;
+    bool dirty_;
+    uint64_t hits_;
+    uint64_t misses_;
+    mutable std::mutex mutex_;
+};
+
+} // namespace core
+} // namespace owcat
\ No newline at end of file
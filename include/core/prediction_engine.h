@@ -1,6 +1,7 @@
 #pragma once
 
 #include "types.h"
+#include "prediction_governor.h"
 #include <string>
 #include <vector>
 #include <memory>
@@ -16,7 +17,13 @@ class LlamaPredictor;
  */
 class PredictionEngine {
 public:
-    explicit PredictionEngine(const std::string& model_path = "");
+    /**
+     * @param model_path 模型文件路径
+     * @param lexicon_path 系统词典路径，提供汉字读音用于受拼音约束的生成
+     * @param model_config 模型推理配置
+     */
+    explicit PredictionEngine(const std::string& model_path = "", const std::string& lexicon_path = "",
+                              const ModelConfig& model_config = ModelConfig());
     ~PredictionEngine();
 
     // 禁用拷贝和移动
@@ -26,7 +33,8 @@ public:
     PredictionEngine& operator=(PredictionEngine&&) = delete;
 
     /**
-     * 初始化预测引擎
+     * 初始化预测引擎：加载模型、建立读音约束、按配置自动调优并预热
+     * 耗时较长，可在后台线程中调用；完成前isAvailable()返回false
      * @return 是否初始化成功
      */
     bool initialize();
@@ -36,6 +44,20 @@ public:
      */
     void shutdown();
 
+    /**
+     * 申请一个预测会话
+     * 各会话共享同一个模型，在同一个推理上下文中并行推理并拥有独立的KV缓存
+     * 可在模型加载完成前调用；会话0保留给不申请会话的调用者
+     * @return 会话ID，会话已满时返回-1
+     */
+    int openSession();
+
+    /**
+     * 释放预测会话及其KV缓存
+     * @param session openSession()返回的会话ID
+     */
+    void closeSession(int session);
+
     /**
      * 基于上下文预测下一个词
      * @param context 上下文文本
@@ -62,14 +84,50 @@ public:
      * @param pinyin 拼音输入
      * @param context 上下文
      * @param max_predictions 最大预测数量
-     * @return 预测候选词列表
+     * @param is_cancelled 取消检查回调，解码过程中返回true时放弃本次预测
+     * @param session 预测会话ID，不同会话可在不同线程中并发调用
+     * @return 预测候选词列表，被取消时为空
      */
     CandidateList predictFromPinyin(
         const std::string& pinyin,
         const std::string& context = "",
-        int max_predictions = 5
+        int max_predictions = 5,
+        const CancelCallback& is_cancelled = nullptr,
+        int session = 0
     ) const;
 
+    /**
+     * 在前文之后给候选词打分，前文只解码一次，所有候选词在同一个batch中计算
+     * @param context 前文
+     * @param candidates 候选词文本
+     * @param session 预测会话ID
+     * @return 每个候选词的自然对数概率，模型不可用时为空，无法打分的候选词为-inf
+     */
+    std::vector<float> scoreCandidates(
+        const std::string& context,
+        const std::vector<std::string>& candidates,
+        int session = 0
+    ) const;
+    
+    /**
+     * 设置系统负载采样回调，预测调节器按CPU占用和电池状态减少模型调用
+     * @param provider 采样回调，为空时只按预测延迟调节
+     */
+    void setSystemLoadProvider(SystemLoadProvider provider);
+    
+    /**
+     * 更新预测调节配置
+     * @param config 调节配置
+     */
+    void setGovernorConfig(const PredictionGovernorConfig& config);
+    
+    /**
+     * 获取当前允许的预测资源，predictFromPinyin()在级别为OFF时不运行模型
+     * 调用方可据此跳过整个预测请求或额外的模型打分
+     * @return 预测资源
+     */
+    PredictionBudget getBudget() const;
+    
     /**
      * 学习用户输入模式
      * @param input_sequence 输入序列
@@ -98,8 +156,8 @@ public:
     double getPredictionThreshold() const;
 
     /**
-     * 检查预测引擎是否可用
-     * @return 是否可用
+     * 检查预测引擎是否可用，可在任意线程调用
+     * @return 模型已加载并预热完成时为true
      */
     bool isAvailable() const;
 
@@ -108,6 +166,17 @@ public:
      * @return 模型信息字符串
      */
     std::string getModelInfo() const;
+    
+    /**
+     * 获取预测结果缓存统计
+     * @return 统计信息
+     */
+    PredictionCacheStats getCacheStats() const;
+    
+    /**
+     * 清空预测结果缓存
+     */
+    void clearCache();
 
 private:
     /**
@@ -0,0 +1,113 @@
+#pragma once
+
+#include "types.h"
+#include <chrono>
+#include <mutex>
+
+namespace owcat {
+namespace core {
+
+// 预测级别，越往后模型调用越少
+enum class PredictionLevel {
+    FULL,       // 不限制
+    REDUCED,    // 减半线程和生成长度，不做模型重排
+    MINIMAL,    // 单线程，只生成一个候选
+    OFF         // 不调用模型，只使用词库和n-gram候选
+};
+
+// 一次预测可以使用的资源
+struct PredictionBudget {
+    PredictionLevel level = PredictionLevel::FULL;
+    int thread_limit = 0;           // 推理线程上限，0表示不限制
+    int max_predictions = 0;        // 预测候选数上限，0表示不限制
+    double token_scale = 1.0;       // 自由生成的token数按此比例缩减
+    bool allow_rerank = true;       // 是否允许用模型给候选词重排
+};
+
+/**
+ * AI预测调节器
+ * 按模型预测延迟的滑动平均、系统CPU占用和电池状态决定预测级别：
+ * 每项超出阈值降一级（延迟超过目标两倍时降两级），使用电池且电量过低时直接停止调用模型；
+ * 降级立即生效，恢复时每次采样最多升一级，且需要连续几次采样都满足条件，避免来回切换
+ * 系统负载按配置的间隔在getBudget()中采样，可在任意线程调用
+ */
+class PredictionGovernor {
+public:
+    // 连续满足恢复条件的采样次数
+    static constexpr int kRecoverySamples = 3;
+
+    explicit PredictionGovernor(const PredictionGovernorConfig& config = PredictionGovernorConfig());
+
+    /**
+     * 更新配置，恢复为FULL级别
+     * @param config 调节配置
+     */
+    void setConfig(const PredictionGovernorConfig& config);
+
+    /**
+     * 设置系统负载采样回调，通常由平台层的系统集成工具提供
+     * @param provider 采样回调，为空时只按预测延迟调节
+     */
+    void setSystemLoadProvider(SystemLoadProvider provider);
+
+    /**
+     * 记录一次模型预测的耗时（不含缓存命中）
+     * @param milliseconds 耗时（毫秒）
+     */
+    void recordLatency(double milliseconds);
+
+    /**
+     * 获取当前的预测资源，到达采样间隔时先采样系统负载并更新级别
+     * @return 预测资源
+     */
+    PredictionBudget getBudget();
+
+    /**
+     * 获取当前级别，不采样
+     * @return 预测级别
+     */
+    PredictionLevel getLevel() const;
+
+    /**
+     * 获取最近一次采样的系统负载
+     * @return 系统负载
+     */
+    SystemLoad getSystemLoad() const;
+
+    /**
+     * 获取级别名称，用于日志
+     * @param level 预测级别
+     * @return 名称
+     */
+    static const char* levelName(PredictionLevel level);
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * 采样系统负载并更新级别，调用方持有mutex_
+     */
+    void updateLocked(Clock::time_point now);
+
+    /**
+     * 按当前的延迟和负载计算目标级别，调用方持有mutex_
+     */
+    PredictionLevel targetLevelLocked() const;
+
+    PredictionBudget budgetFor(PredictionLevel level) const;
+
+    PredictionGovernorConfig config_;
+    SystemLoadProvider provider_;
+    SystemLoad load_;
+    bool load_valid_;
+    double latency_ms_;             // 预测耗时的指数滑动平均，0表示尚无记录
+    PredictionLevel level_;
+    int recovery_count_;            // 连续低于当前级别的采样次数
+    Clock::time_point last_sample_;
+    bool sampled_;
+    int hardware_threads_;
+    mutable std::mutex mutex_;
+};
+
+} // namespace core
+} // namespace owcat
\ No newline at end of file
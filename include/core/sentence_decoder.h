@@ -0,0 +1,144 @@
+#pragma once
+
+#include "lexicon.h"
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+
+namespace owcat {
+namespace core {
+
+class NgramModel;
+
+/**
+ * 整句解码结果
+ */
+struct DecodedSentence {
+    std::string text;       // 整句文本
+    std::string pinyin;     // 各词的完整拼音，音节以空格分隔
+    float log_prob;         // 语言模型对数概率
+    size_t word_count;      // 组成整句的词数
+
+    DecodedSentence() : log_prob(0.0f), word_count(0) {}
+};
+
+/**
+ * 整句解码器
+ * 在音节序列上用系统词典构建词网格，按n-gram语言模型做柱搜索的Viterbi解码
+ * 解码是增量的：第p列只依赖前p个音节，连续两次解码的公共音节前缀部分直接复用，
+ * 追加音节只计算新的列，删除音节只丢弃末尾的列，每次按键的开销与输入长度无关
+ * 所有缓冲区在解码之间复用；只能在单个线程中使用，每个输入会话各持有一个
+ */
+class SentenceDecoder {
+public:
+    /**
+     * @param lexicon 系统词典，提供每段音节对应的词
+     * @param model n-gram语言模型
+     */
+    SentenceDecoder(const Lexicon& lexicon, const NgramModel& model);
+
+    /**
+     * 解码音节序列
+     * @param syllables 音节序列
+     * @param last_is_prefix 末尾音节是否未输入完整（按前缀匹配）
+     * @param max_results 最大结果数
+     * @param out 输出按概率降序排列的整句，文本相同的只保留最优
+     * @return 结果数量，词典或模型未打开时为0
+     */
+    size_t decode(const std::vector<std::string>& syllables, bool last_is_prefix, size_t max_results,
+                  std::vector<DecodedSentence>& out);
+
+    /**
+     * 计算与上次解码可复用的音节数，用于在多个解码器中选择状态最接近的一个
+     * @param syllables 音节序列
+     * @param last_is_prefix 末尾音节是否未输入完整
+     * @return 可复用的音节数
+     */
+    size_t sharedPrefix(const std::vector<std::string>& syllables, bool last_is_prefix) const;
+
+    /**
+     * 丢弃保存的解码状态，词典或模型重新打开后必须调用
+     */
+    void reset();
+
+    // 单个词最多覆盖的音节数
+    static constexpr size_t kMaxWordSyllables = 8;
+
+    // 每段音节保留的最高频词数
+    static constexpr size_t kMaxSpanWords = 8;
+
+    // 每个位置保留的最优部分路径数
+    static constexpr size_t kBeamWidth = 8;
+
+    // 最多解码的音节数，更长的输入只解码前面部分
+    static constexpr size_t kMaxSyllables = 64;
+
+private:
+    // 词网格中的一个词
+    struct LatticeWord {
+        std::string_view text;
+        const uint16_t* syllable_ids;
+        uint16_t syllable_count;
+        uint32_t word_id;           // n-gram词ID，词表外为NgramModel::kNoWord
+    };
+
+    // 部分路径，通过 prev_pos/prev_rank 回溯
+    struct PathEntry {
+        float score;
+        uint32_t prev1;             // 最后一个词的n-gram词ID
+        uint32_t prev2;             // 倒数第二个词的n-gram词ID
+        uint32_t word;              // 最后一个词在words_中的下标
+        uint16_t prev_pos;
+        uint8_t prev_rank;
+    };
+
+    // 以某个音节位置结尾的最优部分路径，按得分降序
+    struct BeamColumn {
+        uint8_t count;
+        PathEntry entries[kBeamWidth];
+    };
+
+    /**
+     * 把音节序列转换为音节ID，未输入完整的末尾音节记为kPrefixSyllable
+     * @return 所有完整音节是否有效
+     */
+    bool encodeSyllables(const std::vector<std::string>& syllables, bool last_is_prefix,
+                         std::vector<uint16_t>& ids) const;
+
+    /**
+     * 收集以end结尾的各段音节对应的词，追加到words_
+     */
+    void addSpans(const std::vector<std::string>& syllables, size_t end, bool last_is_prefix);
+
+    /**
+     * 由以end结尾的各段词和之前各列计算第end列
+     */
+    void extendColumn(size_t end);
+
+    /**
+     * 把路径插入列中，保持按得分降序并丢弃超出柱宽的路径
+     */
+    static void insertPath(BeamColumn& column, const PathEntry& entry);
+
+    // 未输入完整的音节，不与任何音节相等，因此所在列不会被复用
+    static constexpr uint16_t kPrefixSyllable = UINT16_MAX;
+
+private:
+    const Lexicon& lexicon_;
+    const NgramModel& model_;
+
+    // 按结尾位置排列的词网格，(end, length) 对应的词区间为
+    // [span_begin_[(end - 1) * kMaxWordSyllables + length - 1], 下一项)
+    std::vector<LatticeWord> words_;
+    std::vector<uint32_t> span_begin_;
+    std::vector<BeamColumn> beam_;
+    std::vector<uint16_t> ids_;             // 上次解码的音节ID，即已计算各列的依据
+    std::vector<uint16_t> next_ids_;
+    std::vector<LexiconEntry> entries_;     // 词典查询结果缓冲区
+    std::vector<uint32_t> backtrack_;
+    std::string query_;
+};
+
+} // namespace core
+} // namespace owcat
\ No newline at end of file
@@ -4,6 +4,7 @@
 #include <vector>
 #include <memory>
 #include <functional>
+#include <cstdint>
 
 namespace owcat {
 namespace core {
@@ -39,7 +40,9 @@ enum class InputEventType {
     KEY_RELEASE,
     CANDIDATE_SELECT,
     COMMIT_TEXT,
-    CLEAR_COMPOSITION
+    CLEAR_COMPOSITION,
+    RESET_CONTEXT,      // 输入焦点切换到其他输入框，清空提交历史
+    SWITCH_PROFILE      // 按data中的应用标识切换应用配置
 };
 
 // 输入事件
@@ -60,14 +63,106 @@ using CandidateCallback = std::function<void(const CandidateList&)>;
 using CommitCallback = std::function<void(const std::string&)>;
 using StateChangeCallback = std::function<void(InputState)>;
 
+// 取消检查回调，返回true表示当前任务已过期应尽快停止
+using CancelCallback = std::function<bool()>;
+
+// 候选词缓存统计
+struct CandidateCacheStats {
+    uint64_t hits = 0;          // 完全命中（如退格回到之前的输入）
+    uint64_t refinements = 0;   // 由较短输入的缓存结果筛选得到
+    uint64_t misses = 0;        // 需要查询词库
+    size_t entries = 0;         // 当前缓存条目数
+    size_t capacity = 0;        // 缓存容量
+};
+
+// 预测结果缓存统计
+struct PredictionCacheStats {
+    uint64_t hits = 0;          // 无需运行模型直接返回
+    uint64_t misses = 0;
+    size_t entries = 0;
+    size_t capacity = 0;
+};
+
+// 系统负载采样
+struct SystemLoad {
+    double cpu_load = 0.0;          // 所有核心的平均占用率（0-1）
+    bool on_battery = false;        // 是否使用电池供电
+    int battery_percent = -1;       // 剩余电量百分比，-1表示未知或没有电池
+};
+
+// 系统负载采样回调，返回false表示无法采样
+using SystemLoadProvider = std::function<bool(SystemLoad&)>;
+
+// AI预测的功耗与延迟调节配置
+struct PredictionGovernorConfig {
+    bool enabled = true;
+    double target_latency_ms = 150.0;   // 模型预测延迟（滑动平均）的目标，超过时降级
+    double high_cpu_load = 0.85;        // 系统CPU占用高于此值时降级
+    bool reduce_on_battery = true;      // 使用电池时降一级
+    int low_battery_percent = 20;       // 使用电池且电量低于此值时不再调用模型
+    int sample_interval_ms = 1000;      // 系统负载采样间隔
+};
+
+// 预测模型推理配置
+struct ModelConfig {
+    int context_size = 2048;        // 上下文token数，所有预测会话共享
+    int prefill_threads = 0;        // prompt评估（多token batch）线程数，0表示自动
+    int decode_threads = 0;         // 逐token解码线程数，0表示自动
+    int gpu_layers = 0;             // offload到GPU的层数，-1表示全部，0表示纯CPU
+    int main_gpu = 0;               // 多GPU时使用的设备序号
+    bool use_mmap = true;
+    bool use_mlock = false;         // 锁定模型内存，避免被换出后首次预测卡顿
+    int speculative_tokens = 0;     // 推测解码每步最多验证的n-gram草稿token数，0表示关闭
+    bool auto_tune = false;         // 首次加载时测量不同线程数并选用延迟最低的设置
+    std::string tune_cache_path = "data/model_tune.json";  // 自动调优结果缓存
+    int prediction_cache_size = 1024;   // 预测结果LRU缓存条目数，0表示禁用
+    std::string prediction_cache_path = "data/prediction_cache.json";  // 预测结果持久化文件，为空时不持久化
+    PredictionGovernorConfig governor;  // 按预测延迟、系统负载和电池状态减少模型调用
+};
+
+// 模糊音与拼写纠错配置，全部关闭时按拼音精确查询
+struct FuzzyPinyinConfig {
+    bool z_zh = false;              // 声母 z/zh
+    bool c_ch = false;              // 声母 c/ch
+    bool s_sh = false;              // 声母 s/sh
+    bool n_l = false;               // 声母 n/l
+    bool an_ang = false;            // 韵母 an/ang
+    bool en_eng = false;            // 韵母 en/eng
+    bool in_ing = false;            // 韵母 in/ing
+    bool adjacent_keys = false;     // 纠正误按键盘同一行相邻的键
+    bool transpositions = false;    // 纠正相邻字母颠倒
+    int max_alternatives = 4;       // 每个音节最多的替代音节数
+    int max_queries = 8;            // 每次查询最多展开的音节组合数
+};
+
+// 按应用切换的引擎配置
+struct ApplicationProfile {
+    std::string name;
+    std::vector<std::string> applications;  // 应用标识（进程名、Bundle ID或窗口标题）的子串，不区分大小写
+    bool enable_prediction = true;          // 在EngineConfig::enable_prediction开启时才有效
+    FuzzyPinyinConfig fuzzy;
+    std::string domain_lexicon_path;        // 领域词典（二进制词典，如代码标识符、聊天用语），为空时不使用
+};
+
 // 配置选项
 struct EngineConfig {
     std::string dictionary_path = "data/dictionary.db";
+    std::string lexicon_path = "data/system.lex";
+    std::string ngram_model_path = "data/system.ngram";  // 整句解码的n-gram模型，需要系统词典
     std::string model_path = "models/qwen0.6b.gguf";
     int max_candidates = 9;
+    int candidate_cache_size = 32;   // 候选词LRU缓存条目数，0表示禁用
     bool enable_prediction = true;
     bool enable_learning = true;
+    double frequency_half_life_days = 30.0;  // 学习得到的频率的半衰期，0表示不衰减
+    bool enable_context_rerank = true;  // 按最近提交的文本重排候选词，难以区分时再由AI模型打分
+    bool enable_abbreviation = true;  // 允许简拼输入，如 "zgr" 输入 中国人
+    std::string double_pinyin_scheme; // 双拼方案：microsoft、xiaohe、ziranma，为空时使用全拼
     double prediction_threshold = 0.5;
+    ModelConfig model;
+    FuzzyPinyinConfig fuzzy;
+    std::vector<ApplicationProfile> profiles;   // 按顺序匹配，第一个匹配的生效，都不匹配时使用以上默认配置
+    int profile_cache_size = 4;     // 保持预热的配置数（含当前配置）
     
     // 平台特定配置
     struct {
@@ -0,0 +1,189 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <cstdint>
+
+namespace owcat {
+namespace core {
+
+/**
+ * 用户层中的一个词
+ */
+struct UserWord {
+    std::string word;
+    std::string pinyin;     // 音节以空格分隔
+    int frequency;          // 用户词为频率，系统词为学习得到的频率增量，均已衰减到查询时刻
+    bool user_word;         // 是否为用户添加的词；否则只是对系统词的加权
+
+    UserWord() : frequency(0), user_word(false) {}
+};
+
+/**
+ * 用户词库统计
+ */
+struct UserDictionaryStats {
+    size_t words = 0;               // 用户词数
+    size_t boosts = 0;              // 有学习加权的系统词数
+    uint64_t journal_records = 0;   // 上次压缩后追加的日志记录数
+    uint64_t synced_batches = 0;    // 已同步到磁盘的日志批次
+    uint64_t compactions = 0;       // 已完成的压缩次数
+};
+
+/**
+ * 用户词库：叠加在只读系统词典之上的内存层
+ * 所有修改立即作用于内存中的哈希表和按拼音有序的索引，下一次按键即可查到；同时追加到日志，
+ * 由后台线程按批写入并同步到磁盘，日志过长时在后台压缩为快照。启动时加载快照，
+ * 只重放快照之后的日志尾部
+ *
+ * 频率按半衰期随时间衰减：每个条目保存(值, 最后更新时间)，读取时才衰减到当前时刻，
+ * 增加频率时先衰减再累加。近期常用的词排在前面，不需要定期改写整个词库
+ *
+ * 磁盘文件：
+ *   <path>           快照，首行记录已包含的最后一条日志序号，每行一个条目的存储值和更新时间
+ *   <path>.journal   追加日志，每行一条带序号的操作，不完整的末行被忽略
+ * 所有方法都是线程安全的
+ */
+class UserDictionary {
+public:
+    /**
+     * @param path 快照路径，为空时只保存在内存中
+     */
+    explicit UserDictionary(const std::string& path);
+    ~UserDictionary();
+
+    // 禁用拷贝和移动
+    UserDictionary(const UserDictionary&) = delete;
+    UserDictionary& operator=(const UserDictionary&) = delete;
+    UserDictionary(UserDictionary&&) = delete;
+    UserDictionary& operator=(UserDictionary&&) = delete;
+
+    /**
+     * 加载快照并重放日志，启动后台同步线程
+     * @return 是否打开成功
+     */
+    bool open();
+
+    /**
+     * 同步日志、压缩为快照并停止后台线程
+     */
+    void close();
+
+    /**
+     * 检查是否已打开
+     * @return 是否已打开
+     */
+    bool isOpen() const;
+
+    /**
+     * 检查打开时磁盘上是否已有用户词库（快照或日志）
+     * @return 是否已有
+     */
+    bool existedOnDisk() const;
+
+    /**
+     * 添加或覆盖用户词
+     * @param word 词汇
+     * @param pinyin 拼音
+     * @param frequency 频率
+     * @return 是否添加成功，词或拼音为空或含有制表符、换行时失败
+     */
+    bool addWord(const std::string& word, const std::string& pinyin, int frequency);
+
+    /**
+     * 增加词的使用频率，不是用户词时记为对系统词的加权
+     * @param word 词汇
+     * @param pinyin 拼音
+     * @param delta 频率增量
+     * @return 是否更新成功
+     */
+    bool addFrequency(const std::string& word, const std::string& pinyin, int delta);
+
+    /**
+     * 删除用户词（系统词的加权保留）
+     * @param word 词汇
+     * @param pinyin 拼音
+     * @return 是否存在该用户词
+     */
+    bool removeWord(const std::string& word, const std::string& pinyin);
+
+    /**
+     * 删除频率低于阈值的用户词
+     * @param min_frequency 最小频率
+     * @return 删除的词数
+     */
+    int prune(int min_frequency);
+
+    /**
+     * 按拼音前缀查询用户词，按频率降序、短词优先
+     * @param pinyin 拼音前缀
+     * @param max_results 最大结果数
+     * @param out 输出用户词
+     * @return 结果数量
+     */
+    size_t search(const std::string& pinyin, size_t max_results, std::vector<UserWord>& out) const;
+
+    /**
+     * 判断用户词的拼音是否满足查询，在持有内部锁时调用，不能再访问本词库
+     */
+    using PinyinMatcher = std::function<bool(const std::string& pinyin)>;
+
+    /**
+     * 按简拼查询用户词：音节首字母序列以initials为前缀，再由matcher确认各音节，按频率降序、短词优先
+     * @param initials 各音节首字母，如 "zgr"
+     * @param max_results 最大结果数
+     * @param matcher 拼音匹配条件
+     * @param out 输出用户词
+     * @return 结果数量
+     */
+    size_t searchAbbreviated(const std::string& initials, size_t max_results, const PinyinMatcher& matcher,
+                             std::vector<UserWord>& out) const;
+
+    /**
+     * 查找词在用户层中的条目
+     * @param word 词汇
+     * @param pinyin 拼音
+     * @param out 输出条目
+     * @return 是否存在
+     */
+    bool find(const std::string& word, const std::string& pinyin, UserWord& out) const;
+
+    /**
+     * 获取所有用户词，按频率降序
+     * @return 用户词列表
+     */
+    std::vector<UserWord> getUserWords() const;
+
+    /**
+     * 立即把日志写入并同步到磁盘
+     * @return 是否成功
+     */
+    bool sync();
+
+    /**
+     * 立即把当前内容压缩为快照并截断日志
+     * @return 是否成功
+     */
+    bool compact();
+
+    /**
+     * 设置频率半衰期，对已有条目同样生效
+     * @param days 半衰期（天），0表示不衰减
+     */
+    void setHalfLife(double days);
+
+    /**
+     * 获取统计信息
+     * @return 统计信息
+     */
+    UserDictionaryStats getStats() const;
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> pImpl;
+};
+
+} // namespace core
+} // namespace owcat
\ No newline at end of file
@@ -282,6 +282,10 @@ public:
     std::string getDesktopEnvironment();
     std::string getDisplayServer(); // X11, Wayland, etc.
     
+    // CPU load from /proc/stat (delta since the previous call, 0 on the first call)
+    // and battery state from /sys/class/power_supply
+    bool getSystemLoad(core::SystemLoad& load);
+    
     // Process management
     std::vector<std::map<std::string, std::string>> getRunningProcesses();
     std::map<std::string, std::string> getCurrentProcessInfo();
@@ -190,6 +190,9 @@ public:
     static std::string getMacOSVersion();
     static std::map<std::string, std::string> getSystemInfo();
     
+    // 系统负载：CPU占用按与上一次调用之间的处理器tick差值计算（首次为0），电池状态来自IOKit电源信息
+    bool getSystemLoad(core::SystemLoad& load);
+    
     // 输入源管理
     std::vector<std::string> getInstalledInputSources();
     std::string getCurrentInputSource();
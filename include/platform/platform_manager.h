@@ -6,6 +6,10 @@
 #include <functional>
 
 namespace owcat {
+namespace core {
+class Engine;
+}
+
 namespace platform {
 
 /**
@@ -175,6 +179,7 @@ public:
     
     /**
      * @brief 设置焦点变化回调
+     * 切换到其他输入框或应用时调用，前端应据此调用Engine::resetContext()清空提交历史
      * @param callback 回调函数
      */
     virtual void setFocusChangeCallback(PlatformFocusChangeCallback callback) = 0;
@@ -217,6 +222,23 @@ public:
  */
 std::unique_ptr<PlatformManager> createPlatformManager();
 
+/**
+ * @brief 把平台焦点变化接到引擎
+ * 获得焦点时按getCurrentApplication()切换应用配置并清空提交历史，失去焦点时清空当前输入；
+ * 会替换已设置的焦点变化回调，引擎必须比平台管理器的回调存活更久
+ * @param platform 平台管理器
+ * @param engine 引擎
+ */
+void bindFocusToEngine(PlatformManager& platform, core::Engine& engine);
+
+/**
+ * @brief 创建当前平台的系统负载采样回调，供AI预测调节器使用
+ * Linux读取/proc/stat和/sys/class/power_supply，Windows使用GetSystemTimes和GetSystemPowerStatus，
+ * macOS使用host_statistics和IOKit电源信息；CPU占用按相邻两次采样的差值计算
+ * @return 采样回调，不支持的平台返回空
+ */
+core::SystemLoadProvider createSystemLoadProvider();
+
 /**
  * @brief 获取当前平台类型
  * @return 平台类型字符串
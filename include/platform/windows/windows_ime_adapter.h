@@ -111,16 +111,25 @@ public:
     ~WindowsImeMessageHandler();
     
     /**
-     * @brief 安装消息钩子
+     * @brief 开始接收按键
+     * 
+     * 优先注册TSF按键接收器（ITfKeyEventSink），只在OW Cat为当前输入法的焦点上下文中收到按键；
+     * TSF不可用时回退到IMM32，只在当前线程挂WH_KEYBOARD钩子，不使用全局低级钩子。
      * @return 是否安装成功
      */
     bool installHook();
     
     /**
-     * @brief 卸载消息钩子
+     * @brief 停止接收按键，释放TSF对象或卸载线程钩子
      */
     void uninstallHook();
     
+    /**
+     * @brief 是否通过TSF按键接收器接收按键
+     * @return 为false时使用IMM32回退路径
+     */
+    bool isTsfActive() const;
+    
     /**
      * @brief 处理IME消息
      * @param hwnd 窗口句柄
@@ -134,7 +143,6 @@ public:
 private:
     WindowsImeAdapter* adapter_;
     HHOOK keyboard_hook_;
-    HHOOK mouse_hook_;
     HWND ime_window_;
     std::thread message_thread_;
     std::mutex message_mutex_;
@@ -142,12 +150,10 @@ private:
     
     // 静态回调函数
     static LRESULT CALLBACK keyboardHookProc(int nCode, WPARAM wParam, LPARAM lParam);
-    static LRESULT CALLBACK mouseHookProc(int nCode, WPARAM wParam, LPARAM lParam);
     static LRESULT CALLBACK imeWindowProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam);
     
     // 消息处理方法
     void handleKeyboardMessage(const KBDLLHOOKSTRUCT* kbd_struct, WPARAM wParam);
-    void handleMouseMessage(const MSLLHOOKSTRUCT* mouse_struct, WPARAM wParam);
     void handleImeComposition(HWND hwnd, LPARAM lParam);
     void handleImeStartComposition(HWND hwnd);
     void handleImeEndComposition(HWND hwnd);
@@ -293,6 +299,14 @@ public:
      */
     static int getSystemDpi();
     
+    /**
+     * @brief 采样系统负载和电池状态
+     * CPU占用按与上一次调用之间的GetSystemTimes差值计算，首次调用为0
+     * @param load 输出系统负载
+     * @return 是否采样成功
+     */
+    static bool getSystemLoad(core::SystemLoad& load);
+    
 private:
     // 注册表操作辅助函数
     static bool writeRegistryString(HKEY hkey, const std::string& subkey, 
@@ -40,6 +40,10 @@ typedef struct _GtkAboutDialog GtkAboutDialog;
 
 namespace owcat {
 
+namespace core {
+class DictionaryManager;
+}
+
 // Forward declarations
 class GtkMainWindow;
 class GtkCandidateWindow;
@@ -234,6 +238,9 @@ public:
     void setOnConfigurationChanged(std::function<void(const std::map<std::string, std::string>&)> callback);
     void setOnDialogClosed(std::function<void()> callback);
     
+    // Dictionary import/export runs on a background thread; the dialog only polls its progress
+    void setDictionaryManager(std::shared_ptr<core::DictionaryManager> manager);
+    
     // Widget access
     GtkWidget* getWidget() const;
     GtkDialog* getDialog() const;
@@ -0,0 +1,210 @@
+#include "core/candidate_merger.h"
+#include <algorithm>
+
+namespace owcat {
+namespace core {
+
+CandidateMerger::CandidateMerger(size_t max_k)
+    : max_k_(max_k), k_(0), heap_size_(0), next_order_(0), tombstones_(0) {
+    // 哈希表保持至少一半空闲，容量取2的幂
+    size_t table_size = 8;
+    while (table_size < max_k_ * 4) {
+        table_size <<= 1;
+    }
+
+    slots_.resize(max_k_);
+    heap_.resize(max_k_);
+    table_.assign(table_size, EMPTY);
+    free_slots_.reserve(max_k_);
+    sorted_.reserve(max_k_);
+    reset(max_k_);
+}
+
+void CandidateMerger::reset(size_t k) {
+    k_ = std::min(k, max_k_);
+    heap_size_ = 0;
+    next_order_ = 0;
+    tombstones_ = 0;
+    std::fill(table_.begin(), table_.end(), EMPTY);
+
+    free_slots_.clear();
+    for (size_t i = max_k_; i > 0; --i) {
+        free_slots_.push_back(static_cast<uint32_t>(i - 1));
+    }
+}
+
+bool CandidateMerger::add(const CandidateView& candidate) {
+    if (k_ == 0 || candidate.text.empty()) {
+        return false;
+    }
+
+    const uint64_t hash = hashText(candidate.text);
+    const uint32_t order = next_order_++;
+
+    // 重复文本只保留得分较高的一项
+    uint32_t existing = findSlot(hash, candidate.text);
+    if (existing != EMPTY) {
+        Slot& slot = slots_[existing];
+        if (candidate.score <= slot.view.score) {
+            return false;
+        }
+        slot.view = candidate;
+        siftDown(slot.heap_index);
+        return true;
+    }
+
+    uint32_t index;
+    bool replaced = false;
+    if (heap_size_ < k_) {
+        index = free_slots_.back();
+        free_slots_.pop_back();
+        slots_[index].heap_index = static_cast<uint32_t>(heap_size_);
+        heap_[heap_size_++] = index;
+    } else {
+        // 不优于当前最差的候选词时直接丢弃（同分时先加入者优先）
+        index = heap_[0];
+        if (candidate.score <= slots_[index].view.score) {
+            return false;
+        }
+        eraseTable(index);
+        replaced = true;
+    }
+
+    Slot& slot = slots_[index];
+    slot.view = candidate;
+    slot.hash = hash;
+    slot.order = order;
+    insertTable(index);
+
+    if (replaced) {
+        siftDown(0);
+    } else {
+        siftUp(slot.heap_index);
+    }
+    return true;
+}
+
+void CandidateMerger::addAll(const CandidateList& candidates, size_t count) {
+    count = std::min(count, candidates.size());
+    for (size_t i = 0; i < count; ++i) {
+        add(CandidateView(candidates[i]));
+    }
+}
+
+void CandidateMerger::finish(CandidateList& out) {
+    sorted_.assign(heap_.begin(), heap_.begin() + heap_size_);
+    std::sort(sorted_.begin(), sorted_.end(), [this](uint32_t a, uint32_t b) {
+        return worse(b, a);
+    });
+
+    out.resize(sorted_.size());
+    for (size_t i = 0; i < sorted_.size(); ++i) {
+        const CandidateView& view = slots_[sorted_[i]].view;
+        Candidate& candidate = out[i];
+        candidate.text.assign(view.text.data(), view.text.size());
+        candidate.pinyin.assign(view.pinyin.data(), view.pinyin.size());
+        candidate.score = view.score;
+        candidate.frequency = view.frequency;
+        candidate.is_prediction = view.is_prediction;
+    }
+}
+
+uint64_t CandidateMerger::hashText(std::string_view text) {
+    // FNV-1a
+    uint64_t hash = 1469598103934665603ull;
+    for (char c : text) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+bool CandidateMerger::worse(uint32_t a, uint32_t b) const {
+    const Slot& sa = slots_[a];
+    const Slot& sb = slots_[b];
+    if (sa.view.score != sb.view.score) {
+        return sa.view.score < sb.view.score;
+    }
+    return sa.order > sb.order;
+}
+
+void CandidateMerger::siftUp(uint32_t index) {
+    while (index > 0) {
+        uint32_t parent = (index - 1) / 2;
+        if (!worse(heap_[index], heap_[parent])) {
+            break;
+        }
+        swapHeap(index, parent);
+        index = parent;
+    }
+}
+
+void CandidateMerger::siftDown(uint32_t index) {
+    const uint32_t size = static_cast<uint32_t>(heap_size_);
+    while (true) {
+        uint32_t left = index * 2 + 1;
+        if (left >= size) {
+            break;
+        }
+        uint32_t child = left;
+        if (left + 1 < size && worse(heap_[left + 1], heap_[left])) {
+            child = left + 1;
+        }
+        if (!worse(heap_[child], heap_[index])) {
+            break;
+        }
+        swapHeap(index, child);
+        index = child;
+    }
+}
+
+void CandidateMerger::swapHeap(uint32_t a, uint32_t b) {
+    std::swap(heap_[a], heap_[b]);
+    slots_[heap_[a]].heap_index = a;
+    slots_[heap_[b]].heap_index = b;
+}
+
+uint32_t CandidateMerger::findSlot(uint64_t hash, std::string_view text) const {
+    const size_t mask = table_.size() - 1;
+    for (size_t i = hash & mask; ; i = (i + 1) & mask) {
+        uint32_t entry = table_[i];
+        if (entry == EMPTY) {
+            return EMPTY;
+        }
+        if (entry != TOMBSTONE && slots_[entry].hash == hash && slots_[entry].view.text == text) {
+            return entry;
+        }
+    }
+}
+
+void CandidateMerger::insertTable(uint32_t slot) {
+    // 删除标记过多时重建，保证探测总能遇到空位
+    if (tombstones_ > max_k_) {
+        std::fill(table_.begin(), table_.end(), EMPTY);
+        tombstones_ = 0;
+        for (size_t i = 0; i < heap_size_; ++i) {
+            if (heap_[i] != slot) {
+                insertTable(heap_[i]);
+            }
+        }
+    }
+
+    const size_t mask = table_.size() - 1;
+    size_t i = slots_[slot].hash & mask;
+    while (table_[i] != EMPTY && table_[i] != TOMBSTONE) {
+        i = (i + 1) & mask;
+    }
+    if (table_[i] == TOMBSTONE) {
+        --tombstones_;
+    }
+    table_[i] = slot;
+    slots_[slot].table_index = static_cast<uint32_t>(i);
+}
+
+void CandidateMerger::eraseTable(uint32_t slot) {
+    table_[slots_[slot].table_index] = TOMBSTONE;
+    ++tombstones_;
+}
+
+} // namespace core
+} // namespace owcat
\ No newline at end of file
@@ -0,0 +1,65 @@
+#include "core/commit_history.h"
+
+namespace owcat {
+namespace core {
+
+CommitHistory::CommitHistory() : head_(0), size_(0) {
+}
+
+void CommitHistory::push(std::string_view text) {
+    if (text.empty()) {
+        return;
+    }
+    entries_[head_].assign(text.data(), text.size());
+    head_ = (head_ + 1) % kCapacity;
+    if (size_ < kCapacity) {
+        ++size_;
+    }
+}
+
+void CommitHistory::clear() {
+    for (auto& entry : entries_) {
+        entry.clear();
+    }
+    head_ = 0;
+    size_ = 0;
+}
+
+bool CommitHistory::empty() const {
+    return size_ == 0;
+}
+
+const std::string& CommitHistory::last() const {
+    return entries_[(head_ + kCapacity - 1) % kCapacity];
+}
+
+std::string CommitHistory::getContext(size_t max_bytes) const {
+    // 从最近的提交往前累计，确定需要拼接的最早一条及其起始位置
+    size_t total = 0;
+    size_t count = 0;
+    size_t skip = 0;
+    while (count < size_ && total < max_bytes) {
+        const std::string& entry = entries_[(head_ + kCapacity - 1 - count) % kCapacity];
+        ++count;
+        if (total + entry.size() > max_bytes) {
+            skip = entry.size() - (max_bytes - total);
+            while (skip < entry.size() && (static_cast<unsigned char>(entry[skip]) & 0xC0) == 0x80) {
+                ++skip;
+            }
+            total = max_bytes;
+            break;
+        }
+        total += entry.size();
+    }
+
+    std::string context;
+    context.reserve(total);
+    for (size_t i = count; i > 0; --i) {
+        const std::string& entry = entries_[(head_ + kCapacity - i) % kCapacity];
+        context.append(entry, i == count ? skip : 0, std::string::npos);
+    }
+    return context;
+}
+
+} // namespace core
+} // namespace owcat
\ No newline at end of file
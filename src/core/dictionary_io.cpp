@@ -0,0 +1,1046 @@
+#include "core/dictionary_io.h"
+#include "core/lexicon.h"
+#include "core/pinyin_converter.h"
+#include <spdlog/spdlog.h>
+#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <charconv>
+#include <cstdio>
+#include <filesystem>
+#include <iterator>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace owcat {
+namespace core {
+
+namespace {
+
+// 文本格式每处理这么多字节报告一次进度
+constexpr uint64_t PROGRESS_INTERVAL_BYTES = 1 << 20;
+
+// 二进制词典和导出每处理这么多条目报告一次进度
+constexpr uint64_t PROGRESS_INTERVAL_ENTRIES = 4096;
+
+// 写出缓冲达到此大小时写入临时文件
+constexpr size_t WRITE_CHUNK_SIZE = 1 << 20;
+
+constexpr std::string_view UTF8_BOM = "\xef\xbb\xbf";
+
+/**
+ * 只读映射的输入文件，按顺序访问
+ */
+class MappedFile {
+public:
+    MappedFile() : data_(nullptr), size_(0) {
+#ifdef _WIN32
+        file_ = INVALID_HANDLE_VALUE;
+        mapping_ = nullptr;
+#endif
+    }
+
+    ~MappedFile() {
+        close();
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool open(const std::string& path) {
+#ifdef _WIN32
+        file_ = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                            OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (file_ == INVALID_HANDLE_VALUE) {
+            spdlog::error("Failed to open dictionary file: {}", path);
+            return false;
+        }
+
+        LARGE_INTEGER file_size;
+        if (!GetFileSizeEx(file_, &file_size)) {
+            spdlog::error("Failed to get dictionary file size: {}", path);
+            close();
+            return false;
+        }
+        // 空文件无法映射，按没有词条处理
+        if (file_size.QuadPart == 0) {
+            return true;
+        }
+
+        mapping_ = CreateFileMappingA(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        void* data = mapping_ ? MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0) : nullptr;
+        if (!data) {
+            spdlog::error("Failed to map dictionary file: {}", path);
+            close();
+            return false;
+        }
+        data_ = static_cast<const char*>(data);
+        size_ = static_cast<size_t>(file_size.QuadPart);
+#else
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            spdlog::error("Failed to open dictionary file: {}", path);
+            return false;
+        }
+
+        struct stat st;
+        if (fstat(fd, &st) != 0) {
+            spdlog::error("Failed to get dictionary file size: {}", path);
+            ::close(fd);
+            return false;
+        }
+        if (st.st_size == 0) {
+            ::close(fd);
+            return true;
+        }
+
+        void* data = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (data == MAP_FAILED) {
+            spdlog::error("Failed to map dictionary file: {}", path);
+            return false;
+        }
+
+        // 顺序读取，让内核提前读入并及时回收已读过的页
+        madvise(data, static_cast<size_t>(st.st_size), MADV_SEQUENTIAL);
+        data_ = static_cast<const char*>(data);
+        size_ = static_cast<size_t>(st.st_size);
+#endif
+        return true;
+    }
+
+    void close() {
+#ifdef _WIN32
+        if (data_) {
+            UnmapViewOfFile(data_);
+        }
+        if (mapping_) {
+            CloseHandle(mapping_);
+            mapping_ = nullptr;
+        }
+        if (file_ != INVALID_HANDLE_VALUE) {
+            CloseHandle(file_);
+            file_ = INVALID_HANDLE_VALUE;
+        }
+#else
+        if (data_) {
+            munmap(const_cast<char*>(data_), size_);
+        }
+#endif
+        data_ = nullptr;
+        size_ = 0;
+    }
+
+    std::string_view view() const {
+        return data_ ? std::string_view(data_, size_) : std::string_view();
+    }
+
+private:
+    const char* data_;
+    size_t size_;
+#ifdef _WIN32
+    HANDLE file_;
+    HANDLE mapping_;
+#endif
+};
+
+/**
+ * 把词条交给visitor并按间隔报告进度
+ */
+class RecordSink {
+public:
+    RecordSink(const DictionaryRecordVisitor& visitor, const DictionaryProgressCallback& progress,
+               DictionaryProgress& stats, uint64_t interval)
+        : visitor_(visitor), progress_(progress), stats_(stats), interval_(interval)
+        , next_report_(interval), cancelled_(false) {}
+
+    void accept(const DictionaryRecord& record) {
+        if (record.word.empty() || record.pinyin.empty() || !visitor_(record)) {
+            ++stats_.rejected;
+        } else {
+            ++stats_.entries;
+        }
+    }
+
+    void reject() {
+        ++stats_.rejected;
+    }
+
+    /**
+     * 更新已处理量，跨过报告间隔时调用进度回调
+     * @return 是否继续
+     */
+    bool advance(uint64_t processed) {
+        stats_.processed = processed;
+        if (processed < next_report_) {
+            return true;
+        }
+        next_report_ = processed + interval_;
+        return report();
+    }
+
+    bool report() {
+        if (progress_ && !progress_(stats_)) {
+            cancelled_ = true;
+        }
+        return !cancelled_;
+    }
+
+    bool cancelled() const {
+        return cancelled_;
+    }
+
+private:
+    const DictionaryRecordVisitor& visitor_;
+    const DictionaryProgressCallback& progress_;
+    DictionaryProgress& stats_;
+    uint64_t interval_;
+    uint64_t next_report_;
+    bool cancelled_;
+};
+
+bool isNumber(std::string_view text) {
+    return !text.empty() && std::all_of(text.begin(), text.end(),
+                                        [](char c) { return c >= '0' && c <= '9'; });
+}
+
+bool isAsciiWord(std::string_view text) {
+    return !text.empty() && std::all_of(text.begin(), text.end(), [](char c) {
+        return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '\'';
+    });
+}
+
+uint32_t parseFrequency(std::string_view text) {
+    unsigned long long value = 0;
+    auto result = std::from_chars(text.data(), text.data() + text.size(), value);
+    if (result.ec == std::errc::result_out_of_range) {
+        return 0xffffffffu;
+    }
+    if (result.ec != std::errc() || value == 0) {
+        return 1;
+    }
+    return static_cast<uint32_t>(std::min<unsigned long long>(value, 0xffffffffull));
+}
+
+uint32_t clampFrequency(double value) {
+    return static_cast<uint32_t>(std::max(1.0, std::min(value, 4294967295.0)));
+}
+
+/**
+ * 把原始拼音追加为以空格分隔的小写音节
+ * 空格、撇号、声调数字等非字母字符都视为分隔符，ü 和 u: 写作 v
+ * @return 拼音是否有效，含有带声调符号等其他非ASCII字符时无效
+ */
+bool appendPinyin(std::string& out, std::string_view raw) {
+    bool separator = !out.empty();
+    for (size_t i = 0; i < raw.size(); ++i) {
+        unsigned char c = static_cast<unsigned char>(raw[i]);
+        char letter = 0;
+        if (raw.compare(i, 2, "\xc3\xbc") == 0 || raw.compare(i, 2, "u:") == 0) {
+            letter = 'v';
+            ++i;
+        } else if (c >= 0x80) {
+            return false;
+        } else if (std::isalpha(c)) {
+            letter = static_cast<char>(std::tolower(c));
+        }
+
+        if (!letter) {
+            separator = !out.empty();
+            continue;
+        }
+        if (separator) {
+            out += ' ';
+            separator = false;
+        }
+        out += letter;
+    }
+    return !out.empty();
+}
+
+/**
+ * 逐行遍历映射的文本
+ */
+template <typename LineHandler>
+void forEachLine(std::string_view text, RecordSink& sink, LineHandler&& handler) {
+    size_t pos = 0;
+    if (text.substr(0, UTF8_BOM.size()) == UTF8_BOM) {
+        pos = UTF8_BOM.size();
+    }
+
+    while (pos < text.size()) {
+        size_t end = text.find('\n', pos);
+        if (end == std::string_view::npos) {
+            end = text.size();
+        }
+        std::string_view line = text.substr(pos, end - pos);
+        if (!line.empty() && line.back() == '\r') {
+            line.remove_suffix(1);
+        }
+        handler(line);
+
+        pos = end + 1;
+        if (!sink.advance(std::min<uint64_t>(pos, text.size()))) {
+            return;
+        }
+    }
+}
+
+void readTxt(std::string_view text, RecordSink& sink) {
+    std::vector<std::string_view> tokens;
+    std::string pinyin;
+    DictionaryRecord record;
+
+    forEachLine(text, sink, [&](std::string_view line) {
+        if (line.empty() || line[0] == '#') {
+            return;
+        }
+
+        tokens.clear();
+        size_t pos = 0;
+        while (pos < line.size()) {
+            size_t begin = line.find_first_not_of(" \t", pos);
+            if (begin == std::string_view::npos) {
+                break;
+            }
+            size_t end = line.find_first_of(" \t", begin);
+            if (end == std::string_view::npos) {
+                end = line.size();
+            }
+            tokens.push_back(line.substr(begin, end - begin));
+            pos = end;
+        }
+        if (tokens.size() < 2) {
+            sink.reject();
+            return;
+        }
+
+        record.frequency = 1;
+        if (tokens.size() > 2 && isNumber(tokens.back())) {
+            record.frequency = parseFrequency(tokens.back());
+            tokens.pop_back();
+        }
+
+        // "拼音 词" 的顺序
+        size_t word_index = 0;
+        size_t pinyin_begin = 1;
+        size_t pinyin_end = tokens.size();
+        if (isAsciiWord(tokens.front()) && !isAsciiWord(tokens.back())) {
+            word_index = tokens.size() - 1;
+            pinyin_begin = 0;
+            pinyin_end = tokens.size() - 1;
+        }
+
+        pinyin.clear();
+        bool valid = true;
+        for (size_t i = pinyin_begin; i < pinyin_end && valid; ++i) {
+            valid = appendPinyin(pinyin, tokens[i]);
+        }
+        if (!valid) {
+            sink.reject();
+            return;
+        }
+
+        record.word = tokens[word_index];
+        record.pinyin = pinyin;
+        sink.accept(record);
+    });
+}
+
+/**
+ * 解析一行CSV，支持双引号字段
+ * @return 字段数量，fields中多余的字段保留容量供下一行复用
+ */
+size_t splitCsvLine(std::string_view line, std::vector<std::string>& fields) {
+    size_t count = 0;
+    auto next = [&]() -> std::string& {
+        if (count == fields.size()) {
+            fields.emplace_back();
+        }
+        std::string& field = fields[count++];
+        field.clear();
+        return field;
+    };
+
+    std::string* field = &next();
+    bool quoted = false;
+    for (size_t i = 0; i < line.size(); ++i) {
+        char c = line[i];
+        if (quoted) {
+            if (c == '"' && i + 1 < line.size() && line[i + 1] == '"') {
+                *field += '"';
+                ++i;
+            } else if (c == '"') {
+                quoted = false;
+            } else {
+                *field += c;
+            }
+        } else if (c == '"') {
+            quoted = true;
+        } else if (c == ',') {
+            field = &next();
+        } else {
+            *field += c;
+        }
+    }
+    return count;
+}
+
+void readCsv(std::string_view text, RecordSink& sink) {
+    std::vector<std::string> fields;
+    std::string pinyin;
+    DictionaryRecord record;
+    bool first_line = true;
+
+    forEachLine(text, sink, [&](std::string_view line) {
+        if (line.empty()) {
+            return;
+        }
+
+        size_t count = splitCsvLine(line, fields);
+        if (count < 2) {
+            sink.reject();
+            return;
+        }
+
+        // 跳过表头
+        bool header = first_line && (fields[0] == "word" || fields[1] == "pinyin");
+        first_line = false;
+        if (header) {
+            return;
+        }
+
+        pinyin.clear();
+        if (!appendPinyin(pinyin, fields[1])) {
+            sink.reject();
+            return;
+        }
+
+        record.word = fields[0];
+        record.pinyin = pinyin;
+        record.frequency = count > 2 && isNumber(fields[2]) ? parseFrequency(fields[2]) : 1;
+        sink.accept(record);
+    });
+}
+
+/**
+ * 记录JSON解析位置的输入迭代器
+ * nlohmann的SAX接口不提供当前偏移，由迭代器在前进时写回，供报告进度
+ */
+class TrackingIterator {
+public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = char;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const char*;
+    using reference = const char&;
+
+    TrackingIterator() : pos_(nullptr), cursor_(nullptr) {}
+    TrackingIterator(const char* pos, const char** cursor) : pos_(pos), cursor_(cursor) {}
+
+    reference operator*() const { return *pos_; }
+
+    TrackingIterator& operator++() {
+        ++pos_;
+        if (cursor_) {
+            *cursor_ = pos_;
+        }
+        return *this;
+    }
+
+    TrackingIterator operator++(int) {
+        TrackingIterator previous = *this;
+        ++*this;
+        return previous;
+    }
+
+    bool operator==(const TrackingIterator& other) const { return pos_ == other.pos_; }
+    bool operator!=(const TrackingIterator& other) const { return pos_ != other.pos_; }
+
+private:
+    const char* pos_;
+    const char** cursor_;
+};
+
+/**
+ * json格式的SAX处理器，每个对象结束时产生一个词条
+ */
+class JsonRecordHandler : public nlohmann::json_sax<nlohmann::json> {
+public:
+    JsonRecordHandler(RecordSink& sink, const char* begin, const char* const* cursor)
+        : sink_(sink), begin_(begin), cursor_(cursor), frequency_(1), in_pinyin_array_(false)
+        , valid_pinyin_(true) {}
+
+    bool null() override { return true; }
+    bool boolean(bool) override { return true; }
+
+    bool number_integer(number_integer_t value) override {
+        if (isFrequencyKey()) {
+            frequency_ = clampFrequency(static_cast<double>(value));
+        }
+        return true;
+    }
+
+    bool number_unsigned(number_unsigned_t value) override {
+        if (isFrequencyKey()) {
+            frequency_ = clampFrequency(static_cast<double>(value));
+        }
+        return true;
+    }
+
+    bool number_float(number_float_t value, const string_t&) override {
+        if (isFrequencyKey()) {
+            frequency_ = clampFrequency(value);
+        }
+        return true;
+    }
+
+    bool string(string_t& value) override {
+        if (in_pinyin_array_ || key_ == "pinyin") {
+            valid_pinyin_ = appendPinyin(pinyin_, value) && valid_pinyin_;
+        } else if (key_ == "word" || key_ == "text") {
+            word_.swap(value);
+        } else if (isFrequencyKey()) {
+            frequency_ = parseFrequency(value);
+        }
+        return true;
+    }
+
+    bool binary(binary_t&) override { return true; }
+
+    bool start_object(std::size_t) override {
+        resetEntry();
+        return true;
+    }
+
+    bool key(string_t& value) override {
+        key_.swap(value);
+        return true;
+    }
+
+    bool end_object() override {
+        if (!word_.empty() || !pinyin_.empty()) {
+            if (valid_pinyin_) {
+                DictionaryRecord record;
+                record.word = word_;
+                record.pinyin = pinyin_;
+                record.frequency = frequency_;
+                sink_.accept(record);
+            } else {
+                sink_.reject();
+            }
+        }
+        resetEntry();
+        return sink_.advance(static_cast<uint64_t>(*cursor_ - begin_));
+    }
+
+    bool start_array(std::size_t) override {
+        in_pinyin_array_ = key_ == "pinyin";
+        return true;
+    }
+
+    bool end_array() override {
+        in_pinyin_array_ = false;
+        key_.clear();
+        return true;
+    }
+
+    bool parse_error(std::size_t position, const std::string&, const nlohmann::detail::exception& ex) override {
+        spdlog::error("JSON parse error at byte {}: {}", position, ex.what());
+        return false;
+    }
+
+private:
+    bool isFrequencyKey() const {
+        return key_ == "frequency" || key_ == "freq";
+    }
+
+    void resetEntry() {
+        word_.clear();
+        pinyin_.clear();
+        key_.clear();
+        frequency_ = 1;
+        valid_pinyin_ = true;
+    }
+
+    RecordSink& sink_;
+    const char* begin_;
+    const char* const* cursor_;
+    std::string key_;
+    std::string word_;
+    std::string pinyin_;
+    uint32_t frequency_;
+    bool in_pinyin_array_;
+    bool valid_pinyin_;
+};
+
+bool readJson(std::string_view text, RecordSink& sink) {
+    if (text.substr(0, UTF8_BOM.size()) == UTF8_BOM) {
+        text.remove_prefix(UTF8_BOM.size());
+    }
+    if (text.empty()) {
+        return true;
+    }
+
+    const char* cursor = text.data();
+    JsonRecordHandler handler(sink, text.data(), &cursor);
+    bool ok = nlohmann::json::sax_parse(TrackingIterator(text.data(), &cursor),
+                                        TrackingIterator(text.data() + text.size(), nullptr), &handler);
+    return ok || sink.cancelled();
+}
+
+bool readLexicon(const std::string& path, RecordSink& sink, DictionaryProgress& stats) {
+    // 用户选择的文件可能被截断或构造，遍历前完整校验所有记录
+    Lexicon lexicon;
+    if (!lexicon.open(path, true)) {
+        return false;
+    }
+
+    stats.total = lexicon.getEntryCount();
+    std::string pinyin;
+    DictionaryRecord record;
+    uint64_t visited = 0;
+
+    // forEachEntry不能中途停止，取消后跳过剩余条目；条目是映射内存中的视图，跳过几乎没有开销
+    lexicon.forEachEntry([&](const LexiconEntry& entry) {
+        if (sink.cancelled()) {
+            return;
+        }
+
+        pinyin.clear();
+        for (uint16_t i = 0; i < entry.syllable_count; ++i) {
+            if (i > 0) pinyin += ' ';
+            pinyin.append(lexicon.getSyllable(entry.syllable_ids[i]));
+        }
+
+        record.word = entry.text;
+        record.pinyin = pinyin;
+        record.frequency = entry.frequency;
+        sink.accept(record);
+        sink.advance(++visited);
+    });
+    return true;
+}
+
+/**
+ * 把文件内容写入磁盘
+ */
+bool syncFile(std::FILE* file) {
+    if (std::fflush(file) != 0) {
+        return false;
+    }
+#ifdef _WIN32
+    return _commit(_fileno(file)) == 0;
+#else
+    return fsync(fileno(file)) == 0;
+#endif
+}
+
+void appendCsvField(std::string& out, std::string_view field) {
+    if (field.find_first_of(",\"\r\n") == std::string_view::npos) {
+        out.append(field);
+        return;
+    }
+    out += '"';
+    for (char c : field) {
+        if (c == '"') out += '"';
+        out += c;
+    }
+    out += '"';
+}
+
+void appendJsonString(std::string& out, std::string_view text) {
+    static constexpr char HEX[] = "0123456789abcdef";
+    out += '"';
+    for (char c : text) {
+        unsigned char u = static_cast<unsigned char>(c);
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if (u < 0x20) {
+            out.append("\\u00").append(1, HEX[u >> 4]).append(1, HEX[u & 0xf]);
+        } else {
+            out += c;
+        }
+    }
+    out += '"';
+}
+
+} // namespace
+
+bool parseDictionaryFormat(const std::string& name, const std::string& path, DictionaryFormat& format) {
+    std::string key = name;
+    if (key.empty() || key == "auto") {
+        auto dot = path.find_last_of('.');
+        auto slash = path.find_last_of("/\\");
+        key = dot == std::string::npos || (slash != std::string::npos && dot < slash)
+                  ? "txt" : path.substr(dot + 1);
+    }
+    std::transform(key.begin(), key.end(), key.begin(), [](unsigned char c) { return std::tolower(c); });
+
+    if (key == "txt" || key == "dict") {
+        format = DictionaryFormat::TXT;
+    } else if (key == "csv") {
+        format = DictionaryFormat::CSV;
+    } else if (key == "json") {
+        format = DictionaryFormat::JSON;
+    } else if (key == "lex" || key == "lexicon") {
+        format = DictionaryFormat::LEXICON;
+    } else if (name.empty() || name == "auto") {
+        // 未知扩展名按文本处理
+        format = DictionaryFormat::TXT;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+const char* dictionaryFormatName(DictionaryFormat format) {
+    switch (format) {
+        case DictionaryFormat::TXT: return "txt";
+        case DictionaryFormat::CSV: return "csv";
+        case DictionaryFormat::JSON: return "json";
+        case DictionaryFormat::LEXICON: return "lex";
+    }
+    return "unknown";
+}
+
+DictionaryIoStatus readDictionary(const std::string& path, DictionaryFormat format,
+                                  const DictionaryRecordVisitor& visitor,
+                                  const DictionaryProgressCallback& progress, DictionaryProgress& stats) {
+    stats = DictionaryProgress();
+
+    if (format == DictionaryFormat::LEXICON) {
+        RecordSink sink(visitor, progress, stats, PROGRESS_INTERVAL_ENTRIES);
+        if (!readLexicon(path, sink, stats)) {
+            return DictionaryIoStatus::FAILED;
+        }
+        return !sink.cancelled() && sink.report() ? DictionaryIoStatus::OK : DictionaryIoStatus::CANCELLED;
+    }
+
+    MappedFile file;
+    if (!file.open(path)) {
+        return DictionaryIoStatus::FAILED;
+    }
+
+    const std::string_view text = file.view();
+    stats.total = text.size();
+    RecordSink sink(visitor, progress, stats, PROGRESS_INTERVAL_BYTES);
+
+    bool ok = true;
+    switch (format) {
+        case DictionaryFormat::TXT:
+            readTxt(text, sink);
+            break;
+        case DictionaryFormat::CSV:
+            readCsv(text, sink);
+            break;
+        case DictionaryFormat::JSON:
+            ok = readJson(text, sink);
+            break;
+        case DictionaryFormat::LEXICON:
+            break;
+    }
+
+    if (sink.cancelled()) {
+        return DictionaryIoStatus::CANCELLED;
+    }
+    if (ok) {
+        stats.processed = stats.total;
+    }
+    if (!sink.report()) {
+        return DictionaryIoStatus::CANCELLED;
+    }
+    return ok ? DictionaryIoStatus::OK : DictionaryIoStatus::FAILED;
+}
+
+class DictionaryWriter::Impl {
+public:
+    Impl(const std::string& path, DictionaryFormat format)
+        : path_(path), temp_path_(path + ".tmp"), format_(format), file_(nullptr)
+        , first_(true), failed_(false), committed_(false) {}
+
+    ~Impl() {
+        if (!committed_) {
+            abort();
+        }
+    }
+
+    bool open() {
+        if (format_ == DictionaryFormat::LEXICON) {
+            // 二进制词典需要完整的音节表和全部词条才能排序写出
+            PinyinConverter converter;
+            if (!converter.initialize()) {
+                spdlog::error("Failed to initialize pinyin converter for lexicon export");
+                return false;
+            }
+            std::vector<std::string> syllables;
+            syllables.reserve(converter.getSyllableCount());
+            for (size_t id = 0; id < converter.getSyllableCount(); ++id) {
+                syllables.push_back(converter.getSyllable(static_cast<int>(id)));
+            }
+            builder_ = std::make_unique<LexiconBuilder>(syllables);
+            // 导出不应丢词，每个音节序列保留格式允许的全部条目
+            builder_->setMaxEntriesPerKey(0xffff);
+            return true;
+        }
+
+        file_ = std::fopen(temp_path_.c_str(), "wb");
+        if (!file_) {
+            spdlog::error("Failed to create export file: {}", temp_path_);
+            return false;
+        }
+
+        buffer_.reserve(WRITE_CHUNK_SIZE + 4096);
+        if (format_ == DictionaryFormat::CSV) {
+            buffer_.append("word,pinyin,frequency\n");
+        } else if (format_ == DictionaryFormat::JSON) {
+            buffer_.append("[");
+        }
+        return true;
+    }
+
+    bool write(std::string_view word, std::string_view pinyin, uint32_t frequency) {
+        if (failed_) {
+            return false;
+        }
+
+        switch (format_) {
+            case DictionaryFormat::TXT:
+                buffer_.append(word).append(1, ' ').append(pinyin).append(1, ' ');
+                buffer_.append(std::to_string(frequency)).append(1, '\n');
+                break;
+            case DictionaryFormat::CSV:
+                appendCsvField(buffer_, word);
+                buffer_ += ',';
+                appendCsvField(buffer_, pinyin);
+                buffer_.append(1, ',').append(std::to_string(frequency)).append(1, '\n');
+                break;
+            case DictionaryFormat::JSON:
+                buffer_.append(first_ ? "\n  {\"word\": " : ",\n  {\"word\": ");
+                appendJsonString(buffer_, word);
+                buffer_.append(", \"pinyin\": ");
+                appendJsonString(buffer_, pinyin);
+                buffer_.append(", \"frequency\": ").append(std::to_string(frequency)).append(1, '}');
+                break;
+            case DictionaryFormat::LEXICON:
+                return writeLexiconEntry(word, pinyin, frequency);
+        }
+        first_ = false;
+
+        if (buffer_.size() >= WRITE_CHUNK_SIZE) {
+            return flushBuffer();
+        }
+        return true;
+    }
+
+    bool commit() {
+        if (failed_ || committed_) {
+            return false;
+        }
+
+        bool ok;
+        if (format_ == DictionaryFormat::LEXICON) {
+            ok = builder_ && builder_->write(temp_path_);
+        } else {
+            if (format_ == DictionaryFormat::JSON) {
+                buffer_.append(first_ ? "]\n" : "\n]\n");
+            }
+            ok = file_ && flushBuffer() && syncFile(file_);
+            ok = std::fclose(file_) == 0 && ok;
+            file_ = nullptr;
+        }
+
+        // 写完并同步后再替换，中断时原文件保持完整
+        std::error_code ec;
+        if (ok) {
+            std::filesystem::rename(temp_path_, path_, ec);
+            ok = !ec;
+        }
+        if (!ok) {
+            spdlog::error("Failed to write export file: {}", path_);
+            abort();
+            return false;
+        }
+        committed_ = true;
+        return true;
+    }
+
+    void abort() {
+        if (file_) {
+            std::fclose(file_);
+            file_ = nullptr;
+        }
+        builder_.reset();
+        failed_ = true;
+
+        std::error_code ec;
+        std::filesystem::remove(temp_path_, ec);
+    }
+
+private:
+    bool flushBuffer() {
+        if (!buffer_.empty() && std::fwrite(buffer_.data(), 1, buffer_.size(), file_) != buffer_.size()) {
+            spdlog::error("Failed to write export file: {}", temp_path_);
+            failed_ = true;
+            return false;
+        }
+        buffer_.clear();
+        return true;
+    }
+
+    bool writeLexiconEntry(std::string_view word, std::string_view pinyin, uint32_t frequency) {
+        syllables_.clear();
+        size_t pos = 0;
+        while (pos < pinyin.size()) {
+            size_t end = pinyin.find(' ', pos);
+            if (end == std::string_view::npos) {
+                end = pinyin.size();
+            }
+            if (end > pos) {
+                syllables_.emplace_back(pinyin.substr(pos, end - pos));
+            }
+            pos = end + 1;
+        }
+        return builder_ && builder_->addEntry(std::string(word), syllables_, frequency);
+    }
+
+    std::string path_;
+    std::string temp_path_;
+    DictionaryFormat format_;
+    std::FILE* file_;
+    std::string buffer_;
+    std::unique_ptr<LexiconBuilder> builder_;
+    std::vector<std::string> syllables_;
+    bool first_;
+    bool failed_;
+    bool committed_;
+};
+
+DictionaryWriter::DictionaryWriter(const std::string& path, DictionaryFormat format)
+    : pImpl(std::make_unique<Impl>(path, format)) {
+}
+
+DictionaryWriter::~DictionaryWriter() = default;
+
+bool DictionaryWriter::open() {
+    return pImpl->open();
+}
+
+bool DictionaryWriter::write(std::string_view word, std::string_view pinyin, uint32_t frequency) {
+    return pImpl->write(word, pinyin, frequency);
+}
+
+bool DictionaryWriter::commit() {
+    return pImpl->commit();
+}
+
+void DictionaryWriter::abort() {
+    pImpl->abort();
+}
+
+class DictionaryTask::Impl {
+public:
+    Impl(Work work, DictionaryProgressCallback progress)
+        : progress_callback_(std::move(progress)), status_(DictionaryIoStatus::FAILED)
+        , cancelled_(false), finished_(false) {
+        thread_ = std::thread([this, work = std::move(work)] {
+            DictionaryIoStatus status = work([this](const DictionaryProgress& progress) {
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    progress_ = progress;
+                }
+                if (cancelled_.load(std::memory_order_relaxed)) {
+                    return false;
+                }
+                if (progress_callback_ && !progress_callback_(progress)) {
+                    cancelled_.store(true, std::memory_order_relaxed);
+                    return false;
+                }
+                return true;
+            });
+
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                status_ = status;
+            }
+            finished_.store(true, std::memory_order_release);
+        });
+    }
+
+    ~Impl() {
+        cancel();
+        wait();
+    }
+
+    void cancel() {
+        cancelled_.store(true, std::memory_order_relaxed);
+    }
+
+    bool isFinished() const {
+        return finished_.load(std::memory_order_acquire);
+    }
+
+    DictionaryIoStatus wait() {
+        {
+            std::lock_guard<std::mutex> lock(join_mutex_);
+            if (thread_.joinable()) {
+                thread_.join();
+            }
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        return status_;
+    }
+
+    DictionaryProgress getProgress() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return progress_;
+    }
+
+private:
+    DictionaryProgressCallback progress_callback_;
+    mutable std::mutex mutex_;
+    std::mutex join_mutex_;
+    DictionaryProgress progress_;
+    DictionaryIoStatus status_;
+    std::atomic<bool> cancelled_;
+    std::atomic<bool> finished_;
+    std::thread thread_;
+};
+
+DictionaryTask::DictionaryTask(Work work, DictionaryProgressCallback progress)
+    : pImpl(std::make_unique<Impl>(std::move(work), std::move(progress))) {
+}
+
+DictionaryTask::~DictionaryTask() = default;
+
+void DictionaryTask::cancel() {
+    pImpl->cancel();
+}
+
+bool DictionaryTask::isFinished() const {
+    return pImpl->isFinished();
+}
+
+DictionaryIoStatus DictionaryTask::wait() {
+    return pImpl->wait();
+}
+
+DictionaryProgress DictionaryTask::getProgress() const {
+    return pImpl->getProgress();
+}
+
+} // namespace core
+} // namespace owcat
\ No newline at end of file
@@ -1,24 +1,100 @@
 #include "core/dictionary_manager.h"
+#include "core/fuzzy_pinyin.h"
+#include "core/lexicon.h"
+#include "core/ngram_model.h"
+#include "core/pinyin_converter.h"
+#include "core/sentence_decoder.h"
+#include "core/user_dictionary.h"
 #include <spdlog/spdlog.h>
 #include <sqlite3.h>
 #include <fstream>
 #include <sstream>
 #include <algorithm>
+#include <iomanip>
+#include <atomic>
 #include <nlohmann/json.hpp>
 
 namespace owcat {
 namespace core {
 
+// 缓存的预编译语句（用户词由UserDictionary保存，SQLite只查询系统词）
+enum StatementId {
+    STMT_SEARCH_BY_PINYIN,
+    STMT_FUZZY_SEARCH,
+    STMT_COUNT
+};
+
+static const char* const STATEMENT_SQL[STMT_COUNT] = {
+    // STMT_SEARCH_BY_PINYIN
+    R"(
+        SELECT word, pinyin, frequency 
+        FROM words 
+        WHERE (pinyin LIKE ? OR pinyin LIKE ?) AND is_user_word = 0
+        ORDER BY frequency DESC, length(word) ASC
+        LIMIT ?
+    )",
+    // STMT_FUZZY_SEARCH
+    R"(
+        SELECT word, pinyin, frequency 
+        FROM words 
+        WHERE pinyin LIKE ? AND is_user_word = 0
+        ORDER BY frequency DESC, length(word) ASC
+        LIMIT ?
+    )"
+};
+
+// 单次查询从系统词典取出的最大条目数
+static constexpr size_t MAX_LEXICON_RESULTS = 64;
+
+// 模糊匹配的候选词每单位替代代价扣除的分数
+static constexpr double FUZZY_SCORE_PENALTY = 5.0;
+
+// 单次模糊查询最多展开的音节组合数
+static constexpr size_t MAX_FUZZY_QUERIES = 16;
+
+// 整句候选的打分：最优整句与词库中高频的完全匹配词同分，其余按平均每音节的对数概率差扣分
+static constexpr double SENTENCE_TOP_SCORE = 100.0;
+static constexpr double SENTENCE_SCORE_PER_NAT = 10.0;
+
+// 按前文重排：候选词的二元概率每高出一元概率一个nat加CONTEXT_SCORE_PER_NAT分，最多加MAX_CONTEXT_GAIN个nat
+static constexpr double CONTEXT_SCORE_PER_NAT = 4.0;
+static constexpr double MAX_CONTEXT_GAIN = 5.0;
+
+// 在前文末尾查找上文词时最多尝试的字数
+static constexpr size_t MAX_CONTEXT_WORD_CHARS = 4;
+
+// 使用结束后重置语句并清除绑定，释放读锁
+class StatementGuard {
+public:
+    explicit StatementGuard(sqlite3_stmt* stmt) : stmt_(stmt) {}
+    ~StatementGuard() {
+        if (stmt_) {
+            sqlite3_reset(stmt_);
+            sqlite3_clear_bindings(stmt_);
+        }
+    }
+    
+    StatementGuard(const StatementGuard&) = delete;
+    StatementGuard& operator=(const StatementGuard&) = delete;
+    
+private:
+    sqlite3_stmt* stmt_;
+};
+
 class DictionaryManager::Impl {
 public:
-    explicit Impl(const std::string& db_path) 
-        : db_path_(db_path), db_(nullptr) {
+    Impl(const std::string& db_path, const std::string& lexicon_path, const std::string& ngram_path) 
+        : db_path_(db_path), lexicon_path_(lexicon_path), ngram_path_(ngram_path), db_(nullptr)
+        , sentence_decoder_(lexicon_, ngram_), statement_hits_(0), statement_prepares_(0)
+        , lexicon_results_(MAX_LEXICON_RESULTS), lexicon_penalties_(MAX_LEXICON_RESULTS)
+        , fuzzy_results_(MAX_LEXICON_RESULTS)
+        , user_revision_(0)
+        , user_dict_(db_path.empty() || db_path == ":memory:" ? std::string() : db_path + ".user") {
+        std::fill(std::begin(statements_), std::end(statements_), nullptr);
     }
     
     ~Impl() {
-        if (db_) {
-            sqlite3_close(db_);
-        }
+        shutdown();
     }
     
     bool initialize() {
@@ -31,28 +107,176 @@ public:
             return false;
         }
         
+        // WAL模式下读写互不阻塞，批量提交不必每次fsync
+        configureConnection(db_);
+        
         // 创建表结构
         if (!createTables()) {
             spdlog::error("Failed to create database tables");
             return false;
         }
         
+        // 标准拼音表，没有系统词典时用来识别简拼输入中的完整音节
+        if (!syllable_table_.initialize()) {
+            spdlog::warn("Failed to load the standard syllable table, abbreviated user words disabled");
+        }
+        
+        // 优先使用内存映射的系统词典，SQLite只保存用户词
+        if (!lexicon_path_.empty()) {
+            std::ifstream lexicon_file(lexicon_path_);
+            if (!lexicon_file.good()) {
+                spdlog::info("System lexicon not found: {}, using SQLite dictionary", lexicon_path_);
+            } else if (!lexicon_.open(lexicon_path_)) {
+                spdlog::warn("Failed to open system lexicon: {}, using SQLite dictionary", lexicon_path_);
+            }
+        }
+        
+        // 整句解码的语言模型，词网格来自系统词典
+        if (lexicon_.isOpen() && !ngram_path_.empty()) {
+            std::ifstream ngram_file(ngram_path_);
+            if (!ngram_file.good()) {
+                spdlog::info("N-gram model not found: {}, sentence candidates disabled", ngram_path_);
+            } else if (!ngram_.open(ngram_path_)) {
+                spdlog::warn("Failed to open n-gram model: {}, sentence candidates disabled", ngram_path_);
+            }
+        }
+        
+        buildFuzzyTable();
+        
         // 加载系统词库
-        if (!loadSystemDictionary()) {
+        if (!lexicon_.isOpen() && !loadSystemDictionary()) {
             spdlog::warn("Failed to load system dictionary, continuing with empty dictionary");
         }
         
+        // 预编译常用语句
+        if (!prepareStatements()) {
+            spdlog::error("Failed to prepare cached statements");
+            return false;
+        }
+        
+        // 用户词库叠加在系统词之上，学习结果在内存中立即生效，日志在后台批量同步
+        if (!user_dict_.open()) {
+            spdlog::error("Failed to open user dictionary");
+            return false;
+        }
+        if (!user_dict_.existedOnDisk()) {
+            migrateUserWords();
+        }
+        
         spdlog::info("Dictionary manager initialized successfully");
         return true;
     }
     
     void shutdown() {
+        user_dict_.close();
+        finalizeStatements();
+        fuzzy_.clear();
+        ngram_.close();
+        lexicon_.close();
+        
         if (db_) {
             sqlite3_close(db_);
             db_ = nullptr;
         }
     }
     
+    void configureConnection(sqlite3* db) {
+        sqlite3_busy_timeout(db, 1000);
+        
+        char* err_msg = nullptr;
+        if (sqlite3_exec(db, "PRAGMA journal_mode=WAL; PRAGMA synchronous=NORMAL;", nullptr, nullptr, &err_msg) != SQLITE_OK) {
+            spdlog::warn("Failed to enable WAL mode: {}", err_msg ? err_msg : "unknown error");
+            sqlite3_free(err_msg);
+        }
+    }
+    
+    /**
+     * 把旧版本保存在SQLite中的用户词迁移到用户词库，写入快照后才从SQLite删除
+     * @return 是否迁移成功
+     */
+    bool migrateUserWords() {
+        sqlite3_stmt* stmt = nullptr;
+        if (sqlite3_prepare_v2(db_, "SELECT word, pinyin, frequency FROM words WHERE is_user_word = 1", -1, &stmt,
+                               nullptr) != SQLITE_OK) {
+            spdlog::error("Failed to prepare user word migration: {}", sqlite3_errmsg(db_));
+            return false;
+        }
+        
+        int migrated = 0;
+        while (sqlite3_step(stmt) == SQLITE_ROW) {
+            std::string word = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0));
+            std::string pinyin = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1));
+            if (user_dict_.addWord(word, pinyin, sqlite3_column_int(stmt, 2))) {
+                ++migrated;
+            }
+        }
+        sqlite3_finalize(stmt);
+        
+        if (migrated == 0) {
+            return true;
+        }
+        if (!user_dict_.compact()) {
+            spdlog::warn("Failed to persist migrated user words, keeping them in SQLite");
+            return false;
+        }
+        
+        sqlite3_exec(db_, "DELETE FROM words WHERE is_user_word = 1", nullptr, nullptr, nullptr);
+        spdlog::info("Migrated {} user words from SQLite to the user dictionary", migrated);
+        return true;
+    }
+    
+    bool prepareStatements() {
+        for (int id = 0; id < STMT_COUNT; ++id) {
+            if (!prepareStatement(static_cast<StatementId>(id))) {
+                return false;
+            }
+        }
+        return true;
+    }
+    
+    bool prepareStatement(StatementId id) const {
+        if (statements_[id]) {
+            return true;
+        }
+        
+        int rc = sqlite3_prepare_v3(db_, STATEMENT_SQL[id], -1, SQLITE_PREPARE_PERSISTENT, &statements_[id], nullptr);
+        if (rc != SQLITE_OK) {
+            spdlog::error("Failed to prepare statement {}: {}", static_cast<int>(id), sqlite3_errmsg(db_));
+            statements_[id] = nullptr;
+            return false;
+        }
+        
+        ++statement_prepares_;
+        return true;
+    }
+    
+    void finalizeStatements() {
+        for (auto& stmt : statements_) {
+            if (stmt) {
+                sqlite3_finalize(stmt);
+                stmt = nullptr;
+            }
+        }
+    }
+    
+    /**
+     * 获取缓存的语句，必要时重新编译
+     * @param id 语句ID
+     * @return 已重置的语句，失败时返回nullptr
+     */
+    sqlite3_stmt* acquireStatement(StatementId id) const {
+        if (!db_) {
+            return nullptr;
+        }
+        
+        if (statements_[id]) {
+            ++statement_hits_;
+            return statements_[id];
+        }
+        
+        return prepareStatement(id) ? statements_[id] : nullptr;
+    }
+    
     bool createTables() {
         const char* create_words_table = R"(
             CREATE TABLE IF NOT EXISTS words (
@@ -129,6 +353,9 @@ public:
             return false;
         }
         
+        // 单个事务写入，避免启动时逐条提交
+        sqlite3_exec(db_, "BEGIN", nullptr, nullptr, nullptr);
+        
         for (const auto& [word, pinyin] : basic_words) {
             sqlite3_bind_text(stmt, 1, word.c_str(), -1, SQLITE_STATIC);
             sqlite3_bind_text(stmt, 2, pinyin.c_str(), -1, SQLITE_STATIC);
@@ -143,29 +370,295 @@ public:
         }
         
         sqlite3_finalize(stmt);
+        sqlite3_exec(db_, "COMMIT", nullptr, nullptr, nullptr);
         return true;
     }
     
     CandidateList searchByPinyin(const std::string& pinyin, int max_results) const {
+        if (lexicon_.isOpen()) {
+            return searchLayered(pinyin, max_results);
+        }
+        
+        return mergeUserLayer(pinyin, searchDatabase(STMT_SEARCH_BY_PINYIN, pinyin, max_results), CandidateList(),
+                              max_results);
+    }
+    
+    /**
+     * 系统词典与用户词合并查询
+     */
+    CandidateList searchLayered(const std::string& pinyin, int max_results) const {
+        size_t limit = std::min<size_t>(std::max(0, max_results), lexicon_results_.size());
+        size_t count;
+        if (fuzzy_.isEnabled()) {
+            count = lookupFuzzy(pinyin, limit);
+        } else {
+            count = lexicon_.lookupPinyin(pinyin, lexicon_results_.data(), limit);
+            std::fill(lexicon_penalties_.begin(), lexicon_penalties_.begin() + count, 0);
+        }
+        
         CandidateList candidates;
+        candidates.reserve(count);
+        CandidateList fuzzy_candidates;
         
-        const char* sql = R"(
-            SELECT word, pinyin, frequency 
-            FROM words 
-            WHERE pinyin LIKE ? OR pinyin LIKE ?
-            ORDER BY frequency DESC, length(word) ASC
-            LIMIT ?
-        )";
+        for (size_t i = 0; i < count; ++i) {
+            const LexiconEntry& entry = lexicon_results_[i];
+            
+            std::string word(entry.text);
+            std::string word_pinyin;
+            for (uint16_t j = 0; j < entry.syllable_count; ++j) {
+                if (j > 0) word_pinyin += ' ';
+                word_pinyin.append(lexicon_.getSyllable(entry.syllable_ids[j]));
+            }
+            
+            int frequency = static_cast<int>(std::min<uint32_t>(entry.frequency, INT32_MAX));
+            if (lexicon_penalties_[i] > 0) {
+                double score = calculateScore(word, word_pinyin, frequency, pinyin) -
+                               FUZZY_SCORE_PENALTY * lexicon_penalties_[i];
+                fuzzy_candidates.emplace_back(word, word_pinyin, score, frequency, false);
+            } else {
+                double score = calculateScore(word, word_pinyin, frequency, pinyin);
+                candidates.emplace_back(word, word_pinyin, score, frequency, false);
+            }
+        }
         
-        sqlite3_stmt* stmt;
-        int rc = sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr);
-        if (rc != SQLITE_OK) {
+        return mergeUserLayer(pinyin, std::move(candidates), std::move(fuzzy_candidates), max_results);
+    }
+    
+    /**
+     * 把用户层合并到系统词的查询结果中
+     * 用户词按拼音前缀（简拼时按首字母）查询后与系统词一起排序；系统词在用户层有记录时以用户层为准，
+     * 学习得到的频率增量加到系统词频率上
+     * @param pinyin 查询拼音
+     * @param candidates 系统词中的精确匹配，按频率降序
+     * @param fuzzy_candidates 系统词中的模糊匹配，按替代代价升序，排在精确匹配之后
+     * @param max_results 最大结果数
+     * @return 合并后的候选词
+     */
+    CandidateList mergeUserLayer(const std::string& pinyin, CandidateList candidates, CandidateList fuzzy_candidates,
+                                 int max_results) const {
+        const size_t limit = static_cast<size_t>(std::max(0, max_results));
+        std::vector<UserWord> user_words;
+        const std::string initials = abbreviationInitials(pinyin);
+        if (initials.empty()) {
+            user_dict_.search(pinyin, limit, user_words);
+        } else {
+            user_dict_.searchAbbreviated(initials, limit, [&](const std::string& word_pinyin) {
+                return matchesPinyinPrefix(word_pinyin, pinyin);
+            }, user_words);
+        }
+        
+        CandidateList merged;
+        merged.reserve(user_words.size() + candidates.size() + fuzzy_candidates.size());
+        for (const auto& user_word : user_words) {
+            double score = calculateScore(user_word.word, user_word.pinyin, user_word.frequency, pinyin);
+            merged.emplace_back(user_word.word, user_word.pinyin, score, user_word.frequency, false);
+        }
+        const size_t user_count = merged.size();
+        
+        // 按新频率调整得分，模糊匹配的扣分保持不变
+        auto applyUserLayer = [&](Candidate& candidate) {
+            UserWord entry;
+            if (!user_dict_.find(candidate.text, candidate.pinyin, entry)) {
+                return true;
+            }
+            
+            // 已作为用户词给出的不再重复
+            const double previous = calculateScore(candidate.text, candidate.pinyin, candidate.frequency, pinyin);
+            if (entry.user_word) {
+                for (size_t i = 0; i < user_count; ++i) {
+                    if (merged[i].text == candidate.text && merged[i].pinyin == candidate.pinyin) {
+                        return false;
+                    }
+                }
+                candidate.frequency = entry.frequency;
+            } else {
+                candidate.frequency = static_cast<int>(
+                    std::min<int64_t>(static_cast<int64_t>(candidate.frequency) + entry.frequency, INT32_MAX));
+            }
+            candidate.score += calculateScore(candidate.text, candidate.pinyin, candidate.frequency, pinyin) - previous;
+            return true;
+        };
+        
+        for (auto& candidate : candidates) {
+            if (applyUserLayer(candidate)) {
+                merged.push_back(std::move(candidate));
+            }
+        }
+        
+        // 与SQL查询保持相同的排序：频率降序，短词优先
+        std::stable_sort(merged.begin(), merged.end(), [](const Candidate& a, const Candidate& b) {
+            if (a.frequency != b.frequency) {
+                return a.frequency > b.frequency;
+            }
+            return a.text.length() < b.text.length();
+        });
+        
+        // 模糊匹配的词排在精确匹配之后，已按替代代价升序、频率降序排列
+        for (auto& candidate : fuzzy_candidates) {
+            if (applyUserLayer(candidate)) {
+                merged.push_back(std::move(candidate));
+            }
+        }
+        
+        if (merged.size() > limit) {
+            merged.resize(limit);
+        }
+        return merged;
+    }
+    
+    /**
+     * 按模糊音展开表查询系统词典，结果写入lexicon_results_和lexicon_penalties_
+     * 展开的各条查询按代价升序依次执行，同一条目只保留代价最低的一次
+     */
+    size_t lookupFuzzy(const std::string& pinyin, size_t limit) const {
+        FuzzyPinyin::Query queries[MAX_FUZZY_QUERIES];
+        size_t query_count = fuzzy_.expand(pinyin, queries, MAX_FUZZY_QUERIES);
+        
+        // 无法展开的输入（如简拼）按原拼音查询
+        if (query_count == 0) {
+            size_t count = lexicon_.lookupPinyin(pinyin, lexicon_results_.data(), limit);
+            std::fill(lexicon_penalties_.begin(), lexicon_penalties_.begin() + count, 0);
+            return count;
+        }
+        
+        size_t written = 0;
+        for (size_t q = 0; q < query_count && written < limit; ++q) {
+            const FuzzyPinyin::Query& query = queries[q];
+            size_t count = lexicon_.lookupPrefix(query.syllable_ids, query.syllable_count, query.lastSyllable(),
+                                                 fuzzy_results_.data(), limit);
+            for (size_t i = 0; i < count && written < limit; ++i) {
+                const LexiconEntry& entry = fuzzy_results_[i];
+                
+                // 条目文本指向字符串池，地址相同即为同一条目
+                bool duplicate = false;
+                for (size_t k = 0; k < written; ++k) {
+                    if (lexicon_results_[k].text.data() == entry.text.data()) {
+                        duplicate = true;
+                        break;
+                    }
+                }
+                if (!duplicate) {
+                    lexicon_results_[written] = entry;
+                    lexicon_penalties_[written] = query.penalty;
+                    ++written;
+                }
+            }
+        }
+        return written;
+    }
+    
+    void setFuzzyPinyin(const FuzzyPinyinConfig& config) {
+        fuzzy_config_ = config;
+        buildFuzzyTable();
+    }
+    
+    void buildFuzzyTable() {
+        if (!lexicon_.isOpen()) {
+            fuzzy_.clear();
+            return;
+        }
+        
+        std::vector<std::string> syllables;
+        syllables.reserve(lexicon_.getSyllableCount());
+        for (size_t i = 0; i < lexicon_.getSyllableCount(); ++i) {
+            syllables.emplace_back(lexicon_.getSyllable(static_cast<int>(i)));
+        }
+        fuzzy_.build(syllables, fuzzy_config_);
+    }
+    
+    std::unique_ptr<SentenceDecoder> createSentenceDecoder() const {
+        if (!ngram_.isOpen()) {
+            return nullptr;
+        }
+        return std::make_unique<SentenceDecoder>(lexicon_, ngram_);
+    }
+    
+    CandidateList searchSentence(const std::vector<std::string>& syllables, bool complete, int max_results) const {
+        return searchSentence(sentence_decoder_, decoded_sentences_, syllables, complete, max_results);
+    }
+    
+    CandidateList searchSentence(SentenceDecoder& decoder, std::vector<DecodedSentence>& decoded,
+                                 const std::vector<std::string>& syllables, bool complete, int max_results) const {
+        CandidateList candidates;
+        if (!ngram_.isOpen() || syllables.size() < 2 || max_results <= 0) {
+            return candidates;
+        }
+        
+        size_t count = decoder.decode(syllables, !complete, static_cast<size_t>(max_results) + 1, decoded);
+        if (count == 0) {
+            return candidates;
+        }
+        
+        // 最优路径为满分，每个音节平均每低一个nat扣SENTENCE_SCORE_PER_NAT分
+        const float best = decoded.front().log_prob;
+        const double per_syllable = 1.0 / static_cast<double>(syllables.size());
+        for (const auto& sentence : decoded) {
+            if (sentence.word_count < 2 || candidates.size() >= static_cast<size_t>(max_results)) {
+                continue;
+            }
+            double score = SENTENCE_TOP_SCORE + SENTENCE_SCORE_PER_NAT * (sentence.log_prob - best) * per_syllable;
+            candidates.emplace_back(sentence.text, sentence.pinyin, score, 0, false);
+        }
+        return candidates;
+    }
+    
+    size_t rerankByContext(const std::string& context, CandidateList& candidates) const {
+        if (!ngram_.isOpen() || context.empty() || candidates.empty()) {
+            return 0;
+        }
+        
+        // 前文末尾最长的、在词表中的词作为上文
+        std::string_view text(context);
+        uint32_t previous = NgramModel::kNoWord;
+        size_t begin = text.size();
+        for (size_t chars = 0; chars < MAX_CONTEXT_WORD_CHARS && begin > 0; ++chars) {
+            do {
+                --begin;
+            } while (begin > 0 && (static_cast<unsigned char>(text[begin]) & 0xC0) == 0x80);
+            uint32_t id = ngram_.findWord(text.substr(begin));
+            if (id != NgramModel::kNoWord) {
+                previous = id;
+            }
+        }
+        if (previous == NgramModel::kNoWord) {
+            return 0;
+        }
+        
+        // 只奖励二元概率高于一元概率的词；没有二元统计的词和词表外的词（用户词、整句）得分不变
+        size_t supported = 0;
+        for (auto& candidate : candidates) {
+            uint32_t word = ngram_.findWord(candidate.text);
+            if (word == NgramModel::kNoWord) {
+                continue;
+            }
+            double gain = ngram_.logProb(NgramModel::kNoWord, previous, word) -
+                          ngram_.logProb(NgramModel::kNoWord, NgramModel::kNoWord, word);
+            if (gain > 0.0) {
+                candidate.score += CONTEXT_SCORE_PER_NAT * std::min(gain, MAX_CONTEXT_GAIN);
+                ++supported;
+            }
+        }
+        
+        if (supported > 0) {
+            std::stable_sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b) {
+                return a.score > b.score;
+            });
+        }
+        return supported;
+    }
+    
+    CandidateList searchDatabase(StatementId id, const std::string& pinyin, int max_results) const {
+        CandidateList candidates;
+        
+        sqlite3_stmt* stmt = acquireStatement(id);
+        if (!stmt) {
             spdlog::error("Failed to prepare search statement: {}", sqlite3_errmsg(db_));
             return candidates;
         }
         
         std::string exact_match = pinyin;
         std::string prefix_match = pinyin + "%";
+        StatementGuard guard(stmt);
         
         sqlite3_bind_text(stmt, 1, exact_match.c_str(), -1, SQLITE_STATIC);
         sqlite3_bind_text(stmt, 2, prefix_match.c_str(), -1, SQLITE_STATIC);
@@ -180,7 +673,6 @@ public:
             candidates.emplace_back(word, word_pinyin, score, frequency, false);
         }
         
-        sqlite3_finalize(stmt);
         return candidates;
     }
     
@@ -201,25 +693,151 @@ public:
         return searchByPinyin(pinyin_pattern, max_results);
     }
     
+    CandidateList filterByPinyin(const CandidateList& candidates, const std::string& pinyin, int max_results) const {
+        if (fuzzy_.isEnabled()) {
+            return filterByFuzzyPinyin(candidates, pinyin, max_results);
+        }
+        
+        CandidateList filtered;
+        for (const auto& candidate : candidates) {
+            if (filtered.size() >= static_cast<size_t>(std::max(0, max_results))) {
+                break;
+            }
+            if (!matchesPinyinPrefix(candidate.pinyin, pinyin)) {
+                continue;
+            }
+            
+            filtered.push_back(candidate);
+            filtered.back().score = calculateScore(candidate.text, candidate.pinyin, candidate.frequency, pinyin);
+        }
+        return filtered;
+    }
+    
+    /**
+     * 简拼查询的首字母序列：与系统词典相同，至少两个音节且末尾之前有不是完整音节的输入（如 "z g r"）
+     * @param pinyin 输入拼音，音节以空格分隔
+     * @return 各音节首字母，不是简拼查询时为空
+     */
+    std::string abbreviationInitials(const std::string& pinyin) const {
+        std::string initials;
+        bool abbreviated = false;
+        size_t pos = 0;
+        while (pos < pinyin.size()) {
+            size_t space = pinyin.find(' ', pos);
+            if (space == std::string::npos) {
+                space = pinyin.size();
+            }
+            std::string_view token(pinyin.data() + pos, space - pos);
+            const bool is_last = space >= pinyin.size();
+            pos = space + 1;
+            if (token.empty()) {
+                continue;
+            }
+            if (!is_last && !isFullSyllable(token)) {
+                abbreviated = true;
+            }
+            initials.push_back(token[0]);
+        }
+        return abbreviated && initials.size() >= 2 ? initials : std::string();
+    }
+    
+    /**
+     * 检查输入片段是否为完整音节：与系统词典一致时使用其音节表，没有系统词典时使用标准拼音表
+     */
+    bool isFullSyllable(std::string_view token) const {
+        if (lexicon_.isOpen()) {
+            return lexicon_.findSyllableId(token) >= 0;
+        }
+        return syllable_table_.getSyllableId(token) >= 0;
+    }
+    
+    /**
+     * 检查词的拼音能否由输入拼音得到：末尾音节按前缀比较，非末尾的简拼音节（如 "z g r" 中的 z g）也按前缀比较
+     * @param word_pinyin 词的完整拼音，音节以空格分隔
+     * @param pinyin 输入拼音
+     * @return 是否匹配
+     */
+    bool matchesPinyinPrefix(const std::string& word_pinyin, const std::string& pinyin) const {
+        if (word_pinyin.compare(0, pinyin.size(), pinyin) == 0) {
+            return true;
+        }
+        
+        size_t word_pos = 0;
+        size_t pos = 0;
+        while (pos < pinyin.size()) {
+            size_t space = pinyin.find(' ', pos);
+            if (space == std::string::npos) {
+                space = pinyin.size();
+            }
+            std::string_view token(pinyin.data() + pos, space - pos);
+            const bool is_last = space >= pinyin.size();
+            pos = space + 1;
+            if (token.empty()) {
+                continue;
+            }
+            
+            if (word_pos >= word_pinyin.size()) {
+                return false;
+            }
+            size_t word_space = word_pinyin.find(' ', word_pos);
+            if (word_space == std::string::npos) {
+                word_space = word_pinyin.size();
+            }
+            std::string_view syllable(word_pinyin.data() + word_pos, word_space - word_pos);
+            word_pos = word_space + 1;
+            
+            const bool prefix = is_last || !isFullSyllable(token);
+            if (prefix ? syllable.compare(0, token.size(), token) != 0 : syllable != token) {
+                return false;
+            }
+        }
+        return true;
+    }
+    
+    /**
+     * 模糊音下的筛选：按替代代价分组，精确匹配在前，组内保持原有顺序
+     */
+    CandidateList filterByFuzzyPinyin(const CandidateList& candidates, const std::string& pinyin,
+                                      int max_results) const {
+        std::vector<int> penalties(candidates.size());
+        int max_penalty = -1;
+        for (size_t i = 0; i < candidates.size(); ++i) {
+            penalties[i] = fuzzy_.matchPenalty(candidates[i].pinyin, pinyin);
+            max_penalty = std::max(max_penalty, penalties[i]);
+        }
+        
+        CandidateList filtered;
+        const size_t limit = static_cast<size_t>(std::max(0, max_results));
+        for (int penalty = 0; penalty <= max_penalty && filtered.size() < limit; ++penalty) {
+            for (size_t i = 0; i < candidates.size() && filtered.size() < limit; ++i) {
+                if (penalties[i] != penalty) {
+                    continue;
+                }
+                const Candidate& candidate = candidates[i];
+                filtered.push_back(candidate);
+                filtered.back().score = calculateScore(candidate.text, candidate.pinyin, candidate.frequency, pinyin) -
+                                        FUZZY_SCORE_PENALTY * penalty;
+            }
+        }
+        return filtered;
+    }
+    
     CandidateList fuzzySearch(const std::string& partial_pinyin, int max_results) const {
-        CandidateList candidates;
+        if (lexicon_.isOpen()) {
+            return searchLayered(partial_pinyin, max_results);
+        }
         
-        const char* sql = R"(
-            SELECT word, pinyin, frequency 
-            FROM words 
-            WHERE pinyin LIKE ?
-            ORDER BY frequency DESC, length(word) ASC
-            LIMIT ?
-        )";
+        CandidateList candidates;
         
-        sqlite3_stmt* stmt;
-        int rc = sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr);
-        if (rc != SQLITE_OK) {
+        sqlite3_stmt* stmt = acquireStatement(STMT_FUZZY_SEARCH);
+        if (!stmt) {
             spdlog::error("Failed to prepare fuzzy search statement: {}", sqlite3_errmsg(db_));
             return candidates;
         }
         
         std::string pattern = "%" + partial_pinyin + "%";
+        StatementGuard guard(stmt);
+        
         sqlite3_bind_text(stmt, 1, pattern.c_str(), -1, SQLITE_STATIC);
         sqlite3_bind_int(stmt, 2, max_results);
         
@@ -232,82 +850,110 @@ public:
             candidates.emplace_back(word, word_pinyin, score, frequency, false);
         }
         
-        sqlite3_finalize(stmt);
         return candidates;
     }
     
     bool addUserWord(const std::string& word, const std::string& pinyin, int frequency) {
-        const char* sql = "INSERT OR REPLACE INTO words (word, pinyin, frequency, is_user_word) VALUES (?, ?, ?, 1)";
-        sqlite3_stmt* stmt;
-        
-        int rc = sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr);
-        if (rc != SQLITE_OK) {
-            spdlog::error("Failed to prepare add user word statement: {}", sqlite3_errmsg(db_));
-            return false;
-        }
-        
-        sqlite3_bind_text(stmt, 1, word.c_str(), -1, SQLITE_STATIC);
-        sqlite3_bind_text(stmt, 2, pinyin.c_str(), -1, SQLITE_STATIC);
-        sqlite3_bind_int(stmt, 3, frequency);
-        
-        rc = sqlite3_step(stmt);
-        sqlite3_finalize(stmt);
-        
-        if (rc != SQLITE_DONE) {
-            spdlog::error("Failed to add user word: {}", sqlite3_errmsg(db_));
+        if (!user_dict_.addWord(word, pinyin, frequency)) {
+            spdlog::warn("Rejected user word: {} ({})", word, pinyin);
             return false;
         }
-        
+        ++user_revision_;
         spdlog::debug("Added user word: {} ({})", word, pinyin);
         return true;
     }
     
     bool updateWordFrequency(const std::string& word, const std::string& pinyin) {
-        const char* sql = "UPDATE words SET frequency = frequency + 1, updated_at = CURRENT_TIMESTAMP WHERE word = ? AND pinyin = ?";
-        sqlite3_stmt* stmt;
-        
-        int rc = sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr);
-        if (rc != SQLITE_OK) {
-            spdlog::error("Failed to prepare update frequency statement: {}", sqlite3_errmsg(db_));
+        return user_dict_.addFrequency(word, pinyin, 1);
+    }
+    
+    bool removeUserWord(const std::string& word, const std::string& pinyin) {
+        if (!user_dict_.removeWord(word, pinyin)) {
             return false;
         }
+        ++user_revision_;
+        return true;
+    }
+    
+    /**
+     * 流式导入词库文件中的词到用户层，导入后同步日志
+     */
+    DictionaryIoStatus importFile(const std::string& file_path, DictionaryFormat format,
+                                  const DictionaryProgressCallback& progress) {
+        std::string word;
+        std::string pinyin;
+        DictionaryProgress stats;
+        DictionaryIoStatus status = readDictionary(file_path, format, [&](const DictionaryRecord& record) {
+            word.assign(record.word);
+            pinyin.assign(record.pinyin);
+            int frequency = static_cast<int>(std::min<uint32_t>(record.frequency, INT32_MAX));
+            return user_dict_.addWord(word, pinyin, frequency);
+        }, progress, stats);
         
-        sqlite3_bind_text(stmt, 1, word.c_str(), -1, SQLITE_STATIC);
-        sqlite3_bind_text(stmt, 2, pinyin.c_str(), -1, SQLITE_STATIC);
-        
-        rc = sqlite3_step(stmt);
-        sqlite3_finalize(stmt);
+        // 取消或失败时已导入的词同样生效
+        if (stats.entries > 0) {
+            ++user_revision_;
+        }
         
-        if (rc != SQLITE_DONE) {
-            spdlog::error("Failed to update word frequency: {}", sqlite3_errmsg(db_));
-            return false;
+        if (!user_dict_.sync()) {
+            spdlog::error("Failed to persist imported words");
+            return DictionaryIoStatus::FAILED;
         }
         
-        return true;
+        spdlog::info("Imported {} words from {} ({} rejected{})", stats.entries, file_path, stats.rejected,
+                     status == DictionaryIoStatus::CANCELLED ? ", cancelled" : "");
+        return status;
     }
     
-    bool removeUserWord(const std::string& word, const std::string& pinyin) {
-        const char* sql = "DELETE FROM words WHERE word = ? AND pinyin = ? AND is_user_word = 1";
-        sqlite3_stmt* stmt;
-        
-        int rc = sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr);
-        if (rc != SQLITE_OK) {
-            spdlog::error("Failed to prepare remove user word statement: {}", sqlite3_errmsg(db_));
-            return false;
+    void setFrequencyHalfLife(double days) {
+        user_dict_.setHalfLife(days);
+        ++user_revision_;
+    }
+    
+    int cleanupLowFrequencyWords(int min_frequency) {
+        int removed = user_dict_.prune(min_frequency);
+        if (removed > 0) {
+            ++user_revision_;
+        }
+        spdlog::info("Cleaned up {} low frequency words", removed);
+        return removed;
+    }
+    
+    /**
+     * 按频率降序导出用户词
+     */
+    DictionaryIoStatus exportFile(const std::string& file_path, DictionaryFormat format,
+                                  const DictionaryProgressCallback& progress) const {
+        DictionaryWriter writer(file_path, format);
+        if (!writer.open()) {
+            return DictionaryIoStatus::FAILED;
         }
         
-        sqlite3_bind_text(stmt, 1, word.c_str(), -1, SQLITE_STATIC);
-        sqlite3_bind_text(stmt, 2, pinyin.c_str(), -1, SQLITE_STATIC);
-        
-        rc = sqlite3_step(stmt);
-        sqlite3_finalize(stmt);
+        const std::vector<UserWord> words = user_dict_.getUserWords();
+        DictionaryProgress stats;
+        stats.total = words.size();
+        for (const auto& user_word : words) {
+            if (writer.write(user_word.word, user_word.pinyin, static_cast<uint32_t>(std::max(1, user_word.frequency)))) {
+                ++stats.entries;
+            } else {
+                ++stats.rejected;
+            }
+            if (++stats.processed % 4096 == 0 && progress && !progress(stats)) {
+                writer.abort();
+                return DictionaryIoStatus::CANCELLED;
+            }
+        }
         
-        if (rc != SQLITE_DONE) {
-            spdlog::error("Failed to remove user word: {}", sqlite3_errmsg(db_));
-            return false;
+        if (progress && !progress(stats)) {
+            writer.abort();
+            return DictionaryIoStatus::CANCELLED;
+        }
+        if (!writer.commit()) {
+            return DictionaryIoStatus::FAILED;
         }
         
-        return true;
+        spdlog::info("Exported {} user words to {}", stats.entries, file_path);
+        return DictionaryIoStatus::OK;
     }
     
     std::string getStatistics() const {
@@ -328,16 +974,29 @@ public:
         
         std::stringstream ss;
         if (sqlite3_step(stmt) == SQLITE_ROW) {
-            int total = sqlite3_column_int(stmt, 0);
-            int user = sqlite3_column_int(stmt, 1);
+            UserDictionaryStats user_stats = user_dict_.getStats();
             int system = sqlite3_column_int(stmt, 2);
+            int user = sqlite3_column_int(stmt, 1) + static_cast<int>(user_stats.words);
+            int total = system + user;
             double avg_freq = sqlite3_column_double(stmt, 3);
             
             ss << "Dictionary Statistics:\n";
             ss << "  Total words: " << total << "\n";
             ss << "  User words: " << user << "\n";
             ss << "  System words: " << system << "\n";
-            ss << "  Average frequency: " << std::fixed << std::setprecision(2) << avg_freq;
+            ss << "  Average frequency: " << std::fixed << std::setprecision(2) << avg_freq << "\n";
+            ss << "  Statement cache: " << statement_hits_ << " hits, " << statement_prepares_ << " prepares\n";
+            ss << "  User layer: " << user_stats.boosts << " learned boosts, " << user_stats.journal_records
+               << " journal records, " << user_stats.synced_batches << " synced batches, "
+               << user_stats.compactions << " compactions";
+            if (lexicon_.isOpen()) {
+                ss << "\n  System lexicon: " << lexicon_.getEntryCount() << " entries, "
+                   << lexicon_.getKeyCount() << " keys, " << lexicon_.getAbbreviationCount() << " abbreviations";
+            }
+            if (ngram_.isOpen()) {
+                ss << "\n  N-gram model: " << ngram_.getWordCount() << " words, "
+                   << ngram_.getBigramCount() << " bigrams, " << ngram_.getTrigramCount() << " trigrams";
+            }
         }
         
         sqlite3_finalize(stmt);
@@ -349,7 +1008,7 @@ private:
                          int frequency, const std::string& input_pinyin) const {
         double score = 0.0;
         
-        // 频率得分 (0-50)
+        // 频率得分 (0-50)，用户层的频率已按半衰期衰减，长期不用的词不再一直占据前列
         score += std::min(50.0, frequency / 10.0);
         
         // 长度得分 (shorter words get higher score)
@@ -369,12 +1028,44 @@ private:
     
 public:
     std::string db_path_;
+    std::string lexicon_path_;
+    std::string ngram_path_;
     sqlite3* db_;
+    Lexicon lexicon_;
+    NgramModel ngram_;
+    
+    // 整句解码器及其结果缓冲区（查询接口为const，因此使用mutable）
+    mutable SentenceDecoder sentence_decoder_;
+    mutable std::vector<DecodedSentence> decoded_sentences_;
+    
+    // 预编译语句缓存（查询接口为const，因此使用mutable）
+    mutable sqlite3_stmt* statements_[STMT_COUNT];
+    mutable uint64_t statement_hits_;
+    mutable uint64_t statement_prepares_;
+    
+    // 系统词典查询的结果缓冲区，启动时分配
+    mutable std::vector<LexiconEntry> lexicon_results_;
+    mutable std::vector<uint8_t> lexicon_penalties_;     // 每个结果的模糊替代代价
+    
+    // 模糊音展开表，由系统词典的音节表构建
+    FuzzyPinyinConfig fuzzy_config_;
+    FuzzyPinyin fuzzy_;
+    mutable std::vector<LexiconEntry> fuzzy_results_;
+    
+    // 标准拼音表，只用于识别完整音节
+    PinyinConverter syllable_table_;
+    
+    // 用户层修订号，除学习加权外的每次修改递增；后台导入与查询线程并发访问
+    std::atomic<uint64_t> user_revision_;
+    
+    // 用户层：叠加在系统词之上的内存词库，由追加日志和快照持久化
+    UserDictionary user_dict_;
 };
 
 // DictionaryManager implementation
-DictionaryManager::DictionaryManager(const std::string& db_path)
-    : pImpl(std::make_unique<Impl>(db_path)) {
+DictionaryManager::DictionaryManager(const std::string& db_path, const std::string& lexicon_path,
+                                     const std::string& ngram_path)
+    : pImpl(std::make_unique<Impl>(db_path, lexicon_path, ngram_path)) {
 }
 
 DictionaryManager::~DictionaryManager() = default;
@@ -395,6 +1086,33 @@ CandidateList DictionaryManager::searchByPinyinSequence(const std::vector<std::s
     return pImpl->searchByPinyinSequence(pinyins, max_results);
 }
 
+CandidateList DictionaryManager::filterByPinyin(const CandidateList& candidates, const std::string& pinyin, int max_results) const {
+    return pImpl->filterByPinyin(candidates, pinyin, max_results);
+}
+
+CandidateList DictionaryManager::searchSentence(const std::vector<std::string>& syllables, bool complete,
+                                              int max_results) const {
+    return pImpl->searchSentence(syllables, complete, max_results);
+}
+
+CandidateList DictionaryManager::searchSentence(SentenceDecoder& decoder, const std::vector<std::string>& syllables,
+                                              bool complete, int max_results) const {
+    std::vector<DecodedSentence> decoded;
+    return pImpl->searchSentence(decoder, decoded, syllables, complete, max_results);
+}
+
+size_t DictionaryManager::rerankByContext(const std::string& context, CandidateList& candidates) const {
+    return pImpl->rerankByContext(context, candidates);
+}
+
+void DictionaryManager::setFuzzyPinyin(const FuzzyPinyinConfig& config) {
+    pImpl->setFuzzyPinyin(config);
+}
+
+std::unique_ptr<SentenceDecoder> DictionaryManager::createSentenceDecoder() const {
+    return pImpl->createSentenceDecoder();
+}
+
 CandidateList DictionaryManager::fuzzySearch(const std::string& partial_pinyin, int max_results) const {
     return pImpl->fuzzySearch(partial_pinyin, max_results);
 }
@@ -437,103 +1155,74 @@ std::unique_ptr<Candidate> DictionaryManager::getWordInfo(const std::string& wor
     return nullptr;
 }
 
-bool DictionaryManager::importDictionary(const std::string& file_path, const std::string& format) {
-    // 简单的TXT格式导入实现
-    if (format == "txt") {
-        std::ifstream file(file_path);
-        if (!file.is_open()) {
-            spdlog::error("Failed to open dictionary file: {}", file_path);
-            return false;
-        }
-        
-        std::string line;
-        int imported = 0;
-        while (std::getline(file, line)) {
-            // 假设格式为: word pinyin frequency
-            std::istringstream iss(line);
-            std::string word, pinyin;
-            int frequency = 1;
-            
-            if (iss >> word >> pinyin >> frequency) {
-                if (addUserWord(word, pinyin, frequency)) {
-                    imported++;
-                }
-            }
-        }
-        
-        spdlog::info("Imported {} words from {}", imported, file_path);
-        return imported > 0;
+bool DictionaryManager::importDictionary(const std::string& file_path, const std::string& format,
+                                         const DictionaryProgressCallback& progress) {
+    DictionaryFormat parsed;
+    if (!parseDictionaryFormat(format, file_path, parsed)) {
+        spdlog::error("Unsupported dictionary format: {}", format);
+        return false;
+    }
+    return pImpl->importFile(file_path, parsed, progress) == DictionaryIoStatus::OK;
+}
+
+bool DictionaryManager::exportUserDictionary(const std::string& file_path, const std::string& format,
+                                             const DictionaryProgressCallback& progress) const {
+    DictionaryFormat parsed;
+    if (!parseDictionaryFormat(format, file_path, parsed)) {
+        spdlog::error("Unsupported export format: {}", format);
+        return false;
+    }
+    return pImpl->exportFile(file_path, parsed, progress) == DictionaryIoStatus::OK;
+}
+
+std::unique_ptr<DictionaryTask> DictionaryManager::importDictionaryAsync(const std::string& file_path,
+                                                                         const std::string& format,
+                                                                         DictionaryProgressCallback progress) {
+    DictionaryFormat parsed;
+    if (!parseDictionaryFormat(format, file_path, parsed)) {
+        spdlog::error("Unsupported dictionary format: {}", format);
+        return nullptr;
     }
     
-    spdlog::error("Unsupported dictionary format: {}", format);
-    return false;
+    Impl* impl = pImpl.get();
+    return std::make_unique<DictionaryTask>([impl, file_path, parsed](const DictionaryProgressCallback& report) {
+        return impl->importFile(file_path, parsed, report);
+    }, std::move(progress));
 }
 
-bool DictionaryManager::exportUserDictionary(const std::string& file_path, const std::string& format) const {
-    // 简单的TXT格式导出实现
-    if (format == "txt") {
-        std::ofstream file(file_path);
-        if (!file.is_open()) {
-            spdlog::error("Failed to create export file: {}", file_path);
-            return false;
-        }
-        
-        // 导出用户词汇
-        const char* sql = "SELECT word, pinyin, frequency FROM words WHERE is_user_word = 1 ORDER BY frequency DESC";
-        sqlite3_stmt* stmt;
-        
-        int rc = sqlite3_prepare_v2(pImpl->db_, sql, -1, &stmt, nullptr);
-        if (rc != SQLITE_OK) {
-            spdlog::error("Failed to prepare export statement: {}", sqlite3_errmsg(pImpl->db_));
-            return false;
-        }
-        
-        int exported = 0;
-        while (sqlite3_step(stmt) == SQLITE_ROW) {
-            std::string word = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0));
-            std::string pinyin = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1));
-            int frequency = sqlite3_column_int(stmt, 2);
-            
-            file << word << " " << pinyin << " " << frequency << "\n";
-            exported++;
-        }
-        
-        sqlite3_finalize(stmt);
-        spdlog::info("Exported {} user words to {}", exported, file_path);
-        return exported > 0;
+std::unique_ptr<DictionaryTask> DictionaryManager::exportUserDictionaryAsync(const std::string& file_path,
+                                                                             const std::string& format,
+                                                                             DictionaryProgressCallback progress) const {
+    DictionaryFormat parsed;
+    if (!parseDictionaryFormat(format, file_path, parsed)) {
+        spdlog::error("Unsupported export format: {}", format);
+        return nullptr;
     }
     
-    spdlog::error("Unsupported export format: {}", format);
-    return false;
+    const Impl* impl = pImpl.get();
+    return std::make_unique<DictionaryTask>([impl, file_path, parsed](const DictionaryProgressCallback& report) {
+        return impl->exportFile(file_path, parsed, report);
+    }, std::move(progress));
 }
 
 std::string DictionaryManager::getStatistics() const {
     return pImpl->getStatistics();
 }
 
+bool DictionaryManager::flushPendingWrites() {
+    return pImpl->user_dict_.sync();
+}
+
+uint64_t DictionaryManager::getUserRevision() const {
+    return pImpl->user_revision_.load(std::memory_order_acquire);
+}
+
+void DictionaryManager::setFrequencyHalfLife(double days) {
+    pImpl->setFrequencyHalfLife(days);
+}
+
 int DictionaryManager::cleanupLowFrequencyWords(int min_frequency) {
-    const char* sql = "DELETE FROM words WHERE is_user_word = 1 AND frequency < ?";
-    sqlite3_stmt* stmt;
-    
-    int rc = sqlite3_prepare_v2(pImpl->db_, sql, -1, &stmt, nullptr);
-    if (rc != SQLITE_OK) {
-        spdlog::error("Failed to prepare cleanup statement: {}", sqlite3_errmsg(pImpl->db_));
-        return 0;
-    }
-    
-    sqlite3_bind_int(stmt, 1, min_frequency);
-    
-    rc = sqlite3_step(stmt);
-    int deleted = sqlite3_changes(pImpl->db_);
-    sqlite3_finalize(stmt);
-    
-    if (rc != SQLITE_DONE) {
-        spdlog::error("Failed to cleanup low frequency words: {}", sqlite3_errmsg(pImpl->db_));
-        return 0;
-    }
-    
-    spdlog::info("Cleaned up {} low frequency words", deleted);
-    return deleted;
+    return pImpl->cleanupLowFrequencyWords(min_frequency);
 }
 
 } // namespace core
@@ -0,0 +1,219 @@
+#include "core/double_pinyin.h"
+#include <spdlog/spdlog.h>
+#include <algorithm>
+
+namespace owcat {
+namespace core {
+
+namespace {
+
+/**
+ * 内置方案的键位数据
+ * finals: "键:韵母,韵母 ..."，声母取第一个键本身，zh/ch/sh 由 retroflex 指定
+ * zero_initial: "音节:两键 ..."，零声母音节的完整键位
+ */
+struct SchemeData {
+    const char* name;
+    const char* retroflex;
+    const char* finals;
+    const char* zero_initial;
+};
+
+const SchemeData SCHEMES[] = {
+    {
+        "microsoft",
+        "zh:v ch:i sh:u",
+        "q:iu w:ia,ua e:e r:uan,er t:ue y:uai,v u:u i:i o:o,uo p:un a:a s:ong,iong d:iang,uang f:en "
+        "g:eng h:ang j:an k:ao l:ai ;:ing z:ei x:ie c:iao v:ui b:ou n:in m:ian",
+        "a:oa ai:ol an:oj ang:oh ao:ok e:oe ei:oz en:of eng:og er:or o:oo ou:ob"
+    },
+    {
+        "xiaohe",
+        "zh:v ch:i sh:u",
+        "q:iu w:ei e:e r:uan t:ue y:un u:u i:i o:o,uo p:ie a:a s:ong,iong d:ai f:en g:eng h:ang "
+        "j:an k:ing,uai l:iang,uang z:ou x:ia,ua c:ao v:ui,v b:in n:iao m:ian",
+        "a:aa ai:ai an:an ang:ah ao:ao e:ee ei:ei en:en eng:eg er:er o:oo ou:ou"
+    },
+    {
+        "ziranma",
+        "zh:v ch:i sh:u",
+        "q:iu w:ia,ua e:e r:uan t:ue,ve y:uai,ing u:u i:i o:o,uo p:un a:a s:ong,iong d:iang,uang "
+        "f:en g:eng h:ang j:an k:ao l:ai z:ei x:ie c:iao v:ui,v b:ou n:in m:ian",
+        "a:aa ai:ai an:an ang:ah ao:ao e:ee ei:ei en:en eng:eg er:er o:oo ou:ou"
+    },
+};
+
+// 由本身作为第一个键的声母
+const char SINGLE_INITIALS[] = "bpmfdtnlgkhjqxrzcsyw";
+
+/**
+ * 遍历 "键:值,值 键:值" 形式的键位数据
+ */
+template <typename Callback>
+void forEachMapping(std::string_view data, Callback callback) {
+    size_t pos = 0;
+    while (pos < data.size()) {
+        size_t end = data.find(' ', pos);
+        if (end == std::string_view::npos) {
+            end = data.size();
+        }
+        std::string_view item = data.substr(pos, end - pos);
+        pos = end + 1;
+
+        size_t colon = item.find(':');
+        if (colon == std::string_view::npos || colon == 0) {
+            continue;
+        }
+        std::string_view key = item.substr(0, colon);
+        std::string_view values = item.substr(colon + 1);
+
+        size_t value_pos = 0;
+        while (value_pos <= values.size()) {
+            size_t comma = values.find(',', value_pos);
+            if (comma == std::string_view::npos) {
+                comma = values.size();
+            }
+            callback(key, values.substr(value_pos, comma - value_pos));
+            value_pos = comma + 1;
+        }
+    }
+}
+
+} // namespace
+
+DoublePinyin::DoublePinyin() {
+    clear();
+}
+
+int DoublePinyin::keyIndex(char key) {
+    if (key >= 'a' && key <= 'z') {
+        return key - 'a';
+    }
+    return key == ';' ? 26 : -1;
+}
+
+bool DoublePinyin::load(std::string_view scheme, const std::vector<std::string>& syllables) {
+    const SchemeData* data = nullptr;
+    for (const auto& candidate : SCHEMES) {
+        if (scheme == candidate.name) {
+            data = &candidate;
+            break;
+        }
+    }
+    if (!data) {
+        spdlog::warn("Unknown double pinyin scheme: {}", scheme);
+        return false;
+    }
+
+    clear();
+    name_ = data->name;
+
+    auto findSyllable = [&syllables](const std::string& syllable) {
+        auto it = std::lower_bound(syllables.begin(), syllables.end(), syllable);
+        return it != syllables.end() && *it == syllable ? static_cast<int>(it - syllables.begin()) : -1;
+    };
+
+    // 各第一个键对应的声母
+    std::string initials[26];
+    for (const char* c = SINGLE_INITIALS; *c; ++c) {
+        initials[*c - 'a'] = std::string(1, *c);
+    }
+    forEachMapping(data->retroflex, [&initials](std::string_view initial, std::string_view key) {
+        if (key.size() == 1 && keyIndex(key[0]) >= 0 && keyIndex(key[0]) < 26) {
+            initials[keyIndex(key[0])] = std::string(initial);
+        }
+    });
+
+    // 同一键位有多个韵母时只会有一个构成有效音节，保留第一个
+    // 只输入第一个键时显示声母，零声母键显示该键本身
+    auto assign = [this, &initials](int first, int second, int id) {
+        uint16_t& slot = table_[first * kKeyCount + second];
+        if (slot != kNoSyllable || id < 0) {
+            return false;
+        }
+        slot = static_cast<uint16_t>(id);
+        if (prefixes_[first].empty()) {
+            prefixes_[first] = initials[first].empty() ? std::string(1, static_cast<char>('a' + first)) : initials[first];
+        }
+        return true;
+    };
+
+    size_t mapped = 0;
+    forEachMapping(data->finals, [&](std::string_view key, std::string_view final_part) {
+        const int second = key.size() == 1 ? keyIndex(key[0]) : -1;
+        if (second < 0) {
+            return;
+        }
+        for (int first = 0; first < 26; ++first) {
+            if (initials[first].empty()) {
+                continue;
+            }
+            if (assign(first, second, findSyllable(initials[first] + std::string(final_part)))) {
+                ++mapped;
+            }
+        }
+    });
+
+    forEachMapping(data->zero_initial, [&](std::string_view syllable, std::string_view keys) {
+        if (keys.size() != 2 || keyIndex(keys[0]) < 0 || keyIndex(keys[0]) >= 26 || keyIndex(keys[1]) < 0) {
+            return;
+        }
+        if (assign(keyIndex(keys[0]), keyIndex(keys[1]), findSyllable(std::string(syllable)))) {
+            ++mapped;
+        }
+    });
+
+    spdlog::info("Loaded double pinyin scheme {} ({} key pairs)", name_, mapped);
+    return true;
+}
+
+void DoublePinyin::clear() {
+    name_.clear();
+    std::fill(std::begin(table_), std::end(table_), kNoSyllable);
+    for (auto& prefix : prefixes_) {
+        prefix.clear();
+    }
+}
+
+bool DoublePinyin::isLoaded() const {
+    return !name_.empty();
+}
+
+const std::string& DoublePinyin::getName() const {
+    return name_;
+}
+
+bool DoublePinyin::isFirstKey(char key) const {
+    int index = keyIndex(key);
+    return index >= 0 && index < 26 && !prefixes_[index].empty();
+}
+
+int DoublePinyin::decode(char first, char second) const {
+    int row = keyIndex(first);
+    int column = keyIndex(second);
+    if (row < 0 || row >= 26 || column < 0) {
+        return -1;
+    }
+
+    uint16_t id = table_[row * kKeyCount + column];
+    return id == kNoSyllable ? -1 : id;
+}
+
+std::string_view DoublePinyin::getPrefix(char key) const {
+    int index = keyIndex(key);
+    if (index < 0 || index >= 26) {
+        return std::string_view();
+    }
+    return prefixes_[index];
+}
+
+std::vector<std::string> DoublePinyin::getSchemeNames() {
+    std::vector<std::string> names;
+    for (const auto& scheme : SCHEMES) {
+        names.emplace_back(scheme.name);
+    }
+    return names;
+}
+
+} // namespace core
+} // namespace owcat
\ No newline at end of file
@@ -1,24 +1,120 @@
 #include "core/engine.h"
 #include "core/pinyin_converter.h"
 #include "core/dictionary_manager.h"
+#include "core/sentence_decoder.h"
 #include "core/prediction_engine.h"
+#include "core/candidate_merger.h"
+#include "core/commit_history.h"
+#include "core/latency_tracker.h"
 #include <spdlog/spdlog.h>
 #include <memory>
 #include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <condition_variable>
+#include <iterator>
+#include <mutex>
+#include <thread>
 
 namespace owcat {
 namespace core {
 
+// 缓存未命中时向词库请求的候选词数量，作为后续更长输入筛选的超集
+static constexpr int CANDIDATE_SUPERSET_SIZE = 64;
+
+// 整句解码使用的分割路径数和每条路径的整句数
+static constexpr size_t SENTENCE_SEGMENTATIONS = 2;
+static constexpr int SENTENCE_CANDIDATES = 3;
+
+// 作为AI预测前文的最近提交文本的最大字节数
+static constexpr size_t PREDICTION_CONTEXT_BYTES = 64;
+
+// 按前文重排后前两名得分相差不到此值时视为难以区分，交给AI模型打分
+static constexpr double CONTEXT_AMBIGUITY_MARGIN = 3.0;
+
+// 交给AI模型打分的候选词数量
+static constexpr size_t MODEL_RERANK_CANDIDATES = 4;
+
+// 默认配置在ApplicationProfile列表中的下标
+static constexpr int DEFAULT_PROFILE = -1;
+
+static bool sameFuzzyRules(const FuzzyPinyinConfig& a, const FuzzyPinyinConfig& b) {
+    return a.z_zh == b.z_zh && a.c_ch == b.c_ch && a.s_sh == b.s_sh && a.n_l == b.n_l &&
+           a.an_ang == b.an_ang && a.en_eng == b.en_eng && a.in_ing == b.in_ing &&
+           a.adjacent_keys == b.adjacent_keys && a.transpositions == b.transpositions &&
+           a.max_alternatives == b.max_alternatives && a.max_queries == b.max_queries;
+}
+
+static bool containsIgnoreCase(const std::string& text, const std::string& pattern) {
+    auto it = std::search(text.begin(), text.end(), pattern.begin(), pattern.end(), [](char a, char b) {
+        return std::tolower(static_cast<unsigned char>(a)) == std::tolower(static_cast<unsigned char>(b));
+    });
+    return !pattern.empty() && it != text.end();
+}
+
 class Engine::Impl {
 public:
+    // 排队等待后台线程处理的AI预测请求
+    struct PredictionRequest {
+        uint64_t generation = 0;    // 发起请求时的候选词版本号
+        std::string pinyin;
+        std::string context;        // 最近提交的文本
+        int max_predictions = 0;
+        std::vector<std::string> rerank;    // 需要模型按前文打分的候选词，为空时不打分
+        int session = 0;            // 当前配置的预测会话
+        uint64_t event_id = 0;      // 发起请求的输入事件，用于延迟追踪
+    };
+    
+    // 候选词缓存条目，键为查询拼音（最优分割路径，音节以空格分隔）
+    struct CandidateCacheEntry {
+        std::string pattern;
+        CandidateList candidates;   // 词库按频率降序返回的结果
+        bool complete = false;      // 结果未被截断，包含该拼音的全部匹配
+        uint64_t last_used = 0;
+    };
+    
+    // 暂存的应用配置状态，切换回来时候选词缓存、领域词典和预测会话的KV缓存仍然有效
+    struct ProfileState {
+        int profile = DEFAULT_PROFILE;      // config_.profiles中的下标
+        std::vector<CandidateCacheEntry> candidate_cache;
+        CandidateCacheStats cache_stats;
+        std::unique_ptr<DictionaryManager> domain_dictionary;
+        int prediction_session = 0;
+        uint64_t last_used = 0;
+    };
+    
     explicit Impl(const EngineConfig& config)
+        : Impl(config,
+               std::make_shared<DictionaryManager>(config.dictionary_path, config.lexicon_path, config.ngram_model_path),
+               config.enable_prediction
+                   ? std::make_shared<PredictionEngine>(config.model_path, config.lexicon_path, config.model)
+                   : nullptr,
+               true)
+    {
+    }
+    
+    Impl(const EngineConfig& config, std::shared_ptr<DictionaryManager> dictionary_manager,
+         std::shared_ptr<PredictionEngine> prediction_engine, bool owns_components)
         : config_(config)
         , state_(InputState::IDLE)
         , pinyin_converter_(std::make_unique<PinyinConverter>())
-        , dictionary_manager_(std::make_unique<DictionaryManager>(config.dictionary_path))
-        , prediction_engine_(config.enable_prediction ? 
-            std::make_unique<PredictionEngine>(config.model_path) : nullptr)
+        , dictionary_manager_(std::move(dictionary_manager))
+        , prediction_engine_(config.enable_prediction ? std::move(prediction_engine) : nullptr)
+        , owns_components_(owns_components)
+        , candidate_generation_(0)
+        , prediction_running_(false)
+        , cache_tick_(0)
+        , cache_revision_(0)
+        , active_profile_(DEFAULT_PROFILE)
+        , profile_tick_(0)
+        , merger_(CANDIDATE_SUPERSET_SIZE)
     {
+        candidate_cache_.reserve(std::max(0, config.candidate_cache_size));
+    }
+    
+    ~Impl() {
+        stopPredictionWorker();
+        closePredictionSession();
     }
 
     bool initialize() {
@@ -29,17 +125,45 @@ public:
             spdlog::error("Failed to initialize pinyin converter");
             return false;
         }
+        pinyin_converter_->setAbbreviationEnabled(config_.enable_abbreviation);
+        pinyin_converter_->setDoublePinyinScheme(config_.double_pinyin_scheme);
 
-        // 初始化词库管理器
-        if (!dictionary_manager_->initialize()) {
+        if (!dictionary_manager_) {
+            spdlog::error("No dictionary manager available");
+            return false;
+        }
+        
+        // 初始化词库管理器（共享组件由所有者初始化）
+        if (owns_components_ && !dictionary_manager_->initialize()) {
             spdlog::error("Failed to initialize dictionary manager");
             return false;
         }
+        if (owns_components_) {
+            applyFuzzyRules(config_.fuzzy);
+            dictionary_manager_->setFrequencyHalfLife(config_.frequency_half_life_days);
+        }
+        
+        // 每条分割路径各用一个解码器，按键之间保留解码状态，只计算新增的音节
+        sentence_decoders_.clear();
+        for (size_t i = 0; i < SENTENCE_SEGMENTATIONS; ++i) {
+            auto decoder = dictionary_manager_->createSentenceDecoder();
+            if (!decoder) {
+                break;
+            }
+            sentence_decoders_.push_back(std::move(decoder));
+        }
 
-        // 初始化预测引擎（如果启用）
-        if (prediction_engine_ && !prediction_engine_->initialize()) {
-            spdlog::warn("Failed to initialize prediction engine, continuing without AI prediction");
-            prediction_engine_.reset();
+        // 共享的预测引擎中每个引擎占用一个预测会话，在同一模型上下文中与其他会话并行推理
+        if (prediction_engine_ && !owns_components_ && prediction_session_ == 0) {
+            prediction_session_ = prediction_engine_->openSession();
+            if (prediction_session_ < 0) {
+                spdlog::warn("No prediction session available, continuing without AI prediction");
+            }
+        }
+        
+        // 模型加载与预热在预测线程中进行，首次按键不必等待；就绪前只提供词库候选词
+        if (prediction_engine_ && prediction_session_ >= 0) {
+            startPredictionWorker();
         }
 
         spdlog::info("Input method engine initialized successfully");
@@ -49,11 +173,17 @@ public:
     void shutdown() {
         spdlog::info("Shutting down input method engine...");
         
-        if (prediction_engine_) {
+        stopPredictionWorker();
+        closePredictionSession();
+        
+        if (owns_components_ && prediction_engine_) {
             prediction_engine_->shutdown();
         }
         
-        if (dictionary_manager_) {
+        // 解码器引用词典的内存映射，必须在词典关闭前销毁
+        sentence_decoders_.clear();
+        
+        if (owns_components_ && dictionary_manager_) {
             dictionary_manager_->shutdown();
         }
         
@@ -62,6 +192,9 @@ public:
     }
 
     bool processInput(const InputEvent& event) {
+        LatencyTracker::instance().beginEvent();
+        ScopedLatency latency(LatencyStage::ENGINE_INPUT);
+        
         switch (event.type) {
             case InputEventType::KEY_PRESS:
                 return handleKeyPress(event);
@@ -72,6 +205,12 @@ public:
             case InputEventType::CLEAR_COMPOSITION:
                 clearComposition();
                 return true;
+            case InputEventType::RESET_CONTEXT:
+                resetContext();
+                return true;
+            case InputEventType::SWITCH_PROFILE:
+                switchProfile(event.data);
+                return true;
             default:
                 return false;
         }
@@ -106,14 +245,14 @@ public:
         // 处理数字键选择候选词
         if (ch >= '1' && ch <= '9') {
             int index = ch - '1';
-            if (index < static_cast<int>(candidates_.size())) {
-                selectCandidate(index);
+            if (selectCandidate(index)) {
                 return true;
             }
         }
         
-        // 处理字母输入
-        if ((ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z')) {
+        // 处理字母输入，双拼方案下 ';' 也是韵母键
+        if ((ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z') ||
+            (ch == ';' && pinyin_converter_->isDoublePinyin())) {
             ch = std::tolower(ch);
             if (pinyin_converter_->addChar(ch)) {
                 updateCandidates();
@@ -135,29 +274,50 @@ public:
     }
 
     bool handleCommitText(const InputEvent& event) {
+        commit(event.data);
+        clearComposition();
+        return true;
+    }
+    
+    /**
+     * 提交文本并记入提交历史，作为之后输入的前文
+     */
+    void commit(const std::string& text) {
+        if (text.empty()) {
+            return;
+        }
+        commit_history_.push(text);
         if (commit_callback_) {
-            commit_callback_(event.data);
+            commit_callback_(text);
         }
+    }
+    
+    void resetContext() {
         clearComposition();
-        return true;
+        commit_history_.clear();
     }
 
     bool selectCandidate(int index) {
-        if (index < 0 || index >= static_cast<int>(candidates_.size())) {
-            return false;
+        // 预测线程会重排或替换candidates_，在锁内复制选中的候选词
+        Candidate candidate;
+        {
+            std::lock_guard<std::mutex> lock(candidates_mutex_);
+            if (index < 0 || index >= static_cast<int>(candidates_.size())) {
+                return false;
+            }
+            candidate = candidates_[index];
         }
         
-        const auto& candidate = candidates_[index];
-        
         // 学习用户选择
         if (config_.enable_learning) {
             dictionary_manager_->updateWordFrequency(candidate.text, candidate.pinyin);
+            
+            // 只有可能包含该词的缓存结果排序已过期
+            invalidateCachedCandidates(candidate.text, candidate.pinyin);
         }
         
         // 提交选择的候选词
-        if (commit_callback_) {
-            commit_callback_(candidate.text);
-        }
+        commit(candidate.text);
         
         clearComposition();
         return true;
@@ -165,77 +325,604 @@ public:
 
     std::string commitComposition() {
         std::string result = composition_;
-        if (commit_callback_ && !result.empty()) {
-            commit_callback_(result);
-        }
+        commit(result);
         clearComposition();
         return result;
     }
 
     void clearComposition() {
-        composition_.clear();
-        candidates_.clear();
+        {
+            std::lock_guard<std::mutex> lock(candidates_mutex_);
+            ++candidate_generation_;
+            composition_.clear();
+            candidates_.clear();
+            published_candidates_.clear();
+        }
         pinyin_converter_->clear();
         setState(InputState::IDLE);
         
         if (candidate_callback_) {
-            candidate_callback_(candidates_);
+            candidate_callback_(published_candidates_);
         }
     }
 
     void updateCandidates() {
+        std::unique_lock<std::mutex> lock(candidates_mutex_);
+        
+        // 递增版本号，使仍在解码的旧预测请求失效
+        uint64_t generation = ++candidate_generation_;
         composition_ = pinyin_converter_->getCurrentPinyin();
-        candidates_.clear();
         
         if (composition_.empty()) {
+            candidates_.clear();
+            published_candidates_.clear();
+            lock.unlock();
             setState(InputState::IDLE);
             if (candidate_callback_) {
-                candidate_callback_(candidates_);
+                candidate_callback_(published_candidates_);
             }
             return;
         }
         
-        // 从词库获取候选词
-        auto dict_candidates = dictionary_manager_->searchByPinyin(composition_, config_.max_candidates);
-        candidates_.insert(candidates_.end(), dict_candidates.begin(), dict_candidates.end());
+        // 从词库获取候选词，按最优分割路径查询（词库拼音以空格分隔音节）
+        auto segmentations = pinyin_converter_->getBestSegmentations(SENTENCE_SEGMENTATIONS);
+        query_pattern_.assign(composition_);
+        if (!segmentations.empty()) {
+            query_pattern_.clear();
+            for (const auto& syllable : segmentations.front().syllables) {
+                if (!query_pattern_.empty()) query_pattern_ += ' ';
+                query_pattern_ += syllable;
+            }
+        }
         
-        // 如果启用AI预测，添加预测结果
-        if (prediction_engine_ && prediction_engine_->isAvailable()) {
-            auto predicted_candidates = prediction_engine_->predictFromPinyin(
-                composition_, "", 
-                std::max(1, config_.max_candidates - static_cast<int>(candidates_.size()))
-            );
-            
-            // 过滤重复候选词
-            for (const auto& pred_candidate : predicted_candidates) {
-                bool duplicate = false;
-                for (const auto& existing : candidates_) {
-                    if (existing.text == pred_candidate.text) {
-                        duplicate = true;
-                        break;
-                    }
+        // 取词库结果的前max_candidates项，按得分合并（复用candidates_中的字符串）
+        const CandidateList& dict_candidates = lookupDictionary(query_pattern_);
+        const size_t max_candidates = static_cast<size_t>(std::max(0, config_.max_candidates));
+        merger_.reset(max_candidates);
+        merger_.addAll(dict_candidates, max_candidates);
+        if (domain_dictionary_) {
+            domain_candidates_ = domain_dictionary_->searchByPinyin(query_pattern_, config_.max_candidates);
+            merger_.addAll(domain_candidates_);
+        }
+        merger_.addAll(decodeSentences(segmentations));
+        merger_.finish(candidates_);
+        const bool ambiguous = rerankByContext();
+        
+        // 如果启用AI预测且模型已就绪，交给后台线程，结果稍后合并；系统负载过高或电量过低时只用词库候选词
+        const bool can_predict = prediction_running_ && activeProfilePredicts() && prediction_session_ >= 0 &&
+                                 prediction_engine_->isAvailable();
+        const PredictionBudget budget = can_predict ? prediction_engine_->getBudget() : PredictionBudget();
+        if (can_predict && budget.level != PredictionLevel::OFF) {
+            PredictionRequest request;
+            request.generation = generation;
+            request.session = prediction_session_;
+            request.pinyin = composition_;
+            request.context = commit_history_.getContext(PREDICTION_CONTEXT_BYTES);
+            request.max_predictions = std::max(1, config_.max_candidates - static_cast<int>(candidates_.size()));
+            if (ambiguous && budget.allow_rerank) {
+                const size_t count = std::min(candidates_.size(), MODEL_RERANK_CANDIDATES);
+                for (size_t i = 0; i < count; ++i) {
+                    request.rerank.push_back(candidates_[i].text);
+                }
+            }
+            request.event_id = LatencyTracker::currentEvent();
+            submitPrediction(std::move(request));
+        }
+        
+        // 解锁后预测线程可能修改candidates_，回调使用副本
+        published_candidates_ = candidates_;
+        lock.unlock();
+        
+        setState(InputState::SELECTING);
+        
+        // 先发布词库候选词
+        if (candidate_callback_) {
+            candidate_callback_(published_candidates_);
+        }
+    }
+    
+    /**
+     * 按最近一次提交的文本重排候选词（调用者需持有candidates_mutex_）
+     * n-gram二元概率只需查表，每次按键都做；只有重排后前两名仍难以区分时才需要AI模型打分
+     * @return 是否需要AI模型打分
+     */
+    bool rerankByContext() {
+        if (!config_.enable_context_rerank || commit_history_.empty() || candidates_.size() < 2) {
+            return false;
+        }
+        
+        ScopedLatency latency(LatencyStage::CONTEXT_RERANK);
+        dictionary_manager_->rerankByContext(commit_history_.last(), candidates_);
+        return candidates_[0].score - candidates_[1].score < CONTEXT_AMBIGUITY_MARGIN;
+    }
+    
+    /**
+     * 多音节输入的整句候选：n-gram模型在前几条分割路径上解码，不依赖AI模型
+     */
+    const CandidateList& decodeSentences(const std::vector<PinyinSegmentation>& segmentations) {
+        sentence_candidates_.clear();
+        if (segmentations.empty() || segmentations.front().syllables.size() < 2) {
+            return sentence_candidates_;
+        }
+        
+        ScopedLatency latency(LatencyStage::SENTENCE_DECODE);
+        uint32_t used = 0;
+        for (const auto& segmentation : segmentations) {
+            // 分割路径的排名随按键变化，选择与该路径公共前缀最长的空闲解码器
+            SentenceDecoder* decoder = nullptr;
+            size_t best_shared = 0;
+            size_t best_index = 0;
+            for (size_t i = 0; i < sentence_decoders_.size(); ++i) {
+                if (used & (1u << i)) {
+                    continue;
                 }
-                if (!duplicate && pred_candidate.score >= config_.prediction_threshold) {
-                    candidates_.push_back(pred_candidate);
+                size_t shared = sentence_decoders_[i]->sharedPrefix(segmentation.syllables, !segmentation.complete);
+                if (!decoder || shared > best_shared) {
+                    decoder = sentence_decoders_[i].get();
+                    best_shared = shared;
+                    best_index = i;
                 }
             }
+            
+            CandidateList sentences;
+            if (decoder) {
+                used |= 1u << best_index;
+                sentences = dictionary_manager_->searchSentence(
+                    *decoder, segmentation.syllables, segmentation.complete, SENTENCE_CANDIDATES);
+            } else {
+                sentences = dictionary_manager_->searchSentence(
+                    segmentation.syllables, segmentation.complete, SENTENCE_CANDIDATES);
+            }
+            sentence_candidates_.insert(sentence_candidates_.end(),
+                                        std::make_move_iterator(sentences.begin()),
+                                        std::make_move_iterator(sentences.end()));
         }
+        return sentence_candidates_;
+    }
+    
+    /**
+     * 查询词库候选词，优先使用缓存
+     * 完全相同的拼音直接返回；以已缓存拼音为前缀的新拼音从缓存结果中筛选
+     */
+    const CandidateList& lookupDictionary(const std::string& pattern) {
+        ScopedLatency latency(LatencyStage::DICTIONARY_LOOKUP);
         
-        // 按得分排序
-        std::sort(candidates_.begin(), candidates_.end(), 
-                  [](const Candidate& a, const Candidate& b) {
-                      return a.score > b.score;
-                  });
+        if (config_.candidate_cache_size <= 0) {
+            uncached_candidates_ = dictionary_manager_->searchByPinyin(pattern, config_.max_candidates);
+            return uncached_candidates_;
+        }
         
-        // 限制候选词数量
-        if (candidates_.size() > static_cast<size_t>(config_.max_candidates)) {
-            candidates_.resize(config_.max_candidates);
+        // 导入词库等批量修改后所有配置的缓存结果都可能过期
+        const uint64_t revision = dictionary_manager_->getUserRevision();
+        if (revision != cache_revision_) {
+            clearCandidateCache();
+            cache_revision_ = revision;
         }
         
-        setState(InputState::SELECTING);
+        ++cache_tick_;
+        
+        // 查找完全匹配，同时记录最长的前缀条目
+        CandidateCacheEntry* parent = nullptr;
+        for (auto& entry : candidate_cache_) {
+            if (entry.pattern == pattern) {
+                entry.last_used = cache_tick_;
+                ++cache_stats_.hits;
+                return entry.candidates;
+            }
+            if (entry.complete && entry.pattern.size() < pattern.size() &&
+                pattern.compare(0, entry.pattern.size(), entry.pattern) == 0 &&
+                (!parent || entry.pattern.size() > parent->pattern.size())) {
+                parent = &entry;
+            }
+        }
+        
+        // 只有未截断的超集才能筛选：截断的结果中完全匹配优先，缺少更长拼音的低频完全匹配
+        if (parent && parent->complete) {
+            CandidateList refined = dictionary_manager_->filterByPinyin(parent->candidates, pattern, CANDIDATE_SUPERSET_SIZE);
+            parent->last_used = cache_tick_;
+            ++cache_stats_.refinements;
+            return insertCacheEntry(pattern, std::move(refined), true);
+        }
+        
+        ++cache_stats_.misses;
+        CandidateList candidates = dictionary_manager_->searchByPinyin(pattern, CANDIDATE_SUPERSET_SIZE);
+        bool complete = candidates.size() < static_cast<size_t>(CANDIDATE_SUPERSET_SIZE);
+        return insertCacheEntry(pattern, std::move(candidates), complete);
+    }
+    
+    const CandidateList& insertCacheEntry(const std::string& pattern, CandidateList candidates, bool complete) {
+        CandidateCacheEntry* slot = nullptr;
+        if (candidate_cache_.size() < static_cast<size_t>(config_.candidate_cache_size)) {
+            candidate_cache_.emplace_back();
+            slot = &candidate_cache_.back();
+        } else {
+            // 淘汰最久未使用的条目
+            slot = &*std::min_element(candidate_cache_.begin(), candidate_cache_.end(),
+                                      [](const CandidateCacheEntry& a, const CandidateCacheEntry& b) {
+                                          return a.last_used < b.last_used;
+                                      });
+        }
+        
+        slot->pattern = pattern;
+        slot->candidates = std::move(candidates);
+        slot->complete = complete;
+        slot->last_used = cache_tick_;
+        return slot->candidates;
+    }
+    
+    /**
+     * 词频更新后丢弃受影响的缓存条目，其余条目保持有效
+     * 受影响的条目：按词库的匹配规则（前缀、简拼、模糊音）该词属于查询结果，或结果中已包含该词；
+     * 截断的结果即使未包含该词也可能因排序变化而过期
+     */
+    void invalidateCachedCandidates(const std::string& text, const std::string& pinyin) {
+        const CandidateList changed{Candidate(text, pinyin, 0.0, 0, false)};
+        auto affected = [&](const CandidateCacheEntry& entry) {
+            if (pinyin.compare(0, entry.pattern.size(), entry.pattern) == 0 ||
+                !dictionary_manager_->filterByPinyin(changed, entry.pattern, 1).empty()) {
+                return true;
+            }
+            return std::any_of(entry.candidates.begin(), entry.candidates.end(), [&](const Candidate& candidate) {
+                return candidate.text == text && candidate.pinyin == pinyin;
+            });
+        };
+        candidate_cache_.erase(std::remove_if(candidate_cache_.begin(), candidate_cache_.end(), affected),
+                               candidate_cache_.end());
+        // 暂存配置的缓存同样来自共享的用户词库；其模糊音规则与当前不同时无法按当前规则判断，整体丢弃
+        for (auto& state : profile_states_) {
+            auto& cache = state.candidate_cache;
+            const FuzzyPinyinConfig& rules =
+                state.profile == DEFAULT_PROFILE ? config_.fuzzy : config_.profiles[state.profile].fuzzy;
+            if (owns_components_ && !sameFuzzyRules(rules, fuzzy_rules_)) {
+                cache.clear();
+                continue;
+            }
+            cache.erase(std::remove_if(cache.begin(), cache.end(), affected), cache.end());
+        }
+    }
+    
+    /**
+     * 清空全部配置的候选词缓存
+     * 仅用于配置变化（模糊音规则、词频衰减等会改变所有结果的排序），学习提交使用invalidateCachedCandidates
+     */
+    void clearCandidateCache() {
+        candidate_cache_.clear();
+        for (auto& state : profile_states_) {
+            state.candidate_cache.clear();
+        }
+    }
+    
+    void applyFuzzyRules(const FuzzyPinyinConfig& rules) {
+        if (fuzzy_applied_ && sameFuzzyRules(fuzzy_rules_, rules)) {
+            return;
+        }
+        dictionary_manager_->setFuzzyPinyin(rules);
+        fuzzy_rules_ = rules;
+        fuzzy_applied_ = true;
+    }
+    
+    bool activeProfilePredicts() const {
+        return active_profile_ == DEFAULT_PROFILE ||
+               config_.profiles[static_cast<size_t>(active_profile_)].enable_prediction;
+    }
+    
+    /**
+     * 按应用标识切换配置
+     * 当前配置的状态暂存到LRU中，目标配置已暂存时直接恢复，否则加载领域词典并打开新的预测会话
+     */
+    std::string switchProfile(const std::string& application) {
+        int target = DEFAULT_PROFILE;
+        for (size_t i = 0; i < config_.profiles.size() && target == DEFAULT_PROFILE; ++i) {
+            for (const auto& pattern : config_.profiles[i].applications) {
+                if (containsIgnoreCase(application, pattern)) {
+                    target = static_cast<int>(i);
+                    break;
+                }
+            }
+        }
+        
+        std::string name = target == DEFAULT_PROFILE ? std::string() : config_.profiles[target].name;
+        if (target == active_profile_) {
+            return name;
+        }
+        
+        // 切换后缓存的候选词和进行中的预测都不再适用
+        clearComposition();
+        
+        ProfileState parked;
+        parked.profile = active_profile_;
+        parked.candidate_cache.swap(candidate_cache_);
+        parked.cache_stats = cache_stats_;
+        parked.domain_dictionary = std::move(domain_dictionary_);
+        parked.prediction_session = prediction_session_;
+        parked.last_used = ++profile_tick_;
+        
+        auto it = std::find_if(profile_states_.begin(), profile_states_.end(), [target](const ProfileState& state) {
+            return state.profile == target;
+        });
+        if (it != profile_states_.end()) {
+            candidate_cache_.swap(it->candidate_cache);
+            cache_stats_ = it->cache_stats;
+            domain_dictionary_ = std::move(it->domain_dictionary);
+            prediction_session_ = it->prediction_session;
+            profile_states_.erase(it);
+        } else {
+            cache_stats_ = CandidateCacheStats();
+            domain_dictionary_ = target == DEFAULT_PROFILE ? nullptr : openDomainDictionary(config_.profiles[target]);
+            prediction_session_ = openProfileSession(target);
+        }
+        profile_states_.push_back(std::move(parked));
+        active_profile_ = target;
+        
+        if (owns_components_) {
+            applyFuzzyRules(target == DEFAULT_PROFILE ? config_.fuzzy : config_.profiles[target].fuzzy);
+        }
+        evictProfiles();
+        
+        spdlog::info("Switched to input profile '{}' for {}", name.empty() ? "default" : name, application);
+        return name;
+    }
+    
+    std::unique_ptr<DictionaryManager> openDomainDictionary(const ApplicationProfile& profile) {
+        if (profile.domain_lexicon_path.empty()) {
+            return nullptr;
+        }
+        
+        // 领域词典只读，用户词和学习结果仍记入主词库
+        auto dictionary = std::make_unique<DictionaryManager>(":memory:", profile.domain_lexicon_path);
+        if (!dictionary->initialize()) {
+            spdlog::warn("Failed to open domain dictionary {} for profile {}", profile.domain_lexicon_path, profile.name);
+            return nullptr;
+        }
+        return dictionary;
+    }
+    
+    int openProfileSession(int profile) {
+        if (!prediction_engine_) {
+            return -1;
+        }
+        // 自有预测引擎的默认配置使用默认会话
+        if (profile == DEFAULT_PROFILE && owns_components_) {
+            return 0;
+        }
+        return prediction_engine_->openSession();
+    }
+    
+    void closeProfileSession(int session) {
+        if (!prediction_engine_ || session <= 0) {
+            return;
+        }
+        // 预测线程可能仍在用该会话完成已取消的请求，等它结束后再释放
+        std::lock_guard<std::mutex> lock(prediction_run_mutex_);
+        prediction_engine_->closeSession(session);
+    }
+    
+    /**
+     * 淘汰最久未用的暂存配置，释放其领域词典和预测会话
+     */
+    void evictProfiles() {
+        const size_t capacity = static_cast<size_t>(std::max(1, config_.profile_cache_size));
+        while (!profile_states_.empty() && profile_states_.size() + 1 > capacity) {
+            auto oldest = std::min_element(profile_states_.begin(), profile_states_.end(),
+                                           [](const ProfileState& a, const ProfileState& b) {
+                                               return a.last_used < b.last_used;
+                                           });
+            closeProfileSession(oldest->prediction_session);
+            profile_states_.erase(oldest);
+        }
+    }
+    
+    /**
+     * 释放所有应用配置，回到默认配置（配置列表变化或关闭时）
+     */
+    void resetProfiles() {
+        // 保留默认配置的预测会话，其余全部释放
+        bool has_default = active_profile_ == DEFAULT_PROFILE;
+        int default_session = prediction_session_;
+        if (!has_default) {
+            closeProfileSession(prediction_session_);
+        }
+        for (auto& state : profile_states_) {
+            if (state.profile == DEFAULT_PROFILE) {
+                has_default = true;
+                default_session = state.prediction_session;
+            } else {
+                closeProfileSession(state.prediction_session);
+            }
+        }
+        prediction_session_ = has_default ? default_session : openProfileSession(DEFAULT_PROFILE);
+        profile_states_.clear();
+        domain_dictionary_.reset();
+        active_profile_ = DEFAULT_PROFILE;
+    }
+    
+    CandidateCacheStats getCandidateCacheStats() const {
+        CandidateCacheStats stats = cache_stats_;
+        stats.entries = candidate_cache_.size();
+        stats.capacity = static_cast<size_t>(std::max(0, config_.candidate_cache_size));
+        return stats;
+    }
+    
+    void startPredictionWorker() {
+        prediction_running_ = true;
+        prediction_thread_ = std::thread([this] { predictionLoop(); });
+    }
+    
+    void stopPredictionWorker() {
+        {
+            std::lock_guard<std::mutex> lock(prediction_mutex_);
+            if (!prediction_running_) {
+                return;
+            }
+            prediction_running_ = false;
+            ++candidate_generation_;
+        }
+        prediction_cv_.notify_all();
+        
+        if (prediction_thread_.joinable()) {
+            prediction_thread_.join();
+        }
+    }
+    
+    void closePredictionSession() {
+        for (auto& state : profile_states_) {
+            closeProfileSession(state.prediction_session);
+        }
+        profile_states_.clear();
+        domain_dictionary_.reset();
+        active_profile_ = DEFAULT_PROFILE;
+        
+        closeProfileSession(prediction_session_);
+        prediction_session_ = 0;
+    }
+    
+    void submitPrediction(PredictionRequest request) {
+        {
+            // 只保留最新的请求，未开始的旧请求直接丢弃
+            std::lock_guard<std::mutex> lock(prediction_mutex_);
+            pending_prediction_ = std::move(request);
+            has_pending_prediction_ = true;
+        }
+        prediction_cv_.notify_one();
+    }
+    
+    void predictionLoop() {
+        // 先在本线程加载模型，失败时预测保持不可用（共享的预测引擎由所有者加载）
+        if (owns_components_ && !prediction_engine_->initialize()) {
+            spdlog::warn("Failed to initialize prediction engine, continuing without AI prediction");
+            return;
+        }
+        
+        while (true) {
+            PredictionRequest request;
+            {
+                std::unique_lock<std::mutex> lock(prediction_mutex_);
+                prediction_cv_.wait(lock, [this] {
+                    return !prediction_running_ || has_pending_prediction_;
+                });
+                if (!prediction_running_) {
+                    return;
+                }
+                request = std::move(pending_prediction_);
+                has_pending_prediction_ = false;
+            }
+            
+            if (!prediction_engine_->isAvailable()) {
+                continue;
+            }
+            
+            const uint64_t generation = request.generation;
+            auto is_cancelled = [this, generation] {
+                return candidate_generation_.load(std::memory_order_relaxed) != generation;
+            };
+            
+            LatencyTracker::setCurrentEvent(request.event_id);
+            std::lock_guard<std::mutex> run_lock(prediction_run_mutex_);
+            if (!request.rerank.empty()) {
+                std::vector<float> log_probs;
+                {
+                    ScopedLatency latency(LatencyStage::PREDICTION, request.event_id);
+                    log_probs = prediction_engine_->scoreCandidates(request.context, request.rerank,
+                                                                    request.session);
+                }
+                applyModelRerank(generation, request.rerank, log_probs);
+                if (is_cancelled()) {
+                    continue;
+                }
+            }
+            
+            CandidateList predicted_candidates;
+            {
+                ScopedLatency latency(LatencyStage::PREDICTION, request.event_id);
+                predicted_candidates = prediction_engine_->predictFromPinyin(
+                    request.pinyin, request.context, request.max_predictions, is_cancelled, request.session);
+            }
+            
+            mergePredictions(generation, predicted_candidates);
+        }
+    }
+    
+    /**
+     * 按模型给出的对数概率重排前几名候选词
+     * 这些候选词原有的得分按新顺序重新分配，与其他候选词的相对位置不变
+     */
+    void applyModelRerank(uint64_t generation, const std::vector<std::string>& texts,
+                          const std::vector<float>& log_probs) {
+        if (log_probs.size() != texts.size()) {
+            return;
+        }
+        
+        {
+            std::lock_guard<std::mutex> lock(candidates_mutex_);
+            if (candidate_generation_ != generation || candidates_.size() < texts.size()) {
+                return; // 输入已变化，丢弃过期结果
+            }
+            for (size_t i = 0; i < texts.size(); ++i) {
+                if (candidates_[i].text != texts[i]) {
+                    return;
+                }
+            }
+            
+            size_t order[MODEL_RERANK_CANDIDATES];
+            const size_t count = std::min(texts.size(), MODEL_RERANK_CANDIDATES);
+            for (size_t i = 0; i < count; ++i) {
+                order[i] = i;
+            }
+            std::stable_sort(order, order + count, [&log_probs](size_t a, size_t b) {
+                return log_probs[a] > log_probs[b];
+            });
+            
+            bool changed = false;
+            merge_buffer_.assign(candidates_.begin(), candidates_.begin() + count);
+            for (size_t i = 0; i < count; ++i) {
+                const double score = candidates_[i].score;
+                if (order[i] != i) {
+                    candidates_[i] = std::move(merge_buffer_[order[i]]);
+                    candidates_[i].score = score;
+                    changed = true;
+                }
+            }
+            if (!changed) {
+                return;
+            }
+            prediction_candidates_ = candidates_;
+        }
+        
+        if (candidate_callback_) {
+            candidate_callback_(prediction_candidates_);
+        }
+    }
+    
+    void mergePredictions(uint64_t generation, const CandidateList& predicted_candidates) {
+        {
+            std::lock_guard<std::mutex> lock(candidates_mutex_);
+            if (candidate_generation_ != generation) {
+                return; // 输入已变化，丢弃过期结果
+            }
+            
+            // 与当前候选词按得分合并，同文本只保留得分较高者
+            merger_.reset(static_cast<size_t>(std::max(0, config_.max_candidates)));
+            merger_.addAll(candidates_);
+            
+            bool changed = false;
+            for (const auto& pred_candidate : predicted_candidates) {
+                if (pred_candidate.score >= config_.prediction_threshold && merger_.add(CandidateView(pred_candidate))) {
+                    changed = true;
+                }
+            }
+            
+            if (!changed) {
+                return;
+            }
+            
+            merger_.finish(merge_buffer_);
+            candidates_.swap(merge_buffer_);
+            prediction_candidates_ = candidates_;
+        }
         
+        // 第二次回调：合并AI预测后的候选词（在预测线程中调用）
         if (candidate_callback_) {
-            candidate_callback_(candidates_);
+            candidate_callback_(prediction_candidates_);
         }
     }
 
@@ -255,12 +942,55 @@ public:
     CandidateList candidates_;
     
     std::unique_ptr<PinyinConverter> pinyin_converter_;
-    std::unique_ptr<DictionaryManager> dictionary_manager_;
-    std::unique_ptr<PredictionEngine> prediction_engine_;
+    std::shared_ptr<DictionaryManager> dictionary_manager_;
+    std::shared_ptr<PredictionEngine> prediction_engine_;
+    bool owns_components_;      // 词库和预测引擎是否由本引擎创建并负责初始化、关闭
+    int prediction_session_ = 0;    // 当前配置在预测引擎中的会话ID，自有预测引擎的默认配置使用默认会话0
     
     CandidateCallback candidate_callback_;
     CommitCallback commit_callback_;
     StateChangeCallback state_change_callback_;
+    
+    // 本输入上下文最近提交的文本（仅在按键线程中访问）
+    CommitHistory commit_history_;
+    
+    // 候选词版本号，每次输入变化时递增，用于取消过期的预测
+    std::atomic<uint64_t> candidate_generation_;
+    std::mutex candidates_mutex_;
+    
+    // 后台预测线程
+    std::thread prediction_thread_;
+    std::mutex prediction_mutex_;
+    std::condition_variable prediction_cv_;
+    std::mutex prediction_run_mutex_;   // 预测线程处理请求期间持有，释放会话前获取
+    PredictionRequest pending_prediction_;
+    bool has_pending_prediction_ = false;
+    std::atomic<bool> prediction_running_;  // 在prediction_mutex_下写入，按键线程不加锁读取
+    
+    // 词库候选词LRU缓存（仅在按键线程中访问）
+    std::vector<CandidateCacheEntry> candidate_cache_;
+    CandidateList uncached_candidates_;
+    CandidateCacheStats cache_stats_;
+    uint64_t cache_tick_;
+    uint64_t cache_revision_;       // 缓存结果对应的用户层修订号
+    
+    // 按应用切换的配置（仅在按键线程中访问）
+    int active_profile_;
+    std::unique_ptr<DictionaryManager> domain_dictionary_;
+    CandidateList domain_candidates_;
+    std::vector<ProfileState> profile_states_;  // 暂存的非当前配置
+    uint64_t profile_tick_;
+    FuzzyPinyinConfig fuzzy_rules_;     // 已应用到自有词库的模糊音规则
+    bool fuzzy_applied_ = false;
+    
+    // 候选词合并：以下缓冲区在各次按键间复用，避免重复分配
+    CandidateMerger merger_;
+    std::string query_pattern_;
+    CandidateList sentence_candidates_;
+    std::vector<std::unique_ptr<SentenceDecoder>> sentence_decoders_;
+    CandidateList merge_buffer_;
+    CandidateList published_candidates_;    // 按键线程回调使用
+    CandidateList prediction_candidates_;   // 预测线程回调使用
 };
 
 // Engine implementation
@@ -269,6 +999,12 @@ Engine::Engine(const EngineConfig& config)
 {
 }
 
+Engine::Engine(const EngineConfig& config, std::shared_ptr<DictionaryManager> dictionary_manager,
+               std::shared_ptr<PredictionEngine> prediction_engine)
+    : pImpl(std::make_unique<Impl>(config, std::move(dictionary_manager), std::move(prediction_engine), false))
+{
+}
+
 Engine::~Engine() = default;
 
 bool Engine::initialize() {
@@ -283,7 +1019,8 @@ bool Engine::processInput(const InputEvent& event) {
     return pImpl->processInput(event);
 }
 
-const CandidateList& Engine::getCandidates() const {
+CandidateList Engine::getCandidates() const {
+    std::lock_guard<std::mutex> lock(pImpl->candidates_mutex_);
     return pImpl->candidates_;
 }
 
@@ -307,6 +1044,14 @@ void Engine::clearComposition() {
     pImpl->clearComposition();
 }
 
+void Engine::resetContext() {
+    pImpl->resetContext();
+}
+
+std::string Engine::switchProfile(const std::string& application) {
+    return pImpl->switchProfile(application);
+}
+
 void Engine::setCandidateCallback(CandidateCallback callback) {
     pImpl->candidate_callback_ = std::move(callback);
 }
@@ -320,7 +1065,47 @@ void Engine::setStateChangeCallback(StateChangeCallback callback) {
 }
 
 void Engine::updateConfig(const EngineConfig& config) {
+    // 配置列表可能已变化，暂存的应用配置状态全部释放
+    pImpl->clearComposition();
+    pImpl->resetProfiles();
     pImpl->config_ = config;
+    pImpl->pinyin_converter_->setAbbreviationEnabled(config.enable_abbreviation);
+    pImpl->pinyin_converter_->setDoublePinyinScheme(config.double_pinyin_scheme);
+    if (pImpl->owns_components_ && pImpl->dictionary_manager_) {
+        pImpl->fuzzy_applied_ = false;
+        pImpl->applyFuzzyRules(config.fuzzy);
+        pImpl->dictionary_manager_->setFrequencyHalfLife(config.frequency_half_life_days);
+    }
+    if (pImpl->owns_components_ && pImpl->prediction_engine_) {
+        pImpl->prediction_engine_->setGovernorConfig(config.model.governor);
+    }
+    pImpl->clearCandidateCache();
+}
+
+void Engine::setSystemLoadProvider(SystemLoadProvider provider) {
+    if (pImpl->prediction_engine_) {
+        pImpl->prediction_engine_->setSystemLoadProvider(std::move(provider));
+    }
+}
+
+bool Engine::isPredictionAvailable() const {
+    return pImpl->prediction_engine_ && pImpl->prediction_engine_->isAvailable();
+}
+
+CandidateCacheStats Engine::getCandidateCacheStats() const {
+    return pImpl->getCandidateCacheStats();
+}
+
+std::map<std::string, std::string> Engine::getLatencyStatistics() const {
+    return LatencyTracker::instance().getSummary();
+}
+
+void Engine::setLatencyTraceEnabled(bool enabled) {
+    LatencyTracker::instance().setTraceEnabled(enabled);
+}
+
+bool Engine::dumpLatencyTrace(const std::string& file_path) const {
+    return LatencyTracker::instance().writeChromeTrace(file_path);
 }
 
 const EngineConfig& Engine::getConfig() const {
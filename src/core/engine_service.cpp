@@ -0,0 +1,1156 @@
+#include "core/engine_service.h"
+#include "core/engine.h"
+#include "core/dictionary_manager.h"
+#include "core/prediction_engine.h"
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <thread>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <cerrno>
+#include <ctime>
+#include <fcntl.h>
+#include <semaphore.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace owcat {
+namespace core {
+
+namespace {
+
+constexpr uint32_t IPC_MAGIC = 0x4950434f;  // "OCPI"
+constexpr uint32_t IPC_VERSION = 1;
+constexpr size_t REQUEST_RING_SIZE = 64;
+constexpr size_t RESPONSE_RING_SIZE = 32;
+constexpr size_t MAX_IPC_CANDIDATES = 16;
+constexpr size_t IPC_TEXT_SIZE = 64;
+constexpr size_t IPC_PINYIN_SIZE = 64;
+constexpr size_t IPC_DATA_SIZE = 256;
+constexpr int SERVER_POLL_MS = 500;     // 服务线程检查客户端存活的间隔
+constexpr int CLIENT_POLL_MS = 100;     // 接收线程检查守护进程存活的间隔
+
+static_assert(std::atomic<uint32_t>::is_always_lock_free, "IPC requires lock-free 32-bit atomics");
+
+enum class SlotState : uint32_t {
+    FREE = 0,
+    CLAIMED = 1,    // 客户端正在初始化缓冲区
+    ACTIVE = 2
+};
+
+enum class RequestType : uint32_t {
+    INPUT_EVENT = 1,
+    DISCONNECT = 2
+};
+
+enum class ResponseType : uint32_t {
+    RESULT = 1,         // processInput的返回值，value为是否处理
+    CANDIDATES = 2,
+    COMMIT = 3,
+    STATE = 4           // value为InputState
+};
+
+struct IpcRequest {
+    uint32_t sequence;
+    uint32_t type;
+    int32_t event_type;
+    int32_t key_code;
+    uint8_t ctrl;
+    uint8_t shift;
+    uint8_t alt;
+    uint8_t reserved;
+    char data[IPC_DATA_SIZE];
+};
+
+struct IpcCandidate {
+    char text[IPC_TEXT_SIZE];
+    char pinyin[IPC_PINYIN_SIZE];
+    double score;
+    int32_t frequency;
+    uint32_t is_prediction;
+};
+
+struct IpcResponse {
+    uint32_t type;
+    uint32_t sequence;
+    int32_t value;
+    uint32_t candidate_count;
+    char text[IPC_DATA_SIZE];
+    IpcCandidate candidates[MAX_IPC_CANDIDATES];
+};
+
+/**
+ * 共享内存中的单生产者单消费者环形缓冲区
+ */
+template <typename T, size_t N>
+struct IpcRing {
+    std::atomic<uint32_t> head;     // 消费者读取位置
+    std::atomic<uint32_t> tail;     // 生产者写入位置
+    T items[N];
+
+    void reset() {
+        head.store(0, std::memory_order_relaxed);
+        tail.store(0, std::memory_order_relaxed);
+    }
+
+    // 返回可写入的位置，缓冲区已满时为空；写完后调用commit
+    T* reserve() {
+        const uint32_t t = tail.load(std::memory_order_relaxed);
+        if (t - head.load(std::memory_order_acquire) >= N) {
+            return nullptr;
+        }
+        return &items[t % N];
+    }
+
+    void commit() {
+        tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    bool pop(T& item) {
+        const uint32_t h = head.load(std::memory_order_relaxed);
+        if (h == tail.load(std::memory_order_acquire)) {
+            return false;
+        }
+        item = items[h % N];
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+};
+
+struct IpcSlot {
+    std::atomic<uint32_t> state;
+    std::atomic<uint32_t> client_pid;
+    IpcRing<IpcRequest, REQUEST_RING_SIZE> requests;
+    IpcRing<IpcResponse, RESPONSE_RING_SIZE> responses;
+};
+
+struct IpcRegion {
+    std::atomic<uint32_t> magic;        // 初始化完成后最后写入
+    uint32_t version;
+    std::atomic<uint32_t> server_pid;
+    uint32_t slot_count;
+    IpcSlot slots[EngineServer::MAX_SESSIONS];
+};
+
+/**
+ * 按UTF-8字符边界截断复制
+ */
+void copyText(char* dst, size_t size, const std::string& src) {
+    size_t length = std::min(src.size(), size - 1);
+    while (length > 0 && length < src.size() && (static_cast<unsigned char>(src[length]) & 0xc0) == 0x80) {
+        --length;
+    }
+    std::memcpy(dst, src.data(), length);
+    dst[length] = '\0';
+}
+
+uint32_t currentProcessId() {
+#ifdef _WIN32
+    return static_cast<uint32_t>(GetCurrentProcessId());
+#else
+    return static_cast<uint32_t>(getpid());
+#endif
+}
+
+bool isProcessAlive(uint32_t pid) {
+    if (pid == 0) {
+        return false;
+    }
+#ifdef _WIN32
+    HANDLE process = OpenProcess(SYNCHRONIZE, FALSE, pid);
+    if (!process) {
+        return GetLastError() == ERROR_ACCESS_DENIED;
+    }
+    bool alive = WaitForSingleObject(process, 0) == WAIT_TIMEOUT;
+    CloseHandle(process);
+    return alive;
+#else
+    return kill(static_cast<pid_t>(pid), 0) == 0 || errno == EPERM;
+#endif
+}
+
+/**
+ * 通道对象名称，按用户隔离
+ */
+std::string channelName(const std::string& suffix) {
+#ifdef _WIN32
+    return "Local\\owcat-engined" + suffix;
+#else
+    // macOS限制信号量名称长度为31字节
+    return "/owcat-" + std::to_string(getuid()) + suffix;
+#endif
+}
+
+#ifdef _WIN32
+std::wstring toWide(const std::string& name) {
+    return std::wstring(name.begin(), name.end());
+}
+#endif
+
+/**
+ * 命名共享内存区域
+ */
+class SharedRegion {
+public:
+    SharedRegion() = default;
+    ~SharedRegion() { close(); }
+
+    SharedRegion(const SharedRegion&) = delete;
+    SharedRegion& operator=(const SharedRegion&) = delete;
+
+    /**
+     * 创建区域，已存在时打开并通过existed告知
+     */
+    bool create(const std::string& name, size_t size, bool& existed) {
+        existed = false;
+        name_ = name;
+        size_ = size;
+#ifdef _WIN32
+        mapping_ = CreateFileMappingW(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+                                      static_cast<DWORD>(static_cast<uint64_t>(size) >> 32),
+                                      static_cast<DWORD>(size & 0xffffffffu), toWide(name).c_str());
+        if (!mapping_) {
+            return false;
+        }
+        existed = GetLastError() == ERROR_ALREADY_EXISTS;
+        return map();
+#else
+        fd_ = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+        if (fd_ < 0 && errno == EEXIST) {
+            existed = true;
+            fd_ = shm_open(name.c_str(), O_RDWR, 0600);
+            
+            // 旧版本遗留的较小区域无法安全映射，删除后重建
+            struct stat info;
+            if (fd_ >= 0 && (fstat(fd_, &info) != 0 || static_cast<size_t>(info.st_size) < size)) {
+                close();
+                shm_unlink(name.c_str());
+                existed = false;
+                fd_ = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+                if (fd_ >= 0 && ftruncate(fd_, static_cast<off_t>(size)) != 0) {
+                    close();
+                    return false;
+                }
+            }
+        } else if (fd_ >= 0 && ftruncate(fd_, static_cast<off_t>(size)) != 0) {
+            close();
+            return false;
+        }
+        if (fd_ < 0) {
+            return false;
+        }
+        return map();
+#endif
+    }
+
+    bool open(const std::string& name, size_t size) {
+        name_ = name;
+        size_ = size;
+#ifdef _WIN32
+        mapping_ = OpenFileMappingW(FILE_MAP_ALL_ACCESS, FALSE, toWide(name).c_str());
+        if (!mapping_) {
+            return false;
+        }
+#else
+        fd_ = shm_open(name.c_str(), O_RDWR, 0600);
+        if (fd_ < 0) {
+            return false;
+        }
+        struct stat info;
+        if (fstat(fd_, &info) != 0 || static_cast<size_t>(info.st_size) < size) {
+            close();
+            return false;
+        }
+#endif
+        return map();
+    }
+
+    void close() {
+#ifdef _WIN32
+        if (data_) {
+            UnmapViewOfFile(data_);
+        }
+        if (mapping_) {
+            CloseHandle(mapping_);
+            mapping_ = nullptr;
+        }
+#else
+        if (data_) {
+            munmap(data_, size_);
+        }
+        if (fd_ >= 0) {
+            ::close(fd_);
+            fd_ = -1;
+        }
+#endif
+        data_ = nullptr;
+    }
+
+    // 删除名称，已映射的进程不受影响（Windows在最后一个句柄关闭时自动释放）
+    void unlink() {
+#ifndef _WIN32
+        if (!name_.empty()) {
+            shm_unlink(name_.c_str());
+        }
+#endif
+    }
+
+    void* data() const { return data_; }
+
+private:
+    bool map() {
+#ifdef _WIN32
+        data_ = MapViewOfFile(mapping_, FILE_MAP_ALL_ACCESS, 0, 0, size_);
+#else
+        void* data = mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+        data_ = data == MAP_FAILED ? nullptr : data;
+#endif
+        if (!data_) {
+            close();
+            return false;
+        }
+        return true;
+    }
+
+private:
+    std::string name_;
+    size_t size_ = 0;
+    void* data_ = nullptr;
+#ifdef _WIN32
+    HANDLE mapping_ = nullptr;
+#else
+    int fd_ = -1;
+#endif
+};
+
+/**
+ * 跨进程唤醒信号：POSIX命名信号量或Windows命名自动重置事件
+ * 多次post可能合并为一次唤醒，接收方每次唤醒都应取空缓冲区
+ */
+class WakeSignal {
+public:
+    WakeSignal() = default;
+    ~WakeSignal() { close(); }
+
+    WakeSignal(const WakeSignal&) = delete;
+    WakeSignal& operator=(const WakeSignal&) = delete;
+
+    bool create(const std::string& name) {
+        name_ = name;
+#ifdef _WIN32
+        event_ = CreateEventW(nullptr, FALSE, FALSE, toWide(name).c_str());
+        return event_ != nullptr;
+#else
+        // 丢弃上次异常退出遗留的计数
+        sem_unlink(name.c_str());
+        sem_ = sem_open(name.c_str(), O_CREAT | O_EXCL, 0600, 0);
+        if (sem_ == SEM_FAILED) {
+            sem_ = nullptr;
+        }
+        return sem_ != nullptr;
+#endif
+    }
+
+    bool open(const std::string& name) {
+        name_ = name;
+#ifdef _WIN32
+        event_ = OpenEventW(EVENT_MODIFY_STATE | SYNCHRONIZE, FALSE, toWide(name).c_str());
+        return event_ != nullptr;
+#else
+        sem_ = sem_open(name.c_str(), 0);
+        if (sem_ == SEM_FAILED) {
+            sem_ = nullptr;
+        }
+        return sem_ != nullptr;
+#endif
+    }
+
+    void close() {
+#ifdef _WIN32
+        if (event_) {
+            CloseHandle(event_);
+            event_ = nullptr;
+        }
+#else
+        if (sem_) {
+            sem_close(sem_);
+            sem_ = nullptr;
+        }
+#endif
+    }
+
+    void unlink() {
+#ifndef _WIN32
+        if (!name_.empty()) {
+            sem_unlink(name_.c_str());
+        }
+#endif
+    }
+
+    void post() {
+#ifdef _WIN32
+        if (event_) {
+            SetEvent(event_);
+        }
+#else
+        if (sem_) {
+            sem_post(sem_);
+        }
+#endif
+    }
+
+    /**
+     * 等待信号
+     * @return 是否被唤醒（超时返回false）
+     */
+    bool wait(int timeout_ms) {
+#ifdef _WIN32
+        return event_ && WaitForSingleObject(event_, static_cast<DWORD>(timeout_ms)) == WAIT_OBJECT_0;
+#elif defined(__APPLE__)
+        // macOS不支持sem_timedwait，以短间隔轮询
+        if (!sem_) {
+            return false;
+        }
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+        while (sem_trywait(sem_) != 0) {
+            if (std::chrono::steady_clock::now() >= deadline) {
+                return false;
+            }
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+        }
+        return true;
+#else
+        if (!sem_) {
+            return false;
+        }
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += timeout_ms / 1000;
+        deadline.tv_nsec += static_cast<long>(timeout_ms % 1000) * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec += 1;
+            deadline.tv_nsec -= 1000000000L;
+        }
+        while (sem_timedwait(sem_, &deadline) != 0) {
+            if (errno != EINTR) {
+                return false;
+            }
+        }
+        return true;
+#endif
+    }
+
+private:
+    std::string name_;
+#ifdef _WIN32
+    HANDLE event_ = nullptr;
+#else
+    sem_t* sem_ = nullptr;
+#endif
+};
+
+std::string slotSignalName(size_t index) {
+    return channelName("-c" + std::to_string(index));
+}
+
+} // namespace
+
+// ===== 服务端 =====
+
+class EngineServer::Impl {
+public:
+    // 一个前端连接对应的会话
+    struct Session {
+        std::unique_ptr<Engine> engine;
+        IpcSlot* slot = nullptr;
+        WakeSignal* client_signal = nullptr;
+        uint32_t client_pid = 0;
+        std::mutex response_mutex;      // 按键线程和预测线程都会写响应
+    };
+
+    explicit Impl(const EngineConfig& config)
+        : config_(config), region_data_(nullptr), running_(false), session_count_(0) {
+    }
+
+    ~Impl() {
+        stop();
+    }
+
+    bool start() {
+        if (running_) {
+            return true;
+        }
+
+        spdlog::info("Starting engine server...");
+
+        dictionary_manager_ = std::make_shared<DictionaryManager>(config_.dictionary_path, config_.lexicon_path,
+                                                                  config_.ngram_model_path);
+        if (!dictionary_manager_->initialize()) {
+            spdlog::error("Failed to initialize shared dictionary manager");
+            dictionary_manager_.reset();
+            return false;
+        }
+        dictionary_manager_->setFuzzyPinyin(config_.fuzzy);
+        dictionary_manager_->setFrequencyHalfLife(config_.frequency_half_life_days);
+
+        if (!openChannel()) {
+            dictionary_manager_->shutdown();
+            dictionary_manager_.reset();
+            return false;
+        }
+
+        // 所有会话共用一份模型，在后台加载
+        if (config_.enable_prediction) {
+            prediction_engine_ = std::make_shared<PredictionEngine>(config_.model_path, config_.lexicon_path,
+                                                                    config_.model);
+            prediction_engine_->setSystemLoadProvider(system_load_provider_);
+            model_thread_ = std::thread([engine = prediction_engine_] {
+                if (!engine->initialize()) {
+                    spdlog::warn("Failed to initialize shared prediction engine, continuing without AI prediction");
+                }
+            });
+        }
+
+        running_ = true;
+        service_thread_ = std::thread([this] { serviceLoop(); });
+
+        spdlog::info("Engine server started");
+        return true;
+    }
+
+    void stop() {
+        if (!running_.exchange(false)) {
+            return;
+        }
+
+        server_signal_.post();
+        if (service_thread_.joinable()) {
+            service_thread_.join();
+        }
+
+        for (size_t i = 0; i < MAX_SESSIONS; ++i) {
+            closeSession(i);
+        }
+
+        closeChannel();
+
+        if (model_thread_.joinable()) {
+            model_thread_.join();
+        }
+        if (prediction_engine_) {
+            prediction_engine_->shutdown();
+            prediction_engine_.reset();
+        }
+        if (dictionary_manager_) {
+            dictionary_manager_->shutdown();
+            dictionary_manager_.reset();
+        }
+
+        spdlog::info("Engine server stopped");
+    }
+
+    bool isRunning() const {
+        return running_;
+    }
+
+    size_t getSessionCount() const {
+        return session_count_;
+    }
+
+private:
+    bool openChannel() {
+        const std::string name = channelName("");
+
+        bool existed = false;
+        if (!region_.create(name, sizeof(IpcRegion), existed)) {
+            spdlog::error("Failed to create engine server shared memory: {}", name);
+            return false;
+        }
+
+        auto* existing = static_cast<IpcRegion*>(region_.data());
+        if (existed) {
+            if (existing->magic.load(std::memory_order_acquire) == IPC_MAGIC &&
+                isProcessAlive(existing->server_pid.load(std::memory_order_relaxed))) {
+                spdlog::error("Another engine server is already running (pid {})", existing->server_pid.load());
+                region_.close();
+                return false;
+            }
+
+            // 上次异常退出遗留的区域
+#ifdef _WIN32
+            if (existing->magic.load() != 0 && existing->version != IPC_VERSION) {
+                spdlog::error("Stale engine server shared memory has an incompatible layout");
+                region_.close();
+                return false;
+            }
+#else
+            region_.close();
+            region_.unlink();
+            if (!region_.create(name, sizeof(IpcRegion), existed) || existed) {
+                spdlog::error("Failed to recreate engine server shared memory: {}", name);
+                region_.close();
+                return false;
+            }
+#endif
+        }
+
+        region_data_ = new (region_.data()) IpcRegion;
+        region_data_->magic.store(0, std::memory_order_relaxed);
+        region_data_->version = IPC_VERSION;
+        region_data_->server_pid.store(currentProcessId(), std::memory_order_relaxed);
+        region_data_->slot_count = static_cast<uint32_t>(MAX_SESSIONS);
+        for (auto& slot : region_data_->slots) {
+            slot.state.store(static_cast<uint32_t>(SlotState::FREE), std::memory_order_relaxed);
+            slot.client_pid.store(0, std::memory_order_relaxed);
+            slot.requests.reset();
+            slot.responses.reset();
+        }
+
+        bool signals_ready = server_signal_.create(channelName("-srv"));
+        for (size_t i = 0; i < MAX_SESSIONS && signals_ready; ++i) {
+            signals_ready = slot_signals_[i].create(slotSignalName(i));
+        }
+        if (!signals_ready) {
+            spdlog::error("Failed to create engine server wake signals");
+            closeChannel();
+            return false;
+        }
+
+        // 客户端看到magic后才会连接
+        region_data_->magic.store(IPC_MAGIC, std::memory_order_release);
+        return true;
+    }
+
+    void closeChannel() {
+        if (region_data_) {
+            region_data_->magic.store(0, std::memory_order_relaxed);
+            region_data_->server_pid.store(0, std::memory_order_release);
+            region_data_ = nullptr;
+        }
+        region_.close();
+        region_.unlink();
+
+        server_signal_.close();
+        server_signal_.unlink();
+        for (auto& signal : slot_signals_) {
+            signal.close();
+            signal.unlink();
+        }
+    }
+
+    void serviceLoop() {
+        auto last_check = std::chrono::steady_clock::now();
+
+        while (running_) {
+            server_signal_.wait(SERVER_POLL_MS);
+            if (!running_) {
+                break;
+            }
+
+            for (size_t i = 0; i < MAX_SESSIONS; ++i) {
+                IpcSlot& slot = region_data_->slots[i];
+                if (!sessions_[i] && slot.state.load(std::memory_order_acquire) == static_cast<uint32_t>(SlotState::ACTIVE)) {
+                    openSession(i);
+                }
+                if (sessions_[i]) {
+                    drainRequests(i);
+                }
+            }
+
+            auto now = std::chrono::steady_clock::now();
+            if (now - last_check >= std::chrono::milliseconds(SERVER_POLL_MS)) {
+                reapDeadClients();
+                last_check = now;
+            }
+        }
+    }
+
+    void openSession(size_t index) {
+        IpcSlot& slot = region_data_->slots[index];
+
+        auto session = std::make_unique<Session>();
+        session->slot = &slot;
+        session->client_signal = &slot_signals_[index];
+        session->client_pid = slot.client_pid.load(std::memory_order_relaxed);
+        session->engine = std::make_unique<Engine>(config_, dictionary_manager_, prediction_engine_);
+
+        Session* raw = session.get();
+        session->engine->setCandidateCallback([this, raw](const CandidateList& candidates) {
+            pushCandidates(*raw, candidates);
+        });
+        session->engine->setCommitCallback([this, raw](const std::string& text) {
+            pushResponse(*raw, ResponseType::COMMIT, 0, 0, &text);
+        });
+        session->engine->setStateChangeCallback([this, raw](InputState state) {
+            pushResponse(*raw, ResponseType::STATE, 0, static_cast<int32_t>(state), nullptr);
+        });
+
+        if (!session->engine->initialize()) {
+            spdlog::error("Failed to initialize engine session {}", index);
+            slot.state.store(static_cast<uint32_t>(SlotState::FREE), std::memory_order_release);
+            return;
+        }
+
+        sessions_[index] = std::move(session);
+        ++session_count_;
+        spdlog::info("Engine session {} opened for pid {}", index, sessions_[index]->client_pid);
+    }
+
+    void closeSession(size_t index) {
+        if (!sessions_[index]) {
+            return;
+        }
+
+        sessions_[index]->engine->shutdown();
+        sessions_[index].reset();
+        --session_count_;
+
+        if (region_data_) {
+            IpcSlot& slot = region_data_->slots[index];
+            slot.client_pid.store(0, std::memory_order_relaxed);
+            slot.state.store(static_cast<uint32_t>(SlotState::FREE), std::memory_order_release);
+        }
+        spdlog::info("Engine session {} closed", index);
+    }
+
+    void drainRequests(size_t index) {
+        Session& session = *sessions_[index];
+        IpcRequest request;
+
+        while (session.slot->requests.pop(request)) {
+            if (request.type == static_cast<uint32_t>(RequestType::DISCONNECT)) {
+                closeSession(index);
+                return;
+            }
+
+            if (request.type != static_cast<uint32_t>(RequestType::INPUT_EVENT)) {
+                continue;
+            }
+
+            request.data[IPC_DATA_SIZE - 1] = '\0';
+            InputEvent event(static_cast<InputEventType>(request.event_type), request.data, request.key_code);
+            event.ctrl = request.ctrl != 0;
+            event.shift = request.shift != 0;
+            event.alt = request.alt != 0;
+
+            bool handled = session.engine->processInput(event);
+            pushResponse(session, ResponseType::RESULT, request.sequence, handled ? 1 : 0, nullptr);
+        }
+    }
+
+    void reapDeadClients() {
+        for (size_t i = 0; i < MAX_SESSIONS; ++i) {
+            IpcSlot& slot = region_data_->slots[i];
+            if (sessions_[i]) {
+                if (!isProcessAlive(sessions_[i]->client_pid)) {
+                    spdlog::info("Client of engine session {} exited without disconnecting", i);
+                    closeSession(i);
+                }
+            } else if (slot.state.load(std::memory_order_acquire) == static_cast<uint32_t>(SlotState::CLAIMED) &&
+                       !isProcessAlive(slot.client_pid.load(std::memory_order_relaxed))) {
+                slot.state.store(static_cast<uint32_t>(SlotState::FREE), std::memory_order_release);
+            }
+        }
+    }
+
+    void pushResponse(Session& session, ResponseType type, uint32_t sequence, int32_t value, const std::string* text) {
+        std::lock_guard<std::mutex> lock(session.response_mutex);
+
+        IpcResponse* response = session.slot->responses.reserve();
+        if (!response) {
+            spdlog::warn("Response buffer of pid {} is full, dropping message", session.client_pid);
+            return;
+        }
+        response->type = static_cast<uint32_t>(type);
+        response->sequence = sequence;
+        response->value = value;
+        response->candidate_count = 0;
+        copyText(response->text, sizeof(response->text), text ? *text : std::string());
+        session.slot->responses.commit();
+        session.client_signal->post();
+    }
+
+    void pushCandidates(Session& session, const CandidateList& candidates) {
+        std::lock_guard<std::mutex> lock(session.response_mutex);
+
+        IpcResponse* response = session.slot->responses.reserve();
+        if (!response) {
+            spdlog::warn("Response buffer of pid {} is full, dropping candidates", session.client_pid);
+            return;
+        }
+        response->type = static_cast<uint32_t>(ResponseType::CANDIDATES);
+        response->sequence = 0;
+        response->value = 0;
+        response->text[0] = '\0';
+        response->candidate_count = static_cast<uint32_t>(std::min(candidates.size(), MAX_IPC_CANDIDATES));
+        for (uint32_t i = 0; i < response->candidate_count; ++i) {
+            IpcCandidate& out = response->candidates[i];
+            copyText(out.text, sizeof(out.text), candidates[i].text);
+            copyText(out.pinyin, sizeof(out.pinyin), candidates[i].pinyin);
+            out.score = candidates[i].score;
+            out.frequency = candidates[i].frequency;
+            out.is_prediction = candidates[i].is_prediction ? 1 : 0;
+        }
+        session.slot->responses.commit();
+        session.client_signal->post();
+    }
+
+public:
+    EngineConfig config_;
+    std::shared_ptr<DictionaryManager> dictionary_manager_;
+    std::shared_ptr<PredictionEngine> prediction_engine_;
+    SystemLoadProvider system_load_provider_;
+    std::thread model_thread_;
+
+    SharedRegion region_;
+    IpcRegion* region_data_;
+    WakeSignal server_signal_;
+    std::array<WakeSignal, MAX_SESSIONS> slot_signals_;
+    std::array<std::unique_ptr<Session>, MAX_SESSIONS> sessions_;  // 仅在服务线程中访问
+
+    std::thread service_thread_;
+    std::atomic<bool> running_;
+    std::atomic<size_t> session_count_;
+};
+
+// ===== 客户端 =====
+
+class RemoteEngine::Impl {
+public:
+    Impl()
+        : region_data_(nullptr), slot_(nullptr), connected_(false), next_sequence_(0)
+        , last_result_sequence_(0), last_result_handled_(false), state_(InputState::IDLE), timeout_ms_(200) {
+    }
+
+    ~Impl() {
+        disconnect();
+    }
+
+    bool connect() {
+        if (connected_) {
+            return true;
+        }
+
+        if (!region_.open(channelName(""), sizeof(IpcRegion))) {
+            spdlog::debug("Engine server is not running");
+            return false;
+        }
+
+        region_data_ = static_cast<IpcRegion*>(region_.data());
+        if (region_data_->magic.load(std::memory_order_acquire) != IPC_MAGIC ||
+            region_data_->version != IPC_VERSION ||
+            !isProcessAlive(region_data_->server_pid.load(std::memory_order_relaxed)) ||
+            !server_signal_.open(channelName("-srv"))) {
+            spdlog::warn("Engine server shared memory is stale or incompatible");
+            closeChannel();
+            return false;
+        }
+
+        // 申请空闲槽位
+        const uint32_t pid = currentProcessId();
+        for (size_t i = 0; i < region_data_->slot_count && i < EngineServer::MAX_SESSIONS; ++i) {
+            IpcSlot& slot = region_data_->slots[i];
+            uint32_t expected = static_cast<uint32_t>(SlotState::FREE);
+            if (!slot.state.compare_exchange_strong(expected, static_cast<uint32_t>(SlotState::CLAIMED),
+                                                    std::memory_order_acq_rel)) {
+                continue;
+            }
+
+            slot.client_pid.store(pid, std::memory_order_relaxed);
+            slot.requests.reset();
+            slot.responses.reset();
+
+            if (!client_signal_.open(slotSignalName(i))) {
+                slot.state.store(static_cast<uint32_t>(SlotState::FREE), std::memory_order_release);
+                break;
+            }
+            // 丢弃上一个使用者遗留的唤醒计数
+            while (client_signal_.wait(0)) {
+            }
+
+            slot_ = &slot;
+            slot.state.store(static_cast<uint32_t>(SlotState::ACTIVE), std::memory_order_release);
+            server_signal_.post();
+
+            connected_ = true;
+            receiver_thread_ = std::thread([this] { receiveLoop(); });
+            spdlog::info("Connected to engine server session {}", i);
+            return true;
+        }
+
+        spdlog::warn("No free engine server session available");
+        closeChannel();
+        return false;
+    }
+
+    void disconnect() {
+        {
+            // 响应超时后connected_已为false，仍通知守护进程释放会话
+            std::lock_guard<std::mutex> request_lock(request_mutex_);
+            connected_ = false;
+            if (slot_) {
+                IpcRequest* request = slot_->requests.reserve();
+                if (request) {
+                    request->sequence = 0;
+                    request->type = static_cast<uint32_t>(RequestType::DISCONNECT);
+                    slot_->requests.commit();
+                    server_signal_.post();
+                }
+            }
+        }
+        result_cv_.notify_all();
+
+        if (receiver_thread_.joinable() && receiver_thread_.get_id() != std::this_thread::get_id()) {
+            receiver_thread_.join();
+        }
+        closeChannel();
+    }
+
+    bool isConnected() const {
+        return connected_;
+    }
+
+    bool processInput(const InputEvent& event) {
+        std::lock_guard<std::mutex> request_lock(request_mutex_);
+        if (!connected_) {
+            return false;
+        }
+
+        IpcRequest* request = slot_->requests.reserve();
+        if (!request) {
+            spdlog::warn("Engine server request buffer is full");
+            return false;
+        }
+
+        const uint32_t sequence = ++next_sequence_;
+        request->sequence = sequence;
+        request->type = static_cast<uint32_t>(RequestType::INPUT_EVENT);
+        request->event_type = static_cast<int32_t>(event.type);
+        request->key_code = event.key_code;
+        request->ctrl = event.ctrl ? 1 : 0;
+        request->shift = event.shift ? 1 : 0;
+        request->alt = event.alt ? 1 : 0;
+        request->reserved = 0;
+        copyText(request->data, sizeof(request->data), event.data);
+        slot_->requests.commit();
+        server_signal_.post();
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        bool answered = result_cv_.wait_for(lock, std::chrono::milliseconds(timeout_ms_), [this, sequence] {
+            return !connected_ || static_cast<int32_t>(last_result_sequence_ - sequence) >= 0;
+        });
+        if (!answered || !connected_) {
+            spdlog::warn("Engine server did not respond within {} ms, disconnecting", timeout_ms_);
+            connected_ = false;
+            return false;
+        }
+        return last_result_handled_;
+    }
+
+    void receiveLoop() {
+        IpcResponse response;
+        CandidateList candidates;
+
+        while (connected_) {
+            client_signal_.wait(CLIENT_POLL_MS);
+
+            while (slot_->responses.pop(response)) {
+                dispatch(response, candidates);
+            }
+
+            if (!isProcessAlive(region_data_->server_pid.load(std::memory_order_relaxed))) {
+                spdlog::warn("Engine server exited");
+                connected_ = false;
+                result_cv_.notify_all();
+            }
+        }
+    }
+
+    void dispatch(const IpcResponse& response, CandidateList& candidates) {
+        switch (static_cast<ResponseType>(response.type)) {
+            case ResponseType::RESULT: {
+                std::lock_guard<std::mutex> lock(mutex_);
+                last_result_sequence_ = response.sequence;
+                last_result_handled_ = response.value != 0;
+                result_cv_.notify_all();
+                break;
+            }
+            case ResponseType::CANDIDATES: {
+                candidates.resize(response.candidate_count);
+                for (uint32_t i = 0; i < response.candidate_count; ++i) {
+                    const IpcCandidate& in = response.candidates[i];
+                    candidates[i].text.assign(in.text);
+                    candidates[i].pinyin.assign(in.pinyin);
+                    candidates[i].score = in.score;
+                    candidates[i].frequency = in.frequency;
+                    candidates[i].is_prediction = in.is_prediction != 0;
+                }
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    candidates_ = candidates;
+                }
+                if (candidate_callback_) {
+                    candidate_callback_(candidates);
+                }
+                break;
+            }
+            case ResponseType::COMMIT:
+                if (commit_callback_) {
+                    commit_callback_(response.text);
+                }
+                break;
+            case ResponseType::STATE: {
+                InputState state = static_cast<InputState>(response.value);
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    state_ = state;
+                }
+                if (state_change_callback_) {
+                    state_change_callback_(state);
+                }
+                break;
+            }
+            default:
+                break;
+        }
+    }
+
+    void closeChannel() {
+        client_signal_.close();
+        server_signal_.close();
+        region_.close();
+        region_data_ = nullptr;
+        slot_ = nullptr;
+    }
+
+public:
+    SharedRegion region_;
+    IpcRegion* region_data_;
+    IpcSlot* slot_;
+    WakeSignal server_signal_;
+    WakeSignal client_signal_;
+
+    std::thread receiver_thread_;
+    std::atomic<bool> connected_;
+    std::mutex request_mutex_;          // 请求缓冲区只有一个生产者
+    std::mutex mutex_;
+    std::condition_variable result_cv_;
+    uint32_t next_sequence_;
+    uint32_t last_result_sequence_;
+    bool last_result_handled_;
+
+    CandidateList candidates_;
+    InputState state_;
+    int timeout_ms_;
+
+    CandidateCallback candidate_callback_;
+    CommitCallback commit_callback_;
+    StateChangeCallback state_change_callback_;
+};
+
+// EngineServer implementation
+EngineServer::EngineServer(const EngineConfig& config)
+    : pImpl(std::make_unique<Impl>(config)) {
+}
+
+EngineServer::~EngineServer() = default;
+
+bool EngineServer::start() {
+    return pImpl->start();
+}
+
+void EngineServer::setSystemLoadProvider(SystemLoadProvider provider) {
+    pImpl->system_load_provider_ = std::move(provider);
+}
+
+void EngineServer::stop() {
+    pImpl->stop();
+}
+
+bool EngineServer::isRunning() const {
+    return pImpl->isRunning();
+}
+
+size_t EngineServer::getSessionCount() const {
+    return pImpl->getSessionCount();
+}
+
+// RemoteEngine implementation
+RemoteEngine::RemoteEngine()
+    : pImpl(std::make_unique<Impl>()) {
+}
+
+RemoteEngine::~RemoteEngine() = default;
+
+bool RemoteEngine::connect() {
+    return pImpl->connect();
+}
+
+void RemoteEngine::disconnect() {
+    pImpl->disconnect();
+}
+
+bool RemoteEngine::isConnected() const {
+    return pImpl->isConnected();
+}
+
+bool RemoteEngine::processInput(const InputEvent& event) {
+    return pImpl->processInput(event);
+}
+
+bool RemoteEngine::selectCandidate(int index) {
+    return pImpl->processInput(InputEvent(InputEventType::CANDIDATE_SELECT, std::to_string(index)));
+}
+
+void RemoteEngine::clearComposition() {
+    pImpl->processInput(InputEvent(InputEventType::CLEAR_COMPOSITION));
+}
+
+void RemoteEngine::resetContext() {
+    pImpl->processInput(InputEvent(InputEventType::RESET_CONTEXT));
+}
+
+void RemoteEngine::switchProfile(const std::string& application) {
+    pImpl->processInput(InputEvent(InputEventType::SWITCH_PROFILE, application));
+}
+
+CandidateList RemoteEngine::getCandidates() const {
+    std::lock_guard<std::mutex> lock(pImpl->mutex_);
+    return pImpl->candidates_;
+}
+
+InputState RemoteEngine::getState() const {
+    std::lock_guard<std::mutex> lock(pImpl->mutex_);
+    return pImpl->state_;
+}
+
+void RemoteEngine::setResponseTimeout(int timeout_ms) {
+    pImpl->timeout_ms_ = std::max(1, timeout_ms);
+}
+
+void RemoteEngine::setCandidateCallback(CandidateCallback callback) {
+    pImpl->candidate_callback_ = std::move(callback);
+}
+
+void RemoteEngine::setCommitCallback(CommitCallback callback) {
+    pImpl->commit_callback_ = std::move(callback);
+}
+
+void RemoteEngine::setStateChangeCallback(StateChangeCallback callback) {
+    pImpl->state_change_callback_ = std::move(callback);
+}
+
+} // namespace core
+} // namespace owcat
\ No newline at end of file
@@ -0,0 +1,501 @@
+#include "core/fuzzy_pinyin.h"
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <cstring>
+
+namespace owcat {
+namespace core {
+
+namespace {
+
+// 键盘同一行中每个字母左右相邻的键
+const char* const KEYBOARD_ROWS[] = {"qwertyuiop", "asdfghjkl", "zxcvbnm"};
+
+struct InitialRule {
+    char initial;
+    bool FuzzyPinyinConfig::*enabled;
+};
+
+// 平舌/翘舌：z c s 后补h或去掉h
+const InitialRule RETROFLEX_RULES[] = {
+    {'z', &FuzzyPinyinConfig::z_zh},
+    {'c', &FuzzyPinyinConfig::c_ch},
+    {'s', &FuzzyPinyinConfig::s_sh},
+};
+
+struct FinalRule {
+    const char* final;          // 前鼻音韵母，后鼻音加g
+    bool FuzzyPinyinConfig::*enabled;
+};
+
+const FinalRule NASAL_RULES[] = {
+    {"an", &FuzzyPinyinConfig::an_ang},
+    {"en", &FuzzyPinyinConfig::en_eng},
+    {"in", &FuzzyPinyinConfig::in_ing},
+};
+
+bool endsWith(std::string_view text, std::string_view suffix) {
+    return text.size() >= suffix.size() && text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+} // namespace
+
+FuzzyPinyin::FuzzyPinyin() : enabled_(false) {
+}
+
+void FuzzyPinyin::clear() {
+    config_ = FuzzyPinyinConfig();
+    enabled_ = false;
+    syllables_.clear();
+    alternative_begin_.clear();
+    alternatives_.clear();
+    corrections_.clear();
+    correction_pool_.clear();
+}
+
+bool FuzzyPinyin::isEnabled() const {
+    return enabled_;
+}
+
+void FuzzyPinyin::build(const std::vector<std::string>& syllables, const FuzzyPinyinConfig& config) {
+    clear();
+    config_ = config;
+    syllables_ = syllables;
+
+    const size_t max_alternatives = std::min<size_t>(std::max(0, config.max_alternatives), kMaxChoices - 1);
+
+    // 模糊音：每个音节的规则变体中有效的音节
+    std::string variants[kMaxVariants];
+    uint8_t penalties[kMaxVariants];
+    alternative_begin_.reserve(syllables_.size() + 1);
+    for (const auto& syllable : syllables_) {
+        alternative_begin_.push_back(static_cast<uint32_t>(alternatives_.size()));
+        const size_t first = alternatives_.size();
+
+        size_t count = ruleVariants(syllable, false, variants, penalties);
+        for (size_t i = 0; i < count; ++i) {
+            int id = findSyllable(variants[i]);
+            if (id >= 0) {
+                alternatives_.push_back({static_cast<uint16_t>(id), penalties[i]});
+            }
+        }
+
+        std::stable_sort(alternatives_.begin() + first, alternatives_.end(),
+                         [](const Alternative& a, const Alternative& b) { return a.penalty < b.penalty; });
+        if (alternatives_.size() - first > max_alternatives) {
+            alternatives_.resize(first + max_alternatives);
+        }
+    }
+    alternative_begin_.push_back(static_cast<uint32_t>(alternatives_.size()));
+
+    // 纠错：每个音节的单处编辑中既不是音节也不是音节前缀的字母串，映射回原音节
+    struct Edit {
+        std::string token;
+        uint16_t syllable_id;
+    };
+    std::vector<Edit> edits;
+    auto addEdit = [this, &edits](std::string token, size_t id) {
+        if (!isSyllablePrefix(token)) {
+            edits.push_back({std::move(token), static_cast<uint16_t>(id)});
+        }
+    };
+
+    for (size_t id = 0; id < syllables_.size(); ++id) {
+        const std::string& syllable = syllables_[id];
+
+        if (config.transpositions) {
+            for (size_t i = 0; i + 1 < syllable.size(); ++i) {
+                if (syllable[i] != syllable[i + 1]) {
+                    std::string token = syllable;
+                    std::swap(token[i], token[i + 1]);
+                    addEdit(std::move(token), id);
+                }
+            }
+        }
+
+        if (config.adjacent_keys) {
+            for (size_t i = 0; i < syllable.size(); ++i) {
+                for (const char* row : KEYBOARD_ROWS) {
+                    const char* key = std::strchr(row, syllable[i]);
+                    if (!key) {
+                        continue;
+                    }
+                    if (key > row) {
+                        std::string token = syllable;
+                        token[i] = key[-1];
+                        addEdit(std::move(token), id);
+                    }
+                    if (key[1] != '\0') {
+                        std::string token = syllable;
+                        token[i] = key[1];
+                        addEdit(std::move(token), id);
+                    }
+                }
+            }
+        }
+    }
+
+    std::sort(edits.begin(), edits.end(), [](const Edit& a, const Edit& b) {
+        return a.token != b.token ? a.token < b.token : a.syllable_id < b.syllable_id;
+    });
+
+    for (size_t i = 0; i < edits.size();) {
+        size_t j = i;
+        Correction correction;
+        correction.token = edits[i].token;
+        correction.begin = static_cast<uint32_t>(correction_pool_.size());
+        for (; j < edits.size() && edits[j].token == edits[i].token; ++j) {
+            const bool duplicate = j > i && edits[j].syllable_id == edits[j - 1].syllable_id;
+            if (!duplicate && correction_pool_.size() - correction.begin < max_alternatives) {
+                correction_pool_.push_back({edits[j].syllable_id, kTypoPenalty});
+            }
+        }
+        correction.end = static_cast<uint32_t>(correction_pool_.size());
+        corrections_.push_back(std::move(correction));
+        i = j;
+    }
+
+    enabled_ = !alternatives_.empty() || !corrections_.empty();
+    if (enabled_) {
+        spdlog::info("Fuzzy pinyin table built: {} alternatives, {} typo corrections",
+                     alternatives_.size(), corrections_.size());
+    }
+}
+
+int FuzzyPinyin::findSyllable(std::string_view syllable) const {
+    auto it = std::lower_bound(syllables_.begin(), syllables_.end(), syllable,
+                               [](const std::string& a, std::string_view b) { return a < b; });
+    if (it == syllables_.end() || *it != syllable) {
+        return -1;
+    }
+    return static_cast<int>(it - syllables_.begin());
+}
+
+bool FuzzyPinyin::isSyllablePrefix(std::string_view prefix) const {
+    auto it = std::lower_bound(syllables_.begin(), syllables_.end(), prefix,
+                               [](const std::string& a, std::string_view b) { return a < b; });
+    return it != syllables_.end() && it->compare(0, prefix.size(), prefix.data(), prefix.size()) == 0;
+}
+
+size_t FuzzyPinyin::ruleVariants(std::string_view text, bool is_prefix, std::string* out, uint8_t* penalties) const {
+    if (text.empty()) {
+        return 0;
+    }
+
+    // 声母替换：最多一种
+    std::string initial_variant;
+    for (const auto& rule : RETROFLEX_RULES) {
+        if (!(config_.*rule.enabled) || text[0] != rule.initial) {
+            continue;
+        }
+        if (text.size() >= 2 && text[1] == 'h') {
+            initial_variant = std::string(1, rule.initial).append(text.substr(2));
+        } else if (!(is_prefix && text.size() == 1)) {
+            // 单个 z/c/s 作前缀时已包含 zh/ch/sh
+            initial_variant = std::string(1, rule.initial).append("h").append(text.substr(1));
+        }
+    }
+    if (config_.n_l && (text[0] == 'n' || text[0] == 'l')) {
+        initial_variant = std::string(text);
+        initial_variant[0] = text[0] == 'n' ? 'l' : 'n';
+    }
+
+    // 韵母替换：后鼻音去掉g，前鼻音补g（前缀已包含补g的音节）
+    auto finalVariant = [this, is_prefix](std::string_view base) {
+        for (const auto& rule : NASAL_RULES) {
+            if (!(config_.*rule.enabled)) {
+                continue;
+            }
+            const std::string back_nasal = std::string(rule.final) + 'g';
+            if (endsWith(base, back_nasal)) {
+                return std::string(base.substr(0, base.size() - 1));
+            }
+            if (!is_prefix && endsWith(base, rule.final)) {
+                return std::string(base).append("g");
+            }
+        }
+        return std::string();
+    };
+
+    size_t count = 0;
+    if (!initial_variant.empty()) {
+        out[count] = initial_variant;
+        penalties[count++] = kFuzzyPenalty;
+    }
+    std::string final_variant = finalVariant(text);
+    if (!final_variant.empty()) {
+        out[count] = final_variant;
+        penalties[count++] = kFuzzyPenalty;
+    }
+    if (!initial_variant.empty() && !final_variant.empty()) {
+        std::string both = finalVariant(initial_variant);
+        if (!both.empty()) {
+            out[count] = both;
+            penalties[count++] = 2 * kFuzzyPenalty;
+        }
+    }
+    return count;
+}
+
+const FuzzyPinyin::Alternative* FuzzyPinyin::getAlternatives(uint16_t syllable_id, size_t& count) const {
+    count = 0;
+    if (syllable_id + 1u >= alternative_begin_.size()) {
+        return nullptr;
+    }
+    const uint32_t begin = alternative_begin_[syllable_id];
+    count = alternative_begin_[syllable_id + 1] - begin;
+    return count > 0 ? alternatives_.data() + begin : nullptr;
+}
+
+const FuzzyPinyin::Alternative* FuzzyPinyin::getCorrections(std::string_view token, size_t& count) const {
+    count = 0;
+    auto it = std::lower_bound(corrections_.begin(), corrections_.end(), token,
+                               [](const Correction& a, std::string_view b) { return a.token < b; });
+    if (it == corrections_.end() || it->token != token) {
+        return nullptr;
+    }
+    count = it->end - it->begin;
+    return correction_pool_.data() + it->begin;
+}
+
+size_t FuzzyPinyin::positionChoices(std::string_view token, bool is_last, Choice* out) const {
+    if (token.size() > kMaxSyllableLength) {
+        return 0;
+    }
+
+    size_t count = 0;
+    auto addSyllable = [&count, out](uint16_t id, uint8_t penalty) {
+        out[count].syllable_id = id;
+        out[count].penalty = penalty;
+        out[count].prefix_length = 0;
+        ++count;
+    };
+    auto addPrefix = [&count, out](std::string_view prefix, uint8_t penalty) {
+        out[count].syllable_id = 0;
+        out[count].penalty = penalty;
+        out[count].prefix_length = static_cast<uint8_t>(prefix.size());
+        std::memcpy(out[count].prefix, prefix.data(), prefix.size());
+        out[count].prefix[prefix.size()] = '\0';
+        ++count;
+    };
+
+    if (is_last && isSyllablePrefix(token)) {
+        addPrefix(token, 0);
+        std::string variants[kMaxVariants];
+        uint8_t penalties[kMaxVariants];
+        size_t variant_count = ruleVariants(token, true, variants, penalties);
+        for (size_t i = 0; i < variant_count && count < kMaxChoices; ++i) {
+            if (variants[i].size() <= kMaxSyllableLength && isSyllablePrefix(variants[i])) {
+                addPrefix(variants[i], penalties[i]);
+            }
+        }
+        return count;
+    }
+
+    int id = is_last ? -1 : findSyllable(token);
+    if (id >= 0) {
+        addSyllable(static_cast<uint16_t>(id), 0);
+        size_t alternative_count = 0;
+        const Alternative* alternatives = getAlternatives(static_cast<uint16_t>(id), alternative_count);
+        for (size_t i = 0; i < alternative_count && count < kMaxChoices; ++i) {
+            addSyllable(alternatives[i].syllable_id, alternatives[i].penalty);
+        }
+        return count;
+    }
+
+    // 无效的音节（或末尾无效的前缀）按纠错表替换为完整音节
+    size_t correction_count = 0;
+    const Alternative* corrections = getCorrections(token, correction_count);
+    for (size_t i = 0; i < correction_count && count < kMaxChoices; ++i) {
+        if (is_last) {
+            addPrefix(syllables_[corrections[i].syllable_id], corrections[i].penalty);
+        } else {
+            addSyllable(corrections[i].syllable_id, corrections[i].penalty);
+        }
+    }
+    return count;
+}
+
+size_t FuzzyPinyin::expand(std::string_view pinyin, Query* out, size_t max_queries) const {
+    if (max_queries == 0) {
+        return 0;
+    }
+
+    // 拆分空格分隔的音节并列出每个位置的选择
+    Expansion expansion;
+    expansion.position_count = 0;
+
+    std::string_view tokens[kMaxQuerySyllables];
+    size_t token_count = 0;
+    size_t pos = 0;
+    while (pos < pinyin.size()) {
+        size_t space = pinyin.find(' ', pos);
+        if (space == std::string_view::npos) {
+            space = pinyin.size();
+        }
+        if (space > pos) {
+            if (token_count >= kMaxQuerySyllables) {
+                return 0;
+            }
+            tokens[token_count++] = pinyin.substr(pos, space - pos);
+        }
+        pos = space + 1;
+    }
+    if (token_count == 0) {
+        return 0;
+    }
+
+    for (size_t i = 0; i < token_count; ++i) {
+        size_t count = positionChoices(tokens[i], i + 1 == token_count, expansion.choices[i]);
+        if (count == 0) {
+            return 0;
+        }
+        expansion.choice_counts[i] = static_cast<uint8_t>(count);
+    }
+    expansion.position_count = token_count;
+
+    // 剪枝用：从每个位置到末尾最多还能累加的代价
+    expansion.suffix_max_penalty[token_count] = 0;
+    for (size_t i = token_count; i > 0; --i) {
+        uint8_t max_penalty = 0;
+        for (size_t c = 0; c < expansion.choice_counts[i - 1]; ++c) {
+            max_penalty = std::max(max_penalty, expansion.choices[i - 1][c].penalty);
+        }
+        expansion.suffix_max_penalty[i - 1] = static_cast<uint8_t>(
+            std::min<int>(UINT8_MAX, expansion.suffix_max_penalty[i] + max_penalty));
+    }
+
+    // 按总代价从低到高逐层枚举，直到输出缓冲区写满
+    max_queries = std::min<size_t>(max_queries, std::max(1, config_.max_queries));
+    size_t written = 0;
+    Query current;
+    for (uint8_t target = 0; target <= kMaxPenalty && written < max_queries; ++target) {
+        current.syllable_count = 0;
+        current.penalty = 0;
+        enumerate(expansion, 0, target, current, out, max_queries, written);
+    }
+    return written;
+}
+
+void FuzzyPinyin::enumerate(const Expansion& expansion, size_t position, uint8_t target, Query& current,
+                            Query* out, size_t max_queries, size_t& written) const {
+    if (written >= max_queries || current.penalty + expansion.suffix_max_penalty[position] < target) {
+        return;
+    }
+
+    if (position == expansion.position_count) {
+        if (current.penalty == target) {
+            out[written++] = current;
+        }
+        return;
+    }
+
+    const bool is_last = position + 1 == expansion.position_count;
+    for (size_t c = 0; c < expansion.choice_counts[position]; ++c) {
+        const Choice& choice = expansion.choices[position][c];
+        if (current.penalty + choice.penalty > target) {
+            continue;
+        }
+
+        const uint8_t saved_penalty = current.penalty;
+        current.penalty = static_cast<uint8_t>(current.penalty + choice.penalty);
+        if (is_last) {
+            current.last_length = choice.prefix_length;
+            std::memcpy(current.last, choice.prefix, choice.prefix_length + 1);
+        } else {
+            current.syllable_ids[position] = choice.syllable_id;
+            current.syllable_count = static_cast<uint8_t>(position + 1);
+        }
+
+        enumerate(expansion, position + 1, target, current, out, max_queries, written);
+        current.penalty = saved_penalty;
+        if (written >= max_queries) {
+            return;
+        }
+    }
+}
+
+int FuzzyPinyin::matchPenalty(std::string_view word_pinyin, std::string_view pinyin) const {
+    int penalty = 0;
+    size_t word_pos = 0;
+    size_t pos = 0;
+
+    while (pos < pinyin.size()) {
+        size_t space = pinyin.find(' ', pos);
+        if (space == std::string_view::npos) {
+            space = pinyin.size();
+        }
+        std::string_view token = pinyin.substr(pos, space - pos);
+        const bool is_last = space >= pinyin.size();
+        pos = space + 1;
+        if (token.empty()) {
+            continue;
+        }
+
+        if (word_pos >= word_pinyin.size()) {
+            return -1;
+        }
+        size_t word_space = word_pinyin.find(' ', word_pos);
+        if (word_space == std::string_view::npos) {
+            word_space = word_pinyin.size();
+        }
+        std::string_view syllable = word_pinyin.substr(word_pos, word_space - word_pos);
+        word_pos = word_space + 1;
+
+        // 末尾音节按前缀比较
+        auto matches = [is_last, syllable](std::string_view text) {
+            return is_last ? syllable.compare(0, text.size(), text) == 0 : syllable == text;
+        };
+        if (matches(token)) {
+            continue;
+        }
+
+        // 简拼：非末尾的声母等不完整音节按前缀比较，不计代价
+        if (!is_last && findSyllable(token) < 0 && isSyllablePrefix(token) &&
+            syllable.compare(0, token.size(), token) == 0) {
+            continue;
+        }
+        
+        int best = -1;
+        const int syllable_id = findSyllable(syllable);
+        const int token_id = is_last ? -1 : findSyllable(token);
+        if (token_id >= 0) {
+            size_t count = 0;
+            const Alternative* alternatives = getAlternatives(static_cast<uint16_t>(token_id), count);
+            for (size_t i = 0; i < count; ++i) {
+                if (alternatives[i].syllable_id == syllable_id) {
+                    best = alternatives[i].penalty;
+                    break;
+                }
+            }
+        } else if (is_last && isSyllablePrefix(token)) {
+            std::string variants[kMaxVariants];
+            uint8_t penalties[kMaxVariants];
+            size_t count = ruleVariants(token, true, variants, penalties);
+            for (size_t i = 0; i < count; ++i) {
+                if (matches(variants[i]) && (best < 0 || penalties[i] < best)) {
+                    best = penalties[i];
+                }
+            }
+        } else {
+            size_t count = 0;
+            const Alternative* corrections = getCorrections(token, count);
+            for (size_t i = 0; i < count; ++i) {
+                if (matches(syllables_[corrections[i].syllable_id])) {
+                    best = corrections[i].penalty;
+                    break;
+                }
+            }
+        }
+
+        if (best < 0) {
+            return -1;
+        }
+        penalty += best;
+    }
+
+    return penalty;
+}
+
+} // namespace core
+} // namespace owcat
\ No newline at end of file
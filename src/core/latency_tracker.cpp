@@ -0,0 +1,346 @@
+#include "core/latency_tracker.h"
+#include <spdlog/spdlog.h>
+#include <nlohmann/json.hpp>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <vector>
+#include <algorithm>
+
+namespace owcat {
+namespace core {
+
+namespace {
+
+// 每个2的幂区间分为4个子桶，相对误差不超过约12%
+constexpr size_t SUB_BUCKET_BITS = 2;
+constexpr size_t SUB_BUCKETS = 1u << SUB_BUCKET_BITS;
+constexpr size_t BUCKET_COUNT = 64 * SUB_BUCKETS;
+constexpr size_t STAGE_COUNT = static_cast<size_t>(LatencyStage::COUNT);
+
+size_t highestBit(uint64_t value) {
+    size_t bit = 0;
+    while (value >>= 1) {
+        ++bit;
+    }
+    return bit;
+}
+
+size_t bucketIndex(uint64_t value) {
+    if (value < SUB_BUCKETS) {
+        return static_cast<size_t>(value);
+    }
+    const size_t msb = highestBit(value);
+    const size_t sub = static_cast<size_t>(value >> (msb - SUB_BUCKET_BITS)) & (SUB_BUCKETS - 1);
+    return (msb - SUB_BUCKET_BITS + 1) * SUB_BUCKETS + sub;
+}
+
+// 桶的代表值取区间中点
+double bucketValue(size_t index) {
+    if (index < SUB_BUCKETS) {
+        return static_cast<double>(index);
+    }
+    const size_t msb = index / SUB_BUCKETS + SUB_BUCKET_BITS - 1;
+    const size_t sub = index % SUB_BUCKETS;
+    const double width = static_cast<double>(uint64_t(1) << (msb - SUB_BUCKET_BITS));
+    return static_cast<double>(SUB_BUCKETS + sub) * width + width / 2.0;
+}
+
+std::string formatMicros(double us) {
+    std::ostringstream oss;
+    if (us >= 1000.0) {
+        oss << std::fixed << std::setprecision(2) << us / 1000.0 << "ms";
+    } else {
+        oss << std::fixed << std::setprecision(0) << us << "us";
+    }
+    return oss.str();
+}
+
+thread_local uint64_t t_current_event = 0;
+std::atomic<uint32_t> g_next_thread_id{1};
+thread_local uint32_t t_thread_id = 0;
+
+uint32_t currentThreadId() {
+    if (t_thread_id == 0) {
+        t_thread_id = g_next_thread_id.fetch_add(1, std::memory_order_relaxed);
+    }
+    return t_thread_id;
+}
+
+} // namespace
+
+class LatencyTracker::Impl {
+public:
+    struct Histogram {
+        std::array<std::atomic<uint64_t>, BUCKET_COUNT> buckets;
+        std::atomic<uint64_t> count;
+        std::atomic<uint64_t> max_ns;
+    };
+
+    // 序号为奇数表示正在写入，读取前后序号一致才有效
+    struct TraceSlot {
+        std::atomic<uint64_t> sequence;
+        std::atomic<uint64_t> event_id;
+        std::atomic<uint64_t> start_ns;
+        std::atomic<uint64_t> duration_ns;
+        std::atomic<uint32_t> stage;
+        std::atomic<uint32_t> thread_id;
+    };
+
+    Impl() : next_event_(0), next_trace_(0), trace_enabled_(false) {
+        clear();
+    }
+
+    void clear() {
+        for (auto& histogram : histograms_) {
+            for (auto& bucket : histogram.buckets) {
+                bucket.store(0, std::memory_order_relaxed);
+            }
+            histogram.count.store(0, std::memory_order_relaxed);
+            histogram.max_ns.store(0, std::memory_order_relaxed);
+        }
+        for (auto& slot : trace_) {
+            slot.sequence.store(0, std::memory_order_relaxed);
+        }
+        next_trace_.store(0, std::memory_order_release);
+    }
+
+    void record(LatencyStage stage, uint64_t event_id, uint64_t start_ns, uint64_t duration_ns) {
+        const size_t stage_index = static_cast<size_t>(stage);
+        if (stage_index >= STAGE_COUNT) {
+            return;
+        }
+
+        Histogram& histogram = histograms_[stage_index];
+        histogram.buckets[bucketIndex(duration_ns)].fetch_add(1, std::memory_order_relaxed);
+        histogram.count.fetch_add(1, std::memory_order_relaxed);
+        uint64_t current_max = histogram.max_ns.load(std::memory_order_relaxed);
+        while (duration_ns > current_max &&
+               !histogram.max_ns.compare_exchange_weak(current_max, duration_ns, std::memory_order_relaxed)) {
+        }
+
+        if (!trace_enabled_.load(std::memory_order_relaxed)) {
+            return;
+        }
+
+        const uint64_t ticket = next_trace_.fetch_add(1, std::memory_order_relaxed);
+        TraceSlot& slot = trace_[ticket % TRACE_CAPACITY];
+        slot.sequence.store(ticket * 2 + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.event_id.store(event_id, std::memory_order_relaxed);
+        slot.start_ns.store(start_ns, std::memory_order_relaxed);
+        slot.duration_ns.store(duration_ns, std::memory_order_relaxed);
+        slot.stage.store(static_cast<uint32_t>(stage_index), std::memory_order_relaxed);
+        slot.thread_id.store(currentThreadId(), std::memory_order_relaxed);
+        slot.sequence.store(ticket * 2 + 2, std::memory_order_release);
+    }
+
+    LatencyStats getStats(LatencyStage stage) const {
+        LatencyStats stats;
+        const size_t stage_index = static_cast<size_t>(stage);
+        if (stage_index >= STAGE_COUNT) {
+            return stats;
+        }
+
+        const Histogram& histogram = histograms_[stage_index];
+        std::array<uint64_t, BUCKET_COUNT> snapshot;
+        uint64_t total = 0;
+        for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+            snapshot[i] = histogram.buckets[i].load(std::memory_order_relaxed);
+            total += snapshot[i];
+        }
+        if (total == 0) {
+            return stats;
+        }
+
+        const uint64_t max_ns = histogram.max_ns.load(std::memory_order_relaxed);
+        stats.count = total;
+        stats.p50_us = std::min(percentile(snapshot, total, 0.50), static_cast<double>(max_ns)) / 1000.0;
+        stats.p99_us = std::min(percentile(snapshot, total, 0.99), static_cast<double>(max_ns)) / 1000.0;
+        stats.max_us = static_cast<double>(max_ns) / 1000.0;
+        return stats;
+    }
+
+    bool writeChromeTrace(const std::string& path) const {
+        struct TraceEvent {
+            uint64_t event_id;
+            uint64_t start_ns;
+            uint64_t duration_ns;
+            uint32_t stage;
+            uint32_t thread_id;
+        };
+
+        // 只读取已写完且在读取期间未被覆盖的槽位
+        std::vector<TraceEvent> events;
+        events.reserve(TRACE_CAPACITY);
+        for (const auto& slot : trace_) {
+            const uint64_t before = slot.sequence.load(std::memory_order_acquire);
+            if (before == 0 || (before & 1) != 0) {
+                continue;
+            }
+            TraceEvent event;
+            event.event_id = slot.event_id.load(std::memory_order_relaxed);
+            event.start_ns = slot.start_ns.load(std::memory_order_relaxed);
+            event.duration_ns = slot.duration_ns.load(std::memory_order_relaxed);
+            event.stage = slot.stage.load(std::memory_order_relaxed);
+            event.thread_id = slot.thread_id.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot.sequence.load(std::memory_order_relaxed) != before || event.stage >= STAGE_COUNT) {
+                continue;
+            }
+            events.push_back(event);
+        }
+
+        std::sort(events.begin(), events.end(), [](const TraceEvent& a, const TraceEvent& b) {
+            return a.start_ns < b.start_ns;
+        });
+
+        nlohmann::json trace_events = nlohmann::json::array();
+        for (const auto& event : events) {
+            nlohmann::json item;
+            item["name"] = getStageName(static_cast<LatencyStage>(event.stage));
+            item["cat"] = "owcat";
+            item["ph"] = "X";
+            item["ts"] = static_cast<double>(event.start_ns) / 1000.0;
+            item["dur"] = static_cast<double>(event.duration_ns) / 1000.0;
+            item["pid"] = 1;
+            item["tid"] = event.thread_id;
+            item["args"] = {{"input_event", event.event_id}};
+            trace_events.push_back(std::move(item));
+        }
+
+        nlohmann::json root;
+        root["traceEvents"] = std::move(trace_events);
+        root["displayTimeUnit"] = "ms";
+
+        std::ofstream file(path);
+        if (!file.is_open()) {
+            spdlog::error("Failed to open trace file: {}", path);
+            return false;
+        }
+        file << root.dump();
+        if (!file) {
+            spdlog::error("Failed to write trace file: {}", path);
+            return false;
+        }
+
+        spdlog::info("Wrote {} latency trace events to {}", events.size(), path);
+        return true;
+    }
+
+private:
+    static double percentile(const std::array<uint64_t, BUCKET_COUNT>& buckets, uint64_t total, double q) {
+        const uint64_t rank = static_cast<uint64_t>(q * static_cast<double>(total - 1));
+        uint64_t seen = 0;
+        for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+            seen += buckets[i];
+            if (seen > rank) {
+                return bucketValue(i);
+            }
+        }
+        return bucketValue(BUCKET_COUNT - 1);
+    }
+
+public:
+    std::array<Histogram, STAGE_COUNT> histograms_;
+    std::array<TraceSlot, TRACE_CAPACITY> trace_;
+    std::atomic<uint64_t> next_event_;
+    std::atomic<uint64_t> next_trace_;
+    std::atomic<bool> trace_enabled_;
+};
+
+LatencyTracker& LatencyTracker::instance() {
+    static LatencyTracker tracker;
+    return tracker;
+}
+
+LatencyTracker::LatencyTracker() : pImpl(std::make_unique<Impl>()) {}
+
+LatencyTracker::~LatencyTracker() = default;
+
+uint64_t LatencyTracker::beginEvent() {
+    t_current_event = pImpl->next_event_.fetch_add(1, std::memory_order_relaxed) + 1;
+    return t_current_event;
+}
+
+uint64_t LatencyTracker::currentEvent() {
+    return t_current_event;
+}
+
+void LatencyTracker::setCurrentEvent(uint64_t event_id) {
+    t_current_event = event_id;
+}
+
+void LatencyTracker::record(LatencyStage stage, uint64_t event_id, uint64_t start_ns, uint64_t duration_ns) {
+    pImpl->record(stage, event_id, start_ns, duration_ns);
+}
+
+LatencyStats LatencyTracker::getStats(LatencyStage stage) const {
+    return pImpl->getStats(stage);
+}
+
+std::map<std::string, std::string> LatencyTracker::getSummary() const {
+    std::map<std::string, std::string> summary;
+    for (size_t i = 0; i < STAGE_COUNT; ++i) {
+        const LatencyStage stage = static_cast<LatencyStage>(i);
+        const LatencyStats stats = getStats(stage);
+        if (stats.count == 0) {
+            continue;
+        }
+        std::ostringstream oss;
+        oss << "p50 " << formatMicros(stats.p50_us)
+            << " / p99 " << formatMicros(stats.p99_us)
+            << " / max " << formatMicros(stats.max_us)
+            << " (" << stats.count << ")";
+        summary[std::string("Latency ") + getStageName(stage)] = oss.str();
+    }
+    return summary;
+}
+
+void LatencyTracker::setTraceEnabled(bool enabled) {
+    pImpl->trace_enabled_.store(enabled, std::memory_order_relaxed);
+}
+
+bool LatencyTracker::isTraceEnabled() const {
+    return pImpl->trace_enabled_.load(std::memory_order_relaxed);
+}
+
+bool LatencyTracker::writeChromeTrace(const std::string& path) const {
+    return pImpl->writeChromeTrace(path);
+}
+
+void LatencyTracker::reset() {
+    pImpl->clear();
+}
+
+const char* LatencyTracker::getStageName(LatencyStage stage) {
+    switch (stage) {
+        case LatencyStage::PLATFORM_KEY:
+            return "platform_key";
+        case LatencyStage::ENGINE_INPUT:
+            return "engine_input";
+        case LatencyStage::DICTIONARY_LOOKUP:
+            return "dictionary_lookup";
+        case LatencyStage::SENTENCE_DECODE:
+            return "sentence_decode";
+        case LatencyStage::CONTEXT_RERANK:
+            return "context_rerank";
+        case LatencyStage::PREDICTION:
+            return "prediction";
+        case LatencyStage::CANDIDATE_RENDER:
+            return "candidate_render";
+        default:
+            return "unknown";
+    }
+}
+
+uint64_t LatencyTracker::nowNs() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+} // namespace core
+} // namespace owcat
\ No newline at end of file
@@ -0,0 +1,1389 @@
+#include "core/lexicon.h"
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <unordered_map>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace owcat {
+namespace core {
+
+namespace {
+
+// 单个拼音查询最多支持的音节数
+constexpr size_t MAX_QUERY_SYLLABLES = 32;
+
+// 简拼查询中按首字母匹配的位置
+constexpr uint16_t NO_SYLLABLE = UINT16_MAX;
+
+// 简拼索引覆盖的最大音节数：每个首字母占5位，共60位
+constexpr size_t MAX_ABBREVIATION_SYLLABLES = 12;
+constexpr unsigned ABBREVIATION_BITS = 5;
+
+// 频率量化刻度：q = log2(1 + f) * FREQUENCY_SCALE
+constexpr double FREQUENCY_SCALE = 2000.0;
+
+#pragma pack(push, 1)
+struct LexiconHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t syllable_count;
+    uint32_t key_count;
+    uint32_t entry_count;
+    uint32_t syllable_table_offset;     // uint32 offsets[syllable_count + 1] + 字符数据
+    uint32_t key_offset;                // LexiconKeyRecord[key_count]
+    uint32_t key_syllable_offset;       // uint16 音节ID池
+    uint32_t key_syllable_count;
+    uint32_t entry_offset;              // LexiconEntryRecord[entry_count]
+    uint32_t string_pool_offset;
+    uint32_t string_pool_size;
+    uint32_t file_size;
+    // 版本2起：简拼索引
+    uint32_t abbreviation_key_offset;   // LexiconAbbreviationKey[abbreviation_key_count]
+    uint32_t abbreviation_key_count;
+    uint32_t abbreviation_entry_offset; // LexiconAbbreviationEntry[abbreviation_entry_count]
+    uint32_t abbreviation_entry_count;
+    // 版本3起：最高频率树，uint16[2 * 键数]，节点i的子节点为2i和2i+1，叶子 键数 + k 为第k个键的最高频率
+    uint32_t key_rank_offset;
+    uint32_t abbreviation_rank_offset;
+};
+
+// 版本1、2的文件头只有前面的字段
+constexpr size_t LEXICON_HEADER_V1_SIZE = 52;
+constexpr size_t LEXICON_HEADER_V2_SIZE = 68;
+
+struct LexiconKeyRecord {
+    uint32_t syllable_begin;            // 在音节ID池中的起点
+    uint32_t entry_begin;               // 在条目表中的起点
+    uint16_t syllable_count;
+    uint16_t entry_count;
+};
+
+struct LexiconEntryRecord {
+    uint32_t text_offset;               // 在字符串池中的偏移
+    uint16_t text_length;
+    uint16_t frequency;                 // 量化频率
+};
+
+// 简拼键：各音节首字母序列，按首字母左对齐压缩，数值顺序即字典序
+struct LexiconAbbreviationKey {
+    uint64_t initials;
+    uint32_t entry_begin;               // 在简拼条目表中的起点
+    uint32_t entry_count;
+};
+
+// 简拼条目：指向主条目表，键内按频率降序，每个键只保留前K个
+struct LexiconAbbreviationEntry {
+    uint32_t key_index;                 // 所属的音节序列键
+    uint32_t entry_index;               // 在条目表中的下标
+};
+#pragma pack(pop)
+
+static_assert(sizeof(LexiconHeader) == 76, "unexpected lexicon header size");
+static_assert(sizeof(LexiconKeyRecord) == 12, "unexpected lexicon key size");
+static_assert(sizeof(LexiconEntryRecord) == 8, "unexpected lexicon entry size");
+static_assert(sizeof(LexiconAbbreviationKey) == 16, "unexpected abbreviation key size");
+static_assert(sizeof(LexiconAbbreviationEntry) == 8, "unexpected abbreviation entry size");
+
+/**
+ * 把第position个音节的首字母放入简拼键
+ */
+uint64_t packInitial(char letter, size_t position) {
+    return static_cast<uint64_t>(letter - 'a' + 1) << (ABBREVIATION_BITS * (MAX_ABBREVIATION_SYLLABLES - 1 - position));
+}
+
+/**
+ * 以前count个首字母为前缀的简拼键区间大小
+ */
+uint64_t abbreviationSpan(size_t count) {
+    return static_cast<uint64_t>(1) << (ABBREVIATION_BITS * (MAX_ABBREVIATION_SYLLABLES - count));
+}
+
+/**
+ * 前缀查询中待访问的键或最高频率树节点，frequency为其覆盖的键中的最高频率
+ */
+struct KeyRank {
+    uint16_t frequency;
+    uint32_t node;
+
+    bool operator<(const KeyRank& other) const {
+        return frequency < other.frequency;
+    }
+};
+
+/**
+ * 按最高频率从高到低取出区间内的键
+ * 有最高频率树时只放入覆盖区间的O(log n)个节点，取出时逐层展开，访问的键数取决于输出条数而非区间大小；
+ * 版本1、2的文件没有这棵树，逐个放入区间内的键
+ */
+class BestKeyQueue {
+public:
+    BestKeyQueue(const uint16_t* tree, uint32_t key_count)
+        : tree_(tree), key_count_(key_count), ranks_(scratch()) {
+    }
+    
+    template <typename TopFrequency>
+    void seed(uint32_t first, uint32_t last, TopFrequency top) {
+        if (!tree_) {
+            for (uint32_t index = first; index < last; ++index) {
+                ranks_.push_back({top(index), key_count_ + index});
+            }
+            std::make_heap(ranks_.begin(), ranks_.end());
+            return;
+        }
+        
+        // 自底向上分解区间，选出的节点的子树都落在区间内
+        for (uint32_t l = key_count_ + first, r = key_count_ + last; l < r; l >>= 1, r >>= 1) {
+            if (l & 1) {
+                push(l++);
+            }
+            if (r & 1) {
+                push(--r);
+            }
+        }
+    }
+    
+    /**
+     * 取出最高频率最大的键，途经的树节点展开为两个子节点
+     */
+    bool next(uint32_t& index, uint16_t& frequency) {
+        while (!ranks_.empty()) {
+            std::pop_heap(ranks_.begin(), ranks_.end());
+            const KeyRank best = ranks_.back();
+            ranks_.pop_back();
+            if (best.node >= key_count_) {
+                index = best.node - key_count_;
+                frequency = best.frequency;
+                return true;
+            }
+            push(2 * best.node);
+            push(2 * best.node + 1);
+        }
+        return false;
+    }
+
+private:
+    // 每个线程一个暂存区，容量在查询间保留
+    static std::vector<KeyRank>& scratch() {
+        thread_local std::vector<KeyRank> ranks;
+        ranks.clear();
+        return ranks;
+    }
+    
+    void push(uint32_t node) {
+        ranks_.push_back({tree_[node], node});
+        std::push_heap(ranks_.begin(), ranks_.end());
+    }
+    
+    const uint16_t* tree_;
+    uint32_t key_count_;
+    std::vector<KeyRank>& ranks_;
+};
+
+/**
+ * 由各键的最高频率建出最高频率树，节点0不用
+ */
+std::vector<uint16_t> buildRankTree(const std::vector<uint16_t>& leaves) {
+    const size_t count = leaves.size();
+    std::vector<uint16_t> tree(2 * count, 0);
+    std::copy(leaves.begin(), leaves.end(), tree.begin() + count);
+    for (size_t node = count; node-- > 1; ) {
+        tree[node] = std::max(tree[2 * node], tree[2 * node + 1]);
+    }
+    return tree;
+}
+
+/**
+ * 比较音节序列（字典序，短序列在前）
+ */
+int compareSyllables(const uint16_t* a, size_t a_count, const uint16_t* b, size_t b_count) {
+    size_t n = std::min(a_count, b_count);
+    for (size_t i = 0; i < n; ++i) {
+        if (a[i] != b[i]) {
+            return a[i] < b[i] ? -1 : 1;
+        }
+    }
+    if (a_count == b_count) {
+        return 0;
+    }
+    return a_count < b_count ? -1 : 1;
+}
+
+} // namespace
+
+// ---------------------------------------------------------------------------
+// Lexicon
+// ---------------------------------------------------------------------------
+
+class Lexicon::Impl {
+public:
+    Impl()
+        : data_(nullptr), size_(0), header_(nullptr), syllable_offsets_(nullptr), syllable_chars_(nullptr)
+        , keys_(nullptr), key_syllables_(nullptr), entries_(nullptr), string_pool_(nullptr)
+        , abbreviation_keys_(nullptr), abbreviation_entries_(nullptr), key_ranks_(nullptr), abbreviation_ranks_(nullptr)
+#ifdef _WIN32
+        , file_(INVALID_HANDLE_VALUE), mapping_(nullptr)
+#endif
+    {
+    }
+
+    ~Impl() {
+        close();
+    }
+
+    bool open(const std::string& path, bool verify) {
+        close();
+
+        if (!mapFile(path)) {
+            return false;
+        }
+
+        if (!validate() || (verify && !verifyRecords())) {
+            spdlog::error("Invalid lexicon file: {}", path);
+            close();
+            return false;
+        }
+
+        spdlog::info("Lexicon mapped: {} ({} syllables, {} keys, {} entries, {} bytes)",
+                     path, header_->syllable_count, header_->key_count, header_->entry_count, size_);
+        return true;
+    }
+
+    void close() {
+        unmapFile();
+        header_ = nullptr;
+        syllable_offsets_ = nullptr;
+        syllable_chars_ = nullptr;
+        keys_ = nullptr;
+        key_syllables_ = nullptr;
+        entries_ = nullptr;
+        string_pool_ = nullptr;
+        abbreviation_keys_ = nullptr;
+        abbreviation_entries_ = nullptr;
+        key_ranks_ = nullptr;
+        abbreviation_ranks_ = nullptr;
+    }
+
+    bool isOpen() const {
+        return header_ != nullptr;
+    }
+
+    std::string_view getSyllable(int syllable_id) const {
+        if (!isOpen() || syllable_id < 0 || static_cast<uint32_t>(syllable_id) >= header_->syllable_count) {
+            return {};
+        }
+        uint32_t begin = syllable_offsets_[syllable_id];
+        uint32_t end = syllable_offsets_[syllable_id + 1];
+        return std::string_view(syllable_chars_ + begin, end - begin);
+    }
+
+    int findSyllableId(std::string_view syllable) const {
+        if (!isOpen() || syllable.empty()) {
+            return -1;
+        }
+
+        int lo = 0;
+        int hi = static_cast<int>(header_->syllable_count);
+        while (lo < hi) {
+            int mid = lo + (hi - lo) / 2;
+            int cmp = getSyllable(mid).compare(syllable);
+            if (cmp == 0) {
+                return mid;
+            }
+            if (cmp < 0) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        return -1;
+    }
+
+    bool findSyllablePrefixRange(std::string_view prefix, int& begin, int& end) const {
+        begin = end = 0;
+        if (!isOpen() || prefix.empty()) {
+            return false;
+        }
+
+        // 第一个 >= prefix 的音节
+        int lo = 0;
+        int hi = static_cast<int>(header_->syllable_count);
+        while (lo < hi) {
+            int mid = lo + (hi - lo) / 2;
+            if (getSyllable(mid) < prefix) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        begin = lo;
+
+        // 第一个不以 prefix 开头的音节
+        hi = static_cast<int>(header_->syllable_count);
+        while (lo < hi) {
+            int mid = lo + (hi - lo) / 2;
+            if (getSyllable(mid).substr(0, prefix.size()) == prefix) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        end = lo;
+
+        return begin < end;
+    }
+
+    // 第一个 >= target 的键
+    uint32_t lowerBound(const uint16_t* target, size_t count) const {
+        uint32_t lo = 0;
+        uint32_t hi = header_->key_count;
+        while (lo < hi) {
+            uint32_t mid = lo + (hi - lo) / 2;
+            const LexiconKeyRecord& key = keys_[mid];
+            if (compareSyllables(key_syllables_ + key.syllable_begin, key.syllable_count, target, count) < 0) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        return lo;
+    }
+
+    // 第一个不以 prefix 开头且大于它的键：把前缀当作多位数加一
+    uint32_t prefixUpperBound(uint16_t* prefix, size_t count) const {
+        for (size_t n = count; n > 0; --n) {
+            if (prefix[n - 1] + 1u < header_->syllable_count) {
+                uint16_t saved = prefix[n - 1];
+                prefix[n - 1] = static_cast<uint16_t>(saved + 1);
+                uint32_t index = lowerBound(prefix, n);
+                prefix[n - 1] = saved;
+                return index;
+            }
+        }
+        return header_->key_count;
+    }
+
+    void fillEntry(const LexiconKeyRecord& key, const LexiconEntryRecord& record, LexiconEntry& entry) const {
+        entry.text = std::string_view(string_pool_ + record.text_offset, record.text_length);
+        entry.frequency = dequantizeFrequency(record.frequency);
+        entry.syllable_ids = key_syllables_ + key.syllable_begin;
+        entry.syllable_count = key.syllable_count;
+    }
+
+    size_t lookup(const uint16_t* syllable_ids, size_t count, LexiconEntry* out, size_t max_results) const {
+        if (!isOpen() || count == 0 || max_results == 0) {
+            return 0;
+        }
+
+        uint32_t index = lowerBound(syllable_ids, count);
+        if (index >= header_->key_count) {
+            return 0;
+        }
+
+        const LexiconKeyRecord& key = keys_[index];
+        if (compareSyllables(key_syllables_ + key.syllable_begin, key.syllable_count, syllable_ids, count) != 0) {
+            return 0;
+        }
+
+        size_t n = std::min<size_t>(key.entry_count, max_results);
+        for (size_t i = 0; i < n; ++i) {
+            fillEntry(key, entries_[key.entry_begin + i], out[i]);
+        }
+        return n;
+    }
+
+    size_t lookupPinyin(std::string_view pinyin, LexiconEntry* out, size_t max_results) const {
+        if (!isOpen() || max_results == 0) {
+            return 0;
+        }
+
+        // 解析空格分隔的音节，最后一个音节作为前缀；之前不是音节的音节前缀按简拼处理
+        uint16_t ids[MAX_QUERY_SYLLABLES + 1];
+        std::string_view tokens[MAX_QUERY_SYLLABLES + 1];
+        size_t count = 0;
+        bool abbreviated = false;
+        std::string_view last;
+
+        size_t pos = 0;
+        while (pos < pinyin.size()) {
+            size_t space = pinyin.find(' ', pos);
+            if (space == std::string_view::npos) {
+                space = pinyin.size();
+            }
+
+            std::string_view token = pinyin.substr(pos, space - pos);
+            pos = space + 1;
+            if (token.empty()) {
+                continue;
+            }
+
+            if (!last.empty()) {
+                if (count >= MAX_QUERY_SYLLABLES) {
+                    return 0;
+                }
+                int id = findSyllableId(last);
+                int range_begin = 0;
+                int range_end = 0;
+                if (id < 0 && !findSyllablePrefixRange(last, range_begin, range_end)) {
+                    return 0;
+                }
+                abbreviated = abbreviated || id < 0;
+                tokens[count] = last;
+                ids[count++] = id < 0 ? NO_SYLLABLE : static_cast<uint16_t>(id);
+            }
+            last = token;
+        }
+
+        if (last.empty()) {
+            return 0;
+        }
+
+        if (abbreviated) {
+            tokens[count] = last;
+            ids[count] = NO_SYLLABLE;
+            return lookupAbbreviated(tokens, ids, count + 1, out, max_results);
+        }
+        return lookupPrefix(ids, count, last, out, max_results);
+    }
+
+    // 条目是否满足简拼查询中各位置的约束：完整音节须相同，其余须以输入的字母开头
+    bool matchesAbbreviation(const LexiconKeyRecord& key, const std::string_view* tokens, const uint16_t* ids,
+                             size_t count) const {
+        const uint16_t* syllables = key_syllables_ + key.syllable_begin;
+        for (size_t i = 0; i < count; ++i) {
+            if (ids[i] != NO_SYLLABLE) {
+                if (syllables[i] != ids[i]) {
+                    return false;
+                }
+            } else if (tokens[i].size() > 1 && getSyllable(syllables[i]).substr(0, tokens[i].size()) != tokens[i]) {
+                return false;
+            }
+        }
+        return true;
+    }
+    
+    size_t lookupAbbreviated(const std::string_view* tokens, const uint16_t* ids, size_t count,
+                             LexiconEntry* out, size_t max_results) const {
+        if (!abbreviation_keys_ || count < 2 || count > MAX_ABBREVIATION_SYLLABLES) {
+            return 0;
+        }
+        
+        uint64_t initials = 0;
+        for (size_t i = 0; i < count; ++i) {
+            initials |= packInitial(tokens[i][0], i);
+        }
+        
+        auto lowerBoundInitials = [this](uint64_t target) {
+            const LexiconAbbreviationKey* begin = abbreviation_keys_;
+            const LexiconAbbreviationKey* end = abbreviation_keys_ + header_->abbreviation_key_count;
+            return static_cast<uint32_t>(std::lower_bound(begin, end, target,
+                [](const LexiconAbbreviationKey& key, uint64_t value) { return key.initials < value; }) - begin);
+        };
+        
+        // 首字母序列完全相同的词优先，其余按频率合并更长的词
+        size_t written = 0;
+        uint32_t first = lowerBoundInitials(initials);
+        const uint32_t last_key = lowerBoundInitials(initials + abbreviationSpan(count));
+        if (first < last_key && abbreviation_keys_[first].initials == initials) {
+            const LexiconAbbreviationKey& abbreviation = abbreviation_keys_[first++];
+            for (uint32_t i = 0; i < abbreviation.entry_count && written < max_results; ++i) {
+                const LexiconAbbreviationEntry& item = abbreviation_entries_[abbreviation.entry_begin + i];
+                const LexiconKeyRecord& key = keys_[item.key_index];
+                if (matchesAbbreviation(key, tokens, ids, count)) {
+                    fillEntry(key, entries_[item.entry_index], out[written++]);
+                }
+            }
+        }
+        
+        // 更长的词按各键最高频率从高到低访问，输出已满且下一个键的最高频率不超过末项时结束；
+        // 结果与扫描整个区间相同，短前缀下区间后部的高频词不会因键的顺序被截断
+        BestKeyQueue queue(abbreviation_ranks_, header_->abbreviation_key_count);
+        queue.seed(first, last_key, [this](uint32_t index) { return abbreviationTopFrequency(index); });
+        
+        const size_t exact_written = written;
+        uint32_t index = 0;
+        uint16_t top = 0;
+        while (queue.next(index, top)) {
+            if (written >= max_results && dequantizeFrequency(top) <= out[written - 1].frequency) {
+                break;
+            }
+            
+            const LexiconAbbreviationKey& abbreviation = abbreviation_keys_[index];
+            for (uint32_t i = 0; i < abbreviation.entry_count; ++i) {
+                const LexiconAbbreviationEntry& item = abbreviation_entries_[abbreviation.entry_begin + i];
+                const LexiconKeyRecord& key = keys_[item.key_index];
+                const LexiconEntryRecord& record = entries_[item.entry_index];
+                uint32_t frequency = dequantizeFrequency(record.frequency);
+                
+                // 键内条目已按频率降序，放不下时后续条目也放不下
+                if (written >= max_results && frequency <= out[written - 1].frequency) {
+                    break;
+                }
+                if (!matchesAbbreviation(key, tokens, ids, count)) {
+                    continue;
+                }
+                
+                size_t slot = std::min(written, max_results - 1);
+                while (slot > exact_written && out[slot - 1].frequency < frequency) {
+                    if (slot < max_results) {
+                        out[slot] = out[slot - 1];
+                    }
+                    --slot;
+                }
+                fillEntry(key, record, out[slot]);
+                if (written < max_results) {
+                    ++written;
+                }
+            }
+        }
+        
+        return written;
+    }
+    
+    size_t lookupPrefix(const uint16_t* syllable_ids, size_t count, std::string_view last,
+                        LexiconEntry* out, size_t max_results) const {
+        if (!isOpen() || max_results == 0 || last.empty() || count > MAX_QUERY_SYLLABLES) {
+            return 0;
+        }
+
+        uint16_t ids[MAX_QUERY_SYLLABLES + 1];
+        std::copy(syllable_ids, syllable_ids + count, ids);
+
+        int range_begin = 0;
+        int range_end = 0;
+        if (!findSyllablePrefixRange(last, range_begin, range_end)) {
+            return 0;
+        }
+
+        size_t written = 0;
+
+        // 完全匹配的键优先
+        int exact_id = findSyllableId(last);
+        uint32_t exact_index = header_->key_count;
+        if (exact_id >= 0) {
+            ids[count] = static_cast<uint16_t>(exact_id);
+            uint32_t index = lowerBound(ids, count + 1);
+            if (index < header_->key_count) {
+                const LexiconKeyRecord& key = keys_[index];
+                if (compareSyllables(key_syllables_ + key.syllable_begin, key.syllable_count, ids, count + 1) == 0) {
+                    exact_index = index;
+                    written = lookup(ids, count + 1, out, max_results);
+                }
+            }
+        }
+
+        if (written >= max_results) {
+            return written;
+        }
+
+        // 前缀区间 [prefix + range_begin, prefix + range_end) 内的键连续存放
+        ids[count] = static_cast<uint16_t>(range_begin);
+        uint32_t first = lowerBound(ids, count + 1);
+        uint32_t last_key;
+        if (static_cast<uint32_t>(range_end) < header_->syllable_count) {
+            ids[count] = static_cast<uint16_t>(range_end);
+            last_key = lowerBound(ids, count + 1);
+        } else {
+            last_key = prefixUpperBound(ids, count);
+        }
+
+        // 其余条目按频率合并到有序的输出区间 [exact_written, written)；
+        // 按各键最高频率从高到低访问，输出已满且下一个键的最高频率不超过末项时结束，
+        // 结果与扫描整个区间相同，短前缀（如 "z"）下区间后部的高频词不会因音节ID顺序被截断
+        BestKeyQueue queue(key_ranks_, header_->key_count);
+        queue.seed(first, last_key, [this](uint32_t index) { return keyTopFrequency(index); });
+
+        const size_t exact_written = written;
+        uint32_t index = 0;
+        uint16_t top = 0;
+        while (queue.next(index, top)) {
+            if (written >= max_results && dequantizeFrequency(top) <= out[written - 1].frequency) {
+                break;
+            }
+            if (index == exact_index) {
+                continue;
+            }
+
+            const LexiconKeyRecord& key = keys_[index];
+            for (uint32_t i = 0; i < key.entry_count; ++i) {
+                const LexiconEntryRecord& record = entries_[key.entry_begin + i];
+                uint32_t frequency = dequantizeFrequency(record.frequency);
+
+                // 键内条目已按频率降序，放不下时后续条目也放不下
+                if (written >= max_results && frequency <= out[written - 1].frequency) {
+                    break;
+                }
+
+                size_t slot = std::min(written, max_results - 1);
+                while (slot > exact_written && out[slot - 1].frequency < frequency) {
+                    if (slot < max_results) {
+                        out[slot] = out[slot - 1];
+                    }
+                    --slot;
+                }
+                fillEntry(key, record, out[slot]);
+                if (written < max_results) {
+                    ++written;
+                }
+            }
+        }
+
+        return written;
+    }
+
+    // 键内首个条目的量化频率，空键为0
+    uint16_t keyTopFrequency(uint32_t index) const {
+        const LexiconKeyRecord& key = keys_[index];
+        return key.entry_count > 0 ? entries_[key.entry_begin].frequency : 0;
+    }
+    
+    uint16_t abbreviationTopFrequency(uint32_t index) const {
+        const LexiconAbbreviationKey& abbreviation = abbreviation_keys_[index];
+        return abbreviation.entry_count > 0
+            ? entries_[abbreviation_entries_[abbreviation.entry_begin].entry_index].frequency : 0;
+    }
+    
+    void forEachEntry(const std::function<void(const LexiconEntry&)>& visitor) const {
+        if (!isOpen()) {
+            return;
+        }
+
+        LexiconEntry entry;
+        for (uint32_t k = 0; k < header_->key_count; ++k) {
+            const LexiconKeyRecord& key = keys_[k];
+            for (uint32_t i = 0; i < key.entry_count; ++i) {
+                fillEntry(key, entries_[key.entry_begin + i], entry);
+                visitor(entry);
+            }
+        }
+    }
+
+    size_t getSyllableCount() const {
+        return isOpen() ? header_->syllable_count : 0;
+    }
+
+    size_t getKeyCount() const {
+        return isOpen() ? header_->key_count : 0;
+    }
+
+    size_t getEntryCount() const {
+        return isOpen() ? header_->entry_count : 0;
+    }
+
+    size_t getAbbreviationCount() const {
+        return abbreviation_keys_ ? header_->abbreviation_key_count : 0;
+    }
+
+private:
+    bool mapFile(const std::string& path) {
+#ifdef _WIN32
+        file_ = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                            OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_RANDOM_ACCESS, nullptr);
+        if (file_ == INVALID_HANDLE_VALUE) {
+            spdlog::error("Failed to open lexicon file: {}", path);
+            return false;
+        }
+
+        LARGE_INTEGER file_size;
+        if (!GetFileSizeEx(file_, &file_size) || file_size.QuadPart == 0) {
+            spdlog::error("Failed to get lexicon file size: {}", path);
+            unmapFile();
+            return false;
+        }
+
+        mapping_ = CreateFileMappingA(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!mapping_) {
+            spdlog::error("Failed to create lexicon file mapping: {}", path);
+            unmapFile();
+            return false;
+        }
+
+        data_ = MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0);
+        if (!data_) {
+            spdlog::error("Failed to map lexicon file: {}", path);
+            unmapFile();
+            return false;
+        }
+        size_ = static_cast<size_t>(file_size.QuadPart);
+#else
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            spdlog::error("Failed to open lexicon file: {}", path);
+            return false;
+        }
+
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size == 0) {
+            spdlog::error("Failed to get lexicon file size: {}", path);
+            ::close(fd);
+            return false;
+        }
+
+        void* data = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (data == MAP_FAILED) {
+            spdlog::error("Failed to map lexicon file: {}", path);
+            return false;
+        }
+
+        madvise(data, static_cast<size_t>(st.st_size), MADV_RANDOM);
+        data_ = data;
+        size_ = static_cast<size_t>(st.st_size);
+#endif
+        return true;
+    }
+
+    void unmapFile() {
+#ifdef _WIN32
+        if (data_) {
+            UnmapViewOfFile(data_);
+        }
+        if (mapping_) {
+            CloseHandle(mapping_);
+            mapping_ = nullptr;
+        }
+        if (file_ != INVALID_HANDLE_VALUE) {
+            CloseHandle(file_);
+            file_ = INVALID_HANDLE_VALUE;
+        }
+#else
+        if (data_) {
+            munmap(data_, size_);
+        }
+#endif
+        data_ = nullptr;
+        size_ = 0;
+    }
+
+    bool sectionInBounds(uint64_t offset, uint64_t length) const {
+        return offset % 4 == 0 && offset + length <= size_;
+    }
+
+    bool validate() {
+        if (size_ < LEXICON_HEADER_V1_SIZE) {
+            return false;
+        }
+
+        const auto* base = static_cast<const char*>(data_);
+        const auto* header = reinterpret_cast<const LexiconHeader*>(base);
+        const bool has_abbreviations = header->version >= 2;
+        const bool has_ranks = header->version >= 3;
+        if (header->magic != kMagic || header->version < 1 || header->version > kVersion ||
+            header->file_size != size_ || (has_abbreviations && size_ < LEXICON_HEADER_V2_SIZE) ||
+            (has_ranks && size_ < sizeof(LexiconHeader))) {
+            spdlog::error("Lexicon header mismatch (magic {:#x}, version {})", header->magic, header->version);
+            return false;
+        }
+
+        // 只校验各段边界，键和条目在查询时不再逐一检查，保证启动开销接近零
+        uint64_t syllable_offsets_size = (static_cast<uint64_t>(header->syllable_count) + 1) * sizeof(uint32_t);
+        if (header->syllable_count == 0 || header->syllable_count > 0xffff ||
+            !sectionInBounds(header->syllable_table_offset, syllable_offsets_size) ||
+            !sectionInBounds(header->key_offset, static_cast<uint64_t>(header->key_count) * sizeof(LexiconKeyRecord)) ||
+            !sectionInBounds(header->key_syllable_offset, static_cast<uint64_t>(header->key_syllable_count) * sizeof(uint16_t)) ||
+            !sectionInBounds(header->entry_offset, static_cast<uint64_t>(header->entry_count) * sizeof(LexiconEntryRecord)) ||
+            header->string_pool_offset + static_cast<uint64_t>(header->string_pool_size) > size_) {
+            return false;
+        }
+
+        if (has_abbreviations &&
+            (!sectionInBounds(header->abbreviation_key_offset,
+                              static_cast<uint64_t>(header->abbreviation_key_count) * sizeof(LexiconAbbreviationKey)) ||
+             !sectionInBounds(header->abbreviation_entry_offset,
+                              static_cast<uint64_t>(header->abbreviation_entry_count) * sizeof(LexiconAbbreviationEntry)))) {
+            return false;
+        }
+        
+        if (has_ranks &&
+            (!sectionInBounds(header->key_rank_offset, static_cast<uint64_t>(header->key_count) * 2 * sizeof(uint16_t)) ||
+             !sectionInBounds(header->abbreviation_rank_offset,
+                              static_cast<uint64_t>(header->abbreviation_key_count) * 2 * sizeof(uint16_t)))) {
+            return false;
+        }
+        
+        const auto* offsets = reinterpret_cast<const uint32_t*>(base + header->syllable_table_offset);
+        uint64_t chars_offset = header->syllable_table_offset + syllable_offsets_size;
+        if (chars_offset + offsets[header->syllable_count] > size_) {
+            return false;
+        }
+
+        header_ = header;
+        syllable_offsets_ = offsets;
+        syllable_chars_ = base + chars_offset;
+        keys_ = reinterpret_cast<const LexiconKeyRecord*>(base + header->key_offset);
+        key_syllables_ = reinterpret_cast<const uint16_t*>(base + header->key_syllable_offset);
+        entries_ = reinterpret_cast<const LexiconEntryRecord*>(base + header->entry_offset);
+        string_pool_ = base + header->string_pool_offset;
+        if (has_abbreviations && header->abbreviation_key_count > 0) {
+            abbreviation_keys_ = reinterpret_cast<const LexiconAbbreviationKey*>(base + header->abbreviation_key_offset);
+            abbreviation_entries_ =
+                reinterpret_cast<const LexiconAbbreviationEntry*>(base + header->abbreviation_entry_offset);
+        }
+        if (has_ranks && header->key_count > 0) {
+            key_ranks_ = reinterpret_cast<const uint16_t*>(base + header->key_rank_offset);
+        }
+        if (has_ranks && abbreviation_keys_) {
+            abbreviation_ranks_ = reinterpret_cast<const uint16_t*>(base + header->abbreviation_rank_offset);
+        }
+        return true;
+    }
+
+    /**
+     * 逐一检查键、条目和简拼索引记录，任何区间越出所在段时拒绝文件
+     * 开销与文件大小成正比，只用于来源不可信的文件（如用户导入的词典）
+     */
+    bool verifyRecords() const {
+        const uint32_t chars_size = syllable_offsets_[header_->syllable_count];
+        for (uint32_t i = 0; i < header_->syllable_count; ++i) {
+            if (syllable_offsets_[i] > syllable_offsets_[i + 1] || syllable_offsets_[i + 1] > chars_size) {
+                spdlog::error("Lexicon syllable {} is out of bounds", i);
+                return false;
+            }
+        }
+
+        for (uint32_t k = 0; k < header_->key_count; ++k) {
+            const LexiconKeyRecord& key = keys_[k];
+            if (key.syllable_count == 0 ||
+                static_cast<uint64_t>(key.syllable_begin) + key.syllable_count > header_->key_syllable_count ||
+                static_cast<uint64_t>(key.entry_begin) + key.entry_count > header_->entry_count) {
+                spdlog::error("Lexicon key {} is out of bounds", k);
+                return false;
+            }
+            const uint16_t* syllables = key_syllables_ + key.syllable_begin;
+            for (uint16_t i = 0; i < key.syllable_count; ++i) {
+                if (syllables[i] >= header_->syllable_count) {
+                    spdlog::error("Lexicon key {} has an invalid syllable ID", k);
+                    return false;
+                }
+            }
+        }
+
+        for (uint32_t e = 0; e < header_->entry_count; ++e) {
+            const LexiconEntryRecord& record = entries_[e];
+            if (static_cast<uint64_t>(record.text_offset) + record.text_length > header_->string_pool_size) {
+                spdlog::error("Lexicon entry {} is out of bounds", e);
+                return false;
+            }
+        }
+
+        if (key_ranks_ && !verifyRankTree(key_ranks_, header_->key_count,
+                                          [this](uint32_t index) { return keyTopFrequency(index); })) {
+            spdlog::error("Lexicon key rank tree is inconsistent");
+            return false;
+        }
+        
+        if (!abbreviation_keys_) {
+            return true;
+        }
+        for (uint32_t k = 0; k < header_->abbreviation_key_count; ++k) {
+            const LexiconAbbreviationKey& abbreviation = abbreviation_keys_[k];
+            if (static_cast<uint64_t>(abbreviation.entry_begin) + abbreviation.entry_count >
+                header_->abbreviation_entry_count) {
+                spdlog::error("Lexicon abbreviation key {} is out of bounds", k);
+                return false;
+            }
+
+            // 简拼查询按首字母数访问音节，所指的键须有同样多的音节
+            size_t initials = 0;
+            while (initials < MAX_ABBREVIATION_SYLLABLES &&
+                   ((abbreviation.initials >> (ABBREVIATION_BITS * (MAX_ABBREVIATION_SYLLABLES - 1 - initials))) & 0x1f)) {
+                ++initials;
+            }
+            for (uint32_t i = 0; i < abbreviation.entry_count; ++i) {
+                const LexiconAbbreviationEntry& item = abbreviation_entries_[abbreviation.entry_begin + i];
+                if (item.key_index >= header_->key_count || item.entry_index >= header_->entry_count ||
+                    keys_[item.key_index].syllable_count != initials) {
+                    spdlog::error("Lexicon abbreviation key {} has an invalid entry", k);
+                    return false;
+                }
+            }
+        }
+        
+        if (abbreviation_ranks_ && !verifyRankTree(abbreviation_ranks_, header_->abbreviation_key_count,
+                                                   [this](uint32_t index) { return abbreviationTopFrequency(index); })) {
+            spdlog::error("Lexicon abbreviation rank tree is inconsistent");
+            return false;
+        }
+        return true;
+    }
+    
+    /**
+     * 最高频率树的叶子须等于各键的最高频率，内部节点须等于子节点的最大值，否则前缀查询会漏掉结果
+     */
+    template <typename TopFrequency>
+    static bool verifyRankTree(const uint16_t* tree, uint32_t count, TopFrequency top) {
+        for (uint32_t index = 0; index < count; ++index) {
+            if (tree[count + index] != top(index)) {
+                return false;
+            }
+        }
+        for (uint32_t node = 1; node < count; ++node) {
+            if (tree[node] != std::max(tree[2 * node], tree[2 * node + 1])) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+private:
+    void* data_;
+    size_t size_;
+    const LexiconHeader* header_;
+    const uint32_t* syllable_offsets_;
+    const char* syllable_chars_;
+    const LexiconKeyRecord* keys_;
+    const uint16_t* key_syllables_;
+    const LexiconEntryRecord* entries_;
+    const char* string_pool_;
+    const LexiconAbbreviationKey* abbreviation_keys_;       // 版本1的文件没有简拼索引
+    const LexiconAbbreviationEntry* abbreviation_entries_;
+    const uint16_t* key_ranks_;                             // 版本3起的最高频率树，旧文件为空
+    const uint16_t* abbreviation_ranks_;
+#ifdef _WIN32
+    HANDLE file_;
+    HANDLE mapping_;
+#endif
+};
+
+Lexicon::Lexicon()
+    : pImpl(std::make_unique<Impl>()) {
+}
+
+Lexicon::~Lexicon() = default;
+
+bool Lexicon::open(const std::string& path, bool verify) {
+    return pImpl->open(path, verify);
+}
+
+void Lexicon::close() {
+    pImpl->close();
+}
+
+bool Lexicon::isOpen() const {
+    return pImpl->isOpen();
+}
+
+int Lexicon::findSyllableId(std::string_view syllable) const {
+    return pImpl->findSyllableId(syllable);
+}
+
+bool Lexicon::findSyllablePrefixRange(std::string_view prefix, int& begin, int& end) const {
+    return pImpl->findSyllablePrefixRange(prefix, begin, end);
+}
+
+std::string_view Lexicon::getSyllable(int syllable_id) const {
+    return pImpl->getSyllable(syllable_id);
+}
+
+size_t Lexicon::lookup(const uint16_t* syllable_ids, size_t count, LexiconEntry* out, size_t max_results) const {
+    return pImpl->lookup(syllable_ids, count, out, max_results);
+}
+
+size_t Lexicon::lookupPinyin(std::string_view pinyin, LexiconEntry* out, size_t max_results) const {
+    return pImpl->lookupPinyin(pinyin, out, max_results);
+}
+
+size_t Lexicon::lookupPrefix(const uint16_t* syllable_ids, size_t count, std::string_view last,
+                             LexiconEntry* out, size_t max_results) const {
+    return pImpl->lookupPrefix(syllable_ids, count, last, out, max_results);
+}
+
+void Lexicon::forEachEntry(const std::function<void(const LexiconEntry&)>& visitor) const {
+    pImpl->forEachEntry(visitor);
+}
+
+size_t Lexicon::getSyllableCount() const {
+    return pImpl->getSyllableCount();
+}
+
+size_t Lexicon::getKeyCount() const {
+    return pImpl->getKeyCount();
+}
+
+size_t Lexicon::getEntryCount() const {
+    return pImpl->getEntryCount();
+}
+
+size_t Lexicon::getAbbreviationCount() const {
+    return pImpl->getAbbreviationCount();
+}
+
+uint16_t Lexicon::quantizeFrequency(uint32_t frequency) {
+    double q = std::round(std::log2(1.0 + frequency) * FREQUENCY_SCALE);
+    return static_cast<uint16_t>(std::min(q, 65535.0));
+}
+
+uint32_t Lexicon::dequantizeFrequency(uint16_t quantized) {
+    double f = std::exp2(quantized / FREQUENCY_SCALE) - 1.0;
+    return static_cast<uint32_t>(std::min(std::round(f), 4294967295.0));
+}
+
+// ---------------------------------------------------------------------------
+// LexiconBuilder
+// ---------------------------------------------------------------------------
+
+class LexiconBuilder::Impl {
+public:
+    // 原始词条，音节和文本存放在扁平池中，避免每个词条单独分配
+    struct RawEntry {
+        uint32_t syllable_begin;
+        uint32_t text_begin;
+        uint32_t frequency;
+        uint16_t syllable_count;
+        uint16_t text_length;
+    };
+
+    explicit Impl(const std::vector<std::string>& syllables)
+        : syllables_(syllables), max_entries_per_key_(64), max_entries_per_abbreviation_(32) {
+        for (size_t id = 0; id < syllables_.size(); ++id) {
+            syllable_index_[syllables_[id]] = static_cast<uint16_t>(id);
+        }
+    }
+
+    bool addEntry(const std::string& word, const std::vector<std::string>& syllables, uint32_t frequency) {
+        std::vector<uint16_t> ids;
+        ids.reserve(syllables.size());
+        for (const auto& syllable : syllables) {
+            auto it = syllable_index_.find(syllable);
+            if (it == syllable_index_.end()) {
+                return false;
+            }
+            ids.push_back(it->second);
+        }
+        return addEncodedEntry(word, ids, frequency);
+    }
+
+    bool addEncodedEntry(const std::string& word, const std::vector<uint16_t>& syllable_ids, uint32_t frequency) {
+        if (word.empty() || word.size() > 0xffff || syllable_ids.empty() || syllable_ids.size() > 0xffff) {
+            return false;
+        }
+        for (uint16_t id : syllable_ids) {
+            if (id >= syllables_.size()) {
+                return false;
+            }
+        }
+
+        RawEntry entry;
+        entry.syllable_begin = static_cast<uint32_t>(syllable_pool_.size());
+        entry.syllable_count = static_cast<uint16_t>(syllable_ids.size());
+        entry.text_begin = static_cast<uint32_t>(text_pool_.size());
+        entry.text_length = static_cast<uint16_t>(word.size());
+        entry.frequency = frequency;
+
+        syllable_pool_.insert(syllable_pool_.end(), syllable_ids.begin(), syllable_ids.end());
+        text_pool_.append(word);
+        entries_.push_back(entry);
+        return true;
+    }
+
+    std::string_view text(const RawEntry& entry) const {
+        return std::string_view(text_pool_.data() + entry.text_begin, entry.text_length);
+    }
+
+    int compareKey(const RawEntry& a, const RawEntry& b) const {
+        return compareSyllables(syllable_pool_.data() + a.syllable_begin, a.syllable_count,
+                                syllable_pool_.data() + b.syllable_begin, b.syllable_count);
+    }
+
+    void buildAbbreviationIndex(const std::vector<LexiconKeyRecord>& keys, const std::vector<uint16_t>& key_syllables,
+                                const std::vector<LexiconEntryRecord>& records,
+                                std::vector<LexiconAbbreviationKey>& abbreviation_keys,
+                                std::vector<LexiconAbbreviationEntry>& abbreviation_entries) const {
+        struct Item {
+            uint64_t initials;
+            uint16_t frequency;
+            LexiconAbbreviationEntry entry;
+        };
+        
+        std::vector<Item> items;
+        for (uint32_t k = 0; k < keys.size(); ++k) {
+            const LexiconKeyRecord& key = keys[k];
+            if (key.syllable_count < 2 || key.syllable_count > MAX_ABBREVIATION_SYLLABLES) {
+                continue;
+            }
+            
+            uint64_t initials = 0;
+            for (size_t i = 0; i < key.syllable_count; ++i) {
+                initials |= packInitial(syllables_[key_syllables[key.syllable_begin + i]][0], i);
+            }
+            for (uint32_t i = 0; i < key.entry_count; ++i) {
+                const uint32_t entry_index = key.entry_begin + i;
+                items.push_back({initials, records[entry_index].frequency, {k, entry_index}});
+            }
+        }
+        
+        std::stable_sort(items.begin(), items.end(), [](const Item& a, const Item& b) {
+            if (a.initials != b.initials) {
+                return a.initials < b.initials;
+            }
+            return a.frequency > b.frequency;
+        });
+        
+        for (size_t i = 0; i < items.size(); ) {
+            LexiconAbbreviationKey key;
+            key.initials = items[i].initials;
+            key.entry_begin = static_cast<uint32_t>(abbreviation_entries.size());
+            key.entry_count = 0;
+            
+            size_t j = i;
+            for (; j < items.size() && items[j].initials == key.initials; ++j) {
+                if (key.entry_count < max_entries_per_abbreviation_) {
+                    abbreviation_entries.push_back(items[j].entry);
+                    ++key.entry_count;
+                }
+            }
+            
+            abbreviation_keys.push_back(key);
+            i = j;
+        }
+    }
+    
+    bool write(const std::string& path) const {
+        // 按 (音节序列, 文本) 排序去重，保留最高频率
+        std::vector<uint32_t> order(entries_.size());
+        for (size_t i = 0; i < order.size(); ++i) {
+            order[i] = static_cast<uint32_t>(i);
+        }
+        std::sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b) {
+            const RawEntry& ea = entries_[a];
+            const RawEntry& eb = entries_[b];
+            int cmp = compareKey(ea, eb);
+            if (cmp != 0) {
+                return cmp < 0;
+            }
+            int text_cmp = text(ea).compare(text(eb));
+            if (text_cmp != 0) {
+                return text_cmp < 0;
+            }
+            return ea.frequency > eb.frequency;
+        });
+        order.erase(std::unique(order.begin(), order.end(), [this](uint32_t a, uint32_t b) {
+            return compareKey(entries_[a], entries_[b]) == 0 && text(entries_[a]) == text(entries_[b]);
+        }), order.end());
+
+        // 键内按频率降序
+        std::stable_sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b) {
+            int cmp = compareKey(entries_[a], entries_[b]);
+            if (cmp != 0) {
+                return cmp < 0;
+            }
+            return entries_[a].frequency > entries_[b].frequency;
+        });
+
+        std::vector<LexiconKeyRecord> keys;
+        std::vector<uint16_t> key_syllables;
+        std::vector<LexiconEntryRecord> records;
+        std::string string_pool;
+        std::unordered_map<std::string_view, uint32_t> string_offsets;
+        string_offsets.reserve(order.size());
+
+        for (size_t i = 0; i < order.size(); ) {
+            const RawEntry& first = entries_[order[i]];
+
+            LexiconKeyRecord key;
+            key.syllable_begin = static_cast<uint32_t>(key_syllables.size());
+            key.syllable_count = first.syllable_count;
+            key.entry_begin = static_cast<uint32_t>(records.size());
+            key.entry_count = 0;
+            key_syllables.insert(key_syllables.end(),
+                                 syllable_pool_.begin() + first.syllable_begin,
+                                 syllable_pool_.begin() + first.syllable_begin + first.syllable_count);
+
+            size_t j = i;
+            for (; j < order.size() && compareKey(entries_[order[j]], first) == 0; ++j) {
+                if (key.entry_count >= max_entries_per_key_ || key.entry_count == 0xffff) {
+                    continue;
+                }
+
+                const RawEntry& entry = entries_[order[j]];
+                std::string_view word = text(entry);
+
+                // 相同文本只在字符串池中存放一次
+                auto it = string_offsets.find(word);
+                uint32_t offset;
+                if (it != string_offsets.end()) {
+                    offset = it->second;
+                } else {
+                    offset = static_cast<uint32_t>(string_pool.size());
+                    string_pool.append(word.data(), word.size());
+                    string_offsets.emplace(word, offset);
+                }
+
+                records.push_back({offset, entry.text_length, Lexicon::quantizeFrequency(entry.frequency)});
+                ++key.entry_count;
+            }
+
+            keys.push_back(key);
+            i = j;
+        }
+
+        // 简拼索引：多音节词按首字母序列分组，组内按频率降序保留前K个
+        std::vector<LexiconAbbreviationKey> abbreviation_keys;
+        std::vector<LexiconAbbreviationEntry> abbreviation_entries;
+        buildAbbreviationIndex(keys, key_syllables, records, abbreviation_keys, abbreviation_entries);
+        
+        // 最高频率树：前缀查询据此只访问可能进入结果的键
+        std::vector<uint16_t> key_tops;
+        key_tops.reserve(keys.size());
+        for (const LexiconKeyRecord& key : keys) {
+            key_tops.push_back(key.entry_count > 0 ? records[key.entry_begin].frequency : 0);
+        }
+        std::vector<uint16_t> abbreviation_tops;
+        abbreviation_tops.reserve(abbreviation_keys.size());
+        for (const LexiconAbbreviationKey& key : abbreviation_keys) {
+            abbreviation_tops.push_back(
+                key.entry_count > 0 ? records[abbreviation_entries[key.entry_begin].entry_index].frequency : 0);
+        }
+        const std::vector<uint16_t> key_ranks = buildRankTree(key_tops);
+        const std::vector<uint16_t> abbreviation_ranks = buildRankTree(abbreviation_tops);
+        
+        // 音节表
+        std::vector<uint32_t> syllable_offsets;
+        std::string syllable_chars;
+        syllable_offsets.reserve(syllables_.size() + 1);
+        for (const auto& syllable : syllables_) {
+            syllable_offsets.push_back(static_cast<uint32_t>(syllable_chars.size()));
+            syllable_chars += syllable;
+        }
+        syllable_offsets.push_back(static_cast<uint32_t>(syllable_chars.size()));
+
+        auto align = [](uint64_t offset) { return (offset + 3) & ~static_cast<uint64_t>(3); };
+
+        LexiconHeader header;
+        std::memset(&header, 0, sizeof(header));
+        header.magic = Lexicon::kMagic;
+        header.version = Lexicon::kVersion;
+        header.syllable_count = static_cast<uint32_t>(syllables_.size());
+        header.key_count = static_cast<uint32_t>(keys.size());
+        header.entry_count = static_cast<uint32_t>(records.size());
+        header.key_syllable_count = static_cast<uint32_t>(key_syllables.size());
+
+        uint64_t offset = align(sizeof(LexiconHeader));
+        header.syllable_table_offset = static_cast<uint32_t>(offset);
+        offset = align(offset + syllable_offsets.size() * sizeof(uint32_t) + syllable_chars.size());
+        header.key_offset = static_cast<uint32_t>(offset);
+        offset = align(offset + keys.size() * sizeof(LexiconKeyRecord));
+        header.key_syllable_offset = static_cast<uint32_t>(offset);
+        offset = align(offset + key_syllables.size() * sizeof(uint16_t));
+        header.entry_offset = static_cast<uint32_t>(offset);
+        offset = align(offset + records.size() * sizeof(LexiconEntryRecord));
+        header.abbreviation_key_offset = static_cast<uint32_t>(offset);
+        header.abbreviation_key_count = static_cast<uint32_t>(abbreviation_keys.size());
+        offset = align(offset + abbreviation_keys.size() * sizeof(LexiconAbbreviationKey));
+        header.abbreviation_entry_offset = static_cast<uint32_t>(offset);
+        header.abbreviation_entry_count = static_cast<uint32_t>(abbreviation_entries.size());
+        offset = align(offset + abbreviation_entries.size() * sizeof(LexiconAbbreviationEntry));
+        header.key_rank_offset = static_cast<uint32_t>(offset);
+        offset = align(offset + key_ranks.size() * sizeof(uint16_t));
+        header.abbreviation_rank_offset = static_cast<uint32_t>(offset);
+        offset = align(offset + abbreviation_ranks.size() * sizeof(uint16_t));
+        header.string_pool_offset = static_cast<uint32_t>(offset);
+        header.string_pool_size = static_cast<uint32_t>(string_pool.size());
+        offset += string_pool.size();
+
+        if (offset > 0xffffffffu) {
+            spdlog::error("Lexicon too large: {} bytes", offset);
+            return false;
+        }
+        header.file_size = static_cast<uint32_t>(offset);
+
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            spdlog::error("Failed to create lexicon file: {}", path);
+            return false;
+        }
+
+        auto pad = [&file](uint64_t target) {
+            static const char zeros[4] = {0, 0, 0, 0};
+            uint64_t current = static_cast<uint64_t>(file.tellp());
+            if (target > current) {
+                file.write(zeros, static_cast<std::streamsize>(target - current));
+            }
+        };
+
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        pad(header.syllable_table_offset);
+        file.write(reinterpret_cast<const char*>(syllable_offsets.data()), syllable_offsets.size() * sizeof(uint32_t));
+        file.write(syllable_chars.data(), syllable_chars.size());
+        pad(header.key_offset);
+        file.write(reinterpret_cast<const char*>(keys.data()), keys.size() * sizeof(LexiconKeyRecord));
+        pad(header.key_syllable_offset);
+        file.write(reinterpret_cast<const char*>(key_syllables.data()), key_syllables.size() * sizeof(uint16_t));
+        pad(header.entry_offset);
+        file.write(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(LexiconEntryRecord));
+        pad(header.abbreviation_key_offset);
+        file.write(reinterpret_cast<const char*>(abbreviation_keys.data()),
+                   abbreviation_keys.size() * sizeof(LexiconAbbreviationKey));
+        pad(header.abbreviation_entry_offset);
+        file.write(reinterpret_cast<const char*>(abbreviation_entries.data()),
+                   abbreviation_entries.size() * sizeof(LexiconAbbreviationEntry));
+        pad(header.key_rank_offset);
+        file.write(reinterpret_cast<const char*>(key_ranks.data()), key_ranks.size() * sizeof(uint16_t));
+        pad(header.abbreviation_rank_offset);
+        file.write(reinterpret_cast<const char*>(abbreviation_ranks.data()),
+                   abbreviation_ranks.size() * sizeof(uint16_t));
+        pad(header.string_pool_offset);
+        file.write(string_pool.data(), string_pool.size());
+
+        if (!file.good()) {
+            spdlog::error("Failed to write lexicon file: {}", path);
+            return false;
+        }
+
+        spdlog::info("Wrote lexicon {}: {} keys, {} entries, {} bytes", path, keys.size(), records.size(), offset);
+        return true;
+    }
+
+public:
+    std::vector<std::string> syllables_;
+    std::unordered_map<std::string, uint16_t> syllable_index_;
+    std::vector<RawEntry> entries_;
+    std::vector<uint16_t> syllable_pool_;
+    std::string text_pool_;
+    size_t max_entries_per_key_;
+    size_t max_entries_per_abbreviation_;
+};
+
+LexiconBuilder::LexiconBuilder(const std::vector<std::string>& syllables)
+    : pImpl(std::make_unique<Impl>(syllables)) {
+}
+
+LexiconBuilder::~LexiconBuilder() = default;
+
+bool LexiconBuilder::addEntry(const std::string& word, const std::vector<std::string>& syllables, uint32_t frequency) {
+    return pImpl->addEntry(word, syllables, frequency);
+}
+
+bool LexiconBuilder::addEncodedEntry(const std::string& word, const std::vector<uint16_t>& syllable_ids, uint32_t frequency) {
+    return pImpl->addEncodedEntry(word, syllable_ids, frequency);
+}
+
+void LexiconBuilder::setMaxEntriesPerKey(size_t max_entries) {
+    pImpl->max_entries_per_key_ = std::max<size_t>(1, max_entries);
+}
+
+void LexiconBuilder::setMaxEntriesPerAbbreviation(size_t max_entries) {
+    pImpl->max_entries_per_abbreviation_ = std::max<size_t>(1, max_entries);
+}
+
+size_t LexiconBuilder::getEntryCount() const {
+    return pImpl->entries_.size();
+}
+
+bool LexiconBuilder::write(const std::string& path) const {
+    return pImpl->write(path);
+}
+
+} // namespace core
+} // namespace owcat
\ No newline at end of file
@@ -1,8 +1,18 @@
 #include "core/llama_predictor.h"
+#include "core/logit_math.h"
 #include <spdlog/spdlog.h>
+#include <nlohmann/json.hpp>
 #include <fstream>
 #include <sstream>
 #include <algorithm>
+#include <cmath>
+#include <limits>
+#include <thread>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
 
 #ifdef ENABLE_LLAMA_CPP
 #include <llama.h>
@@ -18,9 +28,116 @@ struct GenerationParams {
     int top_k = 40;
 };
 
+// 单次llama_decode提交的最大token数，与上下文的n_batch一致
+static constexpr int PROMPT_BATCH_SIZE = 512;
+
+// 参与受约束生成的token最多包含的汉字数
+static constexpr size_t MAX_TOKEN_CHARS = 8;
+
+// 会话i的主序列为i，候选词打分的分叉序列在其后按会话分段编号
+static constexpr int FORK_SEQ_BASE = LlamaPredictor::MAX_SESSIONS;
+
+// 自动调优每种线程数解码的token数
+static constexpr int TUNE_DECODE_TOKENS = 16;
+
+// 推测解码草稿短语索引的token数上限
+static constexpr size_t MAX_DRAFT_TOKENS = 1u << 18;
+
+/**
+ * 未指定线程数时的默认值
+ * prompt评估是计算密集的，使用约等于物理核心数的线程；
+ * 逐token解码受内存带宽限制，线程再多也不会更快，最多4个，避免打字时占满所有核心
+ */
+static int defaultThreadCount(bool decode) {
+    const int hardware = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    const int physical = std::max(1, hardware / 2);
+    return decode ? std::min(physical, 4) : physical;
+}
+
+/**
+ * 解码UTF-8字符串为码点序列
+ * @return 是否为完整合法的UTF-8
+ */
+static bool decodeUtf8(const char* text, size_t length, std::vector<uint32_t>& codepoints) {
+    codepoints.clear();
+    size_t i = 0;
+    while (i < length) {
+        unsigned char c = static_cast<unsigned char>(text[i]);
+        uint32_t cp;
+        size_t extra;
+        if (c < 0x80) {
+            cp = c;
+            extra = 0;
+        } else if ((c & 0xE0) == 0xC0) {
+            cp = c & 0x1F;
+            extra = 1;
+        } else if ((c & 0xF0) == 0xE0) {
+            cp = c & 0x0F;
+            extra = 2;
+        } else if ((c & 0xF8) == 0xF0) {
+            cp = c & 0x07;
+            extra = 3;
+        } else {
+            return false;
+        }
+        
+        if (i + extra >= length) {
+            return false;
+        }
+        for (size_t k = 1; k <= extra; ++k) {
+            unsigned char cc = static_cast<unsigned char>(text[i + k]);
+            if ((cc & 0xC0) != 0x80) {
+                return false;
+            }
+            cp = (cp << 6) | (cc & 0x3F);
+        }
+        
+        codepoints.push_back(cp);
+        i += extra + 1;
+    }
+    return true;
+}
+
 #ifdef ENABLE_LLAMA_CPP
 class LlamaPredictor::Impl {
 public:
+    // 由汉字组成的词表token及其读音
+    struct TokenReading {
+        llama_token token;
+        uint32_t chars_begin;   // token_chars_中的起始下标
+        uint8_t char_count;
+        std::string piece;
+    };
+    
+    // 一次解码请求：若干行token，解码后对需要logits的行调用回调
+    struct DecodeRow {
+        llama_token token;
+        llama_pos pos;
+        llama_seq_id seq;
+        bool logits;
+    };
+    
+    struct DecodeJob {
+        std::vector<DecodeRow> rows;
+        std::function<void(size_t row, const float* logits)> on_logits;   // 在执行解码的线程中调用
+        bool done = false;
+        bool ok = false;
+    };
+    
+    // 一个会话在共享上下文中的推理状态，会话i的token都在序列i中
+    struct Session {
+        std::mutex mutex;                       // 同一会话的调用串行执行
+        std::vector<llama_token> cached_tokens; // KV缓存中本会话序列的token，位置即下标
+        std::vector<float> logits;              // 序列最后一个token的logits
+        DecodeJob job;                          // 复用的主序列解码请求
+        std::vector<uint32_t> reading_stamps;   // collectAllowedReadings去重用
+        uint32_t reading_stamp = 0;
+        std::vector<TokenLogit> top_tokens;     // 采样时top-k预筛选的暂存区
+        std::vector<llama_token_data> sample_tokens; // 交给llama采样函数的候选token
+        size_t kv_cells = 0;                    // 占用的KV单元数（含临时分叉），由context_mutex_保护
+        uint64_t last_used = 0;                 // 最近使用时间，用于淘汰，由context_mutex_保护
+    };
+    
     Impl() : model_(nullptr), ctx_(nullptr), model_loaded_(false) {
         // 初始化llama.cpp
         llama_backend_init(false);
@@ -49,9 +166,6 @@ public:
             return false;
         }
         
-        // 预热模型
-        warmupModel();
-        
         spdlog::info("LlamaPredictor initialized successfully");
         return true;
     }
@@ -63,9 +177,11 @@ public:
     bool loadModel() {
         // 设置模型参数
         llama_model_params model_params = llama_model_default_params();
-        model_params.n_gpu_layers = 0; // CPU only for compatibility
-        model_params.use_mmap = true;
-        model_params.use_mlock = false;
+        // 使用哪种GPU后端（Metal/CUDA/Vulkan）由llama.cpp的编译选项决定，-1表示offload全部层
+        model_params.n_gpu_layers = config_.gpu_layers < 0 ? 999 : config_.gpu_layers;
+        model_params.main_gpu = config_.main_gpu;
+        model_params.use_mmap = config_.use_mmap;
+        model_params.use_mlock = config_.use_mlock;
         
         // 加载模型
         model_ = llama_load_model_from_file(model_path_.c_str(), model_params);
@@ -77,9 +193,11 @@ public:
         // 创建上下文
         llama_context_params ctx_params = llama_context_default_params();
         ctx_params.seed = -1; // random seed
-        ctx_params.n_ctx = 2048; // context size
-        ctx_params.n_threads = std::thread::hardware_concurrency();
-        ctx_params.n_threads_batch = ctx_params.n_threads;
+        ctx_params.n_ctx = static_cast<uint32_t>(config_.context_size > 0 ? config_.context_size : 2048);
+        ctx_params.n_batch = PROMPT_BATCH_SIZE;
+        // 单token解码使用n_threads，多token的batch使用n_threads_batch
+        ctx_params.n_threads = config_.decode_threads > 0 ? config_.decode_threads : defaultThreadCount(true);
+        ctx_params.n_threads_batch = config_.prefill_threads > 0 ? config_.prefill_threads : defaultThreadCount(false);
         
         ctx_ = llama_new_context_with_model(model_, ctx_params);
         if (!ctx_) {
@@ -89,12 +207,25 @@ public:
             return false;
         }
         
+        // 各会话的解码请求合并进同一个batch，行数上限与n_batch一致
+        batch_ = llama_batch_init(PROMPT_BATCH_SIZE, 0, 1);
+        resetSessions();
+        prefill_threads_ = static_cast<int>(ctx_params.n_threads_batch);
+        decode_threads_ = static_cast<int>(ctx_params.n_threads);
+        if (thread_limit_ > 0) {
+            applyThreads();
+        }
         model_loaded_ = true;
+        
+        spdlog::info("llama context: n_ctx={}, prefill threads={}, decode threads={}, gpu layers={}, mlock={}, logit kernels={}",
+                     ctx_params.n_ctx, prefill_threads_, decode_threads_, config_.gpu_layers, config_.use_mlock,
+                     logitKernelName());
         return true;
     }
     
     void unloadModel() {
         if (ctx_) {
+            llama_batch_free(batch_);
             llama_free(ctx_);
             ctx_ = nullptr;
         }
@@ -104,15 +235,73 @@ public:
             model_ = nullptr;
         }
         
+        resetSessions();
         model_loaded_ = false;
     }
     
-    std::string generateText(const std::string& prompt, int max_tokens) {
+    /**
+     * 获取会话状态
+     * @return 会话ID无效时为nullptr
+     */
+    Session* getSession(int session) {
+        if (session < 0 || session >= LlamaPredictor::MAX_SESSIONS) {
+            spdlog::warn("Invalid prediction session id: {}", session);
+            return nullptr;
+        }
+        return &sessions_[session];
+    }
+    
+    void releaseSession(int session) {
+        Session* s = getSession(session);
+        if (!s) {
+            return;
+        }
+        
+        std::lock_guard<std::mutex> guard(s->mutex);
+        if (model_loaded_) {
+            std::lock_guard<std::mutex> lock(context_mutex_);
+            clearSequence(*s, session);
+        }
+    }
+    
+    void setSessionKvBudget(size_t tokens) {
+        std::lock_guard<std::mutex> lock(context_mutex_);
+        requested_kv_budget_ = tokens;
+    }
+    
+    void setDraftPhrases(const std::vector<std::string>& phrases) {
+        std::lock_guard<std::mutex> lock(draft_mutex_);
+        draft_tokens_.clear();
+        draft_index_.clear();
+        for (const auto& phrase : phrases) {
+            indexDraftPhrase(phrase);
+        }
+        spdlog::info("Indexed {} draft tokens from {} phrases for speculative decoding",
+                     draft_tokens_.size(), phrases.size());
+    }
+    
+    void addDraftPhrase(const std::string& phrase) {
+        std::lock_guard<std::mutex> lock(draft_mutex_);
+        indexDraftPhrase(phrase);
+    }
+    
+    std::string generateText(const std::string& prompt, int max_tokens, const CancelCallback& is_cancelled = nullptr,
+                             int session = 0) {
         if (!model_loaded_) {
             spdlog::warn("Model not loaded, cannot generate text");
             return "";
         }
         
+        if (is_cancelled && is_cancelled()) {
+            return "";
+        }
+        
+        Session* s = getSession(session);
+        if (!s) {
+            return "";
+        }
+        std::lock_guard<std::mutex> guard(s->mutex);
+        
         try {
             // 预处理输入
             std::string processed_prompt = preprocessInput(prompt);
@@ -127,26 +316,38 @@ public:
             // 生成文本
             std::vector<llama_token> generated_tokens;
             
-            // 评估prompt tokens
-            if (llama_decode(ctx_, llama_batch_get_one(tokens.data(), tokens.size(), 0, 0)) != 0) {
+            // 评估prompt tokens（复用KV缓存中的公共前缀）
+            if (!evaluatePrefix(*s, session, tokens.data(), tokens.size())) {
                 spdlog::error("Failed to decode prompt tokens");
                 return "";
             }
             
             // 生成新的tokens
-            for (int i = 0; i < max_tokens; ++i) {
-                llama_token next_token = sampleNextToken();
-                
-                if (next_token == llama_token_eos(model_)) {
-                    break; // 遇到结束符
+            if (config_.speculative_tokens > 0) {
+                if (!generateSpeculative(*s, session, max_tokens, is_cancelled, generated_tokens)) {
+                    return "";
                 }
-                
-                generated_tokens.push_back(next_token);
-                
-                // 将新token添加到上下文
-                if (llama_decode(ctx_, llama_batch_get_one(&next_token, 1, tokens.size() + i, 0)) != 0) {
-                    spdlog::warn("Failed to decode generated token at position {}", i);
-                    break;
+            } else {
+                for (int i = 0; i < max_tokens; ++i) {
+                    // 请求已过期时放弃剩余的解码
+                    if (is_cancelled && is_cancelled()) {
+                        spdlog::debug("Text generation cancelled after {} tokens", i);
+                        return "";
+                    }
+                    
+                    llama_token next_token = sampleNextToken(*s);
+                    
+                    if (next_token == llama_token_eos(model_)) {
+                        break; // 遇到结束符
+                    }
+                    
+                    generated_tokens.push_back(next_token);
+                    
+                    // 将新token添加到上下文
+                    if (!appendToken(*s, session, next_token)) {
+                        spdlog::warn("Failed to decode generated token at position {}", i);
+                        break;
+                    }
                 }
             }
             
@@ -162,58 +363,442 @@ public:
         }
     }
     
-    double getNextWordProbability(const std::string& context, const std::string& word) {
-        if (!model_loaded_) {
-            return 0.0;
+    std::vector<float> getNextWordLogProbs(const std::string& context, const std::vector<std::string>& words,
+                                           int session = 0) {
+        const float neg_inf = -std::numeric_limits<float>::infinity();
+        std::vector<float> log_probs(words.size(), neg_inf);
+        
+        if (!model_loaded_ || words.empty()) {
+            return log_probs;
         }
         
+        Session* s = getSession(session);
+        if (!s) {
+            return log_probs;
+        }
+        std::lock_guard<std::mutex> guard(s->mutex);
+        
         try {
-            // 将上下文和词汇转换为tokens
             std::vector<llama_token> context_tokens = tokenize(context);
-            std::vector<llama_token> word_tokens = tokenize(word);
+            if (context_tokens.empty()) {
+                return log_probs;
+            }
             
-            if (context_tokens.empty() || word_tokens.empty()) {
-                return 0.0;
+            // 上下文只解码一次，所有候选词共享这段前缀
+            if (!evaluatePrefix(*s, session, context_tokens.data(), context_tokens.size())) {
+                return log_probs;
             }
             
-            // 评估上下文
-            if (llama_decode(ctx_, llama_batch_get_one(context_tokens.data(), context_tokens.size(), 0, 0)) != 0) {
-                return 0.0;
+            const float* context_logits = s->logits.data();
+            const int vocab_size = llama_n_vocab(model_);
+            const float context_lse = logSumExp(context_logits, vocab_size);
+            
+            // 每个候选词的第一个token直接由上下文的logits打分
+            std::vector<std::vector<llama_token>> word_tokens(words.size());
+            for (size_t w = 0; w < words.size(); ++w) {
+                word_tokens[w] = tokenize(words[w]);
+                if (word_tokens[w].empty() || word_tokens[w][0] >= vocab_size) {
+                    word_tokens[w].clear();
+                    continue;
+                }
+                log_probs[w] = context_logits[word_tokens[w][0]] - context_lse;
             }
             
-            // 计算词汇的概率
-            double total_prob = 1.0;
-            for (size_t i = 0; i < word_tokens.size(); ++i) {
-                float* logits = llama_get_logits_ith(ctx_, -1);
-                if (!logits) {
-                    return 0.0;
+            // 其余token：每个候选词在本会话的分叉序列中从共享前缀分叉，打包进同一个batch
+            const llama_pos prefix_length = static_cast<llama_pos>(context_tokens.size());
+            const llama_seq_id fork_base = FORK_SEQ_BASE + session * PROMPT_BATCH_SIZE;
+            size_t budget;
+            {
+                std::lock_guard<std::mutex> lock(context_mutex_);
+                const size_t kv_budget = sessionKvBudget();
+                budget = std::min(static_cast<size_t>(PROMPT_BATCH_SIZE),
+                                  kv_budget > s->kv_cells ? kv_budget - s->kv_cells : 0);
+            }
+            
+            DecodeJob job;
+            job.rows.reserve(PROMPT_BATCH_SIZE);
+            std::vector<std::pair<size_t, size_t>> rows;   // batch行 -> (候选词, 被预测的token下标)
+            rows.reserve(PROMPT_BATCH_SIZE);
+            job.on_logits = [&](size_t row, const float* logits) {
+                const size_t word_index = rows[row].first;
+                const llama_token target = word_tokens[word_index][rows[row].second];
+                log_probs[word_index] += target < vocab_size ? logits[target] - logSumExp(logits, vocab_size) : neg_inf;
+            };
+            
+            size_t w = 0;
+            while (w < words.size()) {
+                job.rows.clear();
+                rows.clear();
+                llama_seq_id seq_id = fork_base;
+                
+                for (; w < words.size(); ++w) {
+                    const auto& tokens = word_tokens[w];
+                    if (tokens.size() < 2) {
+                        continue;
+                    }
+                    
+                    const size_t needed = tokens.size() - 1;
+                    if (needed > budget) {
+                        log_probs[w] = neg_inf; // 超出会话的KV预算，无法打分
+                        continue;
+                    }
+                    if (rows.size() + needed > budget) {
+                        break; // 留到下一个batch
+                    }
+                    
+                    for (size_t j = 0; j < needed; ++j) {
+                        job.rows.push_back({tokens[j], prefix_length + static_cast<llama_pos>(j), seq_id, true});
+                        rows.emplace_back(w, j + 1);
+                    }
+                    ++seq_id;
                 }
                 
-                // 应用softmax获取概率分布
-                int vocab_size = llama_n_vocab(model_);
-                std::vector<float> probs(vocab_size);
-                softmax(logits, probs.data(), vocab_size);
+                if (job.rows.empty()) {
+                    continue;
+                }
                 
-                // 获取当前token的概率
-                if (word_tokens[i] < vocab_size) {
-                    total_prob *= probs[word_tokens[i]];
-                } else {
-                    return 0.0;
+                bool reserved;
+                {
+                    std::lock_guard<std::mutex> lock(context_mutex_);
+                    reserved = reserveCells(*s, job.rows.size());
+                    if (reserved) {
+                        for (llama_seq_id id = fork_base; id < seq_id; ++id) {
+                            llama_kv_cache_seq_rm(ctx_, id, -1, -1);
+                            llama_kv_cache_seq_cp(ctx_, session, id, 0, prefix_length);
+                        }
+                    }
+                }
+                
+                if (!reserved || !runDecode(job)) {
+                    spdlog::warn("Failed to decode candidate batch of {} tokens", job.rows.size());
+                    for (const auto& row : rows) {
+                        log_probs[row.first] = neg_inf;
+                    }
                 }
                 
-                // 如果不是最后一个token，继续解码
-                if (i < word_tokens.size() - 1) {
-                    if (llama_decode(ctx_, llama_batch_get_one(&word_tokens[i], 1, context_tokens.size() + i, 0)) != 0) {
-                        return 0.0;
+                // 释放分叉序列，本会话的主序列（共享前缀）保持不变
+                if (reserved) {
+                    std::lock_guard<std::mutex> lock(context_mutex_);
+                    for (llama_seq_id id = fork_base; id < seq_id; ++id) {
+                        llama_kv_cache_seq_rm(ctx_, id, -1, -1);
+                    }
+                    releaseCells(*s, job.rows.size());
+                }
+            }
+            
+            return log_probs;
+            
+        } catch (const std::exception& e) {
+            spdlog::error("Error in getNextWordLogProbs: {}", e.what());
+            return std::vector<float>(words.size(), neg_inf);
+        }
+    }
+    
+    bool setCharacterReadings(const std::unordered_map<uint32_t, std::vector<uint16_t>>& readings) {
+        token_readings_.clear();
+        token_chars_.clear();
+        char_syllables_.clear();
+        tokens_by_syllable_.clear();
+        
+        if (!model_loaded_ || readings.empty()) {
+            return false;
+        }
+        
+        size_t syllable_count = 0;
+        for (const auto& item : readings) {
+            for (uint16_t id : item.second) {
+                syllable_count = std::max<size_t>(syllable_count, id + 1u);
+            }
+        }
+        tokens_by_syllable_.resize(syllable_count);
+        
+        // 扫描词表，保留完全由已知读音汉字组成的token
+        std::unordered_map<uint32_t, uint32_t> char_index;
+        std::vector<uint32_t> codepoints;
+        char buffer[64];
+        const int vocab_size = llama_n_vocab(model_);
+        for (llama_token token = 0; token < vocab_size; ++token) {
+            int length = llama_token_to_piece(model_, token, buffer, sizeof(buffer));
+            if (length <= 0 || !decodeUtf8(buffer, static_cast<size_t>(length), codepoints) ||
+                codepoints.empty() || codepoints.size() > MAX_TOKEN_CHARS) {
+                continue;
+            }
+            
+            bool known = std::all_of(codepoints.begin(), codepoints.end(),
+                                     [&readings](uint32_t cp) { return readings.count(cp) > 0; });
+            if (!known) {
+                continue;
+            }
+            
+            TokenReading reading;
+            reading.token = token;
+            reading.chars_begin = static_cast<uint32_t>(token_chars_.size());
+            reading.char_count = static_cast<uint8_t>(codepoints.size());
+            reading.piece.assign(buffer, length);
+            
+            for (uint32_t cp : codepoints) {
+                auto it = char_index.find(cp);
+                if (it == char_index.end()) {
+                    std::vector<uint16_t> syllables = readings.at(cp);
+                    std::sort(syllables.begin(), syllables.end());
+                    syllables.erase(std::unique(syllables.begin(), syllables.end()), syllables.end());
+                    it = char_index.emplace(cp, static_cast<uint32_t>(char_syllables_.size())).first;
+                    char_syllables_.push_back(std::move(syllables));
+                }
+                token_chars_.push_back(it->second);
+            }
+            
+            // 按首字读音建立索引
+            const uint32_t reading_index = static_cast<uint32_t>(token_readings_.size());
+            for (uint16_t syllable : char_syllables_[token_chars_[reading.chars_begin]]) {
+                tokens_by_syllable_[syllable].push_back(reading_index);
+            }
+            token_readings_.push_back(std::move(reading));
+        }
+        
+        spdlog::info("Indexed {} hanzi tokens covering {} characters for constrained decoding",
+                     token_readings_.size(), char_syllables_.size());
+        return !token_readings_.empty();
+    }
+    
+    std::vector<ConstrainedPrediction> generateConstrained(const std::string& prompt,
+                                                           const std::vector<std::vector<uint16_t>>& allowed,
+                                                           int max_results, const CancelCallback& is_cancelled,
+                                                           int session = 0) {
+        std::vector<ConstrainedPrediction> results;
+        if (!model_loaded_ || token_readings_.empty() || allowed.empty() || max_results <= 0) {
+            return results;
+        }
+        
+        Session* s = getSession(session);
+        if (!s) {
+            return results;
+        }
+        std::lock_guard<std::mutex> guard(s->mutex);
+        
+        try {
+            std::vector<llama_token> tokens = tokenize(preprocessInput(prompt));
+            if (tokens.empty() || !evaluatePrefix(*s, session, tokens.data(), tokens.size())) {
+                return results;
+            }
+            
+            const int vocab_size = llama_n_vocab(model_);
+            std::vector<uint32_t> readings;
+            collectAllowedReadings(*s, allowed, 0, readings);
+            if (readings.empty()) {
+                return results;
+            }
+            
+            // 第一步取logit最高的若干个合法token作为分支起点，保证结果互不相同
+            const float* logits = s->logits.data();
+            const float lse = logSumExp(logits, vocab_size);
+            
+            size_t branch_count = std::min(readings.size(), static_cast<size_t>(max_results));
+            std::partial_sort(readings.begin(), readings.begin() + branch_count, readings.end(),
+                              [this, logits](uint32_t a, uint32_t b) {
+                                  return logits[token_readings_[a].token] > logits[token_readings_[b].token];
+                              });
+            
+            std::vector<std::pair<uint32_t, float>> branches;
+            for (size_t i = 0; i < branch_count; ++i) {
+                branches.emplace_back(readings[i], logits[token_readings_[readings[i]].token] - lse);
+            }
+            
+            std::vector<llama_token> allowed_tokens;
+            for (const auto& branch : branches) {
+                ConstrainedPrediction prediction;
+                prediction.log_prob = branch.second;
+                size_t position = 0;
+                appendReading(branch.first, allowed, position, prediction);
+                
+                std::vector<llama_token> sequence = tokens;
+                sequence.push_back(token_readings_[branch.first].token);
+                
+                // 后续每步在掩码下采样，每个token至少消耗一个音节
+                bool complete = true;
+                while (position < allowed.size()) {
+                    if (is_cancelled && is_cancelled()) {
+                        return {};
+                    }
+                    
+                    collectAllowedReadings(*s, allowed, position, readings);
+                    if (readings.empty() || !evaluatePrefix(*s, session, sequence.data(), sequence.size())) {
+                        complete = false;
+                        break;
+                    }
+                    
+                    allowed_tokens.clear();
+                    for (uint32_t r : readings) {
+                        allowed_tokens.push_back(token_readings_[r].token);
                     }
+                    
+                    const float* step_logits = s->logits.data();
+                    const float step_lse = logSumExp(step_logits, vocab_size);
+                    
+                    llama_token next = sampleNextToken(*s, &allowed_tokens);
+                    auto it = std::find(allowed_tokens.begin(), allowed_tokens.end(), next);
+                    if (it == allowed_tokens.end()) {
+                        complete = false;
+                        break;
+                    }
+                    
+                    prediction.log_prob += step_logits[next] - step_lse;
+                    appendReading(readings[it - allowed_tokens.begin()], allowed, position, prediction);
+                    sequence.push_back(next);
+                }
+                
+                if (complete) {
+                    results.push_back(std::move(prediction));
                 }
             }
             
-            return total_prob;
+            // 去重并按概率排序
+            std::sort(results.begin(), results.end(), [](const ConstrainedPrediction& a, const ConstrainedPrediction& b) {
+                return a.text != b.text ? a.text < b.text : a.log_prob > b.log_prob;
+            });
+            results.erase(std::unique(results.begin(), results.end(),
+                                      [](const ConstrainedPrediction& a, const ConstrainedPrediction& b) {
+                                          return a.text == b.text;
+                                      }), results.end());
+            std::sort(results.begin(), results.end(), [](const ConstrainedPrediction& a, const ConstrainedPrediction& b) {
+                return a.log_prob > b.log_prob;
+            });
             
         } catch (const std::exception& e) {
-            spdlog::error("Error in getNextWordProbability: {}", e.what());
-            return 0.0;
+            spdlog::error("Error in generateConstrained: {}", e.what());
+            results.clear();
+        }
+        
+        return results;
+    }
+    
+    bool measureThroughput(const std::string& prompt, int decode_tokens, LlamaThroughput& result) {
+        result = LlamaThroughput();
+        if (!model_loaded_) {
+            return false;
+        }
+        
+        std::vector<llama_token> tokens = tokenize(prompt);
+        if (tokens.empty()) {
+            return false;
+        }
+        
+        Session& s = sessions_[0];
+        std::lock_guard<std::mutex> guard(s.mutex);
+        
+        // 清空默认会话的缓存，测量完整的prompt评估
+        {
+            std::lock_guard<std::mutex> lock(context_mutex_);
+            clearSequence(s, 0);
+        }
+        
+        auto start = std::chrono::steady_clock::now();
+        if (!evaluatePrefix(s, 0, tokens.data(), tokens.size())) {
+            return false;
+        }
+        auto prefill_end = std::chrono::steady_clock::now();
+        
+        // 解码固定数量的token，不因结束符提前停止
+        int generated = 0;
+        while (generated < decode_tokens && appendToken(s, 0, sampleNextToken(s))) {
+            ++generated;
+        }
+        auto decode_end = std::chrono::steady_clock::now();
+        
+        result.prompt_tokens = static_cast<int>(tokens.size());
+        result.generated_tokens = generated;
+        result.prefill_ms = std::chrono::duration<double, std::milli>(prefill_end - start).count();
+        result.decode_ms = std::chrono::duration<double, std::milli>(decode_end - prefill_end).count();
+        return true;
+    }
+    
+    bool autoTune(const std::string& cache_path) {
+        if (!model_loaded_) {
+            return false;
+        }
+        
+        const std::string key = tuneKey();
+        int prefill_threads = 0;
+        int decode_threads = 0;
+        if (loadTuneResult(cache_path, key, prefill_threads, decode_threads)) {
+            setThreads(prefill_threads, decode_threads);
+            spdlog::info("Using cached thread tuning: prefill={}, decode={}", prefill_threads, decode_threads);
+            return true;
+        }
+        
+        // 候选线程数：1、2、4……直到逻辑核心数，另加物理核心数的估计值
+        const int hardware = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+        std::vector<int> counts;
+        for (int n = 1; n < hardware; n *= 2) {
+            counts.push_back(n);
+        }
+        counts.push_back(hardware);
+        counts.push_back(std::max(1, hardware / 2));
+        std::sort(counts.begin(), counts.end());
+        counts.erase(std::unique(counts.begin(), counts.end()), counts.end());
+        
+        std::string prompt;
+        for (int i = 0; i < 4; ++i) {
+            prompt += "输入法根据用户输入的拼音预测最可能的汉字序列。今天天气很好，我们一起去公园散步。";
+        }
+        
+        const int configured_prefill = prefill_threads_;
+        const int configured_decode = decode_threads_;
+        
+        // 先跑一次使权重页面就绪，避免第一组测量偏慢
+        LlamaThroughput result;
+        measureThroughput(prompt, 1, result);
+        
+        double best_prefill = std::numeric_limits<double>::infinity();
+        double best_decode = std::numeric_limits<double>::infinity();
+        for (int n : counts) {
+            setThreads(n, n);
+            if (!measureThroughput(prompt, TUNE_DECODE_TOKENS, result) ||
+                result.prompt_tokens == 0 || result.generated_tokens == 0) {
+                continue;
+            }
+            
+            const double prefill = result.prefill_ms / result.prompt_tokens;
+            const double decode = result.decode_ms / result.generated_tokens;
+            spdlog::debug("Tuning {} threads: prefill {:.3f} ms/token, decode {:.3f} ms/token", n, prefill, decode);
+            if (prefill < best_prefill) {
+                best_prefill = prefill;
+                prefill_threads = n;
+            }
+            if (decode < best_decode) {
+                best_decode = decode;
+                decode_threads = n;
+            }
+        }
+        
+        {
+            std::lock_guard<std::mutex> guard(sessions_[0].mutex);
+            std::lock_guard<std::mutex> lock(context_mutex_);
+            clearSequence(sessions_[0], 0);
+        }
+        
+        if (prefill_threads == 0 || decode_threads == 0) {
+            setThreads(configured_prefill, configured_decode);
+            spdlog::warn("Thread tuning failed, keeping prefill={}, decode={}", configured_prefill, configured_decode);
+            return false;
+        }
+        
+        setThreads(prefill_threads, decode_threads);
+        saveTuneResult(cache_path, key, prefill_threads, decode_threads, best_prefill, best_decode);
+        spdlog::info("Auto-tuned threads: prefill={} ({:.3f} ms/token), decode={} ({:.3f} ms/token)",
+                     prefill_threads, best_prefill, decode_threads, best_decode);
+        return true;
+    }
+    
+    void setThreadLimit(int max_threads) {
+        std::lock_guard<std::mutex> lock(context_mutex_);
+        if (thread_limit_ == max_threads) {
+            return;
+        }
+        thread_limit_ = max_threads;
+        if (ctx_) {
+            applyThreads();
+            spdlog::debug("llama thread limit set to {}", max_threads);
         }
     }
     
@@ -231,26 +816,24 @@ public:
             double log_likelihood = 0.0;
             int token_count = 0;
             
-            // 计算每个token的对数似然
+            Session& s = sessions_[0];
+            std::lock_guard<std::mutex> guard(s.mutex);
+            
+            // 计算每个token的对数似然，每步只需解码一个新token
+            if (!evaluatePrefix(s, 0, tokens.data(), 1)) {
+                return std::numeric_limits<double>::infinity();
+            }
+            
             for (size_t i = 1; i < tokens.size(); ++i) {
-                // 评估前i个tokens
-                if (llama_decode(ctx_, llama_batch_get_one(tokens.data(), i, 0, 0)) != 0) {
-                    continue;
-                }
-                
-                float* logits = llama_get_logits_ith(ctx_, -1);
-                if (!logits) {
-                    continue;
+                if (i > 1 && !appendToken(s, 0, tokens[i - 1])) {
+                    break;
                 }
                 
-                // 计算softmax
-                int vocab_size = llama_n_vocab(model_);
-                std::vector<float> probs(vocab_size);
-                softmax(logits, probs.data(), vocab_size);
-                
-                // 添加当前token的对数概率
-                if (tokens[i] < vocab_size && probs[tokens[i]] > 0) {
-                    log_likelihood += std::log(probs[tokens[i]]);
+                // 当前token的对数概率只需其logit和整个词表的log-sum-exp
+                const float* logits = s.logits.data();
+                const int vocab_size = llama_n_vocab(model_);
+                if (tokens[i] < vocab_size) {
+                    log_likelihood += logits[tokens[i]] - logSumExp(logits, vocab_size);
                     token_count++;
                 }
             }
@@ -282,7 +865,9 @@ public:
         ss << "Model: " << model_path_ << "\n";
         ss << "Context size: " << llama_n_ctx(ctx_) << "\n";
         ss << "Vocabulary size: " << llama_n_vocab(model_) << "\n";
-        ss << "Embedding size: " << llama_n_embd(model_);
+        ss << "Embedding size: " << llama_n_embd(model_) << "\n";
+        ss << "Threads: prefill " << prefill_threads_ << ", decode " << decode_threads_ << "\n";
+        ss << "GPU layers: " << config_.gpu_layers;
         
         return ss.str();
     }
@@ -295,21 +880,628 @@ public:
         return generation_params_;
     }
     
-    void warmupModel() {
+    bool warmupModel() {
         if (!model_loaded_) {
-            return;
+            return false;
         }
         
         spdlog::info("Warming up model...");
         
-        // 使用简单的提示进行预热
+        // 使用简单的提示进行预热，使权重页面和计算缓冲区在首次预测前就绪
         std::string warmup_prompt = "你好";
         generateText(warmup_prompt, 5);
         
         spdlog::info("Model warmup completed");
+        return true;
     }
     
 private:
+    /**
+     * 使会话序列的KV缓存内容与给定token序列一致
+     * 保留与缓存相同的前缀，只删除分叉后的部分并解码新增token
+     * @return 是否成功，成功后会话的logits对应序列最后一个token
+     */
+    bool evaluatePrefix(Session& s, int session, const llama_token* tokens, size_t count) {
+        if (count == 0) {
+            return false;
+        }
+        
+        size_t common = 0;
+        while (common < s.cached_tokens.size() && common < count && s.cached_tokens[common] == tokens[common]) {
+            ++common;
+        }
+        
+        // 至少重新解码最后一个token以得到其logits
+        if (common == count) {
+            --common;
+        }
+        
+        {
+            std::lock_guard<std::mutex> lock(context_mutex_);
+            if (count > sessionKvBudget()) {
+                spdlog::warn("Prompt of {} tokens exceeds session KV budget {}", count, sessionKvBudget());
+                return false;
+            }
+            
+            if (common < s.cached_tokens.size()) {
+                llama_kv_cache_seq_rm(ctx_, session, static_cast<llama_pos>(common), -1);
+                releaseCells(s, s.cached_tokens.size() - common);
+                s.cached_tokens.resize(common);
+            }
+            if (!reserveCells(s, count - common)) {
+                return false;
+            }
+        }
+        
+        const int vocab_size = llama_n_vocab(model_);
+        s.job.on_logits = [&s, vocab_size](size_t, const float* logits) {
+            s.logits.assign(logits, logits + vocab_size);
+        };
+        
+        while (s.cached_tokens.size() < count) {
+            size_t pos = s.cached_tokens.size();
+            size_t n = std::min(count - pos, static_cast<size_t>(PROMPT_BATCH_SIZE));
+            
+            s.job.rows.clear();
+            for (size_t i = 0; i < n; ++i) {
+                s.job.rows.push_back({tokens[pos + i], static_cast<llama_pos>(pos + i), session, i + 1 == n});
+            }
+            
+            if (!runDecode(s.job)) {
+                // 解码失败时无法确定序列状态，整体清空
+                std::lock_guard<std::mutex> lock(context_mutex_);
+                clearSequence(s, session);
+                return false;
+            }
+            s.cached_tokens.insert(s.cached_tokens.end(), tokens + pos, tokens + pos + n);
+        }
+        
+        spdlog::trace("KV cache of session {} reused {} of {} prompt tokens", session, common, count);
+        return true;
+    }
+    
+    /**
+     * 在会话序列末尾解码一个token
+     * @return 是否成功
+     */
+    bool appendToken(Session& s, int session, llama_token token) {
+        {
+            std::lock_guard<std::mutex> lock(context_mutex_);
+            if (!reserveCells(s, 1)) {
+                return false;
+            }
+        }
+        
+        const int vocab_size = llama_n_vocab(model_);
+        s.job.on_logits = [&s, vocab_size](size_t, const float* logits) {
+            s.logits.assign(logits, logits + vocab_size);
+        };
+        s.job.rows.clear();
+        s.job.rows.push_back({token, static_cast<llama_pos>(s.cached_tokens.size()), session, true});
+        
+        if (!runDecode(s.job)) {
+            std::lock_guard<std::mutex> lock(context_mutex_);
+            clearSequence(s, session);
+            return false;
+        }
+        
+        s.cached_tokens.push_back(token);
+        return true;
+    }
+    
+    /**
+     * 推测解码
+     * 每步把当前token和n-gram草稿一起解码，逐行采样：采样结果与草稿一致则接受并继续验证下一行，
+     * 否则以该采样结果作为下一个token。草稿是确定的，接受的token与逐个生成的采样分布相同
+     * @param generated 输出生成的token
+     * @return 是否完成（被取消时为false）
+     */
+    bool generateSpeculative(Session& s, int session, int max_tokens, const CancelCallback& is_cancelled,
+                             std::vector<llama_token>& generated) {
+        const llama_token eos = llama_token_eos(model_);
+        const size_t max_generated = static_cast<size_t>(std::max(0, max_tokens));
+        llama_token next = sampleNextToken(s);
+        std::vector<llama_token> draft;
+        size_t steps = 0;
+        size_t accepted_total = 0;
+        
+        while (generated.size() < max_generated && next != eos) {
+            if (is_cancelled && is_cancelled()) {
+                spdlog::debug("Speculative generation cancelled after {} tokens", generated.size());
+                return false;
+            }
+            
+            generated.push_back(next);
+            if (generated.size() >= max_generated) {
+                break;
+            }
+            
+            draft.clear();
+            findDraft(s.cached_tokens, next, std::min(static_cast<size_t>(config_.speculative_tokens),
+                                                      max_generated - generated.size()), draft);
+            
+            {
+                std::lock_guard<std::mutex> lock(context_mutex_);
+                if (!reserveCells(s, 1 + draft.size())) {
+                    break;
+                }
+            }
+            
+            const llama_pos base = static_cast<llama_pos>(s.cached_tokens.size());
+            s.job.rows.clear();
+            s.job.rows.push_back({next, base, session, true});
+            for (size_t i = 0; i < draft.size(); ++i) {
+                s.job.rows.push_back({draft[i], base + 1 + static_cast<llama_pos>(i), session, true});
+            }
+            
+            // 各行按顺序回调；出现不一致后其余行的logits不再需要
+            size_t accepted = 0;
+            bool rejected = false;
+            llama_token correction = eos;
+            s.job.on_logits = [&](size_t row, const float* logits) {
+                if (rejected || row != accepted) {
+                    return;
+                }
+                llama_token sampled = sampleFromLogits(s, logits);
+                if (row < draft.size() && sampled == draft[row]) {
+                    ++accepted;
+                } else {
+                    correction = sampled;
+                    rejected = true;
+                }
+            };
+            
+            if (!runDecode(s.job)) {
+                std::lock_guard<std::mutex> lock(context_mutex_);
+                clearSequence(s, session);
+                break;
+            }
+            ++steps;
+            
+            // 删除未被接受的草稿在KV缓存中的位置
+            if (accepted < draft.size()) {
+                std::lock_guard<std::mutex> lock(context_mutex_);
+                llama_kv_cache_seq_rm(ctx_, session, base + 1 + static_cast<llama_pos>(accepted), -1);
+                releaseCells(s, draft.size() - accepted);
+            }
+            
+            s.cached_tokens.push_back(next);
+            s.cached_tokens.insert(s.cached_tokens.end(), draft.begin(), draft.begin() + accepted);
+            accepted_total += accepted;
+            
+            bool finished = false;
+            for (size_t i = 0; i < accepted; ++i) {
+                if (draft[i] == eos || generated.size() >= max_generated) {
+                    finished = true;
+                    break;
+                }
+                generated.push_back(draft[i]);
+            }
+            if (finished) {
+                break;
+            }
+            next = correction;
+        }
+        
+        spdlog::debug("Speculative decoding generated {} tokens in {} decode steps ({} draft tokens accepted)",
+                      generated.size(), steps, accepted_total);
+        return true;
+    }
+    
+    /**
+     * 查找n-gram草稿
+     * 先在会话已有的token中找上一个token和当前token连续出现的位置（prompt lookup），
+     * 找不到时查草稿短语索引，取其后续token
+     * @param history 会话序列中已有的token
+     * @param current 即将追加的token
+     * @param limit 最多草稿token数
+     * @param draft 输出草稿
+     */
+    void findDraft(const std::vector<llama_token>& history, llama_token current, size_t limit,
+                   std::vector<llama_token>& draft) {
+        if (limit == 0) {
+            return;
+        }
+        
+        // 从后往前找，优先取最近的、后续足够长的匹配
+        const llama_token previous = history.empty() ? -1 : history.back();
+        size_t best = 0;
+        size_t best_length = 0;
+        for (size_t i = history.size(); i-- > 1 && best_length < limit;) {
+            if (history[i] == current && history[i - 1] == previous) {
+                const size_t length = std::min(limit, history.size() - i - 1);
+                if (length > best_length) {
+                    best = i + 1;
+                    best_length = length;
+                }
+            }
+        }
+        if (best_length > 0) {
+            draft.assign(history.begin() + best, history.begin() + best + best_length);
+            return;
+        }
+        
+        std::lock_guard<std::mutex> lock(draft_mutex_);
+        auto it = draft_index_.find(draftKey(previous, current));
+        if (it == draft_index_.end()) {
+            it = draft_index_.find(draftKey(-1, current));
+            if (it == draft_index_.end()) {
+                return;
+            }
+        }
+        for (size_t j = it->second; j < draft_tokens_.size() && draft_tokens_[j] >= 0 && draft.size() < limit; ++j) {
+            draft.push_back(draft_tokens_[j]);
+        }
+    }
+    
+    static uint64_t draftKey(llama_token previous, llama_token current) {
+        return (static_cast<uint64_t>(static_cast<uint32_t>(previous)) << 32) | static_cast<uint32_t>(current);
+    }
+    
+    /**
+     * 把短语的token加入草稿索引，调用方需持有draft_mutex_
+     * 每个token以（前一token，当前token）和（当前token）为键，指向其后续位置；已有的键保持不变
+     */
+    void indexDraftPhrase(const std::string& phrase) {
+        std::vector<llama_token> tokens = tokenize(phrase);
+        if (tokens.size() < 2) {
+            return;
+        }
+        if (draft_tokens_.size() + tokens.size() + 1 > MAX_DRAFT_TOKENS) {
+            spdlog::debug("Draft phrase index full, ignoring phrase");
+            return;
+        }
+        
+        const size_t begin = draft_tokens_.size();
+        draft_tokens_.insert(draft_tokens_.end(), tokens.begin(), tokens.end());
+        draft_tokens_.push_back(-1);   // 短语分隔符
+        
+        for (size_t i = 0; i + 1 < tokens.size(); ++i) {
+            const llama_token previous = i > 0 ? tokens[i - 1] : -1;
+            draft_index_.emplace(draftKey(previous, tokens[i]), begin + i + 1);
+            draft_index_.emplace(draftKey(-1, tokens[i]), begin + i + 1);
+        }
+    }
+    
+    /**
+     * 提交解码请求并等待完成
+     * 连续批处理：没有batch在解码时由提交者直接解码；否则排队，
+     * 由正在解码的线程在下一轮把所有排队的请求合并进同一个batch
+     * @return 是否解码成功
+     */
+    bool runDecode(DecodeJob& job) {
+        std::unique_lock<std::mutex> lock(queue_mutex_);
+        job.done = false;
+        job.ok = false;
+        decode_queue_.push_back(&job);
+        
+        std::vector<DecodeJob*> jobs;
+        while (!job.done) {
+            if (decoding_) {
+                decode_cv_.wait(lock);
+                continue;
+            }
+            
+            // 按到达顺序取出能装进一个batch的请求
+            decoding_ = true;
+            jobs.clear();
+            size_t rows = 0;
+            while (!decode_queue_.empty() &&
+                   (jobs.empty() || rows + decode_queue_.front()->rows.size() <= static_cast<size_t>(PROMPT_BATCH_SIZE))) {
+                rows += decode_queue_.front()->rows.size();
+                jobs.push_back(decode_queue_.front());
+                decode_queue_.pop_front();
+            }
+            lock.unlock();
+            
+            {
+                std::lock_guard<std::mutex> context_lock(context_mutex_);
+                // 合并的batch失败时（如KV缓存碎片导致找不到足够的连续空位）逐个重试
+                if (!decodeBatch(jobs.data(), jobs.size()) && jobs.size() > 1) {
+                    for (DecodeJob* pending : jobs) {
+                        decodeBatch(&pending, 1);
+                    }
+                }
+            }
+            
+            lock.lock();
+            for (DecodeJob* finished : jobs) {
+                finished->done = true;
+            }
+            decoding_ = false;
+            decode_cv_.notify_all();
+        }
+        
+        return job.ok;
+    }
+    
+    /**
+     * 把若干解码请求放进同一个batch解码，调用方需持有context_mutex_
+     * @return 是否解码成功
+     */
+    bool decodeBatch(DecodeJob* const* jobs, size_t count) {
+        batch_.n_tokens = 0;
+        for (size_t j = 0; j < count; ++j) {
+            for (const DecodeRow& row : jobs[j]->rows) {
+                const int index = batch_.n_tokens++;
+                batch_.token[index] = row.token;
+                batch_.pos[index] = row.pos;
+                batch_.n_seq_id[index] = 1;
+                batch_.seq_id[index][0] = row.seq;
+                batch_.logits[index] = row.logits;
+            }
+        }
+        
+        if (llama_decode(ctx_, batch_) != 0) {
+            spdlog::debug("Failed to decode batch of {} tokens from {} requests", batch_.n_tokens, count);
+            for (size_t j = 0; j < count; ++j) {
+                jobs[j]->ok = false;
+            }
+            return false;
+        }
+        
+        int index = 0;
+        for (size_t j = 0; j < count; ++j) {
+            DecodeJob& job = *jobs[j];
+            job.ok = true;
+            for (size_t row = 0; row < job.rows.size(); ++row, ++index) {
+                if (!job.rows[row].logits) {
+                    continue;
+                }
+                const float* logits = llama_get_logits_ith(ctx_, index);
+                if (!logits) {
+                    job.ok = false;
+                } else if (job.on_logits) {
+                    job.on_logits(row, logits);
+                }
+            }
+        }
+        return true;
+    }
+    
+    /**
+     * 每个会话可占用的KV单元数，调用方需持有context_mutex_
+     */
+    size_t sessionKvBudget() const {
+        const size_t n_ctx = static_cast<size_t>(llama_n_ctx(ctx_));
+        return requested_kv_budget_ > 0 ? std::min(requested_kv_budget_, n_ctx) : n_ctx / 2;
+    }
+    
+    /**
+     * 为会话预留KV单元，上下文容量不足时淘汰最久未用的空闲会话
+     * 调用方需持有context_mutex_
+     * @return 是否预留成功（超出会话预算或没有可淘汰的会话时失败）
+     */
+    bool reserveCells(Session& s, size_t cells) {
+        s.last_used = ++use_clock_;
+        if (s.kv_cells + cells > sessionKvBudget()) {
+            spdlog::debug("Session KV budget {} exhausted", sessionKvBudget());
+            return false;
+        }
+        
+        const size_t n_ctx = static_cast<size_t>(llama_n_ctx(ctx_));
+        while (used_cells_ + cells > n_ctx) {
+            if (!evictIdleSession(s)) {
+                spdlog::warn("KV cache full: {} of {} cells in use by active sessions", used_cells_, n_ctx);
+                return false;
+            }
+        }
+        
+        s.kv_cells += cells;
+        used_cells_ += cells;
+        return true;
+    }
+    
+    void releaseCells(Session& s, size_t cells) {
+        cells = std::min(cells, s.kv_cells);
+        s.kv_cells -= cells;
+        used_cells_ -= cells;
+    }
+    
+    /**
+     * 删除会话序列的全部KV缓存，调用方需持有context_mutex_和该会话的锁
+     */
+    void clearSequence(Session& s, int session) {
+        llama_kv_cache_seq_rm(ctx_, session, -1, -1);
+        releaseCells(s, s.kv_cells);
+        s.cached_tokens.clear();
+    }
+    
+    /**
+     * 淘汰最久未用且当前没有推理在进行的会话，调用方需持有context_mutex_
+     * 被淘汰的会话下次使用时重新评估prompt
+     * @return 是否淘汰了会话
+     */
+    bool evictIdleSession(const Session& requester) {
+        std::vector<int> victims;
+        for (int i = 0; i < LlamaPredictor::MAX_SESSIONS; ++i) {
+            if (&sessions_[i] != &requester && sessions_[i].kv_cells > 0) {
+                victims.push_back(i);
+            }
+        }
+        std::sort(victims.begin(), victims.end(), [this](int a, int b) {
+            return sessions_[a].last_used < sessions_[b].last_used;
+        });
+        
+        for (int victim : victims) {
+            // 正在推理的会话持有自己的锁，跳过
+            std::unique_lock<std::mutex> victim_lock(sessions_[victim].mutex, std::try_to_lock);
+            if (!victim_lock.owns_lock()) {
+                continue;
+            }
+            spdlog::debug("Evicting KV cache of idle session {} ({} cells)", victim, sessions_[victim].kv_cells);
+            clearSequence(sessions_[victim], victim);
+            return true;
+        }
+        return false;
+    }
+    
+    void setThreads(int prefill_threads, int decode_threads) {
+        std::lock_guard<std::mutex> lock(context_mutex_);
+        prefill_threads_ = prefill_threads;
+        decode_threads_ = decode_threads;
+        applyThreads();
+    }
+    
+    /**
+     * 按线程上限设置上下文的线程数，调用方持有context_mutex_
+     */
+    void applyThreads() {
+        int prefill = prefill_threads_;
+        int decode = decode_threads_;
+        if (thread_limit_ > 0) {
+            prefill = std::min(prefill, thread_limit_);
+            decode = std::min(decode, thread_limit_);
+        }
+        llama_set_n_threads(ctx_, static_cast<uint32_t>(decode), static_cast<uint32_t>(prefill));
+    }
+    
+    /**
+     * 调优结果的缓存键：模型文件及大小、上下文大小、GPU层数和逻辑核心数
+     */
+    std::string tuneKey() const {
+        std::ifstream file(model_path_, std::ios::binary | std::ios::ate);
+        const long long model_size = file.good() ? static_cast<long long>(file.tellg()) : 0;
+        std::stringstream ss;
+        ss << model_path_ << "|" << model_size << "|ctx" << llama_n_ctx(ctx_) << "|gpu" << config_.gpu_layers
+           << "|hw" << std::thread::hardware_concurrency();
+        return ss.str();
+    }
+    
+    static nlohmann::json readTuneCache(const std::string& cache_path) {
+        std::ifstream file(cache_path);
+        if (!file.good()) {
+            return nlohmann::json::object();
+        }
+        nlohmann::json cache = nlohmann::json::parse(file, nullptr, false);
+        return cache.is_object() ? cache : nlohmann::json::object();
+    }
+    
+    static bool loadTuneResult(const std::string& cache_path, const std::string& key,
+                               int& prefill_threads, int& decode_threads) {
+        if (cache_path.empty()) {
+            return false;
+        }
+        
+        nlohmann::json cache = readTuneCache(cache_path);
+        auto it = cache.find(key);
+        if (it == cache.end() || !it->is_object()) {
+            return false;
+        }
+        
+        prefill_threads = it->value("prefill_threads", 0);
+        decode_threads = it->value("decode_threads", 0);
+        return prefill_threads > 0 && decode_threads > 0;
+    }
+    
+    static void saveTuneResult(const std::string& cache_path, const std::string& key, int prefill_threads,
+                               int decode_threads, double prefill_ms, double decode_ms) {
+        if (cache_path.empty()) {
+            return;
+        }
+        
+        nlohmann::json cache = readTuneCache(cache_path);
+        cache[key] = {
+            {"prefill_threads", prefill_threads},
+            {"decode_threads", decode_threads},
+            {"prefill_ms_per_token", prefill_ms},
+            {"decode_ms_per_token", decode_ms}
+        };
+        
+        std::ofstream file(cache_path);
+        if (!file.good()) {
+            spdlog::warn("Failed to write thread tuning cache: {}", cache_path);
+            return;
+        }
+        file << cache.dump(2);
+    }
+    
+    void resetSessions() {
+        for (Session& s : sessions_) {
+            s.cached_tokens.clear();
+            s.logits.clear();
+            s.kv_cells = 0;
+            s.last_used = 0;
+        }
+        used_cells_ = 0;
+        use_clock_ = 0;
+    }
+    
+    /**
+     * 收集从指定音节位置开始读音匹配的token
+     * @param allowed 各位置允许的音节ID（升序）
+     * @param position 起始音节位置
+     * @param out 输出匹配的TokenReading下标
+     */
+    void collectAllowedReadings(Session& s, const std::vector<std::vector<uint16_t>>& allowed, size_t position,
+                                std::vector<uint32_t>& out) {
+        out.clear();
+        if (position >= allowed.size()) {
+            return;
+        }
+        
+        // 同一token可能经由多个首字读音被找到，用时间戳去重
+        if (s.reading_stamps.size() != token_readings_.size()) {
+            s.reading_stamps.assign(token_readings_.size(), 0);
+            s.reading_stamp = 0;
+        }
+        if (++s.reading_stamp == 0) {
+            std::fill(s.reading_stamps.begin(), s.reading_stamps.end(), 0);
+            s.reading_stamp = 1;
+        }
+        
+        for (uint16_t syllable : allowed[position]) {
+            if (syllable >= tokens_by_syllable_.size()) {
+                continue;
+            }
+            for (uint32_t r : tokens_by_syllable_[syllable]) {
+                if (s.reading_stamps[r] == s.reading_stamp) {
+                    continue;
+                }
+                s.reading_stamps[r] = s.reading_stamp;
+                if (matchesReading(token_readings_[r], allowed, position)) {
+                    out.push_back(r);
+                }
+            }
+        }
+    }
+    
+    bool matchesReading(const TokenReading& reading, const std::vector<std::vector<uint16_t>>& allowed,
+                        size_t position) const {
+        if (position + reading.char_count > allowed.size()) {
+            return false;
+        }
+        for (size_t i = 0; i < reading.char_count; ++i) {
+            if (matchSyllable(token_chars_[reading.chars_begin + i], allowed[position + i]) < 0) {
+                return false;
+            }
+        }
+        return true;
+    }
+    
+    /**
+     * 返回汉字在允许集合中的第一个读音，不匹配返回-1
+     */
+    int matchSyllable(uint32_t char_index, const std::vector<uint16_t>& allowed_syllables) const {
+        for (uint16_t syllable : char_syllables_[char_index]) {
+            if (std::binary_search(allowed_syllables.begin(), allowed_syllables.end(), syllable)) {
+                return syllable;
+            }
+        }
+        return -1;
+    }
+    
+    void appendReading(uint32_t reading_index, const std::vector<std::vector<uint16_t>>& allowed,
+                       size_t& position, ConstrainedPrediction& prediction) const {
+        const TokenReading& reading = token_readings_[reading_index];
+        for (size_t i = 0; i < reading.char_count; ++i) {
+            int syllable = matchSyllable(token_chars_[reading.chars_begin + i], allowed[position + i]);
+            prediction.syllable_ids.push_back(static_cast<uint16_t>(syllable));
+        }
+        prediction.text += reading.piece;
+        position += reading.char_count;
+    }
+    
     std::vector<llama_token> tokenize(const std::string& text) {
         if (!model_) {
             return {};
@@ -351,39 +1543,67 @@ private:
         return result;
     }
     
-    llama_token sampleNextToken() {
-        if (!ctx_) {
+    /**
+     * 从会话序列最后一个token的logits采样
+     * @param allowed_tokens 允许的token集合，非空时其余token均被屏蔽
+     */
+    llama_token sampleNextToken(Session& s, const std::vector<llama_token>* allowed_tokens = nullptr) {
+        if (!ctx_ || s.logits.empty()) {
             return 0;
         }
         
-        float* logits = llama_get_logits_ith(ctx_, -1);
-        if (!logits) {
-            return 0;
+        const float* logits = s.logits.data();
+        
+        if (allowed_tokens) {
+            return sampleMasked(s, logits, *allowed_tokens);
         }
+        return sampleFromLogits(s, logits);
+    }
+    
+    /**
+     * 按温度、top-k、top-p从一行logits采样，不修改logits
+     * 温度缩放不改变顺序，先在原始logits上预筛选出top-k，只为这些token建立采样候选
+     */
+    llama_token sampleFromLogits(Session& s, const float* logits) {
+        const int vocab_size = llama_n_vocab(model_);
+        const size_t top_k = generation_params_.top_k > 0 ? static_cast<size_t>(generation_params_.top_k) : 0;
+        selectTopK(logits, static_cast<size_t>(vocab_size), top_k, s.top_tokens);
         
-        int vocab_size = llama_n_vocab(model_);
+        // 预筛选后的候选已按logit降序排列
+        return sampleCandidates(s, top_k > 0 && top_k < static_cast<size_t>(vocab_size));
+    }
+    
+    llama_token sampleMasked(Session& s, const float* logits, const std::vector<llama_token>& allowed_tokens) {
+        if (allowed_tokens.empty()) {
+            return llama_token_eos(model_);
+        }
         
-        // 应用温度采样
-        if (generation_params_.temperature > 0) {
-            for (int i = 0; i < vocab_size; ++i) {
-                logits[i] /= generation_params_.temperature;
-            }
+        // 只为允许的token建立候选列表，相当于把其余logits置为-inf
+        s.top_tokens.clear();
+        for (llama_token token : allowed_tokens) {
+            s.top_tokens.push_back({token, logits[token]});
         }
+        selectTopK(s.top_tokens, generation_params_.top_k > 0 ? static_cast<size_t>(generation_params_.top_k) : 0);
         
-        // 创建候选token列表
-        std::vector<llama_token_data> candidates;
-        candidates.reserve(vocab_size);
+        return sampleCandidates(s, true);
+    }
+    
+    /**
+     * 对s.top_tokens中的候选按温度缩放后做top-p采样
+     * @param sorted 候选是否已按logit降序排列
+     */
+    llama_token sampleCandidates(Session& s, bool sorted) {
+        const float scale = generation_params_.temperature > 0 ? 1.0f / generation_params_.temperature : 1.0f;
         
-        for (int i = 0; i < vocab_size; ++i) {
-            candidates.push_back({i, logits[i], 0.0f});
+        s.sample_tokens.clear();
+        for (const TokenLogit& item : s.top_tokens) {
+            s.sample_tokens.push_back({item.id, item.logit * scale, 0.0f});
         }
         
-        llama_token_data_array candidates_p = {candidates.data(), candidates.size(), false};
+        llama_token_data_array candidates_p = {s.sample_tokens.data(), s.sample_tokens.size(), sorted};
         
-        // 应用top-k采样
-        if (generation_params_.top_k > 0) {
-            llama_sample_top_k(ctx_, &candidates_p, generation_params_.top_k, 1);
-        }
+        // 采样函数使用上下文中的随机数发生器，各会话的采样串行执行
+        std::lock_guard<std::mutex> lock(sample_mutex_);
         
         // 应用top-p采样
         if (generation_params_.top_p < 1.0f) {
@@ -394,20 +1614,6 @@ private:
         return llama_sample_token(ctx_, &candidates_p);
     }
     
-    void softmax(const float* input, float* output, int size) {
-        float max_val = *std::max_element(input, input + size);
-        float sum = 0.0f;
-        
-        for (int i = 0; i < size; ++i) {
-            output[i] = std::exp(input[i] - max_val);
-            sum += output[i];
-        }
-        
-        for (int i = 0; i < size; ++i) {
-            output[i] /= sum;
-        }
-    }
-    
     std::string preprocessInput(const std::string& input) {
         // 简单的预处理：去除多余空格
         std::string result = input;
@@ -438,10 +1644,40 @@ private:
     
 public:
     std::string model_path_;
+    ModelConfig config_;
     llama_model* model_;
     llama_context* ctx_;
     bool model_loaded_;
     GenerationParams generation_params_;
+    int prefill_threads_ = 0;
+    int decode_threads_ = 0;
+    int thread_limit_ = 0;              // 0表示不限制
+    
+    // 各会话共享同一上下文，会话i使用序列i
+    Session sessions_[LlamaPredictor::MAX_SESSIONS];
+    llama_batch batch_ = {};
+    size_t requested_kv_budget_ = 0;    // 0表示使用默认预算（上下文的一半）
+    size_t used_cells_ = 0;             // 所有会话占用的KV单元数
+    uint64_t use_clock_ = 0;
+    std::mutex context_mutex_;          // 保护llama上下文、KV缓存及单元计数
+    std::mutex sample_mutex_;
+    
+    // 推测解码的草稿短语：token以-1分隔，索引键为（前一token，当前token），值为后续token的位置
+    std::mutex draft_mutex_;
+    std::vector<llama_token> draft_tokens_;
+    std::unordered_map<uint64_t, size_t> draft_index_;
+    
+    // 连续批处理的解码队列
+    std::mutex queue_mutex_;
+    std::condition_variable decode_cv_;
+    std::deque<DecodeJob*> decode_queue_;
+    bool decoding_ = false;
+    
+    // 受约束生成的缓存
+    std::vector<TokenReading> token_readings_;
+    std::vector<uint32_t> token_chars_;                 // 汉字在char_syllables_中的下标
+    std::vector<std::vector<uint16_t>> char_syllables_; // 每个汉字的读音（升序）
+    std::vector<std::vector<uint32_t>> tokens_by_syllable_;
 };
 
 #else
@@ -459,15 +1695,47 @@ public:
     
     void shutdown() {}
     
-    std::string generateText(const std::string& prompt, int max_tokens) {
+    void releaseSession(int session) {}
+    
+    void setSessionKvBudget(size_t tokens) {}
+    
+    void setDraftPhrases(const std::vector<std::string>& phrases) {}
+    
+    void addDraftPhrase(const std::string& phrase) {}
+    
+    std::string generateText(const std::string& prompt, int max_tokens, const CancelCallback& is_cancelled = nullptr,
+                             int session = 0) {
         spdlog::debug("LlamaPredictor: generateText called (dummy implementation)");
         return "";
     }
     
-    double getNextWordProbability(const std::string& context, const std::string& word) {
-        return 0.0;
+    std::vector<float> getNextWordLogProbs(const std::string& context, const std::vector<std::string>& words,
+                                           int session = 0) {
+        return std::vector<float>(words.size(), -std::numeric_limits<float>::infinity());
+    }
+    
+    bool setCharacterReadings(const std::unordered_map<uint32_t, std::vector<uint16_t>>& readings) {
+        return false;
+    }
+    
+    std::vector<ConstrainedPrediction> generateConstrained(const std::string& prompt,
+                                                           const std::vector<std::vector<uint16_t>>& allowed,
+                                                           int max_results, const CancelCallback& is_cancelled,
+                                                           int session = 0) {
+        return {};
     }
     
+    bool measureThroughput(const std::string& prompt, int decode_tokens, LlamaThroughput& result) {
+        result = LlamaThroughput();
+        return false;
+    }
+    
+    bool autoTune(const std::string& cache_path) {
+        return false;
+    }
+    
+    void setThreadLimit(int max_threads) {}
+    
     double calculatePerplexity(const std::string& text) {
         return std::numeric_limits<double>::infinity();
     }
@@ -488,25 +1756,29 @@ public:
         return generation_params_;
     }
     
-    void warmupModel() {}
+    bool warmupModel() {
+        return false;
+    }
     
 public:
     std::string model_path_;
+    ModelConfig config_;
     bool model_loaded_;
     GenerationParams generation_params_;
 };
 #endif
 
 // LlamaPredictor implementation
-LlamaPredictor::LlamaPredictor(const std::string& model_path)
+LlamaPredictor::LlamaPredictor(const std::string& model_path, const ModelConfig& config)
     : pImpl(std::make_unique<Impl>()) {
-    pImpl->initialize(model_path);
+    pImpl->model_path_ = model_path;
+    pImpl->config_ = config;
 }
 
 LlamaPredictor::~LlamaPredictor() = default;
 
 bool LlamaPredictor::initialize() {
-    return true; // 已在构造函数中初始化
+    return pImpl->initialize(pImpl->model_path_);
 }
 
 void LlamaPredictor::shutdown() {
@@ -517,21 +1789,65 @@ std::vector<std::string> LlamaPredictor::generateText(
     const std::string& prompt,
     int max_tokens,
     float temperature,
-    float top_p
+    float top_p,
+    const CancelCallback& is_cancelled,
+    int session
 ) const {
-    std::string result = pImpl->generateText(prompt, max_tokens);
+    std::string result = pImpl->generateText(prompt, max_tokens, is_cancelled, session);
+    if (result.empty()) {
+        return {};
+    }
     return {result}; // 将单个结果包装成vector
 }
 
 std::vector<float> LlamaPredictor::getNextWordProbabilities(
     const std::string& context,
-    const std::vector<std::string>& candidates
+    const std::vector<std::string>& candidates,
+    int session
 ) const {
-    std::vector<float> probabilities;
-    for (const auto& candidate : candidates) {
-        probabilities.push_back(static_cast<float>(pImpl->getNextWordProbability(context, candidate)));
-    }
-    return probabilities;
+    return pImpl->getNextWordLogProbs(context, candidates, session);
+}
+
+bool LlamaPredictor::setCharacterReadings(const std::unordered_map<uint32_t, std::vector<uint16_t>>& readings) {
+    return pImpl->setCharacterReadings(readings);
+}
+
+std::vector<ConstrainedPrediction> LlamaPredictor::generateConstrained(
+    const std::string& prompt,
+    const std::vector<std::vector<uint16_t>>& allowed_syllables,
+    int max_results,
+    const CancelCallback& is_cancelled,
+    int session
+) const {
+    return pImpl->generateConstrained(prompt, allowed_syllables, max_results, is_cancelled, session);
+}
+
+void LlamaPredictor::releaseSession(int session) {
+    pImpl->releaseSession(session);
+}
+
+void LlamaPredictor::setSessionKvBudget(size_t tokens) {
+    pImpl->setSessionKvBudget(tokens);
+}
+
+void LlamaPredictor::setDraftPhrases(const std::vector<std::string>& phrases) {
+    pImpl->setDraftPhrases(phrases);
+}
+
+void LlamaPredictor::addDraftPhrase(const std::string& phrase) {
+    pImpl->addDraftPhrase(phrase);
+}
+
+bool LlamaPredictor::measureThroughput(const std::string& prompt, int decode_tokens, LlamaThroughput& result) {
+    return pImpl->measureThroughput(prompt, decode_tokens, result);
+}
+
+bool LlamaPredictor::autoTune(const std::string& cache_path) {
+    return pImpl->autoTune(cache_path);
+}
+
+void LlamaPredictor::setThreadLimit(int max_threads) {
+    pImpl->setThreadLimit(max_threads);
 }
 
 float LlamaPredictor::calculatePerplexity(const std::string& text) const {
@@ -551,8 +1867,7 @@ void LlamaPredictor::setGenerationParams(float temperature, float top_p, int top
 }
 
 bool LlamaPredictor::warmup() {
-    // 简化实现
-    return true;
+    return pImpl->warmupModel();
 }
 
 // 移除了不匹配的方法实现
@@ -0,0 +1,313 @@
+#include "core/logit_math.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#if defined(__AVX2__) && (defined(__FMA__) || defined(_MSC_VER))
+#define OWCAT_LOGIT_AVX2
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define OWCAT_LOGIT_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#define OWCAT_LOGIT_NEON
+#include <arm_neon.h>
+#endif
+
+namespace owcat {
+namespace core {
+
+// exp的Cephes多项式近似：x = n·ln2 + r，exp(x) = 2^n·p(r)，相对误差约2e-7
+// 低于EXP_MIN的输入按EXP_MIN计算，结果约1e-38，对求和没有影响
+static constexpr float EXP_MIN = -87.3365447504f;
+static constexpr float EXP_MAX = 88.0f;
+static constexpr float LOG2E = 1.44269504088896341f;
+static constexpr float LN2_HI = 0.693359375f;
+static constexpr float LN2_LO = -2.12194440e-4f;
+static constexpr float EXP_P0 = 1.9875691500e-4f;
+static constexpr float EXP_P1 = 1.3981999507e-3f;
+static constexpr float EXP_P2 = 8.3334519073e-3f;
+static constexpr float EXP_P3 = 4.1665795894e-2f;
+static constexpr float EXP_P4 = 1.6666665459e-1f;
+static constexpr float EXP_P5 = 5.0000001201e-1f;
+
+// selectTopK的暂存区达到k的该倍数时压缩一次
+static constexpr size_t TOPK_BUFFER_FACTOR = 4;
+static constexpr size_t TOPK_MIN_BUFFER = 256;
+
+#if defined(OWCAT_LOGIT_AVX2)
+
+static constexpr size_t LANES = 8;
+
+static inline __m256 expVector(__m256 x) {
+    x = _mm256_min_ps(_mm256_max_ps(x, _mm256_set1_ps(EXP_MIN)), _mm256_set1_ps(EXP_MAX));
+    const __m256 n = _mm256_round_ps(_mm256_mul_ps(x, _mm256_set1_ps(LOG2E)),
+                                     _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    x = _mm256_fnmadd_ps(n, _mm256_set1_ps(LN2_HI), x);
+    x = _mm256_fnmadd_ps(n, _mm256_set1_ps(LN2_LO), x);
+
+    __m256 y = _mm256_set1_ps(EXP_P0);
+    y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(EXP_P1));
+    y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(EXP_P2));
+    y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(EXP_P3));
+    y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(EXP_P4));
+    y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(EXP_P5));
+    y = _mm256_fmadd_ps(y, _mm256_mul_ps(x, x), _mm256_add_ps(x, _mm256_set1_ps(1.0f)));
+
+    __m256i exponent = _mm256_add_epi32(_mm256_cvtps_epi32(n), _mm256_set1_epi32(127));
+    return _mm256_mul_ps(y, _mm256_castsi256_ps(_mm256_slli_epi32(exponent, 23)));
+}
+
+static inline float horizontalMax(__m256 v) {
+    __m128 m = _mm_max_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    m = _mm_max_ps(m, _mm_movehl_ps(m, m));
+    m = _mm_max_ss(m, _mm_shuffle_ps(m, m, 1));
+    return _mm_cvtss_f32(m);
+}
+
+static inline float horizontalSum(__m256 v) {
+    __m128 s = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+    s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+    return _mm_cvtss_f32(s);
+}
+
+static float maxBlocks(const float* logits, size_t blocks) {
+    __m256 m = _mm256_loadu_ps(logits);
+    for (size_t b = 1; b < blocks; ++b) {
+        m = _mm256_max_ps(m, _mm256_loadu_ps(logits + b * LANES));
+    }
+    return horizontalMax(m);
+}
+
+static float sumExpBlocks(const float* logits, size_t blocks, float offset) {
+    const __m256 shift = _mm256_set1_ps(offset);
+    __m256 sum = _mm256_setzero_ps();
+    for (size_t b = 0; b < blocks; ++b) {
+        sum = _mm256_add_ps(sum, expVector(_mm256_sub_ps(_mm256_loadu_ps(logits + b * LANES), shift)));
+    }
+    return horizontalSum(sum);
+}
+
+static inline bool anyGreater(const float* logits, float threshold) {
+    __m256 gt = _mm256_cmp_ps(_mm256_loadu_ps(logits), _mm256_set1_ps(threshold), _CMP_GT_OQ);
+    return _mm256_movemask_ps(gt) != 0;
+}
+
+const char* logitKernelName() {
+    return "avx2";
+}
+
+#elif defined(OWCAT_LOGIT_SSE2)
+
+static constexpr size_t LANES = 4;
+
+static inline __m128 expVector(__m128 x) {
+    x = _mm_min_ps(_mm_max_ps(x, _mm_set1_ps(EXP_MIN)), _mm_set1_ps(EXP_MAX));
+
+    // SSE2没有取整指令，用截断再修正得到floor(x·log2e + 0.5)
+    __m128 fx = _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(LOG2E)), _mm_set1_ps(0.5f));
+    __m128 n = _mm_cvtepi32_ps(_mm_cvttps_epi32(fx));
+    n = _mm_sub_ps(n, _mm_and_ps(_mm_cmpgt_ps(n, fx), _mm_set1_ps(1.0f)));
+
+    x = _mm_sub_ps(x, _mm_mul_ps(n, _mm_set1_ps(LN2_HI)));
+    x = _mm_sub_ps(x, _mm_mul_ps(n, _mm_set1_ps(LN2_LO)));
+
+    __m128 y = _mm_set1_ps(EXP_P0);
+    y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(EXP_P1));
+    y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(EXP_P2));
+    y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(EXP_P3));
+    y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(EXP_P4));
+    y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(EXP_P5));
+    y = _mm_add_ps(_mm_mul_ps(y, _mm_mul_ps(x, x)), _mm_add_ps(x, _mm_set1_ps(1.0f)));
+
+    __m128i exponent = _mm_add_epi32(_mm_cvttps_epi32(n), _mm_set1_epi32(127));
+    return _mm_mul_ps(y, _mm_castsi128_ps(_mm_slli_epi32(exponent, 23)));
+}
+
+static inline float horizontalMax(__m128 m) {
+    m = _mm_max_ps(m, _mm_movehl_ps(m, m));
+    m = _mm_max_ss(m, _mm_shuffle_ps(m, m, 1));
+    return _mm_cvtss_f32(m);
+}
+
+static inline float horizontalSum(__m128 s) {
+    s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+    s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+    return _mm_cvtss_f32(s);
+}
+
+static float maxBlocks(const float* logits, size_t blocks) {
+    __m128 m = _mm_loadu_ps(logits);
+    for (size_t b = 1; b < blocks; ++b) {
+        m = _mm_max_ps(m, _mm_loadu_ps(logits + b * LANES));
+    }
+    return horizontalMax(m);
+}
+
+static float sumExpBlocks(const float* logits, size_t blocks, float offset) {
+    const __m128 shift = _mm_set1_ps(offset);
+    __m128 sum = _mm_setzero_ps();
+    for (size_t b = 0; b < blocks; ++b) {
+        sum = _mm_add_ps(sum, expVector(_mm_sub_ps(_mm_loadu_ps(logits + b * LANES), shift)));
+    }
+    return horizontalSum(sum);
+}
+
+static inline bool anyGreater(const float* logits, float threshold) {
+    return _mm_movemask_ps(_mm_cmpgt_ps(_mm_loadu_ps(logits), _mm_set1_ps(threshold))) != 0;
+}
+
+const char* logitKernelName() {
+    return "sse2";
+}
+
+#elif defined(OWCAT_LOGIT_NEON)
+
+static constexpr size_t LANES = 4;
+
+static inline float32x4_t expVector(float32x4_t x) {
+    x = vminq_f32(vmaxq_f32(x, vdupq_n_f32(EXP_MIN)), vdupq_n_f32(EXP_MAX));
+    const float32x4_t n = vrndnq_f32(vmulq_f32(x, vdupq_n_f32(LOG2E)));
+    x = vfmsq_f32(x, n, vdupq_n_f32(LN2_HI));
+    x = vfmsq_f32(x, n, vdupq_n_f32(LN2_LO));
+
+    float32x4_t y = vdupq_n_f32(EXP_P0);
+    y = vfmaq_f32(vdupq_n_f32(EXP_P1), y, x);
+    y = vfmaq_f32(vdupq_n_f32(EXP_P2), y, x);
+    y = vfmaq_f32(vdupq_n_f32(EXP_P3), y, x);
+    y = vfmaq_f32(vdupq_n_f32(EXP_P4), y, x);
+    y = vfmaq_f32(vdupq_n_f32(EXP_P5), y, x);
+    y = vfmaq_f32(vaddq_f32(x, vdupq_n_f32(1.0f)), y, vmulq_f32(x, x));
+
+    int32x4_t exponent = vaddq_s32(vcvtq_s32_f32(n), vdupq_n_s32(127));
+    return vmulq_f32(y, vreinterpretq_f32_s32(vshlq_n_s32(exponent, 23)));
+}
+
+static float maxBlocks(const float* logits, size_t blocks) {
+    float32x4_t m = vld1q_f32(logits);
+    for (size_t b = 1; b < blocks; ++b) {
+        m = vmaxq_f32(m, vld1q_f32(logits + b * LANES));
+    }
+    return vmaxvq_f32(m);
+}
+
+static float sumExpBlocks(const float* logits, size_t blocks, float offset) {
+    const float32x4_t shift = vdupq_n_f32(offset);
+    float32x4_t sum = vdupq_n_f32(0.0f);
+    for (size_t b = 0; b < blocks; ++b) {
+        sum = vaddq_f32(sum, expVector(vsubq_f32(vld1q_f32(logits + b * LANES), shift)));
+    }
+    return vaddvq_f32(sum);
+}
+
+static inline bool anyGreater(const float* logits, float threshold) {
+    return vmaxvq_u32(vcgtq_f32(vld1q_f32(logits), vdupq_n_f32(threshold))) != 0;
+}
+
+const char* logitKernelName() {
+    return "neon";
+}
+
+#else
+
+static constexpr size_t LANES = 1;
+
+static float maxBlocks(const float* logits, size_t blocks) {
+    return *std::max_element(logits, logits + blocks);
+}
+
+static float sumExpBlocks(const float* logits, size_t blocks, float offset) {
+    float sum = 0.0f;
+    for (size_t i = 0; i < blocks; ++i) {
+        sum += std::exp(logits[i] - offset);
+    }
+    return sum;
+}
+
+static inline bool anyGreater(const float* logits, float threshold) {
+    return logits[0] > threshold;
+}
+
+const char* logitKernelName() {
+    return "scalar";
+}
+
+#endif
+
+float maxLogit(const float* logits, size_t size) {
+    const size_t blocks = size / LANES;
+    float max_val = blocks > 0 ? maxBlocks(logits, blocks) : logits[0];
+    for (size_t i = blocks * LANES; i < size; ++i) {
+        max_val = std::max(max_val, logits[i]);
+    }
+    return max_val;
+}
+
+float logSumExp(const float* logits, size_t size) {
+    const float max_val = maxLogit(logits, size);
+    if (!std::isfinite(max_val)) {
+        return max_val;
+    }
+
+    const size_t blocks = size / LANES;
+    float sum = blocks > 0 ? sumExpBlocks(logits, blocks, max_val) : 0.0f;
+    for (size_t i = blocks * LANES; i < size; ++i) {
+        sum += std::exp(logits[i] - max_val);
+    }
+    return max_val + std::log(sum);
+}
+
+static bool greaterLogit(const TokenLogit& a, const TokenLogit& b) {
+    return a.logit > b.logit;
+}
+
+size_t selectTopK(const float* logits, size_t size, size_t k, std::vector<TokenLogit>& out) {
+    out.clear();
+    if (k == 0 || k >= size) {
+        out.reserve(size);
+        for (size_t i = 0; i < size; ++i) {
+            out.push_back({static_cast<int32_t>(i), logits[i]});
+        }
+        return out.size();
+    }
+
+    const size_t limit = std::max(k * TOPK_BUFFER_FACTOR, TOPK_MIN_BUFFER);
+    out.reserve(limit + LANES);
+
+    // 门限为已保留的第k大logit，绝大多数块整体不超过门限，只需一次向量比较
+    float threshold = -std::numeric_limits<float>::infinity();
+    const size_t blocks = size / LANES;
+    for (size_t b = 0; b <= blocks; ++b) {
+        const size_t begin = b * LANES;
+        const size_t end = std::min(begin + LANES, size);
+        if (begin >= end || (b < blocks && !anyGreater(logits + begin, threshold))) {
+            continue;
+        }
+
+        for (size_t i = begin; i < end; ++i) {
+            if (logits[i] > threshold) {
+                out.push_back({static_cast<int32_t>(i), logits[i]});
+            }
+        }
+        if (out.size() >= limit) {
+            std::nth_element(out.begin(), out.begin() + (k - 1), out.end(), greaterLogit);
+            threshold = out[k - 1].logit;
+            out.resize(k);
+        }
+    }
+
+    return selectTopK(out, k);
+}
+
+size_t selectTopK(std::vector<TokenLogit>& items, size_t k) {
+    if (k > 0 && k < items.size()) {
+        std::nth_element(items.begin(), items.begin() + (k - 1), items.end(), greaterLogit);
+        items.resize(k);
+    }
+    std::sort(items.begin(), items.end(), greaterLogit);
+    return items.size();
+}
+
+} // namespace core
+} // namespace owcat
\ No newline at end of file
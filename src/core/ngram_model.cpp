@@ -0,0 +1,849 @@
+#include "core/ngram_model.h"
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <unordered_map>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace owcat {
+namespace core {
+
+namespace {
+
+// 对数概率量化刻度：q = ln(p) * LOG_PROB_SCALE，精度0.001
+constexpr float LOG_PROB_SCALE = 1000.0f;
+
+// 绝对折扣回退的折扣值
+constexpr double DISCOUNT = 0.5;
+
+// 有语料时一元概率中语料频率的权重，其余来自词典频率
+constexpr double CORPUS_WEIGHT = 0.5;
+
+// 词表外词比最低的一元概率再低的对数值
+constexpr double UNKNOWN_PENALTY = 1.0;
+
+// 正向最大匹配时候选词的最大字节数
+constexpr size_t MAX_MATCH_BYTES = 64;
+
+// 构建器中n-gram键的打包位宽，词表上限约两百万词
+constexpr uint32_t WORD_BITS = 21;
+constexpr uint32_t BUILDER_BOS = (1u << WORD_BITS) - 1;
+
+#pragma pack(push, 1)
+struct NgramHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t word_count;
+    uint32_t bigram_count;
+    uint32_t trigram_count;
+    uint32_t vocab_offset;              // uint32 offsets[word_count + 1] + 字符数据
+    uint32_t unigram_offset;            // NgramUnigramRecord[word_count + 1]，最后一项为句首标记
+    uint32_t bigram_index_offset;       // uint32[word_count + 2]，每个前词在二元表中的区间
+    uint32_t bigram_offset;             // NgramBigramRecord[bigram_count + 1]，末尾哨兵只提供三元区间终点
+    uint32_t trigram_offset;            // NgramTrigramRecord[trigram_count]
+    int32_t unknown_log_prob;           // 词表外词的量化对数概率
+    uint32_t file_size;
+};
+
+struct NgramUnigramRecord {
+    int16_t log_prob;
+    int16_t backoff;
+};
+
+struct NgramBigramRecord {
+    uint32_t word;                      // 后词
+    uint32_t trigram_begin;             // 以该二元组为前缀的三元组起点
+    int16_t log_prob;
+    int16_t backoff;
+};
+
+struct NgramTrigramRecord {
+    uint32_t word;
+    int16_t log_prob;
+    int16_t reserved;
+};
+#pragma pack(pop)
+
+static_assert(sizeof(NgramHeader) == 48, "unexpected n-gram header size");
+static_assert(sizeof(NgramUnigramRecord) == 4, "unexpected n-gram unigram size");
+static_assert(sizeof(NgramBigramRecord) == 12, "unexpected n-gram bigram size");
+static_assert(sizeof(NgramTrigramRecord) == 8, "unexpected n-gram trigram size");
+
+int16_t quantizeLogProb(double log_prob) {
+    double q = std::round(log_prob * LOG_PROB_SCALE);
+    return static_cast<int16_t>(std::max(-32767.0, std::min(q, 32767.0)));
+}
+
+size_t utf8Length(unsigned char lead) {
+    if (lead < 0x80) return 1;
+    if ((lead & 0xe0) == 0xc0) return 2;
+    if ((lead & 0xf0) == 0xe0) return 3;
+    if ((lead & 0xf8) == 0xf0) return 4;
+    return 1;
+}
+
+} // namespace
+
+// ---------------------------------------------------------------------------
+// NgramModel
+// ---------------------------------------------------------------------------
+
+class NgramModel::Impl {
+public:
+    Impl()
+        : data_(nullptr), size_(0), header_(nullptr), vocab_offsets_(nullptr), vocab_chars_(nullptr)
+        , unigrams_(nullptr), bigram_index_(nullptr), bigrams_(nullptr), trigrams_(nullptr)
+#ifdef _WIN32
+        , file_(INVALID_HANDLE_VALUE), mapping_(nullptr)
+#endif
+    {
+    }
+
+    ~Impl() {
+        close();
+    }
+
+    bool open(const std::string& path) {
+        close();
+
+        if (!mapFile(path)) {
+            return false;
+        }
+
+        if (!validate()) {
+            spdlog::error("Invalid n-gram model file: {}", path);
+            close();
+            return false;
+        }
+
+        spdlog::info("N-gram model mapped: {} ({} words, {} bigrams, {} trigrams, {} bytes)",
+                     path, header_->word_count, header_->bigram_count, header_->trigram_count, size_);
+        return true;
+    }
+
+    void close() {
+        unmapFile();
+        header_ = nullptr;
+        vocab_offsets_ = nullptr;
+        vocab_chars_ = nullptr;
+        unigrams_ = nullptr;
+        bigram_index_ = nullptr;
+        bigrams_ = nullptr;
+        trigrams_ = nullptr;
+    }
+
+    bool isOpen() const {
+        return header_ != nullptr;
+    }
+
+    std::string_view word(uint32_t id) const {
+        uint32_t begin = vocab_offsets_[id];
+        uint32_t end = vocab_offsets_[id + 1];
+        return std::string_view(vocab_chars_ + begin, end - begin);
+    }
+
+    uint32_t findWord(std::string_view text) const {
+        if (!isOpen() || text.empty()) {
+            return kNoWord;
+        }
+
+        uint32_t lo = 0;
+        uint32_t hi = header_->word_count;
+        while (lo < hi) {
+            uint32_t mid = lo + (hi - lo) / 2;
+            int cmp = word(mid).compare(text);
+            if (cmp == 0) {
+                return mid;
+            }
+            if (cmp < 0) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        return kNoWord;
+    }
+
+    uint32_t sentenceBegin() const {
+        return isOpen() ? header_->word_count : kNoWord;
+    }
+
+    const NgramBigramRecord* findBigram(uint32_t prev, uint32_t next) const {
+        uint32_t lo = bigram_index_[prev];
+        uint32_t hi = std::min(bigram_index_[prev + 1], header_->bigram_count);
+        while (lo < hi) {
+            uint32_t mid = lo + (hi - lo) / 2;
+            if (bigrams_[mid].word < next) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        return lo < std::min(bigram_index_[prev + 1], header_->bigram_count) && bigrams_[lo].word == next
+            ? &bigrams_[lo] : nullptr;
+    }
+
+    const NgramTrigramRecord* findTrigram(const NgramBigramRecord* prefix, uint32_t next) const {
+        // 哨兵记录保证prefix + 1总是有效
+        uint32_t lo = prefix->trigram_begin;
+        uint32_t end = std::min((prefix + 1)->trigram_begin, header_->trigram_count);
+        uint32_t hi = end;
+        while (lo < hi) {
+            uint32_t mid = lo + (hi - lo) / 2;
+            if (trigrams_[mid].word < next) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        return lo < end && trigrams_[lo].word == next ? &trigrams_[lo] : nullptr;
+    }
+
+    float logProb(uint32_t prev2, uint32_t prev1, uint32_t next) const {
+        if (!isOpen()) {
+            return 0.0f;
+        }
+        if (next >= header_->word_count) {
+            return header_->unknown_log_prob / LOG_PROB_SCALE;
+        }
+
+        // 上下文ID可以是句首标记
+        const uint32_t context_limit = header_->word_count;
+        int backoff = 0;
+
+        if (prev1 <= context_limit) {
+            if (prev2 <= context_limit) {
+                if (const NgramBigramRecord* history = findBigram(prev2, prev1)) {
+                    if (const NgramTrigramRecord* trigram = findTrigram(history, next)) {
+                        return trigram->log_prob / LOG_PROB_SCALE;
+                    }
+                    backoff += history->backoff;
+                }
+            }
+
+            if (const NgramBigramRecord* bigram = findBigram(prev1, next)) {
+                return (backoff + bigram->log_prob) / LOG_PROB_SCALE;
+            }
+            backoff += unigrams_[prev1].backoff;
+        }
+
+        return (backoff + unigrams_[next].log_prob) / LOG_PROB_SCALE;
+    }
+
+    size_t getWordCount() const {
+        return isOpen() ? header_->word_count : 0;
+    }
+
+    size_t getBigramCount() const {
+        return isOpen() ? header_->bigram_count : 0;
+    }
+
+    size_t getTrigramCount() const {
+        return isOpen() ? header_->trigram_count : 0;
+    }
+
+private:
+    bool mapFile(const std::string& path) {
+#ifdef _WIN32
+        file_ = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                            OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_RANDOM_ACCESS, nullptr);
+        if (file_ == INVALID_HANDLE_VALUE) {
+            spdlog::error("Failed to open n-gram model file: {}", path);
+            return false;
+        }
+
+        LARGE_INTEGER file_size;
+        if (!GetFileSizeEx(file_, &file_size) || file_size.QuadPart == 0) {
+            spdlog::error("Failed to get n-gram model file size: {}", path);
+            unmapFile();
+            return false;
+        }
+
+        mapping_ = CreateFileMappingA(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!mapping_) {
+            spdlog::error("Failed to create n-gram model file mapping: {}", path);
+            unmapFile();
+            return false;
+        }
+
+        data_ = MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0);
+        if (!data_) {
+            spdlog::error("Failed to map n-gram model file: {}", path);
+            unmapFile();
+            return false;
+        }
+        size_ = static_cast<size_t>(file_size.QuadPart);
+#else
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            spdlog::error("Failed to open n-gram model file: {}", path);
+            return false;
+        }
+
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size == 0) {
+            spdlog::error("Failed to get n-gram model file size: {}", path);
+            ::close(fd);
+            return false;
+        }
+
+        void* data = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (data == MAP_FAILED) {
+            spdlog::error("Failed to map n-gram model file: {}", path);
+            return false;
+        }
+
+        madvise(data, static_cast<size_t>(st.st_size), MADV_RANDOM);
+        data_ = data;
+        size_ = static_cast<size_t>(st.st_size);
+#endif
+        return true;
+    }
+
+    void unmapFile() {
+#ifdef _WIN32
+        if (data_) {
+            UnmapViewOfFile(data_);
+        }
+        if (mapping_) {
+            CloseHandle(mapping_);
+            mapping_ = nullptr;
+        }
+        if (file_ != INVALID_HANDLE_VALUE) {
+            CloseHandle(file_);
+            file_ = INVALID_HANDLE_VALUE;
+        }
+#else
+        if (data_) {
+            munmap(data_, size_);
+        }
+#endif
+        data_ = nullptr;
+        size_ = 0;
+    }
+
+    bool sectionInBounds(uint64_t offset, uint64_t length) const {
+        return offset % 4 == 0 && offset + length <= size_;
+    }
+
+    bool validate() {
+        if (size_ < sizeof(NgramHeader)) {
+            return false;
+        }
+
+        const auto* base = static_cast<const char*>(data_);
+        const auto* header = reinterpret_cast<const NgramHeader*>(base);
+        if (header->magic != kMagic || header->version != kVersion || header->file_size != size_) {
+            spdlog::error("N-gram model header mismatch (magic {:#x}, version {})", header->magic, header->version);
+            return false;
+        }
+
+        // 与Lexicon相同，只校验各段边界
+        const uint64_t words = header->word_count;
+        uint64_t vocab_offsets_size = (words + 1) * sizeof(uint32_t);
+        if (words == 0 || words >= kNoWord - 1 ||
+            !sectionInBounds(header->vocab_offset, vocab_offsets_size) ||
+            !sectionInBounds(header->unigram_offset, (words + 1) * sizeof(NgramUnigramRecord)) ||
+            !sectionInBounds(header->bigram_index_offset, (words + 2) * sizeof(uint32_t)) ||
+            !sectionInBounds(header->bigram_offset, (static_cast<uint64_t>(header->bigram_count) + 1) * sizeof(NgramBigramRecord)) ||
+            !sectionInBounds(header->trigram_offset, static_cast<uint64_t>(header->trigram_count) * sizeof(NgramTrigramRecord))) {
+            return false;
+        }
+
+        const auto* offsets = reinterpret_cast<const uint32_t*>(base + header->vocab_offset);
+        uint64_t chars_offset = header->vocab_offset + vocab_offsets_size;
+        if (chars_offset + offsets[words] > size_) {
+            return false;
+        }
+
+        header_ = header;
+        vocab_offsets_ = offsets;
+        vocab_chars_ = base + chars_offset;
+        unigrams_ = reinterpret_cast<const NgramUnigramRecord*>(base + header->unigram_offset);
+        bigram_index_ = reinterpret_cast<const uint32_t*>(base + header->bigram_index_offset);
+        bigrams_ = reinterpret_cast<const NgramBigramRecord*>(base + header->bigram_offset);
+        trigrams_ = reinterpret_cast<const NgramTrigramRecord*>(base + header->trigram_offset);
+        return true;
+    }
+
+private:
+    void* data_;
+    size_t size_;
+    const NgramHeader* header_;
+    const uint32_t* vocab_offsets_;
+    const char* vocab_chars_;
+    const NgramUnigramRecord* unigrams_;
+    const uint32_t* bigram_index_;
+    const NgramBigramRecord* bigrams_;
+    const NgramTrigramRecord* trigrams_;
+#ifdef _WIN32
+    HANDLE file_;
+    HANDLE mapping_;
+#endif
+};
+
+NgramModel::NgramModel()
+    : pImpl(std::make_unique<Impl>()) {
+}
+
+NgramModel::~NgramModel() = default;
+
+bool NgramModel::open(const std::string& path) {
+    return pImpl->open(path);
+}
+
+void NgramModel::close() {
+    pImpl->close();
+}
+
+bool NgramModel::isOpen() const {
+    return pImpl->isOpen();
+}
+
+uint32_t NgramModel::findWord(std::string_view text) const {
+    return pImpl->findWord(text);
+}
+
+uint32_t NgramModel::sentenceBegin() const {
+    return pImpl->sentenceBegin();
+}
+
+float NgramModel::logProb(uint32_t prev2, uint32_t prev1, uint32_t word) const {
+    return pImpl->logProb(prev2, prev1, word);
+}
+
+size_t NgramModel::getWordCount() const {
+    return pImpl->getWordCount();
+}
+
+size_t NgramModel::getBigramCount() const {
+    return pImpl->getBigramCount();
+}
+
+size_t NgramModel::getTrigramCount() const {
+    return pImpl->getTrigramCount();
+}
+
+// ---------------------------------------------------------------------------
+// NgramModelBuilder
+// ---------------------------------------------------------------------------
+
+class NgramModelBuilder::Impl {
+public:
+    Impl() : max_word_bytes_(0), token_count_(0) {}
+
+    bool addWord(const std::string& word, uint32_t frequency) {
+        if (word.empty() || !bigram_counts_.empty()) {
+            return false;
+        }
+
+        auto it = word_index_.find(word);
+        if (it != word_index_.end()) {
+            prior_counts_[it->second] += frequency;
+            return true;
+        }
+        if (words_.size() >= BUILDER_BOS) {
+            return false;
+        }
+
+        word_index_.emplace(word, static_cast<uint32_t>(words_.size()));
+        words_.push_back(word);
+        prior_counts_.push_back(frequency);
+        corpus_counts_.push_back(0);
+        max_word_bytes_ = std::min(MAX_MATCH_BYTES, std::max(max_word_bytes_, word.size()));
+        return true;
+    }
+
+    size_t addText(std::string_view line) {
+        size_t counted = 0;
+        uint32_t prev2 = BUILDER_BOS;
+        uint32_t prev1 = BUILDER_BOS;
+        bool has_prev2 = false;
+
+        auto resetContext = [&] {
+            prev1 = BUILDER_BOS;
+            has_prev2 = false;
+        };
+
+        auto count = [&](uint32_t word) {
+            ++corpus_counts_[word];
+            ++bigram_counts_[packBigram(prev1, word)];
+            if (has_prev2) {
+                ++trigram_counts_[packTrigram(prev2, prev1, word)];
+            }
+            prev2 = prev1;
+            prev1 = word;
+            has_prev2 = true;
+            ++counted;
+        };
+
+        size_t pos = 0;
+        while (pos < line.size()) {
+            size_t begin = line.find_first_not_of(" \t\r\n", pos);
+            if (begin == std::string_view::npos) {
+                break;
+            }
+            size_t end = line.find_first_of(" \t\r\n", begin);
+            if (end == std::string_view::npos) {
+                end = line.size();
+            }
+            pos = end;
+
+            // 已分词的词直接计数
+            lookup_key_.assign(line.data() + begin, end - begin);
+            auto it = word_index_.find(lookup_key_);
+            if (it != word_index_.end()) {
+                count(it->second);
+                continue;
+            }
+
+            // 未分词的文本：正向最大匹配
+            size_t offset = begin;
+            while (offset < end) {
+                size_t limit = std::min(end - offset, max_word_bytes_);
+                uint32_t matched = BUILDER_BOS;
+                size_t matched_length = 0;
+
+                // 在UTF-8字符边界上从长到短尝试
+                size_t boundary = 0;
+                boundaries_.clear();
+                while (boundary < limit) {
+                    boundary += utf8Length(static_cast<unsigned char>(line[offset + boundary]));
+                    if (boundary <= limit) {
+                        boundaries_.push_back(boundary);
+                    }
+                }
+                for (auto length = boundaries_.rbegin(); length != boundaries_.rend(); ++length) {
+                    lookup_key_.assign(line.data() + offset, *length);
+                    auto found = word_index_.find(lookup_key_);
+                    if (found != word_index_.end()) {
+                        matched = found->second;
+                        matched_length = *length;
+                        break;
+                    }
+                }
+
+                if (matched == BUILDER_BOS) {
+                    // 词表外的字符截断上下文
+                    resetContext();
+                    offset += utf8Length(static_cast<unsigned char>(line[offset]));
+                    continue;
+                }
+
+                count(matched);
+                offset += matched_length;
+            }
+        }
+
+        token_count_ += counted;
+        return counted;
+    }
+
+    bool write(const std::string& path) const {
+        const uint32_t word_count = static_cast<uint32_t>(words_.size());
+        if (word_count == 0) {
+            spdlog::error("N-gram model has no words");
+            return false;
+        }
+
+        // 词ID重排为有序词表中的下标，句首标记排在最后
+        std::vector<uint32_t> order(word_count);
+        for (uint32_t i = 0; i < word_count; ++i) {
+            order[i] = i;
+        }
+        std::sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b) {
+            return words_[a] < words_[b];
+        });
+        std::vector<uint32_t> remap(word_count);
+        for (uint32_t i = 0; i < word_count; ++i) {
+            remap[order[i]] = i;
+        }
+        auto mapWord = [&](uint32_t id) { return id == BUILDER_BOS ? word_count : remap[id]; };
+
+        // 一元概率：语料频率与词典频率插值，所有词都有非零概率
+        double prior_total = 0.0;
+        for (uint64_t count : prior_counts_) {
+            prior_total += std::max<uint64_t>(1, count);
+        }
+        const double corpus_weight = token_count_ > 0 ? CORPUS_WEIGHT : 0.0;
+        std::vector<double> unigram_probs(word_count);
+        double min_log_prob = 0.0;
+        for (uint32_t old_id = 0; old_id < word_count; ++old_id) {
+            double p = (1.0 - corpus_weight) * static_cast<double>(std::max<uint64_t>(1, prior_counts_[old_id])) / prior_total;
+            if (token_count_ > 0) {
+                p += corpus_weight * static_cast<double>(corpus_counts_[old_id]) / static_cast<double>(token_count_);
+            }
+            unigram_probs[remap[old_id]] = p;
+            min_log_prob = std::min(min_log_prob, std::log(p));
+        }
+
+        // 二元组按 (前词, 后词) 排序
+        struct Bigram {
+            uint32_t prev;
+            uint32_t next;
+            uint32_t count;
+        };
+        std::vector<Bigram> bigrams;
+        bigrams.reserve(bigram_counts_.size());
+        for (const auto& [key, count] : bigram_counts_) {
+            bigrams.push_back({mapWord(static_cast<uint32_t>(key >> WORD_BITS)),
+                               mapWord(static_cast<uint32_t>(key & BUILDER_BOS)), count});
+        }
+        std::sort(bigrams.begin(), bigrams.end(), [](const Bigram& a, const Bigram& b) {
+            return a.prev != b.prev ? a.prev < b.prev : a.next < b.next;
+        });
+
+        struct Trigram {
+            uint32_t prev2;
+            uint32_t prev1;
+            uint32_t next;
+            uint32_t count;
+        };
+        std::vector<Trigram> trigrams;
+        trigrams.reserve(trigram_counts_.size());
+        for (const auto& [key, count] : trigram_counts_) {
+            trigrams.push_back({mapWord(static_cast<uint32_t>(key >> (2 * WORD_BITS))),
+                                mapWord(static_cast<uint32_t>((key >> WORD_BITS) & BUILDER_BOS)),
+                                mapWord(static_cast<uint32_t>(key & BUILDER_BOS)), count});
+        }
+        std::sort(trigrams.begin(), trigrams.end(), [](const Trigram& a, const Trigram& b) {
+            if (a.prev2 != b.prev2) return a.prev2 < b.prev2;
+            if (a.prev1 != b.prev1) return a.prev1 < b.prev1;
+            return a.next < b.next;
+        });
+
+        // 二元区间索引与每个前词的频率合计
+        std::vector<uint32_t> bigram_index(word_count + 2, 0);
+        std::vector<uint64_t> history_totals(word_count + 1, 0);
+        for (const auto& bigram : bigrams) {
+            ++bigram_index[bigram.prev + 1];
+            history_totals[bigram.prev] += bigram.count;
+        }
+        for (uint32_t i = 1; i < bigram_index.size(); ++i) {
+            bigram_index[i] += bigram_index[i - 1];
+        }
+
+        auto findBigram = [&](uint32_t prev, uint32_t next) -> int64_t {
+            auto first = bigrams.begin() + bigram_index[prev];
+            auto last = bigrams.begin() + bigram_index[prev + 1];
+            auto it = std::lower_bound(first, last, next, [](const Bigram& b, uint32_t w) { return b.next < w; });
+            return it != last && it->next == next ? it - bigrams.begin() : -1;
+        };
+
+        // 二元条件概率与一元回退权重：alpha(h) = 剩余概率 / 未见后词的一元概率之和
+        std::vector<double> bigram_probs(bigrams.size());
+        std::vector<double> unigram_backoffs(word_count + 1, 1.0);
+        for (uint32_t prev = 0; prev <= word_count; ++prev) {
+            uint32_t begin = bigram_index[prev];
+            uint32_t end = bigram_index[prev + 1];
+            if (begin == end) {
+                continue;
+            }
+            double total = static_cast<double>(history_totals[prev]);
+            double seen_lower = 0.0;
+            for (uint32_t i = begin; i < end; ++i) {
+                bigram_probs[i] = (bigrams[i].count - DISCOUNT) / total;
+                seen_lower += unigram_probs[bigrams[i].next];
+            }
+            double left = DISCOUNT * (end - begin) / total;
+            unigram_backoffs[prev] = left / std::max(1e-9, 1.0 - seen_lower);
+        }
+
+        auto backedOffBigram = [&](uint32_t prev, uint32_t next) {
+            int64_t index = findBigram(prev, next);
+            return index >= 0 ? bigram_probs[index] : unigram_backoffs[prev] * unigram_probs[next];
+        };
+
+        // 三元条件概率与二元回退权重，三元组按前缀二元组分组
+        std::vector<uint32_t> trigram_begin(bigrams.size() + 1, 0);
+        std::vector<double> trigram_probs(trigrams.size());
+        std::vector<double> bigram_backoffs(bigrams.size(), 1.0);
+        for (size_t i = 0; i < trigrams.size(); ) {
+            size_t j = i;
+            uint64_t total = 0;
+            while (j < trigrams.size() && trigrams[j].prev2 == trigrams[i].prev2 && trigrams[j].prev1 == trigrams[i].prev1) {
+                total += trigrams[j].count;
+                ++j;
+            }
+
+            int64_t history = findBigram(trigrams[i].prev2, trigrams[i].prev1);
+            if (history < 0) {
+                spdlog::error("Trigram without its history bigram");
+                return false;
+            }
+
+            double seen_lower = 0.0;
+            for (size_t k = i; k < j; ++k) {
+                trigram_probs[k] = (trigrams[k].count - DISCOUNT) / static_cast<double>(total);
+                seen_lower += backedOffBigram(trigrams[k].prev1, trigrams[k].next);
+            }
+            double left = DISCOUNT * (j - i) / static_cast<double>(total);
+            bigram_backoffs[history] = left / std::max(1e-9, 1.0 - seen_lower);
+            trigram_begin[history + 1] = static_cast<uint32_t>(j - i);
+            i = j;
+        }
+        for (size_t i = 1; i < trigram_begin.size(); ++i) {
+            trigram_begin[i] += trigram_begin[i - 1];
+        }
+
+        // 组装各段
+        std::vector<uint32_t> vocab_offsets;
+        std::string vocab_chars;
+        vocab_offsets.reserve(word_count + 1);
+        for (uint32_t old_id : order) {
+            vocab_offsets.push_back(static_cast<uint32_t>(vocab_chars.size()));
+            vocab_chars += words_[old_id];
+        }
+        vocab_offsets.push_back(static_cast<uint32_t>(vocab_chars.size()));
+
+        std::vector<NgramUnigramRecord> unigram_records(word_count + 1);
+        for (uint32_t id = 0; id <= word_count; ++id) {
+            unigram_records[id].log_prob = id < word_count ? quantizeLogProb(std::log(unigram_probs[id])) : 0;
+            unigram_records[id].backoff = quantizeLogProb(std::log(unigram_backoffs[id]));
+        }
+
+        std::vector<NgramBigramRecord> bigram_records(bigrams.size() + 1);
+        for (size_t i = 0; i < bigrams.size(); ++i) {
+            bigram_records[i].word = bigrams[i].next;
+            bigram_records[i].trigram_begin = trigram_begin[i];
+            bigram_records[i].log_prob = quantizeLogProb(std::log(bigram_probs[i]));
+            bigram_records[i].backoff = quantizeLogProb(std::log(bigram_backoffs[i]));
+        }
+        bigram_records.back() = {NgramModel::kNoWord, trigram_begin.back(), 0, 0};
+
+        std::vector<NgramTrigramRecord> trigram_records(trigrams.size());
+        for (size_t i = 0; i < trigrams.size(); ++i) {
+            trigram_records[i].word = trigrams[i].next;
+            trigram_records[i].log_prob = quantizeLogProb(std::log(trigram_probs[i]));
+            trigram_records[i].reserved = 0;
+        }
+
+        auto align = [](uint64_t offset) { return (offset + 3) & ~static_cast<uint64_t>(3); };
+
+        NgramHeader header;
+        std::memset(&header, 0, sizeof(header));
+        header.magic = NgramModel::kMagic;
+        header.version = NgramModel::kVersion;
+        header.word_count = word_count;
+        header.bigram_count = static_cast<uint32_t>(bigrams.size());
+        header.trigram_count = static_cast<uint32_t>(trigrams.size());
+        header.unknown_log_prob = quantizeLogProb(min_log_prob - UNKNOWN_PENALTY);
+
+        uint64_t offset = align(sizeof(NgramHeader));
+        header.vocab_offset = static_cast<uint32_t>(offset);
+        offset = align(offset + vocab_offsets.size() * sizeof(uint32_t) + vocab_chars.size());
+        header.unigram_offset = static_cast<uint32_t>(offset);
+        offset = align(offset + unigram_records.size() * sizeof(NgramUnigramRecord));
+        header.bigram_index_offset = static_cast<uint32_t>(offset);
+        offset = align(offset + bigram_index.size() * sizeof(uint32_t));
+        header.bigram_offset = static_cast<uint32_t>(offset);
+        offset = align(offset + bigram_records.size() * sizeof(NgramBigramRecord));
+        header.trigram_offset = static_cast<uint32_t>(offset);
+        offset += trigram_records.size() * sizeof(NgramTrigramRecord);
+
+        if (offset > 0xffffffffu) {
+            spdlog::error("N-gram model too large: {} bytes", offset);
+            return false;
+        }
+        header.file_size = static_cast<uint32_t>(offset);
+
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            spdlog::error("Failed to create n-gram model file: {}", path);
+            return false;
+        }
+
+        auto pad = [&file](uint64_t target) {
+            static const char zeros[4] = {0, 0, 0, 0};
+            uint64_t current = static_cast<uint64_t>(file.tellp());
+            if (target > current) {
+                file.write(zeros, static_cast<std::streamsize>(target - current));
+            }
+        };
+
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        pad(header.vocab_offset);
+        file.write(reinterpret_cast<const char*>(vocab_offsets.data()), vocab_offsets.size() * sizeof(uint32_t));
+        file.write(vocab_chars.data(), vocab_chars.size());
+        pad(header.unigram_offset);
+        file.write(reinterpret_cast<const char*>(unigram_records.data()), unigram_records.size() * sizeof(NgramUnigramRecord));
+        pad(header.bigram_index_offset);
+        file.write(reinterpret_cast<const char*>(bigram_index.data()), bigram_index.size() * sizeof(uint32_t));
+        pad(header.bigram_offset);
+        file.write(reinterpret_cast<const char*>(bigram_records.data()), bigram_records.size() * sizeof(NgramBigramRecord));
+        pad(header.trigram_offset);
+        file.write(reinterpret_cast<const char*>(trigram_records.data()), trigram_records.size() * sizeof(NgramTrigramRecord));
+
+        if (!file.good()) {
+            spdlog::error("Failed to write n-gram model file: {}", path);
+            return false;
+        }
+
+        spdlog::info("Wrote n-gram model {}: {} words, {} bigrams, {} trigrams from {} tokens, {} bytes",
+                     path, word_count, bigrams.size(), trigrams.size(), token_count_, offset);
+        return true;
+    }
+
+private:
+    static uint64_t packBigram(uint32_t prev, uint32_t next) {
+        return (static_cast<uint64_t>(prev) << WORD_BITS) | next;
+    }
+
+    static uint64_t packTrigram(uint32_t prev2, uint32_t prev1, uint32_t next) {
+        return (static_cast<uint64_t>(prev2) << (2 * WORD_BITS)) | (static_cast<uint64_t>(prev1) << WORD_BITS) | next;
+    }
+
+public:
+    std::vector<std::string> words_;
+    std::unordered_map<std::string, uint32_t> word_index_;
+    std::vector<uint64_t> prior_counts_;
+    std::vector<uint64_t> corpus_counts_;
+    std::unordered_map<uint64_t, uint32_t> bigram_counts_;
+    std::unordered_map<uint64_t, uint32_t> trigram_counts_;
+    size_t max_word_bytes_;
+    uint64_t token_count_;
+
+    // addText的临时缓冲区
+    std::string lookup_key_;
+    std::vector<size_t> boundaries_;
+};
+
+NgramModelBuilder::NgramModelBuilder()
+    : pImpl(std::make_unique<Impl>()) {
+}
+
+NgramModelBuilder::~NgramModelBuilder() = default;
+
+bool NgramModelBuilder::addWord(const std::string& word, uint32_t frequency) {
+    return pImpl->addWord(word, frequency);
+}
+
+size_t NgramModelBuilder::addText(std::string_view line) {
+    return pImpl->addText(line);
+}
+
+size_t NgramModelBuilder::getWordCount() const {
+    return pImpl->words_.size();
+}
+
+uint64_t NgramModelBuilder::getTokenCount() const {
+    return pImpl->token_count_;
+}
+
+bool NgramModelBuilder::write(const std::string& path) const {
+    return pImpl->write(path);
+}
+
+} // namespace core
+} // namespace owcat
\ No newline at end of file
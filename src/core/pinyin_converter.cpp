@@ -3,6 +3,7 @@
 #include <algorithm>
 #include <fstream>
 #include <sstream>
+#include <cmath>
 
 namespace owcat {
 namespace core {
@@ -34,11 +35,25 @@ static const std::vector<std::string> STANDARD_PINYINS = {
     "za", "zai", "zan", "zang", "zao", "ze", "zei", "zen", "zeng", "zha", "zhai", "zhan", "zhang", "zhao", "zhe", "zhen", "zheng", "zhi", "zhong", "zhou", "zhu", "zhua", "zhuai", "zhuan", "zhuang", "zhui", "zhun", "zhuo", "zi", "zong", "zou", "zu", "zuan", "zui", "zun", "zuo"
 };
 
-PinyinConverter::PinyinConverter() {
-    // 初始化有效字符映射
-    for (char c = 'a'; c <= 'z'; ++c) {
-        valid_chars_[c] = true;
-    }
+// 末尾未完整音节的额外惩罚（对数概率）
+static constexpr float PARTIAL_SYLLABLE_PENALTY = -2.0f;
+
+// 简拼音节的额外惩罚，使完整音节的分割优先
+static constexpr float ABBREVIATED_SYLLABLE_PENALTY = -3.0f;
+
+// 可作简拼音节的声母
+static const char* const INITIALS[] = {
+    "b", "p", "m", "f", "d", "t", "n", "l", "g", "k", "h", "j", "q", "x",
+    "zh", "ch", "sh", "r", "z", "c", "s", "y", "w"
+};
+
+PinyinConverter::PinyinConverter() : abbreviation_enabled_(true) {
+    // 预留按键状态栈和分割网格，避免输入过程中重新分配
+    match_states_.reserve(64);
+    lattice_.reserve(64);
+    current_pinyin_.reserve(64);
+    double_pinyin_keys_.reserve(64);
+    double_pinyin_syllables_.reserve(32);
 }
 
 PinyinConverter::~PinyinConverter() = default;
@@ -51,61 +66,273 @@ bool PinyinConverter::initialize() {
         return false;
     }
     
-    spdlog::info("Pinyin converter initialized with {} valid pinyins", valid_pinyins_.size());
+    spdlog::info("Pinyin converter initialized with {} valid pinyins, {} trie nodes",
+                 valid_pinyins_.size(), trie_nodes_.size());
     return true;
 }
 
 bool PinyinConverter::loadPinyinData() {
-    // 加载标准拼音表
+    // 加载标准拼音表，字典树要求音节有序
     valid_pinyins_ = STANDARD_PINYINS;
+    std::sort(valid_pinyins_.begin(), valid_pinyins_.end());
+    valid_pinyins_.erase(std::unique(valid_pinyins_.begin(), valid_pinyins_.end()), valid_pinyins_.end());
     
-    // 构建拼音映射表
-    pinyin_map_.clear();
-    for (const auto& pinyin : valid_pinyins_) {
-        pinyin_map_[pinyin] = true;
-    }
+    buildSyllableTrie();
+    clear();
     
     return true;
 }
 
-bool PinyinConverter::addChar(char ch) {
-    // 检查字符是否有效
-    if (valid_chars_.find(ch) == valid_chars_.end()) {
+void PinyinConverter::buildSyllableTrie() {
+    trie_nodes_.clear();
+    
+    auto new_node = [this](uint16_t range_begin) {
+        TrieNode node;
+        std::fill(std::begin(node.children), std::end(node.children), static_cast<int16_t>(-1));
+        node.syllable_id = -1;
+        node.depth = 0;
+        node.is_initial = false;
+        node.range_begin = range_begin;
+        node.range_end = range_begin;
+        trie_nodes_.push_back(node);
+        return static_cast<int16_t>(trie_nodes_.size() - 1);
+    };
+    
+    new_node(0);
+    
+    for (size_t id = 0; id < valid_pinyins_.size(); ++id) {
+        const std::string& syllable = valid_pinyins_[id];
+        int16_t node = 0;
+        trie_nodes_[node].range_end = static_cast<uint16_t>(id + 1);
+        
+        for (char c : syllable) {
+            int index = c - 'a';
+            if (index < 0 || index >= 26) {
+                spdlog::warn("Skipping invalid character in syllable: {}", syllable);
+                break;
+            }
+            
+            int16_t child = trie_nodes_[node].children[index];
+            if (child < 0) {
+                child = new_node(static_cast<uint16_t>(id));
+                trie_nodes_[child].depth = static_cast<uint8_t>(trie_nodes_[node].depth + 1);
+                trie_nodes_[node].children[index] = child;
+            }
+            
+            // 音节有序，因此子树区间只需向后扩展
+            node = child;
+            trie_nodes_[node].range_end = static_cast<uint16_t>(id + 1);
+        }
+        
+        trie_nodes_[node].syllable_id = static_cast<int16_t>(id);
+    }
+    
+    for (const char* initial : INITIALS) {
+        int node = findNode(initial);
+        if (node > 0) {
+            trie_nodes_[node].is_initial = true;
+        }
+    }
+}
+
+int PinyinConverter::findNode(std::string_view text) const {
+    if (trie_nodes_.empty()) {
+        return -1;
+    }
+    
+    int node = 0;
+    for (char c : text) {
+        int index = c - 'a';
+        if (index < 0 || index >= 26) {
+            return -1;
+        }
+        
+        node = trie_nodes_[node].children[index];
+        if (node < 0) {
+            return -1;
+        }
+    }
+    
+    return node;
+}
+
+bool PinyinConverter::advanceState(const MatchState& state, char ch, MatchState& next) const {
+    next.count = 0;
+    
+    int index = ch - 'a';
+    if (index < 0 || index >= 26) {
         return false;
     }
     
-    // 添加字符到缓冲区
-    std::string test_pinyin = current_pinyin_ + ch;
+    auto push = [&next](int16_t node) {
+        for (uint8_t i = 0; i < next.count; ++i) {
+            if (next.nodes[i] == node) {
+                return;
+            }
+        }
+        if (next.count < kMaxActiveNodes) {
+            next.nodes[next.count++] = node;
+        }
+    };
     
-    // 检查是否有以此开头的有效拼音
-    bool has_valid_prefix = false;
-    for (const auto& pinyin : valid_pinyins_) {
-        if (pinyin.length() >= test_pinyin.length() && 
-            pinyin.substr(0, test_pinyin.length()) == test_pinyin) {
-            has_valid_prefix = true;
-            break;
+    for (uint8_t i = 0; i < state.count; ++i) {
+        const TrieNode& node = trie_nodes_[state.nodes[i]];
+        
+        // 在当前音节内继续
+        if (node.children[index] >= 0) {
+            push(node.children[index]);
+        }
+        
+        // 当前音节已完整（或作为简拼结束），从根节点开始下一个音节
+        const bool can_end = node.syllable_id >= 0 || (abbreviation_enabled_ && node.is_initial);
+        if (can_end && trie_nodes_[0].children[index] >= 0) {
+            push(trie_nodes_[0].children[index]);
         }
     }
     
-    if (has_valid_prefix) {
-        current_pinyin_ += ch;
-        return true;
+    return next.count > 0;
+}
+
+bool PinyinConverter::addChar(char ch) {
+    if (double_pinyin_.isLoaded()) {
+        return addDoublePinyinKey(ch);
+    }
+    
+    if (match_states_.empty()) {
+        return false;
     }
     
-    return false;
+    // 检查是否存在以此结尾的有效拼音前缀序列
+    MatchState next;
+    if (!advanceState(match_states_.back(), ch, next)) {
+        return false;
+    }
+    
+    LatticeColumn column;
+    extendLattice(next, column);
+    
+    current_pinyin_ += ch;
+    match_states_.push_back(next);
+    lattice_.push_back(column);
+    return true;
+}
+
+void PinyinConverter::extendLattice(const MatchState& state, LatticeColumn& column) const {
+    column.count = 0;
+    
+    // 新列的位置，等于加入新字符后的拼音长度
+    const size_t end = current_pinyin_.length() + 1;
+    
+    for (uint8_t i = 0; i < state.count; ++i) {
+        const TrieNode& node = trie_nodes_[state.nodes[i]];
+        
+        // 以完整音节或简拼结尾的边：[end - depth, end)
+        int16_t syllable_id;
+        float edge_score;
+        if (node.syllable_id >= 0) {
+            syllable_id = node.syllable_id;
+            edge_score = syllableLogProb(node.syllable_id);
+        } else if (abbreviation_enabled_ && node.is_initial) {
+            syllable_id = kAbbreviatedSyllable;
+            edge_score = syllableLogProb(-1) + ABBREVIATED_SYLLABLE_PENALTY;
+        } else {
+            continue;
+        }
+        
+        const size_t start = end - node.depth;
+        const LatticeColumn& from = lattice_[start];
+        
+        for (uint8_t rank = 0; rank < from.count; ++rank) {
+            const float score = from.entries[rank].score + edge_score;
+            
+            // 插入到有序的前N条路径中
+            size_t pos = column.count;
+            while (pos > 0 && column.entries[pos - 1].score < score) {
+                --pos;
+            }
+            if (pos >= kMaxLatticePaths) {
+                break; // 之后的路径得分只会更低
+            }
+            
+            size_t last = std::min<size_t>(column.count, kMaxLatticePaths - 1);
+            for (size_t j = last; j > pos; --j) {
+                column.entries[j] = column.entries[j - 1];
+            }
+            column.entries[pos] = {score, static_cast<uint16_t>(start), rank, syllable_id};
+            if (column.count < kMaxLatticePaths) {
+                ++column.count;
+            }
+        }
+    }
+}
+
+bool PinyinConverter::addDoublePinyinKey(char key) {
+    // 偶数个按键时开始新音节，否则与上一个键组成音节
+    if (double_pinyin_keys_.size() % 2 == 0) {
+        if (!double_pinyin_.isFirstKey(key)) {
+            return false;
+        }
+        current_pinyin_.append(double_pinyin_.getPrefix(key));
+    } else {
+        int id = double_pinyin_.decode(double_pinyin_keys_.back(), key);
+        if (id < 0) {
+            return false;
+        }
+        current_pinyin_.resize(current_pinyin_.size() - double_pinyin_.getPrefix(double_pinyin_keys_.back()).size());
+        current_pinyin_ += valid_pinyins_[id];
+        double_pinyin_syllables_.push_back(static_cast<uint16_t>(id));
+    }
+    
+    double_pinyin_keys_ += key;
+    return true;
 }
 
 bool PinyinConverter::removeLastChar() {
+    if (double_pinyin_.isLoaded()) {
+        if (double_pinyin_keys_.empty()) {
+            return false;
+        }
+        
+        // 删除第二个键时音节退回为只输入了第一个键
+        if (double_pinyin_keys_.size() % 2 == 0) {
+            current_pinyin_.resize(current_pinyin_.size() - valid_pinyins_[double_pinyin_syllables_.back()].size());
+            current_pinyin_.append(double_pinyin_.getPrefix(double_pinyin_keys_[double_pinyin_keys_.size() - 2]));
+            double_pinyin_syllables_.pop_back();
+        } else {
+            current_pinyin_.resize(current_pinyin_.size() - double_pinyin_.getPrefix(double_pinyin_keys_.back()).size());
+        }
+        double_pinyin_keys_.pop_back();
+        return true;
+    }
+    
     if (current_pinyin_.empty()) {
         return false;
     }
     
     current_pinyin_.pop_back();
+    match_states_.pop_back();
+    lattice_.pop_back();
     return true;
 }
 
 void PinyinConverter::clear() {
     current_pinyin_.clear();
+    match_states_.clear();
+    lattice_.clear();
+    double_pinyin_keys_.clear();
+    double_pinyin_syllables_.clear();
+    
+    if (!trie_nodes_.empty()) {
+        MatchState root;
+        root.count = 1;
+        root.nodes[0] = 0;
+        match_states_.push_back(root);
+        
+        LatticeColumn origin;
+        origin.count = 1;
+        origin.entries[0] = {0.0f, 0, 0, -1};
+        lattice_.push_back(origin);
+    }
 }
 
 const std::string& PinyinConverter::getCurrentPinyin() const {
@@ -115,67 +342,241 @@ const std::string& PinyinConverter::getCurrentPinyin() const {
 std::vector<std::vector<std::string>> PinyinConverter::getPinyinSegments() const {
     std::vector<std::vector<std::string>> results;
     
-    if (current_pinyin_.empty()) {
+    for (auto& segmentation : getBestSegmentations(kMaxLatticePaths)) {
+        if (segmentation.complete) {
+            results.push_back(std::move(segmentation.syllables));
+        }
+    }
+    
+    return results;
+}
+
+std::vector<PinyinSegmentation> PinyinConverter::getBestSegmentations(size_t max_paths) const {
+    std::vector<PinyinSegmentation> results;
+    
+    if (double_pinyin_.isLoaded()) {
+        if (!double_pinyin_keys_.empty() && max_paths > 0) {
+            results.push_back(getDoublePinyinSegmentation());
+        }
         return results;
     }
     
-    std::vector<std::string> current;
-    segmentPinyinRecursive(current_pinyin_, 0, current, results);
+    if (current_pinyin_.empty() || lattice_.size() != current_pinyin_.length() + 1) {
+        return results;
+    }
+    
+    max_paths = std::min(max_paths, kMaxLatticePaths);
+    
+    // 路径终点：最后一列的完整路径，或末尾为未完整音节的路径
+    struct PathEnd {
+        float score;
+        uint16_t pos;
+        uint8_t rank;
+        uint8_t partial_length;
+    };
+    
+    const size_t end = current_pinyin_.length();
+    std::vector<PathEnd> ends;
+    
+    // 末尾的简拼与未完整音节是同一段输入，只保留后者
+    const LatticeColumn& last = lattice_[end];
+    for (uint8_t rank = 0; rank < last.count; ++rank) {
+        if (last.entries[rank].syllable_id != kAbbreviatedSyllable) {
+            ends.push_back({last.entries[rank].score, static_cast<uint16_t>(end), rank, 0});
+        }
+    }
+    
+    const MatchState& state = match_states_.back();
+    for (uint8_t i = 0; i < state.count; ++i) {
+        const TrieNode& node = trie_nodes_[state.nodes[i]];
+        if (node.syllable_id >= 0) {
+            continue;
+        }
+        
+        const size_t start = end - node.depth;
+        const LatticeColumn& from = lattice_[start];
+        const float edge_score = syllableLogProb(-1) + PARTIAL_SYLLABLE_PENALTY;
+        for (uint8_t rank = 0; rank < from.count; ++rank) {
+            ends.push_back({from.entries[rank].score + edge_score, static_cast<uint16_t>(start), rank, node.depth});
+        }
+    }
+    
+    std::sort(ends.begin(), ends.end(), [](const PathEnd& a, const PathEnd& b) {
+        return a.score > b.score;
+    });
+    if (ends.size() > max_paths) {
+        ends.resize(max_paths);
+    }
+    
+    // 回溯每条路径
+    for (const auto& path_end : ends) {
+        PinyinSegmentation segmentation;
+        segmentation.score = path_end.score;
+        segmentation.complete = path_end.partial_length == 0;
+        
+        if (!segmentation.complete) {
+            segmentation.syllables.push_back(current_pinyin_.substr(path_end.pos, path_end.partial_length));
+            segmentation.syllable_ids.push_back(-1);
+        }
+        
+        size_t pos = path_end.pos;
+        size_t rank = path_end.rank;
+        while (pos > 0) {
+            const LatticeEntry& entry = lattice_[pos].entries[rank];
+            if (entry.syllable_id == kAbbreviatedSyllable) {
+                segmentation.syllables.push_back(current_pinyin_.substr(entry.prev_pos, pos - entry.prev_pos));
+                segmentation.syllable_ids.push_back(-1);
+                segmentation.complete = false;
+            } else {
+                segmentation.syllables.push_back(valid_pinyins_[entry.syllable_id]);
+                segmentation.syllable_ids.push_back(entry.syllable_id);
+            }
+            pos = entry.prev_pos;
+            rank = entry.prev_rank;
+        }
+        
+        std::reverse(segmentation.syllables.begin(), segmentation.syllables.end());
+        std::reverse(segmentation.syllable_ids.begin(), segmentation.syllable_ids.end());
+        results.push_back(std::move(segmentation));
+    }
     
     return results;
 }
 
-void PinyinConverter::segmentPinyinRecursive(
-    const std::string& pinyin,
-    size_t start,
-    std::vector<std::string>& current,
-    std::vector<std::vector<std::string>>& results
-) const {
-    if (start >= pinyin.length()) {
-        if (!current.empty()) {
-            results.push_back(current);
-        }
+PinyinSegmentation PinyinConverter::getDoublePinyinSegmentation() const {
+    PinyinSegmentation segmentation;
+    segmentation.syllables.reserve(double_pinyin_syllables_.size() + 1);
+    segmentation.syllable_ids.reserve(double_pinyin_syllables_.size() + 1);
+    
+    for (uint16_t id : double_pinyin_syllables_) {
+        segmentation.syllables.push_back(valid_pinyins_[id]);
+        segmentation.syllable_ids.push_back(id);
+        segmentation.score += syllableLogProb(id);
+    }
+    
+    // 末尾只输入了第一个键，以其声母作为未完整的音节
+    if (double_pinyin_keys_.size() % 2 == 1) {
+        segmentation.syllables.emplace_back(double_pinyin_.getPrefix(double_pinyin_keys_.back()));
+        segmentation.syllable_ids.push_back(-1);
+        segmentation.score += syllableLogProb(-1) + PARTIAL_SYLLABLE_PENALTY;
+        segmentation.complete = false;
+    }
+    
+    return segmentation;
+}
+
+void PinyinConverter::setSyllableLogProbs(const std::vector<float>& log_probs) {
+    if (!log_probs.empty() && log_probs.size() != valid_pinyins_.size()) {
+        spdlog::warn("Syllable log-prob table size {} does not match syllable count {}",
+                     log_probs.size(), valid_pinyins_.size());
         return;
     }
     
-    // 尝试不同长度的拼音
-    for (size_t len = 1; len <= pinyin.length() - start; ++len) {
-        std::string segment = pinyin.substr(start, len);
-        
-        if (isValidPinyin(segment)) {
-            current.push_back(segment);
-            segmentPinyinRecursive(pinyin, start + len, current, results);
-            current.pop_back();
+    syllable_log_probs_ = log_probs;
+    
+    // 用新的得分重建当前输入的分割网格
+    rebuild();
+}
+
+void PinyinConverter::setAbbreviationEnabled(bool enabled) {
+    if (abbreviation_enabled_ == enabled) {
+        return;
+    }
+    abbreviation_enabled_ = enabled;
+    
+    // 重建当前输入的分割网格，关闭后不能再分割的字符被丢弃
+    rebuild();
+}
+
+bool PinyinConverter::setDoublePinyinScheme(std::string_view scheme) {
+    if (scheme == double_pinyin_.getName()) {
+        return true;
+    }
+    
+    if (scheme.empty()) {
+        double_pinyin_.clear();
+    } else if (!double_pinyin_.load(scheme, valid_pinyins_)) {
+        return false;
+    }
+    
+    // 同一按键在两种输入方式下含义不同，已有输入作废
+    clear();
+    return true;
+}
+
+bool PinyinConverter::isDoublePinyin() const {
+    return double_pinyin_.isLoaded();
+}
+
+void PinyinConverter::rebuild() {
+    std::string input = double_pinyin_.isLoaded() ? double_pinyin_keys_ : current_pinyin_;
+    clear();
+    for (char ch : input) {
+        if (!addChar(ch)) {
+            break;
         }
     }
 }
 
+float PinyinConverter::syllableLogProb(int syllable_id) const {
+    if (syllable_id >= 0 && static_cast<size_t>(syllable_id) < syllable_log_probs_.size()) {
+        return syllable_log_probs_[syllable_id];
+    }
+    
+    // 均匀分布：音节越少的分割得分越高
+    return -std::log(static_cast<float>(std::max<size_t>(1, valid_pinyins_.size())));
+}
+
 bool PinyinConverter::isValidPinyin(const std::string& pinyin) const {
-    return pinyin_map_.find(pinyin) != pinyin_map_.end();
+    return getSyllableId(pinyin) >= 0;
 }
 
 std::vector<std::string> PinyinConverter::getPinyinPrefixes(const std::string& pinyin) const {
     std::vector<std::string> prefixes;
     
-    for (const auto& valid_pinyin : valid_pinyins_) {
-        if (valid_pinyin.length() >= pinyin.length() && 
-            valid_pinyin.substr(0, pinyin.length()) == pinyin) {
-            prefixes.push_back(valid_pinyin);
-        }
+    int node = findNode(pinyin);
+    if (node < 0) {
+        return prefixes;
     }
     
+    // 子树中的音节在有序表中连续
+    const TrieNode& found = trie_nodes_[node];
+    prefixes.assign(valid_pinyins_.begin() + found.range_begin, valid_pinyins_.begin() + found.range_end);
+    
     return prefixes;
 }
 
+int PinyinConverter::getSyllableId(std::string_view syllable) const {
+    if (syllable.empty()) {
+        return -1;
+    }
+    
+    int node = findNode(syllable);
+    return node < 0 ? -1 : trie_nodes_[node].syllable_id;
+}
+
+const std::string& PinyinConverter::getSyllable(int syllable_id) const {
+    static const std::string empty;
+    if (syllable_id < 0 || static_cast<size_t>(syllable_id) >= valid_pinyins_.size()) {
+        return empty;
+    }
+    return valid_pinyins_[syllable_id];
+}
+
+size_t PinyinConverter::getSyllableCount() const {
+    return valid_pinyins_.size();
+}
+
 std::string PinyinConverter::normalizePinyin(const std::string& pinyin) const {
     std::string normalized = pinyin;
     
     // 转换为小写
-    std::transform(normalized.begin(), normalized.end(), normalized.begin(), ::tolower);
+    std::transform(normalized.begin(), normalized.end(), normalized.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
     
-    // 移除特殊字符（如果有的话）
+    // 移除特殊字符（如果有的话），UTF-8多字节字符按无符号处理
     normalized.erase(std::remove_if(normalized.begin(), normalized.end(), 
-                                   [](char c) { return !std::isalpha(c); }), 
+                                   [](unsigned char c) { return !std::isalpha(c); }), 
                     normalized.end());
     
     return normalized;
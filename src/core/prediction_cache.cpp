@@ -0,0 +1,204 @@
+#include "core/prediction_cache.h"
+#include <spdlog/spdlog.h>
+#include <nlohmann/json.hpp>
+#include <fstream>
+
+namespace owcat {
+namespace core {
+
+// 持久化文件格式版本
+static constexpr int CACHE_FILE_VERSION = 1;
+
+PredictionCache::PredictionCache(size_t capacity)
+    : capacity_(capacity), dirty_(false), hits_(0), misses_(0) {
+}
+
+void PredictionCache::setCapacity(size_t capacity) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    capacity_ = capacity;
+    evictLocked();
+}
+
+uint64_t PredictionCache::hashKey(const std::string& pinyin, const std::string& context, int max_results) {
+    // FNV-1a，各字段之间插入分隔符避免拼接歧义
+    uint64_t hash = 14695981039346656037ull;
+    auto mix = [&hash](unsigned char byte) {
+        hash ^= byte;
+        hash *= 1099511628211ull;
+    };
+    for (char ch : pinyin) {
+        mix(static_cast<unsigned char>(ch));
+    }
+    mix(0x1f);
+    for (char ch : context) {
+        mix(static_cast<unsigned char>(ch));
+    }
+    mix(0x1f);
+    for (int shift = 0; shift < 32; shift += 8) {
+        mix(static_cast<unsigned char>(static_cast<uint32_t>(max_results) >> shift));
+    }
+    return hash;
+}
+
+bool PredictionCache::lookup(const std::string& pinyin, const std::string& context, int max_results,
+                             std::vector<CachedPrediction>& results) {
+    const uint64_t key = hashKey(pinyin, context, max_results);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = index_.find(key);
+    if (it == index_.end() || it->second->max_results != max_results ||
+        it->second->pinyin != pinyin || it->second->context != context) {
+        ++misses_;
+        return false;
+    }
+
+    entries_.splice(entries_.begin(), entries_, it->second);
+    results = it->second->results;
+    ++hits_;
+    return true;
+}
+
+void PredictionCache::insert(const std::string& pinyin, const std::string& context, int max_results,
+                             std::vector<CachedPrediction> results) {
+    Entry entry;
+    entry.key = hashKey(pinyin, context, max_results);
+    entry.pinyin = pinyin;
+    entry.context = context;
+    entry.max_results = max_results;
+    entry.results = std::move(results);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (capacity_ == 0) {
+        return;
+    }
+    insertLocked(std::move(entry));
+    dirty_ = true;
+}
+
+void PredictionCache::insertLocked(Entry entry) {
+    // 同键（包括哈希冲突的不同键）直接替换
+    auto it = index_.find(entry.key);
+    if (it != index_.end()) {
+        entries_.erase(it->second);
+        index_.erase(it);
+    }
+
+    const uint64_t key = entry.key;
+    entries_.push_front(std::move(entry));
+    index_[key] = entries_.begin();
+    evictLocked();
+}
+
+void PredictionCache::evictLocked() {
+    while (entries_.size() > capacity_) {
+        index_.erase(entries_.back().key);
+        entries_.pop_back();
+        dirty_ = true;
+    }
+}
+
+void PredictionCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    dirty_ = dirty_ || !entries_.empty();
+    entries_.clear();
+    index_.clear();
+}
+
+bool PredictionCache::load(const std::string& path, const std::string& model_id) {
+    std::ifstream file(path);
+    if (!file.good()) {
+        return false;
+    }
+
+    nlohmann::json data = nlohmann::json::parse(file, nullptr, false);
+    if (!data.is_object() || data.value("version", 0) != CACHE_FILE_VERSION ||
+        data.value("model", std::string()) != model_id) {
+        spdlog::info("Discarding prediction cache {} written for a different model", path);
+        return false;
+    }
+
+    auto entries = data.find("entries");
+    if (entries == data.end() || !entries->is_array()) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_.clear();
+    index_.clear();
+
+    try {
+        // 文件中按最久未用到最近使用的顺序保存，依次插入后恢复原有的使用顺序
+        for (const auto& item : *entries) {
+            Entry entry;
+            entry.pinyin = item.at("pinyin").get<std::string>();
+            entry.context = item.at("context").get<std::string>();
+            entry.max_results = item.at("max_results").get<int>();
+            entry.key = hashKey(entry.pinyin, entry.context, entry.max_results);
+            for (const auto& result : item.at("results")) {
+                entry.results.emplace_back(result.at("text").get<std::string>(), result.at("pinyin").get<std::string>());
+            }
+            insertLocked(std::move(entry));
+        }
+    } catch (const nlohmann::json::exception& e) {
+        spdlog::warn("Prediction cache {} is corrupted: {}", path, e.what());
+        entries_.clear();
+        index_.clear();
+        return false;
+    }
+
+    dirty_ = false;
+    spdlog::info("Loaded {} cached predictions from {}", entries_.size(), path);
+    return true;
+}
+
+bool PredictionCache::save(const std::string& path, const std::string& model_id) {
+    nlohmann::json data;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!dirty_) {
+            return true;
+        }
+
+        nlohmann::json entries = nlohmann::json::array();
+        for (auto it = entries_.rbegin(); it != entries_.rend(); ++it) {
+            nlohmann::json results = nlohmann::json::array();
+            for (const auto& result : it->results) {
+                results.push_back({{"text", result.text}, {"pinyin", result.pinyin}});
+            }
+            entries.push_back({
+                {"pinyin", it->pinyin},
+                {"context", it->context},
+                {"max_results", it->max_results},
+                {"results", std::move(results)}
+            });
+        }
+
+        data["version"] = CACHE_FILE_VERSION;
+        data["model"] = model_id;
+        data["entries"] = std::move(entries);
+        dirty_ = false;
+    }
+
+    std::ofstream file(path);
+    file << data.dump();
+    if (!file.good()) {
+        spdlog::warn("Failed to write prediction cache: {}", path);
+        std::lock_guard<std::mutex> lock(mutex_);
+        dirty_ = true;
+        return false;
+    }
+    return true;
+}
+
+PredictionCacheStats PredictionCache::getStats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    PredictionCacheStats stats;
+    stats.hits = hits_;
+    stats.misses = misses_;
+    stats.entries = entries_.size();
+    stats.capacity = capacity_;
+    return stats;
+}
+
+} // namespace core
+} // namespace owcat
\ No newline at end of file
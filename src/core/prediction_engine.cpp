@@ -1,17 +1,33 @@
 #include "core/prediction_engine.h"
 #include "core/llama_predictor.h"
+#include "core/lexicon.h"
+#include "core/pinyin_converter.h"
+#include "core/prediction_cache.h"
+#include "core/prediction_governor.h"
 #include <spdlog/spdlog.h>
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
 #include <fstream>
+#include <mutex>
+#include <sstream>
+#include <unordered_map>
 
 namespace owcat {
 namespace core {
 
+// 推测解码使用的系统词典高频词数量
+static constexpr size_t MAX_DRAFT_PHRASES = 20000;
+
 class PredictionEngine::Impl {
 public:
-    explicit Impl(const std::string& model_path)
-        : model_path_(model_path), prediction_threshold_(0.5), initialized_(false) {
-        llama_predictor_ = std::make_unique<LlamaPredictor>();
+    Impl(const std::string& model_path, const std::string& lexicon_path, const ModelConfig& model_config)
+        : model_path_(model_path), lexicon_path_(lexicon_path), model_config_(model_config)
+        , prediction_threshold_(0.5), initialized_(false)
+        , constrained_ready_(false)
+        , cache_(static_cast<size_t>(std::max(0, model_config.prediction_cache_size)))
+        , governor_(model_config.governor) {
     }
     
     ~Impl() {
@@ -33,22 +49,186 @@ public:
             return true; // 允许在没有模型的情况下运行
         }
         
+        auto start = std::chrono::steady_clock::now();
+        
         // 初始化LlamaPredictor
-        if (!llama_predictor_->initialize(model_path_)) {
+        llama_predictor_ = std::make_unique<LlamaPredictor>(model_path_, model_config_);
+        if (!llama_predictor_->initialize()) {
             spdlog::error("Failed to initialize llama predictor");
             return false;
         }
         
-        initialized_ = true;
-        spdlog::info("Prediction engine initialized successfully");
+        constrained_ready_ = initializeConstraints();
+        if (model_config_.speculative_tokens > 0) {
+            initializeDraftPhrases();
+        }
+        if (model_config_.auto_tune) {
+            llama_predictor_->autoTune(model_config_.tune_cache_path);
+        }
+        llama_predictor_->warmup();
+        
+        // 模型或词典文件变化后旧的缓存不再有效，标识不一致时不加载
+        cache_model_id_ = buildCacheModelId();
+        if (!model_config_.prediction_cache_path.empty()) {
+            cache_.load(model_config_.prediction_cache_path, cache_model_id_);
+        }
+        
+        // 全部就绪后才对其他线程可见
+        initialized_.store(true, std::memory_order_release);
+        
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - start).count();
+        spdlog::info("Prediction engine initialized successfully in {} ms", elapsed);
         return true;
     }
     
     void shutdown() {
+        if (initialized_.exchange(false, std::memory_order_acq_rel)) {
+            saveCache();
+        }
         if (llama_predictor_) {
             llama_predictor_->shutdown();
         }
-        initialized_ = false;
+        lexicon_.close();
+        constrained_ready_ = false;
+    }
+    
+    /**
+     * 生成缓存文件的模型标识：模型和词典的路径及文件大小
+     * @return 模型标识
+     */
+    std::string buildCacheModelId() const {
+        auto file_size = [](const std::string& path) -> long long {
+            std::ifstream file(path, std::ios::binary | std::ios::ate);
+            return file.good() ? static_cast<long long>(file.tellg()) : -1;
+        };
+        return model_path_ + ":" + std::to_string(file_size(model_path_)) + "|" +
+               lexicon_path_ + ":" + std::to_string(file_size(lexicon_path_));
+    }
+    
+    void saveCache() {
+        if (!model_config_.prediction_cache_path.empty() && !cache_model_id_.empty()) {
+            cache_.save(model_config_.prediction_cache_path, cache_model_id_);
+        }
+    }
+    
+    /**
+     * 从系统词典收集汉字读音，供受约束的生成使用
+     * @return 是否可以使用受约束的生成
+     */
+    bool initializeConstraints() {
+        if (lexicon_path_.empty() || !pinyin_converter_.initialize()) {
+            return false;
+        }
+        
+        std::ifstream lexicon_file(lexicon_path_);
+        if (!lexicon_file.good() || !lexicon_.open(lexicon_path_)) {
+            spdlog::info("System lexicon unavailable, AI prediction falls back to free-form generation");
+            return false;
+        }
+        
+        // 字数与音节数相同的词条逐字对应读音
+        std::unordered_map<uint32_t, std::vector<uint16_t>> readings;
+        std::vector<uint32_t> codepoints;
+        lexicon_.forEachEntry([&](const LexiconEntry& entry) {
+            if (!decodeCodepoints(entry.text, codepoints) || codepoints.size() != entry.syllable_count) {
+                return;
+            }
+            for (size_t i = 0; i < codepoints.size(); ++i) {
+                auto& syllables = readings[codepoints[i]];
+                if (std::find(syllables.begin(), syllables.end(), entry.syllable_ids[i]) == syllables.end()) {
+                    syllables.push_back(entry.syllable_ids[i]);
+                }
+            }
+        });
+        
+        return llama_predictor_->setCharacterReadings(readings);
+    }
+    
+    /**
+     * 以系统词典中的高频多字词作为推测解码的草稿短语
+     */
+    void initializeDraftPhrases() {
+        if (lexicon_path_.empty() || (!lexicon_.isOpen() && !lexicon_.open(lexicon_path_))) {
+            return;
+        }
+        
+        std::vector<std::pair<uint32_t, std::string_view>> entries;
+        lexicon_.forEachEntry([&entries](const LexiconEntry& entry) {
+            if (entry.syllable_count >= 2) {
+                entries.emplace_back(entry.frequency, entry.text);
+            }
+        });
+        
+        const size_t count = std::min(entries.size(), MAX_DRAFT_PHRASES);
+        std::partial_sort(entries.begin(), entries.begin() + count, entries.end(),
+                          [](const auto& a, const auto& b) { return a.first > b.first; });
+        
+        std::vector<std::string> phrases;
+        phrases.reserve(count);
+        for (size_t i = 0; i < count; ++i) {
+            phrases.emplace_back(entries[i].second);
+        }
+        llama_predictor_->setDraftPhrases(phrases);
+    }
+    
+    /**
+     * 按最优分割路径为每个音节位置生成允许的音节ID
+     * @return 音节约束，无法分割时为空
+     */
+    std::vector<std::vector<uint16_t>> buildSyllableConstraints(const std::string& pinyin_sequence) {
+        std::vector<std::vector<uint16_t>> allowed;
+        
+        std::lock_guard<std::mutex> lock(converter_mutex_);
+        pinyin_converter_.clear();
+        for (char ch : pinyin_sequence) {
+            if (!pinyin_converter_.addChar(static_cast<char>(std::tolower(static_cast<unsigned char>(ch))))) {
+                return allowed;
+            }
+        }
+        
+        auto segmentations = pinyin_converter_.getBestSegmentations(1);
+        if (segmentations.empty()) {
+            return allowed;
+        }
+        
+        const auto& segmentation = segmentations.front();
+        for (size_t i = 0; i < segmentation.syllables.size(); ++i) {
+            std::vector<uint16_t> ids;
+            if (segmentation.syllable_ids[i] >= 0) {
+                int id = lexicon_.findSyllableId(segmentation.syllables[i]);
+                if (id >= 0) {
+                    ids.push_back(static_cast<uint16_t>(id));
+                }
+            } else {
+                // 未输入完整的末尾音节允许所有以其为前缀的音节
+                int begin = 0;
+                int end = 0;
+                if (lexicon_.findSyllablePrefixRange(segmentation.syllables[i], begin, end)) {
+                    for (int id = begin; id < end; ++id) {
+                        ids.push_back(static_cast<uint16_t>(id));
+                    }
+                }
+            }
+            
+            if (ids.empty()) {
+                return {};
+            }
+            allowed.push_back(std::move(ids));
+        }
+        
+        return allowed;
+    }
+    
+    std::string syllablesToPinyin(const std::vector<uint16_t>& syllable_ids) const {
+        std::string pinyin;
+        for (uint16_t id : syllable_ids) {
+            if (!pinyin.empty()) {
+                pinyin += ' ';
+            }
+            pinyin += lexicon_.getSyllable(id);
+        }
+        return pinyin;
     }
     
     CandidateList predictNextWords(const std::string& context, int max_predictions) {
@@ -60,7 +240,7 @@ public:
         
         try {
             // 使用LlamaPredictor生成预测
-            std::string generated_text = llama_predictor_->generateText(context, max_predictions * 10);
+            std::string generated_text = firstOrEmpty(llama_predictor_->generateText(context, max_predictions * 10));
             
             if (generated_text.empty()) {
                 return predictions;
@@ -69,13 +249,17 @@ public:
             // 解析生成的文本，提取候选词
             auto words = parseGeneratedText(generated_text, context);
             
+            // 所有候选词在一次前向计算中打分
+            auto log_probs = llama_predictor_->getNextWordProbabilities(context, words);
+            
             // 计算每个词的概率分数
-            for (const auto& word : words) {
+            for (size_t i = 0; i < words.size(); ++i) {
                 if (predictions.size() >= static_cast<size_t>(max_predictions)) {
                     break;
                 }
                 
-                double probability = llama_predictor_->getNextWordProbability(context, word);
+                const auto& word = words[i];
+                double probability = std::exp(static_cast<double>(log_probs[i]));
                 if (probability >= prediction_threshold_) {
                     // 生成拼音（简化实现，实际应该使用拼音转换器）
                     std::string pinyin = generatePinyin(word);
@@ -106,7 +290,7 @@ public:
         try {
             // 构建提示文本
             std::string prompt = "请补全以下文本：" + partial_text;
-            std::string generated_text = llama_predictor_->generateText(prompt, max_completions * 20);
+            std::string generated_text = firstOrEmpty(llama_predictor_->generateText(prompt, max_completions * 20));
             
             if (generated_text.empty()) {
                 return completions;
@@ -134,41 +318,100 @@ public:
         return completions;
     }
     
-    CandidateList predictFromPinyin(const std::string& pinyin_sequence, const std::string& context, int max_predictions) {
+    CandidateList predictFromPinyin(const std::string& pinyin_sequence, const std::string& context, int max_predictions,
+                                    const CancelCallback& is_cancelled, int session) {
         CandidateList predictions;
         
         if (!isAvailable()) {
             return predictions;
         }
         
+        // 相同的拼音和上下文直接复用模型输出，得分仍按当前的用户习惯和阈值计算
+        std::vector<CachedPrediction> outputs;
+        if (!cache_.lookup(pinyin_sequence, context, max_predictions, outputs)) {
+            // 需要运行模型时才按系统负载和预测延迟缩减资源，降级时的输出按缩减后的数量缓存
+            const PredictionBudget budget = governor_.getBudget();
+            if (budget.level == PredictionLevel::OFF) {
+                return predictions;
+            }
+            const int model_predictions = budget.max_predictions > 0
+                                              ? std::min(max_predictions, budget.max_predictions)
+                                              : max_predictions;
+            if (model_predictions == max_predictions ||
+                !cache_.lookup(pinyin_sequence, context, model_predictions, outputs)) {
+                llama_predictor_->setThreadLimit(budget.thread_limit);
+                const auto start = std::chrono::steady_clock::now();
+                if (!runPinyinPrediction(pinyin_sequence, context, model_predictions, budget.token_scale,
+                                         is_cancelled, session, outputs)) {
+                    return predictions;
+                }
+                governor_.recordLatency(std::chrono::duration<double, std::milli>(
+                    std::chrono::steady_clock::now() - start).count());
+                cache_.insert(pinyin_sequence, context, model_predictions, outputs);
+            }
+        }
+        
+        for (const auto& output : outputs) {
+            if (predictions.size() >= static_cast<size_t>(max_predictions)) {
+                break;
+            }
+            
+            double score = calculatePinyinScore(output.text, pinyin_sequence, context);
+            if (score >= prediction_threshold_) {
+                predictions.emplace_back(output.text, output.pinyin, score, 0, true);
+            }
+        }
+        
+        return predictions;
+    }
+    
+    /**
+     * 运行模型得到拼音预测的原始输出
+     * @param token_scale 自由生成的token数比例
+     * @param outputs 输出预测的汉字及其拼音
+     * @return 是否完整运行，被取消或出错时为false，结果不应缓存
+     */
+    bool runPinyinPrediction(const std::string& pinyin_sequence, const std::string& context, int max_predictions,
+                             double token_scale, const CancelCallback& is_cancelled, int session,
+                             std::vector<CachedPrediction>& outputs) {
+        outputs.clear();
+        
         try {
             // 构建包含拼音信息的提示
             std::string prompt = "根据拼音'" + pinyin_sequence + "'和上下文'" + context + "'，预测可能的中文词汇：";
-            std::string generated_text = llama_predictor_->generateText(prompt, max_predictions * 15);
             
-            if (generated_text.empty()) {
-                return predictions;
+            // 优先使用受约束的生成：每步只允许读音匹配的汉字，结果自带拼音
+            if (constrained_ready_) {
+                auto allowed = buildSyllableConstraints(pinyin_sequence);
+                if (!allowed.empty()) {
+                    auto results = llama_predictor_->generateConstrained(prompt, allowed, max_predictions,
+                                                                         is_cancelled, session);
+                    for (const auto& result : results) {
+                        outputs.emplace_back(result.text, syllablesToPinyin(result.syllable_ids));
+                    }
+                    return !(is_cancelled && is_cancelled());
+                }
             }
             
-            // 解析预测结果
-            auto predicted_words = parsePinyinPredictions(generated_text, pinyin_sequence);
+            const int max_tokens = std::max(1, static_cast<int>(max_predictions * 15 * token_scale));
+            std::string generated_text = firstOrEmpty(llama_predictor_->generateText(
+                prompt, max_tokens, 0.7f, 0.9f, is_cancelled, session));
             
-            for (const auto& word : predicted_words) {
-                if (predictions.size() >= static_cast<size_t>(max_predictions)) {
-                    break;
-                }
-                
-                double score = calculatePinyinScore(word, pinyin_sequence, context);
-                if (score >= prediction_threshold_) {
-                    predictions.emplace_back(word, pinyin_sequence, score, 0, true);
-                }
+            if (is_cancelled && is_cancelled()) {
+                return false;
+            }
+            
+            // 解析预测结果
+            for (const auto& word : parsePinyinPredictions(generated_text, pinyin_sequence)) {
+                outputs.emplace_back(word, pinyin_sequence);
             }
+            return true;
             
         } catch (const std::exception& e) {
             spdlog::error("Error in predictFromPinyin: {}", e.what());
         }
         
-        return predictions;
+        return false;
     }
     
     void learnUserPattern(const std::string& input_sequence, const std::string& selected_text) {
@@ -176,7 +419,13 @@ public:
             return;
         }
         
+        // 用户提交的文本也作为推测解码的草稿
+        if (model_config_.speculative_tokens > 0) {
+            llama_predictor_->addDraftPhrase(selected_text);
+        }
+        
         // 记录用户选择模式，用于后续优化
+        std::lock_guard<std::mutex> lock(patterns_mutex_);
         user_patterns_[input_sequence].push_back(selected_text);
         
         // 限制存储的模式数量
@@ -203,12 +452,13 @@ public:
         
         // 关闭当前模型
         if (initialized_) {
+            initialized_.store(false, std::memory_order_release);
             llama_predictor_->shutdown();
-            initialized_ = false;
         }
         
-        // 更新模型路径
+        // 更新模型路径，旧模型的预测结果全部作废
         model_path_ = new_model_path;
+        cache_.clear();
         
         // 重新初始化
         return initialize();
@@ -224,7 +474,7 @@ public:
     }
     
     bool isAvailable() const {
-        return initialized_ && llama_predictor_ && llama_predictor_->isModelLoaded();
+        return initialized_.load(std::memory_order_acquire) && llama_predictor_ && llama_predictor_->isLoaded();
     }
     
     std::string getModelInfo() const {
@@ -236,6 +486,29 @@ public:
     }
     
 private:
+    static bool decodeCodepoints(std::string_view text, std::vector<uint32_t>& codepoints) {
+        codepoints.clear();
+        for (size_t i = 0; i < text.size(); ) {
+            unsigned char c = static_cast<unsigned char>(text[i]);
+            size_t length = c < 0x80 ? 1 : (c & 0xE0) == 0xC0 ? 2 : (c & 0xF0) == 0xE0 ? 3 : (c & 0xF8) == 0xF0 ? 4 : 0;
+            if (length == 0 || i + length > text.size()) {
+                return false;
+            }
+            
+            uint32_t cp = length == 1 ? c : c & (0xFF >> (length + 1));
+            for (size_t k = 1; k < length; ++k) {
+                cp = (cp << 6) | (static_cast<unsigned char>(text[i + k]) & 0x3F);
+            }
+            codepoints.push_back(cp);
+            i += length;
+        }
+        return true;
+    }
+    
+    static std::string firstOrEmpty(const std::vector<std::string>& texts) {
+        return texts.empty() ? std::string() : texts.front();
+    }
+    
     std::vector<std::string> parseGeneratedText(const std::string& generated_text, const std::string& context) {
         std::vector<std::string> words;
         
@@ -329,6 +602,7 @@ private:
         double base_score = 0.6;
         
         // 检查用户历史模式
+        std::lock_guard<std::mutex> lock(patterns_mutex_);
         auto it = user_patterns_.find(pinyin_sequence);
         if (it != user_patterns_.end()) {
             for (const auto& pattern : it->second) {
@@ -355,15 +629,37 @@ private:
     
 public:
     std::string model_path_;
+    std::string lexicon_path_;
+    ModelConfig model_config_;
     std::unique_ptr<LlamaPredictor> llama_predictor_;
     double prediction_threshold_;
-    bool initialized_;
+    std::atomic<bool> initialized_;     // 可能在后台线程中置位，模型和读音表就绪后才为true
     std::unordered_map<std::string, std::vector<std::string>> user_patterns_;
+    
+    // 受约束生成所需的读音数据
+    Lexicon lexicon_;
+    PinyinConverter pinyin_converter_;
+    bool constrained_ready_;
+    
+    // 模型输出缓存，命中时不再运行模型
+    PredictionCache cache_;
+    std::string cache_model_id_;
+    
+    // 按预测延迟和系统负载决定每次运行模型的资源
+    PredictionGovernor governor_;
+    
+    std::mutex converter_mutex_;    // 多个会话并发预测时保护pinyin_converter_
+    std::mutex patterns_mutex_;
+    
+    // 已分配的预测会话，会话0保留给直接调用者
+    std::mutex session_mutex_;
+    std::vector<bool> sessions_in_use_ = std::vector<bool>(LlamaPredictor::MAX_SESSIONS, false);
 };
 
 // PredictionEngine implementation
-PredictionEngine::PredictionEngine(const std::string& model_path)
-    : pImpl(std::make_unique<Impl>(model_path)) {
+PredictionEngine::PredictionEngine(const std::string& model_path, const std::string& lexicon_path,
+                                   const ModelConfig& model_config)
+    : pImpl(std::make_unique<Impl>(model_path, lexicon_path, model_config)) {
 }
 
 PredictionEngine::~PredictionEngine() = default;
@@ -376,6 +672,32 @@ void PredictionEngine::shutdown() {
     pImpl->shutdown();
 }
 
+int PredictionEngine::openSession() {
+    std::lock_guard<std::mutex> lock(pImpl->session_mutex_);
+    for (size_t i = 1; i < pImpl->sessions_in_use_.size(); ++i) {
+        if (!pImpl->sessions_in_use_[i]) {
+            pImpl->sessions_in_use_[i] = true;
+            return static_cast<int>(i);
+        }
+    }
+    spdlog::warn("All {} prediction sessions are in use", pImpl->sessions_in_use_.size() - 1);
+    return -1;
+}
+
+void PredictionEngine::closeSession(int session) {
+    if (session <= 0 || session >= static_cast<int>(pImpl->sessions_in_use_.size())) {
+        return;
+    }
+    
+    // 释放会话的KV缓存，供其他会话使用
+    if (pImpl->isAvailable()) {
+        pImpl->llama_predictor_->releaseSession(session);
+    }
+    
+    std::lock_guard<std::mutex> lock(pImpl->session_mutex_);
+    pImpl->sessions_in_use_[session] = false;
+}
+
 CandidateList PredictionEngine::predictNext(const std::string& context, int max_predictions) const {
     return pImpl->predictNextWords(context, max_predictions);
 }
@@ -384,8 +706,29 @@ CandidateList PredictionEngine::predictCompletion(const std::string& partial_inp
     return pImpl->completePartialInput(partial_input, max_predictions);
 }
 
-CandidateList PredictionEngine::predictFromPinyin(const std::string& pinyin, const std::string& context, int max_predictions) const {
-    return pImpl->predictFromPinyin(pinyin, context, max_predictions);
+CandidateList PredictionEngine::predictFromPinyin(const std::string& pinyin, const std::string& context, int max_predictions,
+                                                 const CancelCallback& is_cancelled, int session) const {
+    return pImpl->predictFromPinyin(pinyin, context, max_predictions, is_cancelled, session);
+}
+
+std::vector<float> PredictionEngine::scoreCandidates(const std::string& context,
+                                                    const std::vector<std::string>& candidates, int session) const {
+    if (!pImpl->isAvailable() || candidates.empty()) {
+        return std::vector<float>();
+    }
+    return pImpl->llama_predictor_->getNextWordProbabilities(context, candidates, session);
+}
+
+void PredictionEngine::setSystemLoadProvider(SystemLoadProvider provider) {
+    pImpl->governor_.setSystemLoadProvider(std::move(provider));
+}
+
+void PredictionEngine::setGovernorConfig(const PredictionGovernorConfig& config) {
+    pImpl->governor_.setConfig(config);
+}
+
+PredictionBudget PredictionEngine::getBudget() const {
+    return pImpl->governor_.getBudget();
 }
 
 bool PredictionEngine::learnInputPattern(const std::vector<std::string>& input_sequence, const std::string& context) {
@@ -400,7 +743,10 @@ bool PredictionEngine::learnInputPattern(const std::vector<std::string>& input_s
 }
 
 bool PredictionEngine::updateModel(const std::vector<std::string>& training_data) {
-    // 简化实现，暂时返回false
+    // 简化实现，暂时返回false；新的训练数据会改变预测结果，缓存需要作废
+    if (!training_data.empty()) {
+        pImpl->cache_.clear();
+    }
     return false;
 }
 
@@ -420,5 +766,13 @@ std::string PredictionEngine::getModelInfo() const {
     return pImpl->getModelInfo();
 }
 
+PredictionCacheStats PredictionEngine::getCacheStats() const {
+    return pImpl->cache_.getStats();
+}
+
+void PredictionEngine::clearCache() {
+    pImpl->cache_.clear();
+}
+
 } // namespace core
 } // namespace owcat
\ No newline at end of file
@@ -0,0 +1,148 @@
+#include "core/prediction_governor.h"
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <thread>
+
+namespace owcat {
+namespace core {
+
+// 延迟滑动平均中新样本的权重
+static constexpr double LATENCY_SMOOTHING = 0.3;
+
+PredictionGovernor::PredictionGovernor(const PredictionGovernorConfig& config)
+    : config_(config), load_valid_(false), latency_ms_(0.0), level_(PredictionLevel::FULL)
+    , recovery_count_(0), sampled_(false)
+    , hardware_threads_(std::max(1, static_cast<int>(std::thread::hardware_concurrency()))) {
+}
+
+void PredictionGovernor::setConfig(const PredictionGovernorConfig& config) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    config_ = config;
+    latency_ms_ = 0.0;
+    level_ = PredictionLevel::FULL;
+    recovery_count_ = 0;
+    sampled_ = false;
+}
+
+void PredictionGovernor::setSystemLoadProvider(SystemLoadProvider provider) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    provider_ = std::move(provider);
+    load_ = SystemLoad();
+    load_valid_ = false;
+    sampled_ = false;
+}
+
+void PredictionGovernor::recordLatency(double milliseconds) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    latency_ms_ = latency_ms_ <= 0.0 ? milliseconds
+                                     : latency_ms_ + LATENCY_SMOOTHING * (milliseconds - latency_ms_);
+}
+
+PredictionBudget PredictionGovernor::getBudget() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!config_.enabled) {
+        return PredictionBudget();
+    }
+
+    const auto now = Clock::now();
+    if (!sampled_ || now - last_sample_ >= std::chrono::milliseconds(config_.sample_interval_ms)) {
+        updateLocked(now);
+    }
+    return budgetFor(level_);
+}
+
+PredictionLevel PredictionGovernor::getLevel() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return level_;
+}
+
+SystemLoad PredictionGovernor::getSystemLoad() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return load_;
+}
+
+const char* PredictionGovernor::levelName(PredictionLevel level) {
+    switch (level) {
+        case PredictionLevel::FULL: return "full";
+        case PredictionLevel::REDUCED: return "reduced";
+        case PredictionLevel::MINIMAL: return "minimal";
+        case PredictionLevel::OFF: return "off";
+    }
+    return "unknown";
+}
+
+void PredictionGovernor::updateLocked(Clock::time_point now) {
+    last_sample_ = now;
+    sampled_ = true;
+    if (provider_) {
+        SystemLoad load;
+        load_valid_ = provider_(load);
+        load_ = load_valid_ ? load : SystemLoad();
+    }
+
+    const PredictionLevel target = targetLevelLocked();
+    PredictionLevel next = level_;
+    if (target > level_) {
+        next = target;
+        recovery_count_ = 0;
+    } else if (target < level_) {
+        if (++recovery_count_ >= kRecoverySamples) {
+            next = static_cast<PredictionLevel>(static_cast<int>(level_) - 1);
+            recovery_count_ = 0;
+        }
+    } else {
+        recovery_count_ = 0;
+    }
+
+    if (next != level_) {
+        spdlog::info("Prediction level {} -> {} (latency {:.1f} ms, cpu {:.0f}%, battery {}{})",
+                     levelName(level_), levelName(next), latency_ms_, load_.cpu_load * 100.0,
+                     load_.on_battery ? "discharging " : "", load_.battery_percent);
+        level_ = next;
+    }
+}
+
+PredictionLevel PredictionGovernor::targetLevelLocked() const {
+    if (load_valid_ && load_.on_battery && load_.battery_percent >= 0 &&
+        load_.battery_percent < config_.low_battery_percent) {
+        return PredictionLevel::OFF;
+    }
+
+    int pressure = 0;
+    if (config_.target_latency_ms > 0.0 && latency_ms_ > config_.target_latency_ms) {
+        pressure += latency_ms_ > 2.0 * config_.target_latency_ms ? 2 : 1;
+    }
+    if (load_valid_ && load_.cpu_load > config_.high_cpu_load) {
+        ++pressure;
+    }
+    if (load_valid_ && load_.on_battery && config_.reduce_on_battery) {
+        ++pressure;
+    }
+    return static_cast<PredictionLevel>(std::min(pressure, static_cast<int>(PredictionLevel::OFF)));
+}
+
+PredictionBudget PredictionGovernor::budgetFor(PredictionLevel level) const {
+    PredictionBudget budget;
+    budget.level = level;
+    switch (level) {
+        case PredictionLevel::FULL:
+            break;
+        case PredictionLevel::REDUCED:
+            budget.thread_limit = std::max(1, hardware_threads_ / 2);
+            budget.max_predictions = 3;
+            budget.token_scale = 0.5;
+            budget.allow_rerank = false;
+            break;
+        case PredictionLevel::MINIMAL:
+        case PredictionLevel::OFF:
+            budget.thread_limit = 1;
+            budget.max_predictions = 1;
+            budget.token_scale = 0.25;
+            budget.allow_rerank = false;
+            break;
+    }
+    return budget;
+}
+
+} // namespace core
+} // namespace owcat
\ No newline at end of file
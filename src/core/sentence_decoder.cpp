@@ -0,0 +1,249 @@
+#include "core/sentence_decoder.h"
+#include "core/ngram_model.h"
+#include <algorithm>
+
+namespace owcat {
+namespace core {
+
+// 末尾音节按前缀查询时会返回更长的词，多取一些再按音节数筛选
+static constexpr size_t PREFIX_LOOKUP_RESULTS = SentenceDecoder::kMaxSpanWords * 8;
+
+SentenceDecoder::SentenceDecoder(const Lexicon& lexicon, const NgramModel& model)
+    : lexicon_(lexicon), model_(model) {
+    words_.reserve(kMaxSyllables * kMaxWordSyllables * kMaxSpanWords);
+    span_begin_.reserve(kMaxSyllables * kMaxWordSyllables + 1);
+    beam_.resize(kMaxSyllables + 1);
+    ids_.reserve(kMaxSyllables);
+    next_ids_.reserve(kMaxSyllables);
+    entries_.resize(PREFIX_LOOKUP_RESULTS);
+    backtrack_.reserve(kMaxSyllables);
+    reset();
+}
+
+void SentenceDecoder::reset() {
+    ids_.clear();
+    words_.clear();
+    span_begin_.clear();
+}
+
+bool SentenceDecoder::encodeSyllables(const std::vector<std::string>& syllables, bool last_is_prefix,
+                                      std::vector<uint16_t>& ids) const {
+    // 超出的音节不解码，此时末尾的不完整音节已被截掉
+    const size_t n = std::min(syllables.size(), kMaxSyllables);
+    last_is_prefix = last_is_prefix && n == syllables.size();
+
+    ids.clear();
+    for (size_t i = 0; i < n; ++i) {
+        if (last_is_prefix && i + 1 == n) {
+            ids.push_back(kPrefixSyllable);
+            break;
+        }
+        int id = lexicon_.findSyllableId(syllables[i]);
+        if (id < 0) {
+            return false;
+        }
+        ids.push_back(static_cast<uint16_t>(id));
+    }
+    return true;
+}
+
+size_t SentenceDecoder::sharedPrefix(const std::vector<std::string>& syllables, bool last_is_prefix) const {
+    const size_t n = std::min({syllables.size(), ids_.size(), kMaxSyllables});
+    size_t shared = 0;
+    for (; shared < n; ++shared) {
+        if (ids_[shared] == kPrefixSyllable || (last_is_prefix && shared + 1 == syllables.size()) ||
+            lexicon_.findSyllableId(syllables[shared]) != ids_[shared]) {
+            break;
+        }
+    }
+    return shared;
+}
+
+void SentenceDecoder::addSpans(const std::vector<std::string>& syllables, size_t end, bool last_is_prefix) {
+    for (size_t length = 1; length <= kMaxWordSyllables; ++length) {
+        span_begin_.push_back(static_cast<uint32_t>(words_.size()));
+        if (length > end) {
+            continue;
+        }
+
+        const size_t begin = end - length;
+        size_t count;
+        if (last_is_prefix && end == ids_.size()) {
+            // 末尾音节不完整：按拼音前缀查询，只保留音节数恰好覆盖该段的词
+            query_.clear();
+            for (size_t k = begin; k < end; ++k) {
+                if (k > begin) query_ += ' ';
+                query_ += syllables[k];
+            }
+            count = lexicon_.lookupPinyin(query_, entries_.data(), entries_.size());
+        } else {
+            count = lexicon_.lookup(ids_.data() + begin, length, entries_.data(), kMaxSpanWords);
+        }
+
+        size_t kept = 0;
+        for (size_t k = 0; k < count && kept < kMaxSpanWords; ++k) {
+            const LexiconEntry& entry = entries_[k];
+            if (entry.syllable_count != length) {
+                continue;
+            }
+
+            LatticeWord word;
+            word.text = entry.text;
+            word.syllable_ids = entry.syllable_ids;
+            word.syllable_count = entry.syllable_count;
+            word.word_id = model_.findWord(entry.text);
+            words_.push_back(word);
+            ++kept;
+        }
+    }
+}
+
+void SentenceDecoder::extendColumn(size_t end) {
+    BeamColumn& target = beam_[end];
+    target.count = 0;
+
+    const size_t first_span = (end - 1) * kMaxWordSyllables;
+    for (size_t length = 1; length <= kMaxWordSyllables && length <= end; ++length) {
+        const size_t begin = end - length;
+        const BeamColumn& column = beam_[begin];
+        const size_t span = first_span + length - 1;
+
+        for (uint32_t w = span_begin_[span]; w < span_begin_[span + 1]; ++w) {
+            const LatticeWord& word = words_[w];
+            for (uint8_t rank = 0; rank < column.count; ++rank) {
+                const PathEntry& path = column.entries[rank];
+
+                PathEntry next;
+                next.score = path.score + model_.logProb(path.prev2, path.prev1, word.word_id);
+                next.prev1 = word.word_id;
+                next.prev2 = path.prev1;
+                next.word = w;
+                next.prev_pos = static_cast<uint16_t>(begin);
+                next.prev_rank = rank;
+                insertPath(target, next);
+            }
+        }
+    }
+}
+
+void SentenceDecoder::insertPath(BeamColumn& column, const PathEntry& entry) {
+    // 语言模型状态（最后两个词）相同的路径只保留得分较高者，词表外的词不合并
+    if (entry.prev1 != NgramModel::kNoWord && entry.prev2 != NgramModel::kNoWord) {
+        for (uint8_t i = 0; i < column.count; ++i) {
+            const PathEntry& existing = column.entries[i];
+            if (existing.prev1 == entry.prev1 && existing.prev2 == entry.prev2) {
+                if (existing.score >= entry.score) {
+                    return;
+                }
+                std::copy(column.entries + i + 1, column.entries + column.count, column.entries + i);
+                --column.count;
+                break;
+            }
+        }
+    }
+
+    if (column.count == kBeamWidth && column.entries[kBeamWidth - 1].score >= entry.score) {
+        return;
+    }
+
+    size_t slot = std::min<size_t>(column.count, kBeamWidth - 1);
+    while (slot > 0 && column.entries[slot - 1].score < entry.score) {
+        if (slot < kBeamWidth) {
+            column.entries[slot] = column.entries[slot - 1];
+        }
+        --slot;
+    }
+    column.entries[slot] = entry;
+    if (column.count < kBeamWidth) {
+        ++column.count;
+    }
+}
+
+size_t SentenceDecoder::decode(const std::vector<std::string>& syllables, bool last_is_prefix, size_t max_results,
+                               std::vector<DecodedSentence>& out) {
+    out.clear();
+    if (!lexicon_.isOpen() || !model_.isOpen() || syllables.empty() || max_results == 0) {
+        return 0;
+    }
+
+    if (!encodeSyllables(syllables, last_is_prefix, next_ids_)) {
+        return 0;
+    }
+    const size_t n = next_ids_.size();
+    last_is_prefix = next_ids_.back() == kPrefixSyllable;
+
+    // 前shared个音节与上次相同，第0到shared列及以其为结尾的词都可以复用
+    size_t shared = 0;
+    while (shared < n && shared < ids_.size() && next_ids_[shared] == ids_[shared] &&
+           ids_[shared] != kPrefixSyllable) {
+        ++shared;
+    }
+    ids_.swap(next_ids_);
+
+    if (shared == 0 || span_begin_.empty()) {
+        words_.clear();
+        span_begin_.clear();
+        shared = 0;
+
+        PathEntry start;
+        start.score = 0.0f;
+        start.prev1 = model_.sentenceBegin();
+        start.prev2 = NgramModel::kNoWord;
+        start.word = UINT32_MAX;
+        start.prev_pos = 0;
+        start.prev_rank = 0;
+        beam_[0].entries[0] = start;
+        beam_[0].count = 1;
+    } else {
+        const size_t kept_spans = shared * kMaxWordSyllables;
+        words_.resize(span_begin_[kept_spans]);
+        span_begin_.resize(kept_spans);
+    }
+
+    // 只计算新增的列；计算某一列时之前的列都已完成，回溯下标保持有效
+    for (size_t end = shared + 1; end <= n; ++end) {
+        addSpans(syllables, end, last_is_prefix);
+        span_begin_.push_back(static_cast<uint32_t>(words_.size()));
+        extendColumn(end);
+        span_begin_.pop_back();
+    }
+    span_begin_.push_back(static_cast<uint32_t>(words_.size()));
+
+    // 回溯末列的路径，文本相同的只保留得分最高的一条
+    const BeamColumn& last = beam_[n];
+    for (uint8_t rank = 0; rank < last.count && out.size() < max_results; ++rank) {
+        backtrack_.clear();
+        size_t pos = n;
+        uint8_t r = rank;
+        while (pos > 0) {
+            const PathEntry& entry = beam_[pos].entries[r];
+            backtrack_.push_back(entry.word);
+            pos = entry.prev_pos;
+            r = entry.prev_rank;
+        }
+
+        DecodedSentence sentence;
+        for (auto it = backtrack_.rbegin(); it != backtrack_.rend(); ++it) {
+            const LatticeWord& word = words_[*it];
+            sentence.text.append(word.text);
+            for (uint16_t k = 0; k < word.syllable_count; ++k) {
+                if (!sentence.pinyin.empty()) sentence.pinyin += ' ';
+                sentence.pinyin.append(lexicon_.getSyllable(word.syllable_ids[k]));
+            }
+        }
+        sentence.log_prob = last.entries[rank].score;
+        sentence.word_count = backtrack_.size();
+
+        bool duplicate = std::any_of(out.begin(), out.end(), [&sentence](const DecodedSentence& existing) {
+            return existing.text == sentence.text;
+        });
+        if (!duplicate) {
+            out.push_back(std::move(sentence));
+        }
+    }
+
+    return out.size();
+}
+
+} // namespace core
+} // namespace owcat
\ No newline at end of file
@@ -0,0 +1,913 @@
+#include "core/user_dictionary.h"
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace owcat {
+namespace core {
+
+namespace {
+
+// 快照首行的格式标识与版本
+constexpr char SNAPSHOT_MAGIC[] = "OWUD";
+constexpr int SNAPSHOT_VERSION = 2;
+
+// 版本1的快照没有更新时间，按加载时刻计
+constexpr int SNAPSHOT_VERSION_UNTIMED = 1;
+
+// 默认的频率半衰期
+constexpr double DEFAULT_HALF_LIFE_DAYS = 30.0;
+constexpr double SECONDS_PER_DAY = 86400.0;
+
+// 后台线程同步日志的间隔
+constexpr std::chrono::milliseconds SYNC_INTERVAL{2000};
+
+// 缓冲的日志记录达到此数量时提前同步
+constexpr size_t MAX_BUFFERED_RECORDS = 256;
+
+// 上次压缩后的日志记录达到此数量时在后台压缩
+constexpr uint64_t COMPACT_THRESHOLD = 4096;
+
+// 日志操作
+constexpr char OP_ADD = 'A';
+constexpr char OP_FREQUENCY = 'F';
+constexpr char OP_REMOVE = 'D';
+constexpr char OP_PRUNE = 'P';
+
+// 哈希表键：拼音在前，使有序索引可以按拼音前缀查询
+constexpr char KEY_SEPARATOR = '\x1f';
+
+std::string makeKey(const std::string& word, const std::string& pinyin) {
+    std::string key;
+    key.reserve(pinyin.size() + word.size() + 1);
+    key.append(pinyin).append(1, KEY_SEPARATOR).append(word);
+    return key;
+}
+
+// 拼音中各音节的首字母，作为简拼索引的键
+std::string syllableInitials(std::string_view pinyin) {
+    std::string initials;
+    bool start = true;
+    for (char c : pinyin) {
+        if (c == ' ') {
+            start = true;
+        } else if (start) {
+            initials.push_back(c);
+            start = false;
+        }
+    }
+    return initials;
+}
+
+// 与系统层的排序一致：频率降序，短词优先，保留前max_results个
+void rankUserWords(std::vector<UserWord>& words, size_t max_results) {
+    auto by_frequency = [](const UserWord& a, const UserWord& b) {
+        if (a.frequency != b.frequency) {
+            return a.frequency > b.frequency;
+        }
+        return a.word.length() < b.word.length();
+    };
+    if (words.size() > max_results) {
+        std::partial_sort(words.begin(), words.begin() + max_results, words.end(), by_frequency);
+        words.resize(max_results);
+    } else {
+        std::sort(words.begin(), words.end(), by_frequency);
+    }
+}
+
+// 日志和快照以制表符分隔字段、以换行分隔记录
+bool isStorableText(const std::string& text) {
+    return !text.empty() && text.find_first_of("\t\n\r\x1f") == std::string::npos;
+}
+
+/**
+ * 把文件内容写入磁盘
+ */
+bool syncFile(std::FILE* file) {
+    if (std::fflush(file) != 0) {
+        return false;
+    }
+#ifdef _WIN32
+    return _commit(_fileno(file)) == 0;
+#else
+    return fsync(fileno(file)) == 0;
+#endif
+}
+
+/**
+ * 按制表符拆分一行
+ * @return 字段数量，超过max_fields时返回max_fields + 1
+ */
+size_t splitFields(std::string_view line, std::string_view* fields, size_t max_fields) {
+    size_t count = 0;
+    size_t pos = 0;
+    while (count < max_fields) {
+        size_t tab = line.find('\t', pos);
+        if (tab == std::string_view::npos) {
+            fields[count++] = line.substr(pos);
+            return count;
+        }
+        fields[count++] = line.substr(pos, tab - pos);
+        pos = tab + 1;
+    }
+    return max_fields + 1;
+}
+
+bool parseInteger(std::string_view text, long long& value) {
+    if (text.empty()) {
+        return false;
+    }
+    std::string buffer(text);
+    char* end = nullptr;
+    value = std::strtoll(buffer.c_str(), &end, 10);
+    return end && *end == '\0';
+}
+
+bool parseDouble(std::string_view text, double& value) {
+    if (text.empty()) {
+        return false;
+    }
+    std::string buffer(text);
+    char* end = nullptr;
+    value = std::strtod(buffer.c_str(), &end);
+    return end && *end == '\0' && std::isfinite(value);
+}
+
+std::string formatDouble(double value) {
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%.9g", value);
+    return buffer;
+}
+
+int64_t currentTime() {
+    return std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+} // namespace
+
+class UserDictionary::Impl {
+public:
+    // 用户层条目，词和拼音保存在键中
+    // 频率保存为 value 在 updated 时刻的值，读取时按半衰期衰减到当前时刻，无需定期改写
+    struct Entry {
+        double value;
+        int64_t updated;        // 最后一次更新的时间（Unix秒）
+        bool user_word;
+    };
+
+    explicit Impl(const std::string& path)
+        : path_(path), journal_path_(path.empty() ? path : path + ".journal")
+        , rotated_path_(path.empty() ? path : path + ".journal.old")
+        , open_(false), existed_(false), journal_(nullptr), sequence_(0), snapshot_sequence_(0)
+        , buffered_records_(0), journal_records_(0), synced_batches_(0), compactions_(0), running_(false)
+        , half_life_(DEFAULT_HALF_LIFE_DAYS * SECONDS_PER_DAY) {
+    }
+
+    ~Impl() {
+        close();
+    }
+
+    bool persistent() const {
+        return !path_.empty();
+    }
+
+    bool open() {
+        if (open_) {
+            return true;
+        }
+
+        if (persistent()) {
+            std::error_code ec;
+            existed_ = std::filesystem::exists(path_, ec) || std::filesystem::exists(journal_path_, ec) ||
+                       std::filesystem::exists(rotated_path_, ec);
+
+            // 损坏的快照移到一旁，只用日志恢复，避免覆盖后无法人工找回
+            if (!loadSnapshot()) {
+                std::filesystem::rename(path_, path_ + ".corrupt", ec);
+                spdlog::warn("Moved corrupted user dictionary snapshot to {}.corrupt", path_);
+                snapshot_sequence_ = 0;
+                sequence_ = 0;
+            }
+
+            // 上次压缩中断时轮转出的日志先于当前日志重放，已进入快照的记录按序号跳过
+            size_t replayed = replayJournal(rotated_path_) + replayJournal(journal_path_);
+
+            if (!openJournal()) {
+                return false;
+            }
+            spdlog::info("User dictionary loaded: {} entries, replayed {} journal records", entries_.size(),
+                         replayed);
+
+            running_ = true;
+            worker_ = std::thread([this] { workerLoop(); });
+        }
+
+        open_ = true;
+        return true;
+    }
+
+    void close() {
+        if (!open_) {
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            running_ = false;
+        }
+        cv_.notify_all();
+        if (worker_.joinable()) {
+            worker_.join();
+        }
+
+        if (persistent()) {
+            // 退出时压缩，下次启动不需要重放日志
+            if (journal_records_ > 0 || buffered_records_ > 0) {
+                compact();
+            } else {
+                sync();
+            }
+            std::lock_guard<std::mutex> io_lock(io_mutex_);
+            if (journal_) {
+                std::fclose(journal_);
+                journal_ = nullptr;
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        entries_.clear();
+        index_.clear();
+        initials_index_.clear();
+        buffer_.clear();
+        buffered_records_ = 0;
+        open_ = false;
+    }
+
+    bool addWord(const std::string& word, const std::string& pinyin, int frequency) {
+        if (!isStorableText(word) || !isStorableText(pinyin)) {
+            return false;
+        }
+        const int64_t now = currentTime();
+        std::lock_guard<std::mutex> lock(mutex_);
+        apply(OP_ADD, word, pinyin, frequency, now);
+        appendRecord(OP_ADD, word, pinyin, frequency, now);
+        return true;
+    }
+
+    bool addFrequency(const std::string& word, const std::string& pinyin, int delta) {
+        if (!isStorableText(word) || !isStorableText(pinyin)) {
+            return false;
+        }
+        const int64_t now = currentTime();
+        std::lock_guard<std::mutex> lock(mutex_);
+        apply(OP_FREQUENCY, word, pinyin, delta, now);
+        appendRecord(OP_FREQUENCY, word, pinyin, delta, now);
+        return true;
+    }
+
+    bool removeWord(const std::string& word, const std::string& pinyin) {
+        const int64_t now = currentTime();
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (apply(OP_REMOVE, word, pinyin, 0, now) == 0) {
+            return false;
+        }
+        appendRecord(OP_REMOVE, word, pinyin, 0, now);
+        return true;
+    }
+
+    int prune(int min_frequency) {
+        const int64_t now = currentTime();
+        std::lock_guard<std::mutex> lock(mutex_);
+        int removed = apply(OP_PRUNE, std::string(), std::string(), min_frequency, now);
+        if (removed > 0) {
+            appendRecord(OP_PRUNE, std::string(), std::string(), min_frequency, now);
+        }
+        return removed;
+    }
+
+    size_t search(const std::string& pinyin, size_t max_results, std::vector<UserWord>& out) const {
+        out.clear();
+        if (max_results == 0) {
+            return 0;
+        }
+
+        const int64_t now = currentTime();
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto it = index_.lower_bound(pinyin); it != index_.end(); ++it) {
+            std::string_view key = it->first;
+            if (key.compare(0, pinyin.size(), pinyin) != 0) {
+                break;
+            }
+            if (it->second->user_word) {
+                out.push_back(toUserWord(key, *it->second, now));
+            }
+        }
+
+        rankUserWords(out, max_results);
+        return out.size();
+    }
+
+    size_t searchAbbreviated(const std::string& initials, size_t max_results, const PinyinMatcher& matcher,
+                             std::vector<UserWord>& out) const {
+        out.clear();
+        if (max_results == 0 || initials.empty()) {
+            return 0;
+        }
+
+        const int64_t now = currentTime();
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto it = initials_index_.lower_bound(initials); it != initials_index_.end(); ++it) {
+            if (it->first.compare(0, initials.size(), initials) != 0) {
+                break;
+            }
+            const auto& [key, entry] = *it->second;
+            if (!entry.user_word) {
+                continue;
+            }
+            UserWord word = toUserWord(key, entry, now);
+            if (matcher(word.pinyin)) {
+                out.push_back(std::move(word));
+            }
+        }
+
+        rankUserWords(out, max_results);
+        return out.size();
+    }
+
+    bool find(const std::string& word, const std::string& pinyin, UserWord& out) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = entries_.find(makeKey(word, pinyin));
+        if (it == entries_.end()) {
+            return false;
+        }
+        out = toUserWord(it->first, it->second, currentTime());
+        return true;
+    }
+
+    std::vector<UserWord> getUserWords() const {
+        std::vector<UserWord> words;
+        const int64_t now = currentTime();
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            for (const auto& [key, entry] : entries_) {
+                if (entry.user_word) {
+                    words.push_back(toUserWord(key, entry, now));
+                }
+            }
+        }
+        std::stable_sort(words.begin(), words.end(), [](const UserWord& a, const UserWord& b) {
+            return a.frequency > b.frequency;
+        });
+        return words;
+    }
+
+    bool sync() {
+        std::lock_guard<std::mutex> io_lock(io_mutex_);
+        return syncJournal();
+    }
+
+    bool compact() {
+        if (!persistent()) {
+            return true;
+        }
+
+        std::lock_guard<std::mutex> io_lock(io_mutex_);
+        if (!syncJournal()) {
+            return false;
+        }
+
+        // 复制当前内容（未衰减的存储值）；日志已全部落盘，轮转后新的记录写入新日志
+        std::vector<std::pair<std::string, Entry>> entries;
+        uint64_t sequence;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            entries.assign(entries_.begin(), entries_.end());
+            sequence = sequence_;
+
+            // 上次压缩失败留下的轮转日志仍需保留，本次不轮转，快照之前的记录在重放时按序号跳过
+            std::error_code ec;
+            if (journal_ && !std::filesystem::exists(rotated_path_, ec)) {
+                std::fclose(journal_);
+                journal_ = nullptr;
+                std::filesystem::rename(journal_path_, rotated_path_, ec);
+                if (ec) {
+                    spdlog::warn("Failed to rotate user dictionary journal: {}", ec.message());
+                }
+                journal_ = std::fopen(journal_path_.c_str(), "ab");
+                if (!journal_) {
+                    spdlog::error("Failed to reopen user dictionary journal: {}", journal_path_);
+                }
+            }
+            journal_records_ = 0;
+        }
+
+        if (!writeSnapshot(entries, sequence)) {
+            return false;
+        }
+
+        std::error_code ec;
+        std::filesystem::remove(rotated_path_, ec);
+        snapshot_sequence_ = sequence;
+        ++compactions_;
+        spdlog::debug("Compacted user dictionary: {} entries up to record {}", entries.size(), sequence);
+        return true;
+    }
+
+    UserDictionaryStats getStats() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        UserDictionaryStats stats;
+        for (const auto& [key, entry] : entries_) {
+            if (entry.user_word) {
+                ++stats.words;
+            } else {
+                ++stats.boosts;
+            }
+        }
+        stats.journal_records = journal_records_;
+        stats.synced_batches = synced_batches_;
+        stats.compactions = compactions_;
+        return stats;
+    }
+
+    void setHalfLife(double days) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        half_life_ = std::max(0.0, days) * SECONDS_PER_DAY;
+    }
+
+    bool isOpen() const {
+        return open_;
+    }
+
+    bool existedOnDisk() const {
+        return existed_;
+    }
+
+private:
+    /**
+     * 把存储值衰减到指定时刻：每经过一个半衰期减半（调用者需持有mutex_）
+     */
+    double decayedValue(const Entry& entry, int64_t time) const {
+        if (half_life_ <= 0.0 || time <= entry.updated) {
+            return entry.value;
+        }
+        return entry.value * std::exp2(-static_cast<double>(time - entry.updated) / half_life_);
+    }
+
+    /**
+     * 条目在指定时刻的频率；用户词至少为1，长期不用也不会被衰减掉（调用者需持有mutex_）
+     */
+    int frequencyAt(const Entry& entry, int64_t time) const {
+        double frequency = std::clamp(std::round(decayedValue(entry, time)), static_cast<double>(INT32_MIN),
+                                      static_cast<double>(INT32_MAX));
+        return entry.user_word ? std::max(1, static_cast<int>(frequency)) : static_cast<int>(frequency);
+    }
+
+    UserWord toUserWord(std::string_view key, const Entry& entry, int64_t time) const {
+        size_t separator = key.find(KEY_SEPARATOR);
+        UserWord word;
+        word.pinyin = std::string(key.substr(0, separator));
+        word.word = std::string(key.substr(separator + 1));
+        word.frequency = frequencyAt(entry, time);
+        word.user_word = entry.user_word;
+        return word;
+    }
+
+    void insertEntry(std::string key, const Entry& entry) {
+        auto [it, inserted] = entries_.emplace(std::move(key), entry);
+        if (inserted) {
+            // 节点式哈希表的元素地址在重新散列后保持不变，可直接被有序索引引用
+            index_.emplace(std::string_view(it->first), &it->second);
+            std::string_view pinyin(it->first.data(), it->first.find(KEY_SEPARATOR));
+            initials_index_.emplace(syllableInitials(pinyin), &*it);
+        } else {
+            it->second = entry;
+        }
+    }
+
+    void eraseEntry(std::unordered_map<std::string, Entry>::iterator it) {
+        index_.erase(std::string_view(it->first));
+        std::string_view pinyin(it->first.data(), it->first.find(KEY_SEPARATOR));
+        auto [begin, end] = initials_index_.equal_range(syllableInitials(pinyin));
+        for (auto node = begin; node != end; ++node) {
+            if (node->second == &*it) {
+                initials_index_.erase(node);
+                break;
+            }
+        }
+        entries_.erase(it);
+    }
+
+    /**
+     * 把一条操作作用于内存（调用者需持有mutex_），以日志重放和实时修改共用
+     * 频率增量先把原值衰减到操作时刻再累加，重放时使用记录中的时刻，结果与实时修改一致
+     * @return 受影响的条目数
+     */
+    int apply(char op, const std::string& word, const std::string& pinyin, long long value, int64_t time) {
+        const int clamped = static_cast<int>(std::clamp<long long>(value, INT32_MIN, INT32_MAX));
+        switch (op) {
+            case OP_ADD:
+                insertEntry(makeKey(word, pinyin), Entry{static_cast<double>(clamped), time, true});
+                return 1;
+            case OP_FREQUENCY: {
+                std::string key = makeKey(word, pinyin);
+                auto it = entries_.find(key);
+                if (it == entries_.end()) {
+                    insertEntry(std::move(key), Entry{static_cast<double>(clamped), time, false});
+                } else {
+                    Entry& entry = it->second;
+                    entry.value = std::min(decayedValue(entry, time) + clamped, static_cast<double>(INT32_MAX));
+                    entry.updated = std::max(entry.updated, time);
+                }
+                return 1;
+            }
+            case OP_REMOVE: {
+                auto it = entries_.find(makeKey(word, pinyin));
+                if (it == entries_.end() || !it->second.user_word) {
+                    return 0;
+                }
+                eraseEntry(it);
+                return 1;
+            }
+            case OP_PRUNE: {
+                int removed = 0;
+                for (auto it = entries_.begin(); it != entries_.end();) {
+                    auto next = std::next(it);
+                    if (it->second.user_word && frequencyAt(it->second, time) < clamped) {
+                        eraseEntry(it);
+                        ++removed;
+                    }
+                    it = next;
+                }
+                return removed;
+            }
+            default:
+                return 0;
+        }
+    }
+
+    /**
+     * 追加一条日志到内存缓冲区（调用者需持有mutex_）
+     */
+    void appendRecord(char op, const std::string& word, const std::string& pinyin, int value, int64_t time) {
+        if (!persistent()) {
+            return;
+        }
+
+        buffer_ += std::to_string(++sequence_);
+        buffer_ += '\t';
+        buffer_ += op;
+        buffer_ += '\t';
+        buffer_ += word;
+        buffer_ += '\t';
+        buffer_ += pinyin;
+        buffer_ += '\t';
+        buffer_ += std::to_string(value);
+        buffer_ += '\t';
+        buffer_ += std::to_string(time);
+        buffer_ += '\n';
+
+        if (++buffered_records_ >= MAX_BUFFERED_RECORDS) {
+            cv_.notify_one();
+        }
+    }
+
+    /**
+     * 把缓冲的日志写入文件并同步（调用者需持有io_mutex_）
+     */
+    bool syncJournal() {
+        std::string data;
+        size_t records;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            data.swap(buffer_);
+            records = buffered_records_;
+            buffered_records_ = 0;
+        }
+        if (data.empty()) {
+            return true;
+        }
+
+        if (journal_ && std::fwrite(data.data(), 1, data.size(), journal_) == data.size() && syncFile(journal_)) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            journal_records_ += records;
+            ++synced_batches_;
+            return true;
+        }
+
+        // 写入失败时放回缓冲区，下次同步重试
+        spdlog::error("Failed to write user dictionary journal: {}", journal_path_);
+        std::lock_guard<std::mutex> lock(mutex_);
+        buffer_.insert(0, data);
+        buffered_records_ += records;
+        return false;
+    }
+
+    bool openJournal() {
+        journal_ = std::fopen(journal_path_.c_str(), "ab");
+        if (!journal_) {
+            spdlog::error("Failed to open user dictionary journal: {}", journal_path_);
+            return false;
+        }
+
+        // 上次写入中断留下的不完整末行以换行结束，之后的记录从新行开始
+        std::FILE* reader = std::fopen(journal_path_.c_str(), "rb");
+        if (reader) {
+            bool torn = std::fseek(reader, -1, SEEK_END) == 0 && std::fgetc(reader) != '\n';
+            std::fclose(reader);
+            if (torn) {
+                std::fputc('\n', journal_);
+            }
+        }
+        return true;
+    }
+
+    bool loadSnapshot() {
+        std::FILE* file = std::fopen(path_.c_str(), "rb");
+        if (!file) {
+            return true;
+        }
+
+        std::string line;
+        bool header = true;
+        bool ok = true;
+        long long version = 0;
+        size_t loaded = 0;
+        const int64_t now = currentTime();
+        auto process = [&](std::string_view text) {
+            std::string_view fields[5];
+            size_t count = splitFields(text, fields, 5);
+            if (header) {
+                long long sequence = 0;
+                if (count != 3 || fields[0] != SNAPSHOT_MAGIC || !parseInteger(fields[1], version) ||
+                    (version != SNAPSHOT_VERSION && version != SNAPSHOT_VERSION_UNTIMED) ||
+                    !parseInteger(fields[2], sequence) || sequence < 0) {
+                    ok = false;
+                    return;
+                }
+                snapshot_sequence_ = static_cast<uint64_t>(sequence);
+                sequence_ = snapshot_sequence_;
+                header = false;
+                return;
+            }
+
+            // 类型、词、拼音、存储值、更新时间
+            double value = 0.0;
+            long long updated = now;
+            const size_t expected = version == SNAPSHOT_VERSION_UNTIMED ? 4 : 5;
+            if (count != expected || fields[0].size() != 1 || !parseDouble(fields[3], value) ||
+                (expected == 5 && !parseInteger(fields[4], updated))) {
+                return;
+            }
+            const bool user_word = fields[0][0] == 'U';
+            insertEntry(makeKey(std::string(fields[1]), std::string(fields[2])),
+                        Entry{value, static_cast<int64_t>(updated), user_word});
+            ++loaded;
+        };
+        readLines(file, line, process);
+        std::fclose(file);
+
+        if (!ok || header) {
+            spdlog::error("User dictionary snapshot is corrupted: {}", path_);
+            entries_.clear();
+            index_.clear();
+            initials_index_.clear();
+            return false;
+        }
+        spdlog::debug("Loaded {} entries from user dictionary snapshot {}", loaded, path_);
+        return true;
+    }
+
+    /**
+     * 重放日志中序号大于快照的记录
+     * @return 重放的记录数
+     */
+    size_t replayJournal(const std::string& path) {
+        std::FILE* file = std::fopen(path.c_str(), "rb");
+        if (!file) {
+            return 0;
+        }
+
+        std::string line;
+        size_t replayed = 0;
+        const int64_t now = currentTime();
+        readLines(file, line, [&](std::string_view text) {
+            // 序号、操作、词、拼音、值、时间；旧格式的记录没有时间，按加载时刻计
+            std::string_view fields[6];
+            long long sequence = 0;
+            long long value = 0;
+            long long time = now;
+            size_t count = splitFields(text, fields, 6);
+            if ((count != 5 && count != 6) || fields[1].size() != 1 || !parseInteger(fields[0], sequence) ||
+                !parseInteger(fields[4], value) || (count == 6 && !parseInteger(fields[5], time)) ||
+                sequence <= static_cast<long long>(snapshot_sequence_)) {
+                return;
+            }
+            apply(fields[1][0], std::string(fields[2]), std::string(fields[3]), value, static_cast<int64_t>(time));
+            sequence_ = std::max(sequence_, static_cast<uint64_t>(sequence));
+            ++journal_records_;
+            ++replayed;
+        });
+        std::fclose(file);
+        return replayed;
+    }
+
+    /**
+     * 逐行读取文件，不以换行结尾的末行被视为中断的写入而忽略
+     */
+    template <typename Callback>
+    static void readLines(std::FILE* file, std::string& line, Callback callback) {
+        char chunk[4096];
+        line.clear();
+        size_t read;
+        while ((read = std::fread(chunk, 1, sizeof(chunk), file)) > 0) {
+            for (size_t i = 0; i < read; ++i) {
+                if (chunk[i] == '\n') {
+                    if (!line.empty()) {
+                        callback(std::string_view(line));
+                    }
+                    line.clear();
+                } else {
+                    line += chunk[i];
+                }
+            }
+        }
+    }
+
+    bool writeSnapshot(const std::vector<std::pair<std::string, Entry>>& entries, uint64_t sequence) {
+        const std::string temp_path = path_ + ".tmp";
+        std::FILE* file = std::fopen(temp_path.c_str(), "wb");
+        if (!file) {
+            spdlog::error("Failed to create user dictionary snapshot: {}", temp_path);
+            return false;
+        }
+
+        std::string data;
+        data.reserve(64 + entries.size() * 48);
+        data.append(SNAPSHOT_MAGIC).append(1, '\t').append(std::to_string(SNAPSHOT_VERSION));
+        data.append(1, '\t').append(std::to_string(sequence)).append(1, '\n');
+        for (const auto& [key, entry] : entries) {
+            size_t separator = key.find(KEY_SEPARATOR);
+            data.append(1, entry.user_word ? 'U' : 'B').append(1, '\t');
+            data.append(key, separator + 1, std::string::npos).append(1, '\t');
+            data.append(key, 0, separator).append(1, '\t');
+            data.append(formatDouble(entry.value)).append(1, '\t');
+            data.append(std::to_string(entry.updated)).append(1, '\n');
+        }
+
+        bool ok = std::fwrite(data.data(), 1, data.size(), file) == data.size() && syncFile(file);
+        ok = std::fclose(file) == 0 && ok;
+
+        // 写完并同步后再替换，中断时旧快照保持完整
+        std::error_code ec;
+        if (ok) {
+            std::filesystem::rename(temp_path, path_, ec);
+            ok = !ec;
+        }
+        if (!ok) {
+            spdlog::error("Failed to write user dictionary snapshot: {}", path_);
+            std::filesystem::remove(temp_path, ec);
+        }
+        return ok;
+    }
+
+    void workerLoop() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (running_) {
+            cv_.wait_for(lock, SYNC_INTERVAL, [this] {
+                return !running_ || buffered_records_ >= MAX_BUFFERED_RECORDS;
+            });
+            if (!running_) {
+                break;
+            }
+
+            const bool pending = buffered_records_ > 0;
+            const bool compact_due = journal_records_ + buffered_records_ >= COMPACT_THRESHOLD;
+            lock.unlock();
+            if (compact_due) {
+                compact();
+            } else if (pending) {
+                sync();
+            }
+            lock.lock();
+        }
+    }
+
+    std::string path_;
+    std::string journal_path_;
+    std::string rotated_path_;
+    bool open_;
+    bool existed_;
+
+    // 内存层：哈希表用于精确查找，有序索引用于拼音前缀查询，首字母索引用于简拼查询
+    mutable std::mutex mutex_;
+    std::unordered_map<std::string, Entry> entries_;
+    std::map<std::string_view, const Entry*> index_;
+    std::multimap<std::string, const std::pair<const std::string, Entry>*> initials_index_;
+
+    // 日志：mutex_保护缓冲区和计数，io_mutex_串行化文件写入与压缩
+    std::mutex io_mutex_;
+    std::FILE* journal_;
+    uint64_t sequence_;             // 最后一条日志的序号
+    uint64_t snapshot_sequence_;    // 快照已包含的最后一条日志序号
+    std::string buffer_;
+    size_t buffered_records_;
+    uint64_t journal_records_;
+    uint64_t synced_batches_;
+    uint64_t compactions_;
+
+    std::thread worker_;
+    std::condition_variable cv_;
+    bool running_;
+
+    double half_life_;              // 频率半衰期（秒），0表示不衰减
+};
+
+UserDictionary::UserDictionary(const std::string& path) : pImpl(std::make_unique<Impl>(path)) {
+}
+
+UserDictionary::~UserDictionary() = default;
+
+bool UserDictionary::open() {
+    return pImpl->open();
+}
+
+void UserDictionary::close() {
+    pImpl->close();
+}
+
+bool UserDictionary::isOpen() const {
+    return pImpl->isOpen();
+}
+
+bool UserDictionary::existedOnDisk() const {
+    return pImpl->existedOnDisk();
+}
+
+bool UserDictionary::addWord(const std::string& word, const std::string& pinyin, int frequency) {
+    return pImpl->addWord(word, pinyin, frequency);
+}
+
+bool UserDictionary::addFrequency(const std::string& word, const std::string& pinyin, int delta) {
+    return pImpl->addFrequency(word, pinyin, delta);
+}
+
+bool UserDictionary::removeWord(const std::string& word, const std::string& pinyin) {
+    return pImpl->removeWord(word, pinyin);
+}
+
+int UserDictionary::prune(int min_frequency) {
+    return pImpl->prune(min_frequency);
+}
+
+size_t UserDictionary::search(const std::string& pinyin, size_t max_results, std::vector<UserWord>& out) const {
+    return pImpl->search(pinyin, max_results, out);
+}
+
+size_t UserDictionary::searchAbbreviated(const std::string& initials, size_t max_results,
+                                         const PinyinMatcher& matcher, std::vector<UserWord>& out) const {
+    return pImpl->searchAbbreviated(initials, max_results, matcher, out);
+}
+
+bool UserDictionary::find(const std::string& word, const std::string& pinyin, UserWord& out) const {
+    return pImpl->find(word, pinyin, out);
+}
+
+std::vector<UserWord> UserDictionary::getUserWords() const {
+    return pImpl->getUserWords();
+}
+
+bool UserDictionary::sync() {
+    return pImpl->sync();
+}
+
+bool UserDictionary::compact() {
+    return pImpl->compact();
+}
+
+void UserDictionary::setHalfLife(double days) {
+    pImpl->setHalfLife(days);
+}
+
+UserDictionaryStats UserDictionary::getStats() const {
+    return pImpl->getStats();
+}
+
+} // namespace core
+} // namespace owcat
\ No newline at end of file
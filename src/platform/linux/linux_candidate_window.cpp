@@ -1,10 +1,12 @@
 #include "platform/linux/linux_ime_adapter.h"
+#include "core/latency_tracker.h"
 #include <memory>
 #include <string>
 #include <vector>
 #include <functional>
 #include <iostream>
 #include <algorithm>
+#include <unordered_map>
 
 #ifdef __linux__
 #include <gtk/gtk.h>
@@ -18,6 +20,9 @@
 
 namespace owcat {
 
+// Shaped layouts kept across updates; covers a few pages of paging back and forth
+static constexpr size_t LAYOUT_CACHE_CAPACITY = 128;
+
 // Implementation structure for LinuxCandidateWindow
 struct LinuxCandidateWindow::Impl {
 #ifdef __linux__
@@ -26,10 +31,22 @@ struct LinuxCandidateWindow::Impl {
     GtkWidget* vbox;
     std::vector<GtkWidget*> candidateLabels;
     PangoFontDescription* fontDesc;
+    PangoContext* pangoContext;
     GdkRGBA backgroundColor;
     GdkRGBA textColor;
     GdkRGBA selectedColor;
     GdkRGBA borderColor;
+    
+    // Layout cache keyed by row text; cleared whenever the font changes,
+    // so only candidates that were not on screen recently need shaping
+    struct CachedLayout {
+        PangoLayout* layout;
+        int width;
+        int height;
+        uint64_t lastUse;
+    };
+    std::unordered_map<std::string, CachedLayout> layoutCache;
+    uint64_t layoutClock;
 #endif
     
     // Callbacks
@@ -40,6 +57,7 @@ struct LinuxCandidateWindow::Impl {
     bool isInitialized;
     bool isVisible;
     std::vector<std::string> candidates;
+    std::vector<std::string> rows;  // Formatted text of the rows on the current page
     int selectedIndex;
     int pageSize;
     int currentPage;
@@ -63,6 +81,8 @@ struct LinuxCandidateWindow::Impl {
         drawingArea = nullptr;
         vbox = nullptr;
         fontDesc = nullptr;
+        pangoContext = nullptr;
+        layoutClock = 0;
 #endif
         isInitialized = false;
         isVisible = false;
@@ -94,6 +114,11 @@ struct LinuxCandidateWindow::Impl {
     
     ~Impl() {
 #ifdef __linux__
+        clearLayoutCache();
+        if (pangoContext) {
+            g_object_unref(pangoContext);
+        }
+        
         if (fontDesc) {
             pango_font_description_free(fontDesc);
         }
@@ -103,6 +128,80 @@ struct LinuxCandidateWindow::Impl {
         }
 #endif
     }
+    
+#ifdef __linux__
+    CachedLayout& getLayout(const std::string& text) {
+        auto it = layoutCache.find(text);
+        if (it == layoutCache.end()) {
+            if (layoutCache.size() >= LAYOUT_CACHE_CAPACITY) {
+                evictLayout();
+            }
+            
+            CachedLayout entry;
+            entry.layout = pango_layout_new(pangoContext);
+            pango_layout_set_font_description(entry.layout, fontDesc);
+            pango_layout_set_text(entry.layout, text.c_str(), -1);
+            pango_layout_get_pixel_size(entry.layout, &entry.width, &entry.height);
+            it = layoutCache.emplace(text, entry).first;
+        }
+        it->second.lastUse = ++layoutClock;
+        return it->second;
+    }
+    
+    void evictLayout() {
+        auto oldest = layoutCache.begin();
+        for (auto it = layoutCache.begin(); it != layoutCache.end(); ++it) {
+            if (it->second.lastUse < oldest->second.lastUse) {
+                oldest = it;
+            }
+        }
+        if (oldest != layoutCache.end()) {
+            g_object_unref(oldest->second.layout);
+            layoutCache.erase(oldest);
+        }
+    }
+    
+    void clearLayoutCache() {
+        for (auto& entry : layoutCache) {
+            g_object_unref(entry.second.layout);
+        }
+        layoutCache.clear();
+    }
+    
+    void invalidateRow(int row) {
+        if (!drawingArea || row < 0 || row >= static_cast<int>(rows.size())) {
+            return;
+        }
+        gtk_widget_queue_draw_area(drawingArea, padding, padding + row * itemHeight,
+                                   width - 2 * padding, itemHeight);
+    }
+    
+    /**
+     * Queue redraws after the rows were rebuilt: the whole popup when its size changed,
+     * otherwise only rows whose text changed plus the old and new highlight
+     */
+    void invalidateChanges(const std::vector<std::string>& previousRows, int previousWidth, int previousHeight,
+                           int previousSelectedRow) {
+        if (!drawingArea) {
+            return;
+        }
+        if (width != previousWidth || height != previousHeight) {
+            gtk_widget_queue_draw(drawingArea);
+            return;
+        }
+        
+        const int selectedRow = selectedIndex - currentPage * pageSize;
+        const size_t rowCount = std::max(rows.size(), previousRows.size());
+        for (size_t i = 0; i < rowCount; ++i) {
+            const bool changed = i >= rows.size() || i >= previousRows.size() || rows[i] != previousRows[i];
+            const int row = static_cast<int>(i);
+            if (changed || (row == previousSelectedRow) != (row == selectedRow)) {
+                gtk_widget_queue_draw_area(drawingArea, padding, padding + row * itemHeight,
+                                           width - 2 * padding, itemHeight);
+            }
+        }
+    }
+#endif
 };
 
 LinuxCandidateWindow::LinuxCandidateWindow() : pImpl(std::make_unique<Impl>()) {}
@@ -138,6 +237,7 @@ bool LinuxCandidateWindow::initialize() {
     // Create drawing area for custom rendering
     pImpl->drawingArea = gtk_drawing_area_new();
     gtk_box_pack_start(GTK_BOX(pImpl->vbox), pImpl->drawingArea, TRUE, TRUE, 0);
+    pImpl->pangoContext = gtk_widget_create_pango_context(pImpl->drawingArea);
     
     // Connect drawing signal
     g_signal_connect(pImpl->drawingArea, "draw", G_CALLBACK(onDraw), this);
@@ -174,6 +274,13 @@ void LinuxCandidateWindow::shutdown() {
     
     hide();
     
+    pImpl->clearLayoutCache();
+    pImpl->rows.clear();
+    if (pImpl->pangoContext) {
+        g_object_unref(pImpl->pangoContext);
+        pImpl->pangoContext = nullptr;
+    }
+    
     if (pImpl->fontDesc) {
         pango_font_description_free(pImpl->fontDesc);
         pImpl->fontDesc = nullptr;
@@ -194,6 +301,8 @@ void LinuxCandidateWindow::show(const std::vector<std::string>& candidates, int
         return;
     }
     
+    core::ScopedLatency latency(core::LatencyStage::CANDIDATE_RENDER);
+    
     pImpl->candidates = candidates;
     pImpl->selectedIndex = selectedIndex;
     pImpl->x = x;
@@ -232,31 +341,48 @@ void LinuxCandidateWindow::updateCandidates(const std::vector<std::string>& cand
         return;
     }
     
+    core::ScopedLatency latency(core::LatencyStage::CANDIDATE_RENDER);
+    
+    const std::vector<std::string> previousRows = std::move(pImpl->rows);
+    const int previousWidth = pImpl->width;
+    const int previousHeight = pImpl->height;
+    const int previousSelectedRow = pImpl->selectedIndex - pImpl->currentPage * pImpl->pageSize;
+    
     pImpl->candidates = candidates;
     pImpl->selectedIndex = selectedIndex;
     pImpl->currentPage = selectedIndex / pImpl->pageSize;
     
+    // Only candidates missing from the layout cache are shaped
     updateWindowSize();
     
 #ifdef __linux__
-    if (pImpl->drawingArea) {
-        gtk_widget_queue_draw(pImpl->drawingArea);
-    }
+    pImpl->invalidateChanges(previousRows, previousWidth, previousHeight, previousSelectedRow);
 #endif
 }
 
 void LinuxCandidateWindow::updateSelection(int selectedIndex) {
-    if (!pImpl->isInitialized) {
+    if (!pImpl->isInitialized || selectedIndex == pImpl->selectedIndex) {
         return;
     }
     
+    const int previousPage = pImpl->currentPage;
+    const int previousSelectedRow = pImpl->selectedIndex - previousPage * pImpl->pageSize;
     pImpl->selectedIndex = selectedIndex;
     pImpl->currentPage = selectedIndex / pImpl->pageSize;
     
 #ifdef __linux__
-    if (pImpl->drawingArea) {
-        gtk_widget_queue_draw(pImpl->drawingArea);
+    if (pImpl->currentPage != previousPage) {
+        const std::vector<std::string> previousRows = std::move(pImpl->rows);
+        const int previousWidth = pImpl->width;
+        const int previousHeight = pImpl->height;
+        updateWindowSize();
+        pImpl->invalidateChanges(previousRows, previousWidth, previousHeight, previousSelectedRow);
+        return;
     }
+    
+    // Moving the highlight within a page repaints just the two rows involved
+    pImpl->invalidateRow(previousSelectedRow);
+    pImpl->invalidateRow(selectedIndex - pImpl->currentPage * pImpl->pageSize);
 #endif
 }
 
@@ -287,6 +413,12 @@ void LinuxCandidateWindow::setFont(const std::string& fontFamily, int fontSize)
     pImpl->fontSize = fontSize;
     initializeFont();
     updateWindowSize();
+    
+#ifdef __linux__
+    if (pImpl->drawingArea) {
+        gtk_widget_queue_draw(pImpl->drawingArea);
+    }
+#endif
 }
 
 void LinuxCandidateWindow::setColors(const std::string& background, const std::string& text, 
@@ -335,36 +467,30 @@ int LinuxCandidateWindow::getCurrentPage() const {
 void LinuxCandidateWindow::updateWindowSize() {
 #ifdef __linux__
     if (!pImpl->isInitialized || pImpl->candidates.empty()) {
+        pImpl->rows.clear();
         return;
     }
     
     // Calculate required size based on candidates
     int visibleCandidates = std::min(pImpl->pageSize, static_cast<int>(pImpl->candidates.size()) - pImpl->currentPage * pImpl->pageSize);
     
+    // Rebuild the rows of the current page; their layouts come from the cache
+    pImpl->rows.clear();
+    for (int i = 0; i < visibleCandidates; i++) {
+        pImpl->rows.push_back(formatCandidateText(pImpl->currentPage * pImpl->pageSize + i));
+    }
+    
     // Calculate text dimensions
     int maxWidth = 0;
-    if (pImpl->fontDesc) {
-        PangoLayout* layout = pango_cairo_create_layout(nullptr);
-        if (layout) {
-            pango_layout_set_font_description(layout, pImpl->fontDesc);
-            
-            for (int i = 0; i < visibleCandidates; i++) {
-                int candidateIndex = pImpl->currentPage * pImpl->pageSize + i;
-                if (candidateIndex < static_cast<int>(pImpl->candidates.size())) {
-                    std::string text = formatCandidateText(candidateIndex);
-                    pango_layout_set_text(layout, text.c_str(), -1);
-                    
-                    int textWidth, textHeight;
-                    pango_layout_get_pixel_size(layout, &textWidth, &textHeight);
-                    maxWidth = std::max(maxWidth, textWidth);
-                }
-            }
-            
-            g_object_unref(layout);
+    if (pImpl->fontDesc && pImpl->pangoContext) {
+        for (const auto& row : pImpl->rows) {
+            maxWidth = std::max(maxWidth, pImpl->getLayout(row).width);
         }
     }
     
     // Calculate window dimensions
+    const int previousWidth = pImpl->width;
+    const int previousHeight = pImpl->height;
     pImpl->width = maxWidth + 2 * pImpl->padding + 2 * pImpl->borderWidth;
     pImpl->height = visibleCandidates * pImpl->itemHeight + 2 * pImpl->padding + 2 * pImpl->borderWidth;
     
@@ -372,7 +498,7 @@ void LinuxCandidateWindow::updateWindowSize() {
     pImpl->width = std::max(pImpl->width, 100);
     pImpl->height = std::max(pImpl->height, 50);
     
-    if (pImpl->window) {
+    if (pImpl->window && (pImpl->width != previousWidth || pImpl->height != previousHeight)) {
         gtk_window_resize(GTK_WINDOW(pImpl->window), pImpl->width, pImpl->height);
         gtk_widget_set_size_request(pImpl->drawingArea, pImpl->width, pImpl->height);
     }
@@ -421,6 +547,9 @@ void LinuxCandidateWindow::initializeFont() {
     pImpl->fontDesc = pango_font_description_new();
     pango_font_description_set_family(pImpl->fontDesc, pImpl->fontFamily.c_str());
     pango_font_description_set_size(pImpl->fontDesc, pImpl->fontSize * PANGO_SCALE);
+    
+    // Cached layouts were shaped with the old font
+    pImpl->clearLayoutCache();
 #endif
 }
 
@@ -467,12 +596,13 @@ void LinuxCandidateWindow::selectCandidate(int index) {
 
 void LinuxCandidateWindow::highlightCandidate(int index) {
     if (index != pImpl->selectedIndex) {
+        const int previousSelectedRow = pImpl->selectedIndex - pImpl->currentPage * pImpl->pageSize;
         pImpl->selectedIndex = index;
         
 #ifdef __linux__
-        if (pImpl->drawingArea) {
-            gtk_widget_queue_draw(pImpl->drawingArea);
-        }
+        // Hovered rows are always on the current page
+        pImpl->invalidateRow(previousSelectedRow);
+        pImpl->invalidateRow(index - pImpl->currentPage * pImpl->pageSize);
 #endif
         
         if (pImpl->highlightCallback) {
@@ -485,6 +615,8 @@ void LinuxCandidateWindow::highlightCandidate(int index) {
 #ifdef __linux__
 gboolean LinuxCandidateWindow::onDraw(GtkWidget* widget, cairo_t* cr, gpointer userData) {
     LinuxCandidateWindow* window = static_cast<LinuxCandidateWindow*>(userData);
+    // 实际绘制在主循环中进行，归属到本线程最近的输入事件
+    core::ScopedLatency latency(core::LatencyStage::CANDIDATE_RENDER);
     return window->handleDraw(cr);
 }
 
@@ -499,11 +631,11 @@ gboolean LinuxCandidateWindow::onMotionNotify(GtkWidget* widget, GdkEventMotion*
 }
 
 gboolean LinuxCandidateWindow::handleDraw(cairo_t* cr) {
-    if (pImpl->candidates.empty()) {
+    if (pImpl->rows.empty() || !pImpl->pangoContext) {
         return FALSE;
     }
     
-    // Clear background
+    // Clear background (limited to the damaged area by the clip)
     cairo_set_source_rgba(cr, pImpl->backgroundColor.red, pImpl->backgroundColor.green, 
                           pImpl->backgroundColor.blue, pImpl->backgroundColor.alpha);
     cairo_paint(cr);
@@ -517,27 +649,19 @@ gboolean LinuxCandidateWindow::handleDraw(cairo_t* cr) {
         cairo_stroke(cr);
     }
     
-    // Create Pango layout
-    PangoLayout* layout = pango_cairo_create_layout(cr);
-    if (!layout) {
-        return FALSE;
-    }
-    
-    pango_layout_set_font_description(layout, pImpl->fontDesc);
-    
-    // Draw candidates
-    int visibleCandidates = std::min(pImpl->pageSize, static_cast<int>(pImpl->candidates.size()) - pImpl->currentPage * pImpl->pageSize);
+    // Only rows intersecting the damaged area are drawn
+    double clipX1, clipY1, clipX2, clipY2;
+    cairo_clip_extents(cr, &clipX1, &clipY1, &clipX2, &clipY2);
+    const int rowCount = static_cast<int>(pImpl->rows.size());
+    const int firstRow = std::max(0, static_cast<int>((clipY1 - pImpl->padding) / pImpl->itemHeight));
+    const int lastRow = std::min(rowCount - 1, static_cast<int>((clipY2 - pImpl->padding) / pImpl->itemHeight));
+    const int selectedRow = pImpl->selectedIndex - pImpl->currentPage * pImpl->pageSize;
     
-    for (int i = 0; i < visibleCandidates; i++) {
-        int candidateIndex = pImpl->currentPage * pImpl->pageSize + i;
-        if (candidateIndex >= static_cast<int>(pImpl->candidates.size())) {
-            break;
-        }
-        
+    for (int i = firstRow; i <= lastRow; i++) {
         int itemY = pImpl->padding + i * pImpl->itemHeight;
         
         // Draw selection background
-        if (candidateIndex == pImpl->selectedIndex) {
+        if (i == selectedRow) {
             cairo_set_source_rgba(cr, pImpl->selectedColor.red, pImpl->selectedColor.green, 
                                   pImpl->selectedColor.blue, 0.3);
             cairo_rectangle(cr, pImpl->padding, itemY, 
@@ -546,10 +670,7 @@ gboolean LinuxCandidateWindow::handleDraw(cairo_t* cr) {
         }
         
         // Draw candidate text
-        std::string text = formatCandidateText(candidateIndex);
-        pango_layout_set_text(layout, text.c_str(), -1);
-        
-        if (candidateIndex == pImpl->selectedIndex) {
+        if (i == selectedRow) {
             cairo_set_source_rgba(cr, pImpl->selectedColor.red, pImpl->selectedColor.green, 
                                   pImpl->selectedColor.blue, pImpl->selectedColor.alpha);
         } else {
@@ -558,10 +679,9 @@ gboolean LinuxCandidateWindow::handleDraw(cairo_t* cr) {
         }
         
         cairo_move_to(cr, pImpl->padding + 5, itemY + (pImpl->itemHeight - pImpl->fontSize) / 2);
-        pango_cairo_show_layout(cr, layout);
+        pango_cairo_show_layout(cr, pImpl->getLayout(pImpl->rows[i]).layout);
     }
     
-    g_object_unref(layout);
     return TRUE;
 }
 
@@ -1,4 +1,5 @@
 #include "platform/linux/linux_ime_adapter.h"
+#include "core/latency_tracker.h"
 #include <memory>
 #include <string>
 #include <vector>
@@ -638,6 +639,7 @@ bool LinuxImeAdapter::processKeyEvent(unsigned int keyval, unsigned int keycode,
     
     // Call key event callback
     if (pImpl->keyEventCallback) {
+        core::ScopedLatency latency(core::LatencyStage::PLATFORM_KEY);
         return pImpl->keyEventCallback(keyEvent);
     }
     
@@ -47,6 +47,22 @@ struct LinuxInputEngine::Impl {
     int selectedCandidate;
     bool preeditVisible;
     bool lookupTableVisible;
+    std::string preeditString;
+    int preeditCursor;
+    
+    // What the panel last received; updates are diffed against it and
+    // flushed once per main loop iteration so fast typing costs one emission
+    std::vector<std::string> sentCandidates;
+    int sentCursor;
+    bool sentTableVisible;
+    bool tableSent;
+    std::string sentPreedit;
+    int sentPreeditCursor;
+    bool sentPreeditVisible;
+    bool preeditSent;
+#ifdef __linux__
+    guint flushSource;
+#endif
     
     // Configuration
     std::string engineName;
@@ -65,6 +81,7 @@ struct LinuxInputEngine::Impl {
         lookupTable = nullptr;
         statusProperty = nullptr;
         propList = nullptr;
+        flushSource = 0;
 #endif
         isInitialized = false;
         isEnabled = false;
@@ -72,6 +89,8 @@ struct LinuxInputEngine::Impl {
         selectedCandidate = 0;
         preeditVisible = false;
         lookupTableVisible = false;
+        preeditCursor = 0;
+        resetSentState();
         
         engineName = "owcat";
         displayName = "OwCat";
@@ -85,6 +104,7 @@ struct LinuxInputEngine::Impl {
     
     ~Impl() {
 #ifdef __linux__
+        cancelFlush();
         if (preeditText) {
             g_object_unref(preeditText);
         }
@@ -102,6 +122,109 @@ struct LinuxInputEngine::Impl {
         }
 #endif
     }
+    
+    void resetSentState() {
+        sentCandidates.clear();
+        sentCursor = 0;
+        sentTableVisible = false;
+        tableSent = false;
+        sentPreedit.clear();
+        sentPreeditCursor = 0;
+        sentPreeditVisible = false;
+        preeditSent = false;
+    }
+    
+#ifdef __linux__
+    void scheduleFlush() {
+        if (flushSource == 0) {
+            flushSource = g_idle_add_full(G_PRIORITY_HIGH_IDLE, onFlush, this, nullptr);
+        }
+    }
+    
+    void cancelFlush() {
+        if (flushSource != 0) {
+            g_source_remove(flushSource);
+            flushSource = 0;
+        }
+    }
+    
+    static gboolean onFlush(gpointer userData) {
+        Impl* impl = static_cast<Impl*>(userData);
+        impl->flushSource = 0;
+        impl->flush();
+        return G_SOURCE_REMOVE;
+    }
+    
+    void flush() {
+        if (!engine) {
+            return;
+        }
+        flushPreedit();
+        flushLookupTable();
+    }
+    
+    void flushPreedit() {
+        if (!preeditVisible) {
+            if (preeditSent && sentPreeditVisible) {
+                ibus_engine_hide_preedit_text(engine);
+                sentPreeditVisible = false;
+            }
+            return;
+        }
+        
+        if (!preeditSent || preeditString != sentPreedit || preeditCursor != sentPreeditCursor) {
+            // The IBusText is only rebuilt when the text itself changed
+            if (!preeditText || !preeditSent || preeditString != sentPreedit) {
+                if (preeditText) {
+                    g_object_unref(preeditText);
+                }
+                preeditText = ibus_text_new_from_string(preeditString.c_str());
+                g_object_ref_sink(preeditText);
+            }
+            ibus_engine_update_preedit_text(engine, preeditText, preeditCursor, TRUE);
+            sentPreedit = preeditString;
+            sentPreeditCursor = preeditCursor;
+            preeditSent = true;
+        } else if (!sentPreeditVisible) {
+            ibus_engine_show_preedit_text(engine);
+        }
+        sentPreeditVisible = true;
+    }
+    
+    void flushLookupTable() {
+        if (!lookupTable) {
+            return;
+        }
+        
+        if (!lookupTableVisible) {
+            if (tableSent && sentTableVisible) {
+                ibus_engine_hide_lookup_table(engine);
+                sentTableVisible = false;
+            }
+            return;
+        }
+        
+        if (!tableSent || candidates != sentCandidates) {
+            ibus_lookup_table_clear(lookupTable);
+            for (const auto& candidate : candidates) {
+                // The table takes ownership of the floating text
+                ibus_lookup_table_append_candidate(lookupTable, ibus_text_new_from_string(candidate.c_str()));
+            }
+            ibus_lookup_table_set_cursor_pos(lookupTable, selectedCandidate);
+            ibus_engine_update_lookup_table_fast(engine, lookupTable, TRUE);
+            sentCandidates = candidates;
+            tableSent = true;
+        } else if (selectedCandidate != sentCursor) {
+            // Same candidates: only the cursor moved, send just the visible page
+            ibus_lookup_table_set_cursor_pos(lookupTable, selectedCandidate);
+            ibus_engine_update_lookup_table_fast(engine, lookupTable, TRUE);
+        } else if (!sentTableVisible) {
+            ibus_engine_show_lookup_table(engine);
+        }
+        sentCursor = selectedCandidate;
+        sentTableVisible = true;
+    }
+#endif
 };
 
 LinuxInputEngine::LinuxInputEngine() : pImpl(std::make_unique<Impl>()) {}
@@ -120,6 +243,7 @@ bool LinuxInputEngine::initialize() {
         std::cerr << "Failed to create preedit text" << std::endl;
         return false;
     }
+    g_object_ref_sink(pImpl->preeditText);
     
     // Initialize lookup table
     pImpl->lookupTable = ibus_lookup_table_new(10, 0, TRUE, TRUE);
@@ -147,6 +271,8 @@ void LinuxInputEngine::shutdown() {
     }
     
     // Clean up IBus objects
+    pImpl->cancelFlush();
+    pImpl->resetSentState();
     if (pImpl->preeditText) {
         g_object_unref(pImpl->preeditText);
         pImpl->preeditText = nullptr;
@@ -337,9 +463,7 @@ void LinuxInputEngine::showPreeditText() {
     pImpl->preeditVisible = true;
     
 #ifdef __linux__
-    if (pImpl->engine && pImpl->preeditText) {
-        ibus_engine_show_preedit_text(pImpl->engine);
-    }
+    pImpl->scheduleFlush();
 #endif
 }
 
@@ -347,47 +471,42 @@ void LinuxInputEngine::hidePreeditText() {
     pImpl->preeditVisible = false;
     
 #ifdef __linux__
-    if (pImpl->engine) {
-        ibus_engine_hide_preedit_text(pImpl->engine);
-    }
+    pImpl->scheduleFlush();
 #endif
 }
 
 void LinuxInputEngine::updatePreeditText(const std::string& text, int cursorPos, bool visible) {
-#ifdef __linux__
-    if (pImpl->preeditText) {
-        g_object_unref(pImpl->preeditText);
-    }
-    
-    pImpl->preeditText = ibus_text_new_from_string(text.c_str());
+    pImpl->preeditString = text;
+    pImpl->preeditCursor = cursorPos;
+    pImpl->preeditVisible = visible;
     
-    if (pImpl->engine) {
-        ibus_engine_update_preedit_text(pImpl->engine, pImpl->preeditText, cursorPos, visible);
-    }
+#ifdef __linux__
+    pImpl->scheduleFlush();
 #endif
-    
-    pImpl->preeditVisible = visible;
 }
 
 void LinuxInputEngine::commitText(const std::string& text) {
+    // text may refer to the current input or a candidate, both cleared below
+    const std::string committed = text;
+    clearInput();
+    
 #ifdef __linux__
+    // Hide the preedit and lookup table synchronously so a pending idle
+    // flush carrying the old input cannot reach the panel after the commit
+    pImpl->cancelFlush();
+    pImpl->flush();
     if (pImpl->engine) {
-        IBusText* commitText = ibus_text_new_from_string(text.c_str());
-        ibus_engine_commit_text(pImpl->engine, commitText);
-        g_object_unref(commitText);
+        // Floating text is released by IBus after the signal is emitted
+        ibus_engine_commit_text(pImpl->engine, ibus_text_new_from_string(committed.c_str()));
     }
 #endif
-    
-    clearInput();
 }
 
 void LinuxInputEngine::showLookupTable() {
     pImpl->lookupTableVisible = true;
     
 #ifdef __linux__
-    if (pImpl->engine) {
-        ibus_engine_show_lookup_table(pImpl->engine);
-    }
+    pImpl->scheduleFlush();
 #endif
 }
 
@@ -395,40 +514,28 @@ void LinuxInputEngine::hideLookupTable() {
     pImpl->lookupTableVisible = false;
     
 #ifdef __linux__
-    if (pImpl->engine) {
-        ibus_engine_hide_lookup_table(pImpl->engine);
-    }
+    pImpl->scheduleFlush();
 #endif
 }
 
 void LinuxInputEngine::updateLookupTable(const std::vector<std::string>& candidates, int selectedIndex, bool visible) {
     pImpl->candidates = candidates;
     pImpl->selectedCandidate = selectedIndex;
+    pImpl->lookupTableVisible = visible;
     
 #ifdef __linux__
-    if (pImpl->lookupTable) {
-        ibus_lookup_table_clear(pImpl->lookupTable);
-        
-        for (const auto& candidate : candidates) {
-            IBusText* text = ibus_text_new_from_string(candidate.c_str());
-            ibus_lookup_table_append_candidate(pImpl->lookupTable, text);
-            g_object_unref(text);
-        }
-        
-        ibus_lookup_table_set_cursor_pos(pImpl->lookupTable, selectedIndex);
-        
-        if (pImpl->engine) {
-            ibus_engine_update_lookup_table(pImpl->engine, pImpl->lookupTable, visible);
-        }
-    }
+    pImpl->scheduleFlush();
 #endif
-    
-    pImpl->lookupTableVisible = visible;
 }
 
 void LinuxInputEngine::setEngine(void* engine) {
 #ifdef __linux__
+    if (pImpl->engine != engine) {
+        // A different engine object has not seen any of our updates yet
+        pImpl->resetSentState();
+    }
     pImpl->engine = static_cast<IBusEngine*>(engine);
+    pImpl->scheduleFlush();
 #endif
 }
 
@@ -613,21 +720,20 @@ void LinuxInputEngine::generateCandidates() {
 
 void LinuxInputEngine::updateLookupTableSelection() {
 #ifdef __linux__
-    if (pImpl->lookupTable && pImpl->engine) {
-        ibus_lookup_table_set_cursor_pos(pImpl->lookupTable, pImpl->selectedCandidate);
-        ibus_engine_update_lookup_table(pImpl->engine, pImpl->lookupTable, true);
-    }
+    // The flush sees unchanged candidates and only moves the cursor
+    pImpl->scheduleFlush();
 #endif
 }
 
+// Paging moves the cursor on our own candidate list; the table itself may
+// still hold the previous candidates until the pending flush runs
 void LinuxInputEngine::pageUpCandidates() {
 #ifdef __linux__
     if (pImpl->lookupTable) {
-        if (ibus_lookup_table_page_up(pImpl->lookupTable)) {
-            pImpl->selectedCandidate = ibus_lookup_table_get_cursor_pos(pImpl->lookupTable);
-            if (pImpl->engine) {
-                ibus_engine_update_lookup_table(pImpl->engine, pImpl->lookupTable, true);
-            }
+        const int pageSize = static_cast<int>(ibus_lookup_table_get_page_size(pImpl->lookupTable));
+        if (pageSize > 0 && pImpl->selectedCandidate >= pageSize) {
+            pImpl->selectedCandidate -= pageSize;
+            pImpl->scheduleFlush();
         }
     }
 #endif
@@ -636,11 +742,11 @@ void LinuxInputEngine::pageUpCandidates() {
 void LinuxInputEngine::pageDownCandidates() {
 #ifdef __linux__
     if (pImpl->lookupTable) {
-        if (ibus_lookup_table_page_down(pImpl->lookupTable)) {
-            pImpl->selectedCandidate = ibus_lookup_table_get_cursor_pos(pImpl->lookupTable);
-            if (pImpl->engine) {
-                ibus_engine_update_lookup_table(pImpl->engine, pImpl->lookupTable, true);
-            }
+        const int pageSize = static_cast<int>(ibus_lookup_table_get_page_size(pImpl->lookupTable));
+        const int count = static_cast<int>(pImpl->candidates.size());
+        if (pageSize > 0 && (pImpl->selectedCandidate / pageSize + 1) * pageSize < count) {
+            pImpl->selectedCandidate = std::min(count - 1, pImpl->selectedCandidate + pageSize);
+            pImpl->scheduleFlush();
         }
     }
 #endif
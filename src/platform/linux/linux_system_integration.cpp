@@ -51,6 +51,10 @@ struct LinuxSystemIntegration::Impl {
     std::string displayServer;
     std::string ibusVersion;
     
+    // Previous /proc/stat sample for CPU load deltas
+    unsigned long long previousCpuIdle = 0;
+    unsigned long long previousCpuTotal = 0;
+    
     Impl() {
 #ifdef __linux__
         bus = nullptr;
@@ -308,6 +312,65 @@ bool LinuxSystemIntegration::setCurrentIME(const std::string& id) {
 #endif
 }
 
+bool LinuxSystemIntegration::getSystemLoad(core::SystemLoad& load) {
+    load = core::SystemLoad();
+    
+#ifdef __linux__
+    // Aggregate line: cpu user nice system idle iowait irq softirq steal
+    std::ifstream stat("/proc/stat");
+    std::string label;
+    unsigned long long user = 0, nice = 0, system = 0, idle = 0, iowait = 0, irq = 0, softirq = 0, steal = 0;
+    if (!(stat >> label >> user >> nice >> system >> idle >> iowait >> irq >> softirq >> steal) || label != "cpu") {
+        return false;
+    }
+    
+    const unsigned long long idleTime = idle + iowait;
+    const unsigned long long totalTime = user + nice + system + idleTime + irq + softirq + steal;
+    if (pImpl->previousCpuTotal > 0 && totalTime > pImpl->previousCpuTotal) {
+        const double totalDelta = static_cast<double>(totalTime - pImpl->previousCpuTotal);
+        const double idleDelta = static_cast<double>(idleTime - std::min(idleTime, pImpl->previousCpuIdle));
+        load.cpu_load = std::max(0.0, std::min(1.0, 1.0 - idleDelta / totalDelta));
+    }
+    pImpl->previousCpuIdle = idleTime;
+    pImpl->previousCpuTotal = totalTime;
+    
+    // Any discharging battery means we are running on battery power
+    const std::string powerSupplyDir = "/sys/class/power_supply";
+    DIR* dir = opendir(powerSupplyDir.c_str());
+    if (dir) {
+        struct dirent* entry;
+        while ((entry = readdir(dir)) != nullptr) {
+            if (entry->d_name[0] == '.') {
+                continue;
+            }
+            
+            const std::string supply = powerSupplyDir + "/" + entry->d_name;
+            std::string type;
+            std::ifstream typeFile(supply + "/type");
+            if (!std::getline(typeFile, type) || type != "Battery") {
+                continue;
+            }
+            
+            std::string status;
+            std::ifstream statusFile(supply + "/status");
+            if (std::getline(statusFile, status) && status == "Discharging") {
+                load.on_battery = true;
+            }
+            
+            int capacity = -1;
+            std::ifstream capacityFile(supply + "/capacity");
+            if (capacityFile >> capacity && (load.battery_percent < 0 || capacity < load.battery_percent)) {
+                load.battery_percent = capacity;
+            }
+        }
+        closedir(dir);
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
 std::vector<std::map<std::string, std::string>> LinuxSystemIntegration::getRunningProcesses() {
     std::vector<std::map<std::string, std::string>> processes;
     
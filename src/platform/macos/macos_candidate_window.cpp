@@ -13,6 +13,101 @@
 @class OwCatCandidateWindowController;
 @class OwCatCandidateView;
 
+// Number of candidate rows allocated up front; the pool only grows past this for unusually long pages
+static const NSUInteger kCandidateCellPoolSize = 10;
+
+// Reusable candidate row. Its layers live as long as the view; updates only change
+// the strings and colors, and unchanged rows are not touched at all.
+@interface OwCatCandidateCell : NSObject {
+    CALayer* _backgroundLayer;
+    CATextLayer* _indexLayer;
+    CATextLayer* _textLayer;
+    NSString* _text;
+    NSInteger _index;
+    BOOL _selected;
+}
+
+@property (nonatomic, readonly) NSString* text;
+
+- (instancetype)initWithParentLayer:(CALayer*)parent;
+- (void)setIndex:(NSInteger)index text:(NSString*)text;
+- (void)setSelected:(BOOL)selected textColor:(NSColor*)textColor
+      selectedTextColor:(NSColor*)selectedTextColor selectedBackgroundColor:(NSColor*)selectedBackgroundColor;
+- (void)applyFont:(NSFont*)font scale:(CGFloat)scale;
+- (void)setFrame:(NSRect)frame;
+- (void)setHidden:(BOOL)hidden;
+
+@end
+
+@implementation OwCatCandidateCell
+
+@synthesize text = _text;
+
+- (instancetype)initWithParentLayer:(CALayer*)parent {
+    self = [super init];
+    if (self) {
+        _index = -1;
+        _selected = NO;
+        _text = nil;
+        
+        _backgroundLayer = [CALayer layer];
+        _indexLayer = [CATextLayer layer];
+        _textLayer = [CATextLayer layer];
+        for (CATextLayer* layer in @[_indexLayer, _textLayer]) {
+            [layer setTruncationMode:kCATruncationEnd];
+            [layer setAlignmentMode:kCAAlignmentLeft];
+            [_backgroundLayer addSublayer:layer];
+        }
+        [_backgroundLayer setHidden:YES];
+        [parent addSublayer:_backgroundLayer];
+    }
+    return self;
+}
+
+- (void)setIndex:(NSInteger)index text:(NSString*)text {
+    if (index != _index) {
+        _index = index;
+        [_indexLayer setString:[NSString stringWithFormat:@"%ld.", (long)(index + 1)]];
+    }
+    if (!_text || ![text isEqualToString:_text]) {
+        _text = [text copy];
+        [_textLayer setString:_text];
+    }
+}
+
+- (void)setSelected:(BOOL)selected textColor:(NSColor*)textColor
+      selectedTextColor:(NSColor*)selectedTextColor selectedBackgroundColor:(NSColor*)selectedBackgroundColor {
+    _selected = selected;
+    CGColorRef foreground = [(selected ? selectedTextColor : textColor) CGColor];
+    [_indexLayer setForegroundColor:foreground];
+    [_textLayer setForegroundColor:foreground];
+    [_backgroundLayer setBackgroundColor:selected ? [selectedBackgroundColor CGColor] : NULL];
+}
+
+- (void)applyFont:(NSFont*)font scale:(CGFloat)scale {
+    for (CATextLayer* layer in @[_indexLayer, _textLayer]) {
+        [layer setFont:(__bridge CFTypeRef)font];
+        [layer setFontSize:[font pointSize]];
+        [layer setContentsScale:scale];
+    }
+}
+
+- (void)setFrame:(NSRect)frame {
+    [_backgroundLayer setFrame:NSRectToCGRect(frame)];
+    
+    // Vertically center single-line text inside the row
+    CGFloat lineHeight = ceil(frame.size.height * 0.75);
+    CGFloat y = (frame.size.height - lineHeight) / 2;
+    [_indexLayer setFrame:CGRectMake(2, y, 25, lineHeight)];
+    [_textLayer setFrame:CGRectMake(30, y, MAX(0, frame.size.width - 32), lineHeight)];
+}
+
+- (void)setHidden:(BOOL)hidden {
+    [_backgroundLayer setHidden:hidden];
+}
+
+@end
+
 // Objective-C Candidate View
 @interface OwCatCandidateView : NSView {
     MacOSCandidateWindow* _cppWindow;
@@ -26,6 +121,7 @@
     NSColor* _borderColor;
     CGFloat _itemHeight;
     CGFloat _padding;
+    NSMutableArray* _cells;
 }
 
 @property (nonatomic, assign) MacOSCandidateWindow* cppWindow;
@@ -45,7 +141,6 @@
 - (NSSize)calculateOptimalSize;
 - (void)mouseDown:(NSEvent*)event;
 - (void)mouseMoved:(NSEvent*)event;
-- (void)drawRect:(NSRect)dirtyRect;
 
 @end
 
@@ -80,6 +175,19 @@
         _selectedTextColor = [NSColor whiteColor];
         _borderColor = [NSColor colorWithRed:0.7 green:0.7 blue:0.7 alpha:1.0];
         
+        // Rows are drawn by reusable layers instead of drawRect:
+        [self setWantsLayer:YES];
+        [self setLayerContentsRedrawPolicy:NSViewLayerContentsRedrawNever];
+        CALayer* layer = [self layer];
+        [layer setBackgroundColor:[_backgroundColor CGColor]];
+        [layer setBorderColor:[_borderColor CGColor]];
+        [layer setBorderWidth:1.0];
+        
+        _cells = [NSMutableArray arrayWithCapacity:kCandidateCellPoolSize];
+        for (NSUInteger i = 0; i < kCandidateCellPoolSize; i++) {
+            [self addCell];
+        }
+        
         // Enable mouse tracking
         NSTrackingArea* trackingArea = [[NSTrackingArea alloc] 
                                        initWithRect:NSZeroRect
@@ -91,20 +199,73 @@
     return self;
 }
 
+// Rows are laid out top to bottom, matching the hit testing below
+- (BOOL)isFlipped {
+    return YES;
+}
+
+- (OwCatCandidateCell*)addCell {
+    OwCatCandidateCell* cell = [[OwCatCandidateCell alloc] initWithParentLayer:[self layer]];
+    [cell applyFont:_font scale:[self backingScale]];
+    [_cells addObject:cell];
+    return cell;
+}
+
+- (CGFloat)backingScale {
+    NSWindow* window = [self window];
+    return window ? [window backingScaleFactor] : [[NSScreen mainScreen] backingScaleFactor];
+}
+
+- (void)viewDidChangeBackingProperties {
+    [super viewDidChangeBackingProperties];
+    CGFloat scale = [self backingScale];
+    for (OwCatCandidateCell* cell in _cells) {
+        [cell applyFont:_font scale:scale];
+    }
+}
+
 - (void)updateCandidates:(NSArray*)candidates selectedIndex:(NSInteger)index {
     _candidates = candidates;
     _selectedIndex = index;
     
-    // Update window size
-    NSSize newSize = [self calculateOptimalSize];
-    NSWindow* window = [self window];
-    if (window) {
-        NSRect frame = [window frame];
-        frame.size = newSize;
-        [window setFrame:frame display:YES animate:NO];
+    while ([_cells count] < [_candidates count]) {
+        [self addCell];
     }
     
-    [self setNeedsDisplay:YES];
+    CGFloat width = [self calculateOptimalSize].width - _padding * 2;
+    for (NSUInteger i = 0; i < [_cells count]; i++) {
+        OwCatCandidateCell* cell = [_cells objectAtIndex:i];
+        if (i >= [_candidates count]) {
+            [cell setHidden:YES];
+            continue;
+        }
+        
+        [cell setIndex:(NSInteger)i text:[_candidates objectAtIndex:i]];
+        [cell setSelected:((NSInteger)i == _selectedIndex) textColor:_textColor
+           selectedTextColor:_selectedTextColor selectedBackgroundColor:_selectedBackgroundColor];
+        [cell setFrame:NSMakeRect(_padding, _padding + i * _itemHeight, width, _itemHeight)];
+        [cell setHidden:NO];
+    }
+}
+
+- (void)setSelectedIndex:(NSInteger)index {
+    if (index == _selectedIndex) {
+        return;
+    }
+    
+    // Only the previously and newly selected rows change
+    NSInteger previous = _selectedIndex;
+    _selectedIndex = index;
+    [self refreshSelectionOfRow:previous];
+    [self refreshSelectionOfRow:index];
+}
+
+- (void)refreshSelectionOfRow:(NSInteger)row {
+    if (row >= 0 && row < (NSInteger)[_candidates count]) {
+        [[_cells objectAtIndex:row] setSelected:(row == _selectedIndex) textColor:_textColor
+                               selectedTextColor:_selectedTextColor
+                         selectedBackgroundColor:_selectedBackgroundColor];
+    }
 }
 
 - (NSSize)calculateOptimalSize {
@@ -113,8 +274,8 @@
     }
     
     CGFloat maxWidth = 0;
+    NSDictionary* attributes = @{NSFontAttributeName: _font};
     for (NSString* candidate in _candidates) {
-        NSDictionary* attributes = @{NSFontAttributeName: _font};
         NSSize textSize = [candidate sizeWithAttributes:attributes];
         maxWidth = MAX(maxWidth, textSize.width);
     }
@@ -129,13 +290,19 @@
     return NSMakeSize(width, height);
 }
 
+- (NSInteger)indexAtPoint:(NSPoint)location {
+    if (location.y < _padding) {
+        return -1;
+    }
+    return (NSInteger)((location.y - _padding) / _itemHeight);
+}
+
 - (void)mouseDown:(NSEvent*)event {
     NSPoint location = [self convertPoint:[event locationInWindow] fromView:nil];
-    NSInteger clickedIndex = (NSInteger)((location.y - _padding) / _itemHeight);
+    NSInteger clickedIndex = [self indexAtPoint:location];
     
     if (clickedIndex >= 0 && clickedIndex < [_candidates count]) {
-        _selectedIndex = clickedIndex;
-        [self setNeedsDisplay:YES];
+        [self setSelectedIndex:clickedIndex];
         
         // Notify C++ window
         if (_cppWindow) {
@@ -148,11 +315,10 @@
 
 - (void)mouseMoved:(NSEvent*)event {
     NSPoint location = [self convertPoint:[event locationInWindow] fromView:nil];
-    NSInteger hoveredIndex = (NSInteger)((location.y - _padding) / _itemHeight);
+    NSInteger hoveredIndex = [self indexAtPoint:location];
     
     if (hoveredIndex >= 0 && hoveredIndex < [_candidates count] && hoveredIndex != _selectedIndex) {
-        _selectedIndex = hoveredIndex;
-        [self setNeedsDisplay:YES];
+        [self setSelectedIndex:hoveredIndex];
         
         // Notify C++ window about highlight change
         if (_cppWindow) {
@@ -163,64 +329,22 @@
     }
 }
 
-- (void)drawRect:(NSRect)dirtyRect {
-    // Clear background
-    [_backgroundColor setFill];
-    NSRectFill(dirtyRect);
-    
-    // Draw border
-    [_borderColor setStroke];
-    NSBezierPath* border = [NSBezierPath bezierPathWithRect:[self bounds]];
-    [border setLineWidth:1.0];
-    [border stroke];
-    
-    // Draw candidates
-    for (NSInteger i = 0; i < [_candidates count]; i++) {
-        NSString* candidate = [_candidates objectAtIndex:i];
-        NSRect itemRect = NSMakeRect(_padding, 
-                                   [self bounds].size.height - (i + 1) * _itemHeight - _padding,
-                                   [self bounds].size.width - _padding * 2,
-                                   _itemHeight);
-        
-        // Draw selection background
-        if (i == _selectedIndex) {
-            [_selectedBackgroundColor setFill];
-            NSRectFill(itemRect);
-        }
-        
-        // Draw index number
-        NSString* indexStr = [NSString stringWithFormat:@"%ld.", (long)(i + 1)];
-        NSDictionary* indexAttributes = @{
-            NSFontAttributeName: _font,
-            NSForegroundColorAttributeName: (i == _selectedIndex) ? _selectedTextColor : _textColor
-        };
-        
-        NSRect indexRect = NSMakeRect(itemRect.origin.x + 2,
-                                    itemRect.origin.y + (itemRect.size.height - [_font pointSize]) / 2,
-                                    25,
-                                    [_font pointSize]);
-        [indexStr drawInRect:indexRect withAttributes:indexAttributes];
-        
-        // Draw candidate text
-        NSDictionary* textAttributes = @{
-            NSFontAttributeName: _font,
-            NSForegroundColorAttributeName: (i == _selectedIndex) ? _selectedTextColor : _textColor
-        };
-        
-        NSRect textRect = NSMakeRect(itemRect.origin.x + 30,
-                                   itemRect.origin.y + (itemRect.size.height - [_font pointSize]) / 2,
-                                   itemRect.size.width - 32,
-                                   [_font pointSize]);
-        [candidate drawInRect:textRect withAttributes:textAttributes];
-    }
-}
-
 @end
 
 // Objective-C Window Controller
+// Requests from the C++ side only record the latest state; a run loop observer applies it
+// once per turn, right before Core Animation commits, so a burst of keystrokes costs one frame.
 @interface OwCatCandidateWindowController : NSWindowController {
     MacOSCandidateWindow* _cppWindow;
     OwCatCandidateView* _candidateView;
+    CFRunLoopObserverRef _updateObserver;
+    NSArray* _pendingCandidates;
+    NSInteger _pendingSelectedIndex;
+    NSPoint _pendingPosition;
+    BOOL _hasPendingPosition;
+    BOOL _hasPendingSelection;
+    BOOL _pendingVisible;
+    BOOL _updateScheduled;
 }
 
 @property (nonatomic, assign) MacOSCandidateWindow* cppWindow;
@@ -228,8 +352,10 @@
 
 - (instancetype)initWithCppWindow:(MacOSCandidateWindow*)window;
 - (void)showCandidates:(NSArray*)candidates selectedIndex:(NSInteger)index atPosition:(NSPoint)position;
+- (void)updateCandidates:(NSArray*)candidates selectedIndex:(NSInteger)index;
 - (void)hideCandidates;
 - (void)updateSelection:(NSInteger)index;
+- (void)flushPendingUpdates;
 
 @end
 
@@ -250,6 +376,8 @@
     self = [super initWithWindow:candidateWindow];
     if (self) {
         _cppWindow = window;
+        _pendingVisible = NO;
+        _updateScheduled = NO;
         
         // Configure window
         [candidateWindow setLevel:NSFloatingWindowLevel];
@@ -261,43 +389,136 @@
         // Create and set up the candidate view
         _candidateView = [[OwCatCandidateView alloc] initWithCppWindow:window];
         [candidateWindow setContentView:_candidateView];
+        
+        // Order 0 runs before the Core Animation commit observer in the same turn
+        __weak OwCatCandidateWindowController* weakSelf = self;
+        _updateObserver = CFRunLoopObserverCreateWithHandler(kCFAllocatorDefault, kCFRunLoopBeforeWaiting, true, 0,
+                                                             ^(CFRunLoopObserverRef observer, CFRunLoopActivity activity) {
+            [weakSelf flushPendingUpdates];
+        });
+        CFRunLoopAddObserver(CFRunLoopGetMain(), _updateObserver, kCFRunLoopCommonModes);
     }
     return self;
 }
 
+- (void)dealloc {
+    if (_updateObserver) {
+        CFRunLoopObserverInvalidate(_updateObserver);
+        CFRelease(_updateObserver);
+        _updateObserver = NULL;
+    }
+}
+
+- (void)scheduleUpdate {
+    if (!_updateScheduled) {
+        _updateScheduled = YES;
+        CFRunLoopWakeUp(CFRunLoopGetMain());
+    }
+}
+
 - (void)showCandidates:(NSArray*)candidates selectedIndex:(NSInteger)index atPosition:(NSPoint)position {
-    [_candidateView updateCandidates:candidates selectedIndex:index];
+    _pendingCandidates = candidates;
+    _pendingSelectedIndex = index;
+    _pendingPosition = position;
+    _hasPendingPosition = YES;
+    _pendingVisible = YES;
+    [self scheduleUpdate];
+}
+
+- (void)updateCandidates:(NSArray*)candidates selectedIndex:(NSInteger)index {
+    _pendingCandidates = candidates;
+    _pendingSelectedIndex = index;
+    [self scheduleUpdate];
+}
+
+- (void)hideCandidates {
+    _pendingVisible = NO;
+    _pendingCandidates = nil;
+    _hasPendingPosition = NO;
+    _hasPendingSelection = NO;
+    [self scheduleUpdate];
+}
+
+- (void)updateSelection:(NSInteger)index {
+    _pendingSelectedIndex = index;
+    _hasPendingSelection = YES;
+    [self scheduleUpdate];
+}
+
+- (void)flushPendingUpdates {
+    if (!_updateScheduled) {
+        return;
+    }
+    _updateScheduled = NO;
     
-    // Position the window
     NSWindow* window = [self window];
-    NSRect frame = [window frame];
-    frame.origin = position;
+    if (!_pendingVisible) {
+        [window orderOut:nil];
+        return;
+    }
     
-    // Adjust position to keep window on screen
-    NSScreen* screen = [NSScreen mainScreen];
-    NSRect screenFrame = [screen visibleFrame];
+    [CATransaction begin];
+    [CATransaction setDisableActions:YES];
     
-    if (frame.origin.x + frame.size.width > screenFrame.origin.x + screenFrame.size.width) {
-        frame.origin.x = screenFrame.origin.x + screenFrame.size.width - frame.size.width;
+    BOOL resized = NO;
+    if (_pendingCandidates) {
+        [_candidateView updateCandidates:_pendingCandidates selectedIndex:_pendingSelectedIndex];
+        _pendingCandidates = nil;
+        _hasPendingSelection = NO;
+        resized = YES;
+    } else if (_hasPendingSelection) {
+        [_candidateView setSelectedIndex:_pendingSelectedIndex];
+        _hasPendingSelection = NO;
     }
-    if (frame.origin.y - frame.size.height < screenFrame.origin.y) {
-        frame.origin.y = screenFrame.origin.y + frame.size.height;
+    
+    if (resized || _hasPendingPosition) {
+        NSRect frame = [window frame];
+        frame.size = [_candidateView calculateOptimalSize];
+        if (_hasPendingPosition) {
+            frame.origin = _pendingPosition;
+            _hasPendingPosition = NO;
+        }
+        
+        // Adjust position to keep window on screen
+        NSScreen* screen = [NSScreen mainScreen];
+        NSRect screenFrame = [screen visibleFrame];
+        
+        if (frame.origin.x + frame.size.width > screenFrame.origin.x + screenFrame.size.width) {
+            frame.origin.x = screenFrame.origin.x + screenFrame.size.width - frame.size.width;
+        }
+        if (frame.origin.y - frame.size.height < screenFrame.origin.y) {
+            frame.origin.y = screenFrame.origin.y + frame.size.height;
+        }
+        
+        [window setFrame:frame display:NO animate:NO];
     }
     
-    [window setFrame:frame display:YES animate:NO];
-    [window orderFront:nil];
+    [CATransaction commit];
+    
+    if (![window isVisible]) {
+        [window orderFront:nil];
+    }
 }
 
-- (void)hideCandidates {
-    [[self window] orderOut:nil];
-}
+@end
 
-- (void)updateSelection:(NSInteger)index {
-    [_candidateView setSelectedIndex:index];
-    [_candidateView setNeedsDisplay:YES];
+// AppKit may only be touched on the main thread; engine results can arrive from any thread
+static void runOnMainThread(dispatch_block_t block) {
+    if ([NSThread isMainThread]) {
+        block();
+    } else {
+        dispatch_async(dispatch_get_main_queue(), block);
+    }
 }
 
-@end
+static NSArray* toNSArray(const std::vector<std::string>& candidates) {
+    NSMutableArray* nsArray = [NSMutableArray arrayWithCapacity:candidates.size()];
+    for (const auto& candidate : candidates) {
+        NSString* candidateStr = [NSString stringWithUTF8String:candidate.c_str()];
+        [nsArray addObject:candidateStr];
+    }
+    return nsArray;
+}
 
 #endif // __APPLE__
 
@@ -370,26 +591,26 @@ void MacOSCandidateWindow::show(const std::vector<std::string>& candidates, int
     pImpl->isVisible = true;
     
     // Convert candidates to NSArray
-    NSMutableArray* nsArray = [[NSMutableArray alloc] init];
-    for (const auto& candidate : candidates) {
-        NSString* candidateStr = [NSString stringWithUTF8String:candidate.c_str()];
-        [nsArray addObject:candidateStr];
-    }
-    
-    // Convert coordinates (flip Y coordinate for macOS)
-    NSScreen* screen = [NSScreen mainScreen];
-    NSRect screenFrame = [screen frame];
-    NSPoint position = NSMakePoint(x, screenFrame.size.height - y);
-    
-    [pImpl->windowController showCandidates:nsArray selectedIndex:selectedIndex atPosition:position];
-    [nsArray release];
+    NSArray* nsArray = toNSArray(candidates);
+    OwCatCandidateWindowController* controller = pImpl->windowController;
+    runOnMainThread(^{
+        // Convert coordinates (flip Y coordinate for macOS)
+        NSScreen* screen = [NSScreen mainScreen];
+        NSRect screenFrame = [screen frame];
+        NSPoint position = NSMakePoint(x, screenFrame.size.height - y);
+        
+        [controller showCandidates:nsArray selectedIndex:selectedIndex atPosition:position];
+    });
 #endif
 }
 
 void MacOSCandidateWindow::hide() {
 #ifdef __APPLE__
     if (pImpl->windowController) {
-        [pImpl->windowController hideCandidates];
+        OwCatCandidateWindowController* controller = pImpl->windowController;
+        runOnMainThread(^{
+            [controller hideCandidates];
+        });
     }
 #endif
     pImpl->isVisible = false;
@@ -404,19 +625,12 @@ void MacOSCandidateWindow::updateCandidates(const std::vector<std::string>& cand
     pImpl->candidates = candidates;
     pImpl->selectedIndex = selectedIndex;
     
-    // Convert candidates to NSArray
-    NSMutableArray* nsArray = [[NSMutableArray alloc] init];
-    for (const auto& candidate : candidates) {
-        NSString* candidateStr = [NSString stringWithUTF8String:candidate.c_str()];
-        [nsArray addObject:candidateStr];
-    }
-    
-    // Get current position
-    NSWindow* window = [pImpl->windowController window];
-    NSPoint currentPosition = [window frame].origin;
-    
-    [pImpl->windowController showCandidates:nsArray selectedIndex:selectedIndex atPosition:currentPosition];
-    [nsArray release];
+    // Keeps the current position; only the rows and size change
+    NSArray* nsArray = toNSArray(candidates);
+    OwCatCandidateWindowController* controller = pImpl->windowController;
+    runOnMainThread(^{
+        [controller updateCandidates:nsArray selectedIndex:selectedIndex];
+    });
 #endif
 }
 
@@ -427,7 +641,10 @@ void MacOSCandidateWindow::updateSelection(int selectedIndex) {
     }
     
     pImpl->selectedIndex = selectedIndex;
-    [pImpl->windowController updateSelection:selectedIndex];
+    OwCatCandidateWindowController* controller = pImpl->windowController;
+    runOnMainThread(^{
+        [controller updateSelection:selectedIndex];
+    });
 #endif
 }
 
@@ -5,6 +5,8 @@
 #include <map>
 #include <functional>
 #include <iostream>
+#include <atomic>
+#include <mutex>
 
 #ifdef __APPLE__
 #import <Cocoa/Cocoa.h>
@@ -22,6 +24,7 @@
     NSRange _markedRange;
     NSRange _selectedRange;
     BOOL _isComposing;
+    IMKCandidates* _candidatesPanel;
 }
 
 @property (nonatomic, assign) MacOSInputController* cppController;
@@ -35,6 +38,7 @@
 - (void)commitComposition:(id)sender;
 - (void)cancelComposition;
 - (NSArray*)candidates:(id)sender;
+- (void)refreshCandidates:(NSUInteger)count;
 - (void)candidateSelected:(NSAttributedString*)candidateString;
 - (void)candidateSelectionChanged:(NSAttributedString*)candidateString;
 - (NSMenu*)menu;
@@ -57,10 +61,16 @@
         _markedRange = NSMakeRange(NSNotFound, 0);
         _selectedRange = NSMakeRange(0, 0);
         _isComposing = NO;
+        _candidatesPanel = nil;
     }
     return self;
 }
 
+- (void)dealloc {
+    [_candidatesPanel release];
+    [super dealloc];
+}
+
 - (BOOL)inputText:(NSString*)string client:(id)sender {
     if (!_cppController) {
         return NO;
@@ -197,6 +207,25 @@
     return nsArray;
 }
 
+// Called on the main thread when the engine queue has candidates for the current input.
+// The panel pulls the list again through candidates:, which now returns the fresh results.
+- (void)refreshCandidates:(NSUInteger)count {
+    if (!_candidatesPanel) {
+        if (count == 0) {
+            return;
+        }
+        _candidatesPanel = [[IMKCandidates alloc] initWithServer:[self server]
+                                                       panelType:kIMKSingleColumnScrollingCandidatePanel];
+    }
+    
+    if (count == 0) {
+        [_candidatesPanel hide];
+        return;
+    }
+    [_candidatesPanel update];
+    [_candidatesPanel show:kIMKLocateCandidatesBelowHint];
+}
+
 - (void)candidateSelected:(NSAttributedString*)candidateString {
     if (!_cppController) {
         return;
@@ -260,39 +289,122 @@
 
 #endif // __APPLE__
 
+// Candidates computed on the engine queue. Shared with queued tasks so they stay valid
+// even if the controller is destroyed while work is still pending.
+struct EngineResults {
+    std::mutex mutex;
+    std::vector<std::string> candidates;
+    std::atomic<uint64_t> generation{0};    // bumped on every input, commit and cancel
+#ifdef __APPLE__
+    OwCatInputController* controller = nil; // panel owner; only touched on the main thread
+#endif
+};
+
 // C++ Implementation
 struct MacOSInputController::Impl {
 #ifdef __APPLE__
     OwCatInputController* objcController;
     IMKServer* server;
+    // Serial queue for engine work, so IMK callbacks return without waiting for the engine
+    dispatch_queue_t engineQueue;
 #endif
     
-    // Callbacks
+    // Callbacks (input, commit, cancel, candidates, select and highlight run on the engine queue)
     std::function<void(const std::string&)> inputCallback;
     std::function<void(const std::string&)> commitCallback;
     std::function<void()> cancelCallback;
     std::function<std::vector<std::string>()> candidatesCallback;
     std::function<void(const std::string&)> selectCallback;
     std::function<void(const std::string&)> highlightCallback;
+    // Called on the main thread once fresh candidates are available
+    std::function<void(const std::vector<std::string>&)> candidatesUpdatedCallback;
     
     // State
     std::string currentInput;
     std::vector<std::string> currentCandidates;
     std::string finalText;
+    std::shared_ptr<EngineResults> results;
     
-    Impl() {
+    Impl() : results(std::make_shared<EngineResults>()) {
 #ifdef __APPLE__
         objcController = nil;
         server = nil;
+        engineQueue = dispatch_queue_create("com.owcat.inputmethod.engine", DISPATCH_QUEUE_SERIAL);
 #endif
     }
     
     ~Impl() {
+        // Pending main-queue refreshes must not reach a controller we no longer own
+        nextGeneration();
 #ifdef __APPLE__
+        results->controller = nil;
         if (objcController) {
             [objcController release];
             objcController = nil;
         }
+#endif
+    }
+    
+    // Runs engine work in order off the IMK thread; runs inline where GCD is unavailable
+    void post(std::function<void()> task) {
+#ifdef __APPLE__
+        dispatch_async(engineQueue, ^{
+            task();
+        });
+#else
+        task();
+#endif
+    }
+    
+    // Invalidates candidate work queued for earlier input
+    uint64_t nextGeneration() {
+        return ++results->generation;
+    }
+    
+    // Queues a candidate refresh for the input generation. Skipped if more input arrives
+    // before the queue gets to it, so fast typing computes candidates once per burst.
+    void postCandidateRefresh(uint64_t generation) {
+        auto candidates_callback = candidatesCallback;
+        auto updated_callback = candidatesUpdatedCallback;
+        auto shared_results = results;
+        post([=]() {
+            if (!candidates_callback || shared_results->generation.load() != generation) {
+                return;
+            }
+            std::vector<std::string> candidates = candidates_callback();
+            {
+                std::lock_guard<std::mutex> lock(shared_results->mutex);
+                if (shared_results->generation.load() != generation) {
+                    return;
+                }
+                shared_results->candidates = candidates;
+            }
+#ifdef __APPLE__
+            dispatch_async(dispatch_get_main_queue(), ^{
+                if (shared_results->generation.load() != generation) {
+                    return;
+                }
+                [shared_results->controller refreshCandidates:candidates.size()];
+                if (updated_callback) {
+                    updated_callback(candidates);
+                }
+            });
+#else
+            if (updated_callback) {
+                updated_callback(candidates);
+            }
+#endif
+        });
+    }
+    
+    void clearResults() {
+        nextGeneration();
+        {
+            std::lock_guard<std::mutex> lock(results->mutex);
+            results->candidates.clear();
+        }
+#ifdef __APPLE__
+        [results->controller refreshCandidates:0];
 #endif
     }
 };
@@ -312,7 +424,9 @@ bool MacOSInputController::initialize() {
 }
 
 void MacOSInputController::shutdown() {
+    pImpl->clearResults();
 #ifdef __APPLE__
+    pImpl->results->controller = nil;
     if (pImpl->objcController) {
         [pImpl->objcController release];
         pImpl->objcController = nil;
@@ -344,21 +458,34 @@ void MacOSInputController::setHighlightCallback(std::function<void(const std::st
     pImpl->highlightCallback = callback;
 }
 
+void MacOSInputController::setCandidatesUpdatedCallback(std::function<void(const std::vector<std::string>&)> callback) {
+    pImpl->candidatesUpdatedCallback = callback;
+}
+
 void MacOSInputController::handleInput(const std::string& input) {
     pImpl->currentInput += input;
     
+    const uint64_t generation = pImpl->nextGeneration();
     if (pImpl->inputCallback) {
-        pImpl->inputCallback(input);
+        auto callback = pImpl->inputCallback;
+        pImpl->post([callback, input]() {
+            callback(input);
+        });
     }
+    pImpl->postCandidateRefresh(generation);
 }
 
 void MacOSInputController::commitText(const std::string& text) {
     pImpl->currentInput.clear();
     pImpl->currentCandidates.clear();
     pImpl->finalText.clear();
+    pImpl->clearResults();
     
     if (pImpl->commitCallback) {
-        pImpl->commitCallback(text);
+        auto callback = pImpl->commitCallback;
+        pImpl->post([callback, text]() {
+            callback(text);
+        });
     }
 }
 
@@ -366,31 +493,40 @@ void MacOSInputController::cancelComposition() {
     pImpl->currentInput.clear();
     pImpl->currentCandidates.clear();
     pImpl->finalText.clear();
+    pImpl->clearResults();
     
     if (pImpl->cancelCallback) {
-        pImpl->cancelCallback();
+        auto callback = pImpl->cancelCallback;
+        pImpl->post([callback]() {
+            callback();
+        });
     }
 }
 
 std::vector<std::string> MacOSInputController::getCandidates() {
-    if (pImpl->candidatesCallback) {
-        pImpl->currentCandidates = pImpl->candidatesCallback();
-        return pImpl->currentCandidates;
-    }
-    return {};
+    // Latest candidates from the engine queue; never waits for the engine
+    std::lock_guard<std::mutex> lock(pImpl->results->mutex);
+    pImpl->currentCandidates = pImpl->results->candidates;
+    return pImpl->currentCandidates;
 }
 
 void MacOSInputController::selectCandidate(const std::string& candidate) {
     pImpl->finalText = candidate;
     
     if (pImpl->selectCallback) {
-        pImpl->selectCallback(candidate);
+        auto callback = pImpl->selectCallback;
+        pImpl->post([callback, candidate]() {
+            callback(candidate);
+        });
     }
 }
 
 void MacOSInputController::highlightCandidate(const std::string& candidate) {
     if (pImpl->highlightCallback) {
-        pImpl->highlightCallback(candidate);
+        auto callback = pImpl->highlightCallback;
+        pImpl->post([callback, candidate]() {
+            callback(candidate);
+        });
     }
 }
 
@@ -413,6 +549,7 @@ void* MacOSInputController::getObjCController() {
 
 void MacOSInputController::setObjCController(void* controller) {
     pImpl->objcController = static_cast<OwCatInputController*>(controller);
+    pImpl->results->controller = pImpl->objcController;
 }
 #endif
 
@@ -5,6 +5,7 @@
 #include <map>
 #include <iostream>
 #include <sstream>
+#include <algorithm>
 
 #ifdef __APPLE__
 #import <Cocoa/Cocoa.h>
@@ -17,6 +18,8 @@
 #include <mach/mach.h>
 #include <mach/mach_host.h>
 #include <mach/host_info.h>
+#include <IOKit/ps/IOPowerSources.h>
+#include <IOKit/ps/IOPSKeys.h>
 #include <unistd.h>
 #include <pwd.h>
 #endif
@@ -28,6 +31,10 @@ struct MacOSSystemIntegration::Impl {
     std::string bundleIdentifier;
     std::string imeName;
     
+    // 上一次采样的处理器tick，用于计算CPU占用
+    uint64_t previousIdleTicks = 0;
+    uint64_t previousTotalTicks = 0;
+    
     Impl() : isInitialized(false) {
         bundleIdentifier = "com.owcat.ime";
         imeName = "OwCat IME";
@@ -267,6 +274,61 @@ std::map<std::string, std::string> MacOSSystemIntegration::getSystemInfo() {
     return info;
 }
 
+bool MacOSSystemIntegration::getSystemLoad(core::SystemLoad& load) {
+    load = core::SystemLoad();
+    
+#ifdef __APPLE__
+    host_cpu_load_info_data_t cpu_info;
+    mach_msg_type_number_t count = HOST_CPU_LOAD_INFO_COUNT;
+    if (host_statistics(mach_host_self(), HOST_CPU_LOAD_INFO, (host_info_t)&cpu_info, &count) != KERN_SUCCESS) {
+        return false;
+    }
+    
+    uint64_t total_ticks = 0;
+    for (int i = 0; i < CPU_STATE_MAX; ++i) {
+        total_ticks += cpu_info.cpu_ticks[i];
+    }
+    const uint64_t idle_ticks = cpu_info.cpu_ticks[CPU_STATE_IDLE];
+    if (pImpl->previousTotalTicks > 0 && total_ticks > pImpl->previousTotalTicks) {
+        const double total_delta = static_cast<double>(total_ticks - pImpl->previousTotalTicks);
+        const double idle_delta = static_cast<double>(idle_ticks - std::min(idle_ticks, pImpl->previousIdleTicks));
+        load.cpu_load = std::max(0.0, std::min(1.0, 1.0 - idle_delta / total_delta));
+    }
+    pImpl->previousIdleTicks = idle_ticks;
+    pImpl->previousTotalTicks = total_ticks;
+    
+    CFTypeRef info = IOPSCopyPowerSourcesInfo();
+    if (info) {
+        CFStringRef source_type = IOPSGetProvidingPowerSourceType(info);
+        load.on_battery = source_type && CFStringCompare(source_type, CFSTR(kIOPMBatteryPowerKey), 0) == kCFCompareEqualTo;
+        
+        CFArrayRef sources = IOPSCopyPowerSourcesList(info);
+        if (sources) {
+            for (CFIndex i = 0; i < CFArrayGetCount(sources); ++i) {
+                CFDictionaryRef description = IOPSGetPowerSourceDescription(info, CFArrayGetValueAtIndex(sources, i));
+                if (!description) {
+                    continue;
+                }
+                CFNumberRef current = (CFNumberRef)CFDictionaryGetValue(description, CFSTR(kIOPSCurrentCapacityKey));
+                CFNumberRef maximum = (CFNumberRef)CFDictionaryGetValue(description, CFSTR(kIOPSMaxCapacityKey));
+                int current_capacity = 0;
+                int max_capacity = 0;
+                if (current && maximum && CFNumberGetValue(current, kCFNumberIntType, &current_capacity) &&
+                    CFNumberGetValue(maximum, kCFNumberIntType, &max_capacity) && max_capacity > 0) {
+                    load.battery_percent = current_capacity * 100 / max_capacity;
+                    break;
+                }
+            }
+            CFRelease(sources);
+        }
+        CFRelease(info);
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
 std::vector<std::string> MacOSSystemIntegration::getInstalledIMEs() {
     std::vector<std::string> imes;
     
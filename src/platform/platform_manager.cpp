@@ -1,12 +1,15 @@
 #include "platform/platform_manager.h"
+#include "core/engine.h"
 #include <spdlog/spdlog.h>
 
 #ifdef _WIN32
 #include "platform/windows/windows_ime_adapter.h"
 #elif defined(__APPLE__)
 #include "platform/macos/macos_input_adapter.h"
+#include "platform/macos/macos_ime_adapter.h"
 #elif defined(__linux__)
 #include "platform/linux/linux_input_adapter.h"
+#include "platform/linux/linux_ime_adapter.h"
 #endif
 
 namespace owcat {
@@ -27,6 +30,34 @@ std::unique_ptr<PlatformManager> createPlatformManager() {
 #endif
 }
 
+void bindFocusToEngine(PlatformManager& platform, core::Engine& engine) {
+    PlatformManager* manager = &platform;
+    core::Engine* target = &engine;
+    platform.setFocusChangeCallback([manager, target](bool has_focus) {
+        if (!has_focus) {
+            target->clearComposition();
+            return;
+        }
+        target->resetContext();
+        target->switchProfile(manager->getCurrentApplication());
+    });
+}
+
+core::SystemLoadProvider createSystemLoadProvider() {
+#ifdef _WIN32
+    return [](core::SystemLoad& load) { return windows::WindowsSystemIntegration::getSystemLoad(load); };
+#elif defined(__APPLE__)
+    // CPU占用按差值计算，采样状态保存在回调持有的实例中
+    auto integration = std::make_shared<macos::MacOSSystemIntegration>();
+    return [integration](core::SystemLoad& load) { return integration->getSystemLoad(load); };
+#elif defined(__linux__)
+    auto integration = std::make_shared<LinuxSystemIntegration>();
+    return [integration](core::SystemLoad& load) { return integration->getSystemLoad(load); };
+#else
+    return nullptr;
+#endif
+}
+
 std::string getCurrentPlatform() {
 #ifdef _WIN32
     return "Windows";
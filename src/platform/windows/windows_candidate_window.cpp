@@ -2,8 +2,12 @@
 
 #include "platform/windows/windows_ime_adapter.h"
 #include <spdlog/spdlog.h>
+#include <d2d1.h>
+#include <dwrite.h>
 #include <algorithm>
 #include <sstream>
+#include <unordered_map>
+#include <unordered_set>
 
 namespace owcat {
 namespace platform {
@@ -12,6 +16,22 @@ namespace windows {
 // 窗口类名
 static const wchar_t* CANDIDATE_WINDOW_CLASS = L"OwCatCandidateWindow";
 
+// 布局尺寸以96 DPI下的像素（即DIP）为单位，绘制时按窗口所在显示器的DPI缩放
+static const int MAX_WINDOW_WIDTH = 400;
+static const int MAX_WINDOW_HEIGHT = 300;
+static const int TEXT_PADDING = 5;
+
+// 文本布局缓存容量，超过后只保留当前候选词的布局
+static const size_t LAYOUT_CACHE_CAPACITY = 64;
+
+template <typename T>
+static void safeRelease(T*& object) {
+    if (object) {
+        object->Release();
+        object = nullptr;
+    }
+}
+
 // 窗口过程
 LRESULT CALLBACK CandidateWindowProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
     WindowsCandidateWindow* window = reinterpret_cast<WindowsCandidateWindow*>(GetWindowLongPtr(hwnd, GWLP_USERDATA));
@@ -24,6 +44,10 @@ LRESULT CALLBACK CandidateWindowProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM
             }
             return 0;
             
+        case WM_ERASEBKGND:
+            // 背景在双缓冲中一起绘制，跳过擦除避免闪烁
+            return 1;
+            
         case WM_PAINT:
             if (window) {
                 window->onPaint();
@@ -64,7 +88,13 @@ LRESULT CALLBACK CandidateWindowProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM
 class WindowsCandidateWindow::Impl {
 public:
     Impl() : hwnd_(nullptr), visible_(false), selected_index_(0),
-             item_height_(25), margin_(5), font_(nullptr) {
+             window_width_(0), window_height_(0),
+             item_height_(25), margin_(5), font_(nullptr), dpi_(96),
+             prefer_direct2d_(true), using_direct2d_(false), background_alpha_(255),
+             d2d_factory_(nullptr), dwrite_factory_(nullptr), text_format_(nullptr),
+             ellipsis_sign_(nullptr), render_target_(nullptr), brush_(nullptr),
+             memory_dc_(nullptr), back_buffer_(nullptr), old_bitmap_(nullptr),
+             back_buffer_width_(0), back_buffer_height_(0) {
         // 初始化默认样式
         background_color_ = RGB(255, 255, 255);
         text_color_ = RGB(0, 0, 0);
@@ -90,25 +120,37 @@ public:
             return false;
         }
         
-        // 创建字体
-        createFont();
+        // 边框由两种渲染器自己绘制，Direct2D渲染时使用分层窗口获得逐像素透明
+        const bool direct2d = prefer_direct2d_ && initializeDirect2D();
+        DWORD ex_style = WS_EX_TOPMOST | WS_EX_TOOLWINDOW | WS_EX_NOACTIVATE;
+        if (direct2d) {
+            ex_style |= WS_EX_LAYERED;
+        }
         
         // 创建窗口
         hwnd_ = CreateWindowExW(
-            WS_EX_TOPMOST | WS_EX_TOOLWINDOW | WS_EX_NOACTIVATE,
+            ex_style,
             CANDIDATE_WINDOW_CLASS,
             L"Candidate Window",
-            WS_POPUP | WS_BORDER,
+            WS_POPUP,
             0, 0, 200, 100,
             nullptr, nullptr, GetModuleHandle(nullptr), this
         );
         
         if (!hwnd_) {
             spdlog::error("Failed to create candidate window: {}", GetLastError());
+            releaseDirect2D();
             return false;
         }
         
-        spdlog::info("Windows candidate window created successfully");
+        using_direct2d_ = direct2d;
+        updateDpi();
+        
+        // 创建字体
+        createFont();
+        
+        spdlog::info("Windows candidate window created successfully ({})",
+                     using_direct2d_ ? "Direct2D" : "GDI");
         return true;
     }
     
@@ -123,6 +165,8 @@ public:
             font_ = nullptr;
         }
         
+        releaseDirect2D();
+        using_direct2d_ = false;
         visible_ = false;
     }
     
@@ -135,26 +179,31 @@ public:
         candidates_ = candidates;
         selected_index_ = 0;
         
-        // 计算窗口大小
-        calculateWindowSize();
-        
         // 设置窗口位置
         int x = position.x;
         int y = position.y;
         
+        // 先移到光标所在的显示器，按该显示器的DPI计算窗口大小
+        SetWindowPos(hwnd_, HWND_TOPMOST, x, y, 0, 0, SWP_NOSIZE | SWP_NOACTIVATE);
+        updateDpi();
+        pruneLayoutCache();
+        
+        // 计算窗口大小
+        calculateWindowSize();
+        
         // 确保窗口在屏幕范围内
         adjustWindowPosition(x, y);
         
-        // 移动并显示窗口
-        SetWindowPos(hwnd_, HWND_TOPMOST, x, y, window_width_, window_height_,
-                    SWP_NOACTIVATE | SWP_SHOWWINDOW);
+        // 移动窗口，分层窗口需要先绘制一帧才能显示
+        SetWindowPos(hwnd_, HWND_TOPMOST, x, y, window_width_, window_height_, SWP_NOACTIVATE);
         
         visible_ = true;
         
         // 重绘窗口
-        InvalidateRect(hwnd_, nullptr, TRUE);
+        redraw();
+        ShowWindow(hwnd_, SW_SHOWNOACTIVATE);
         
-        spdlog::debug("Candidate window shown with {} candidates at ({}, {})", 
+        spdlog::debug("Candidate window shown with {} candidates at ({}, {})",
                      candidates.candidates.size(), x, y);
     }
     
@@ -171,7 +220,7 @@ public:
             selected_index_ = selected_index;
             
             if (visible_) {
-                InvalidateRect(hwnd_, nullptr, TRUE);
+                redraw();
             }
             
             spdlog::debug("Candidate selection updated to index {}", selected_index);
@@ -205,6 +254,19 @@ public:
             border_color_ = parseColor(it->second);
         }
         
+        // 背景不透明度（0-100），只在Direct2D分层窗口中生效
+        it = style.find("background_opacity");
+        if (it != style.end()) {
+            try {
+                int opacity = std::stoi(it->second);
+                if (opacity >= 0 && opacity <= 100) {
+                    background_alpha_ = opacity * 255 / 100;
+                }
+            } catch (const std::exception&) {
+                spdlog::warn("Invalid background opacity: {}", it->second);
+            }
+        }
+        
         it = style.find("font_size");
         if (it != style.end()) {
             try {
@@ -218,9 +280,24 @@ public:
             }
         }
         
+        // 渲染器："direct2d"（默认）或"gdi"
+        it = style.find("renderer");
+        if (it != style.end()) {
+            if (it->second == "gdi") {
+                setRenderer(false);
+            } else if (it->second == "direct2d") {
+                setRenderer(true);
+            } else {
+                spdlog::warn("Unknown candidate window renderer: {}", it->second);
+            }
+        }
+        
         // 如果窗口可见，重绘
         if (visible_) {
-            InvalidateRect(hwnd_, nullptr, TRUE);
+            calculateWindowSize();
+            SetWindowPos(hwnd_, nullptr, 0, 0, window_width_, window_height_,
+                         SWP_NOMOVE | SWP_NOZORDER | SWP_NOACTIVATE);
+            redraw();
         }
     }
     
@@ -232,73 +309,36 @@ public:
             return;
         }
         
-        // 设置背景模式
-        SetBkMode(hdc, TRANSPARENT);
-        
-        // 选择字体
-        HFONT old_font = static_cast<HFONT>(SelectObject(hdc, font_));
-        
-        // 填充背景
-        HBRUSH bg_brush = CreateSolidBrush(background_color_);
-        FillRect(hdc, &ps.rcPaint, bg_brush);
-        DeleteObject(bg_brush);
-        
-        // 绘制边框
-        HPEN border_pen = CreatePen(PS_SOLID, 1, border_color_);
-        HPEN old_pen = static_cast<HPEN>(SelectObject(hdc, border_pen));
+        // 分层窗口由UpdateLayeredWindow呈现，不会走到这里
+        if (using_direct2d_) {
+            EndPaint(hwnd_, &ps);
+            return;
+        }
         
         RECT window_rect;
         GetClientRect(hwnd_, &window_rect);
-        Rectangle(hdc, window_rect.left, window_rect.top, window_rect.right, window_rect.bottom);
         
-        SelectObject(hdc, old_pen);
-        DeleteObject(border_pen);
+        // 先画到内存位图再一次性拷贝到窗口，避免闪烁
+        HDC buffer_dc = CreateCompatibleDC(hdc);
+        HBITMAP buffer = CreateCompatibleBitmap(hdc, window_rect.right, window_rect.bottom);
+        HGDIOBJ old_buffer = SelectObject(buffer_dc, buffer);
         
-        // 绘制候选项
-        int y = margin_;
-        for (size_t i = 0; i < candidates_.candidates.size(); ++i) {
-            const auto& candidate = candidates_.candidates[i];
-            
-            RECT item_rect = {
-                margin_,
-                y,
-                window_width_ - margin_,
-                y + item_height_
-            };
-            
-            // 绘制选中背景
-            if (static_cast<int>(i) == selected_index_) {
-                HBRUSH selected_brush = CreateSolidBrush(selected_color_);
-                FillRect(hdc, &item_rect, selected_brush);
-                DeleteObject(selected_brush);
-                
-                SetTextColor(hdc, selected_text_color_);
-            } else {
-                SetTextColor(hdc, text_color_);
-            }
-            
-            // 绘制候选文本
-            std::wstring display_text = formatCandidateText(i + 1, candidate);
-            
-            RECT text_rect = item_rect;
-            text_rect.left += 5;
-            text_rect.right -= 5;
-            
-            DrawTextW(hdc, display_text.c_str(), -1, &text_rect, 
-                     DT_LEFT | DT_VCENTER | DT_SINGLELINE | DT_END_ELLIPSIS);
-            
-            y += item_height_;
-        }
+        paintGdi(buffer_dc, window_rect);
         
-        // 恢复字体
-        SelectObject(hdc, old_font);
+        BitBlt(hdc, ps.rcPaint.left, ps.rcPaint.top,
+               ps.rcPaint.right - ps.rcPaint.left, ps.rcPaint.bottom - ps.rcPaint.top,
+               buffer_dc, ps.rcPaint.left, ps.rcPaint.top, SRCCOPY);
+        
+        SelectObject(buffer_dc, old_buffer);
+        DeleteObject(buffer);
+        DeleteDC(buffer_dc);
         
         EndPaint(hwnd_, &ps);
     }
     
     void onMouseClick(int x, int y) {
         // 计算点击的候选项索引
-        int item_index = (y - margin_) / item_height_;
+        int item_index = hitTest(y);
         
         if (item_index >= 0 && item_index < static_cast<int>(candidates_.candidates.size())) {
             selected_index_ = item_index;
@@ -309,7 +349,7 @@ public:
             }
             
             // 重绘
-            InvalidateRect(hwnd_, nullptr, TRUE);
+            redraw();
             
             spdlog::debug("Candidate {} clicked", item_index);
         }
@@ -317,19 +357,19 @@ public:
     
     void onMouseMove(int x, int y) {
         // 计算鼠标悬停的候选项索引
-        int item_index = (y - margin_) / item_height_;
+        int item_index = hitTest(y);
         
         if (item_index >= 0 && item_index < static_cast<int>(candidates_.candidates.size()) &&
             item_index != selected_index_) {
             selected_index_ = item_index;
-            InvalidateRect(hwnd_, nullptr, TRUE);
+            redraw();
         }
     }
     
     void setSelectionCallback(std::function<void(int)> callback) {
         selection_callback_ = callback;
     }
-    
+
 private:
     bool registerWindowClass() {
         WNDCLASSEXW wc = {0};
@@ -338,7 +378,7 @@ private:
         wc.lpfnWndProc = CandidateWindowProc;
         wc.hInstance = GetModuleHandle(nullptr);
         wc.hCursor = LoadCursor(nullptr, IDC_ARROW);
-        wc.hbrBackground = static_cast<HBRUSH>(GetStockObject(WHITE_BRUSH));
+        wc.hbrBackground = nullptr;
         wc.lpszClassName = CANDIDATE_WINDOW_CLASS;
         
         ATOM result = RegisterClassExW(&wc);
@@ -355,7 +395,7 @@ private:
         }
         
         font_ = CreateFontW(
-            -font_size_,                    // 字体高度
+            -scaled(font_size_),            // 字体高度
             0,                              // 字体宽度
             0,                              // 角度
             0,                              // 基线角度
@@ -366,65 +406,510 @@ private:
             DEFAULT_CHARSET,                // 字符集
             OUT_DEFAULT_PRECIS,             // 输出精度
             CLIP_DEFAULT_PRECIS,            // 裁剪精度
-            DEFAULT_QUALITY,                // 输出质量
+            CLEARTYPE_QUALITY,              // 输出质量
             DEFAULT_PITCH | FF_DONTCARE,    // 字体间距和族
             L"Microsoft YaHei"              // 字体名称
         );
+        
+        // 文本格式随字号变化，已缓存的布局一起失效
+        if (dwrite_factory_) {
+            createTextFormat();
+        }
     }
     
-    void calculateWindowSize() {
-        if (candidates_.candidates.empty()) {
-            window_width_ = 100;
-            window_height_ = 50;
+    /**
+     * 创建Direct2D和DirectWrite工厂
+     * @return 是否可以使用Direct2D渲染
+     */
+    bool initializeDirect2D() {
+        HRESULT hr = D2D1CreateFactory(D2D1_FACTORY_TYPE_SINGLE_THREADED, &d2d_factory_);
+        if (FAILED(hr)) {
+            spdlog::warn("Direct2D unavailable (0x{:x}), using GDI", static_cast<unsigned long>(hr));
+            return false;
+        }
+        
+        hr = DWriteCreateFactory(DWRITE_FACTORY_TYPE_SHARED, __uuidof(IDWriteFactory),
+                                 reinterpret_cast<IUnknown**>(&dwrite_factory_));
+        if (FAILED(hr) || !createTextFormat()) {
+            spdlog::warn("DirectWrite unavailable (0x{:x}), using GDI", static_cast<unsigned long>(hr));
+            releaseDirect2D();
+            return false;
+        }
+        
+        return true;
+    }
+    
+    void releaseDirect2D() {
+        clearLayoutCache();
+        releaseRenderTarget();
+        releaseBackBuffer();
+        safeRelease(ellipsis_sign_);
+        safeRelease(text_format_);
+        safeRelease(dwrite_factory_);
+        safeRelease(d2d_factory_);
+    }
+    
+    /**
+     * 按当前字号创建文本格式：单行、垂直居中、超长时以省略号截断
+     * @return 是否创建成功
+     */
+    bool createTextFormat() {
+        clearLayoutCache();
+        safeRelease(ellipsis_sign_);
+        safeRelease(text_format_);
+        
+        HRESULT hr = dwrite_factory_->CreateTextFormat(
+            L"Microsoft YaHei", nullptr,
+            DWRITE_FONT_WEIGHT_NORMAL, DWRITE_FONT_STYLE_NORMAL, DWRITE_FONT_STRETCH_NORMAL,
+            static_cast<FLOAT>(font_size_), L"zh-cn", &text_format_);
+        if (FAILED(hr)) {
+            return false;
+        }
+        
+        text_format_->SetWordWrapping(DWRITE_WORD_WRAPPING_NO_WRAP);
+        text_format_->SetParagraphAlignment(DWRITE_PARAGRAPH_ALIGNMENT_CENTER);
+        if (SUCCEEDED(dwrite_factory_->CreateEllipsisTrimmingSign(text_format_, &ellipsis_sign_))) {
+            DWRITE_TRIMMING trimming = { DWRITE_TRIMMING_GRANULARITY_CHARACTER, 0, 0 };
+            text_format_->SetTrimming(&trimming, ellipsis_sign_);
+        }
+        return true;
+    }
+    
+    /**
+     * 创建DC渲染目标和画刷，设备丢失后在下一次绘制时重建
+     * @return 是否可用
+     */
+    bool ensureRenderTarget() {
+        if (render_target_) {
+            return true;
+        }
+        if (!d2d_factory_) {
+            return false;
+        }
+        
+        D2D1_RENDER_TARGET_PROPERTIES properties = D2D1::RenderTargetProperties(
+            D2D1_RENDER_TARGET_TYPE_DEFAULT,
+            D2D1::PixelFormat(DXGI_FORMAT_B8G8R8A8_UNORM, D2D1_ALPHA_MODE_PREMULTIPLIED),
+            static_cast<FLOAT>(dpi_), static_cast<FLOAT>(dpi_));
+        HRESULT hr = d2d_factory_->CreateDCRenderTarget(&properties, &render_target_);
+        if (FAILED(hr)) {
+            spdlog::warn("Failed to create Direct2D render target: 0x{:x}", static_cast<unsigned long>(hr));
+            return false;
+        }
+        
+        hr = render_target_->CreateSolidColorBrush(D2D1::ColorF(0.0f, 0.0f, 0.0f), &brush_);
+        if (FAILED(hr)) {
+            releaseRenderTarget();
+            return false;
+        }
+        
+        // 透明背景上无法使用ClearType
+        render_target_->SetTextAntialiasMode(D2D1_TEXT_ANTIALIAS_MODE_GRAYSCALE);
+        return true;
+    }
+    
+    void releaseRenderTarget() {
+        safeRelease(brush_);
+        safeRelease(render_target_);
+    }
+    
+    /**
+     * 确保后备位图不小于窗口，只在窗口变大时重新分配
+     * @return 是否可用
+     */
+    bool ensureBackBuffer(int width, int height) {
+        if (back_buffer_ && width <= back_buffer_width_ && height <= back_buffer_height_) {
+            return true;
+        }
+        releaseBackBuffer();
+        
+        memory_dc_ = CreateCompatibleDC(nullptr);
+        if (!memory_dc_) {
+            return false;
+        }
+        
+        BITMAPINFO info = {};
+        info.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+        info.bmiHeader.biWidth = width;
+        info.bmiHeader.biHeight = -height; // 自上而下
+        info.bmiHeader.biPlanes = 1;
+        info.bmiHeader.biBitCount = 32;
+        info.bmiHeader.biCompression = BI_RGB;
+        
+        void* bits = nullptr;
+        back_buffer_ = CreateDIBSection(memory_dc_, &info, DIB_RGB_COLORS, &bits, nullptr, 0);
+        if (!back_buffer_) {
+            releaseBackBuffer();
+            return false;
+        }
+        
+        old_bitmap_ = SelectObject(memory_dc_, back_buffer_);
+        back_buffer_width_ = width;
+        back_buffer_height_ = height;
+        return true;
+    }
+    
+    void releaseBackBuffer() {
+        if (memory_dc_) {
+            if (old_bitmap_) {
+                SelectObject(memory_dc_, old_bitmap_);
+                old_bitmap_ = nullptr;
+            }
+            DeleteDC(memory_dc_);
+            memory_dc_ = nullptr;
+        }
+        if (back_buffer_) {
+            DeleteObject(back_buffer_);
+            back_buffer_ = nullptr;
+        }
+        back_buffer_width_ = 0;
+        back_buffer_height_ = 0;
+    }
+    
+    /**
+     * 获取候选文本的布局，不存在时创建并缓存
+     * 布局与颜色无关，选中和未选中共用同一个布局
+     * @param text 显示文本
+     * @return 文本布局，失败时返回nullptr
+     */
+    IDWriteTextLayout* getLayout(const std::wstring& text) {
+        auto it = layout_cache_.find(text);
+        if (it != layout_cache_.end()) {
+            return it->second;
+        }
+        if (!dwrite_factory_ || !text_format_) {
+            return nullptr;
+        }
+        
+        IDWriteTextLayout* layout = nullptr;
+        const FLOAT max_width = static_cast<FLOAT>(MAX_WINDOW_WIDTH - margin_ * 2 - TEXT_PADDING * 2);
+        HRESULT hr = dwrite_factory_->CreateTextLayout(text.c_str(), static_cast<UINT32>(text.length()),
+                                                       text_format_, max_width,
+                                                       static_cast<FLOAT>(item_height_), &layout);
+        if (FAILED(hr)) {
+            return nullptr;
+        }
+        layout_cache_.emplace(text, layout);
+        return layout;
+    }
+    
+    /**
+     * 缓存超过容量时只保留当前候选词的布局
+     */
+    void pruneLayoutCache() {
+        if (layout_cache_.size() <= LAYOUT_CACHE_CAPACITY) {
+            return;
+        }
+        
+        std::unordered_set<std::wstring> current;
+        for (size_t i = 0; i < candidates_.candidates.size(); ++i) {
+            current.insert(formatCandidateText(i + 1, candidates_.candidates[i]));
+        }
+        for (auto it = layout_cache_.begin(); it != layout_cache_.end();) {
+            if (current.count(it->first) == 0) {
+                it->second->Release();
+                it = layout_cache_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+    
+    void clearLayoutCache() {
+        for (auto& entry : layout_cache_) {
+            entry.second->Release();
+        }
+        layout_cache_.clear();
+    }
+    
+    /**
+     * 切换渲染器，Direct2D需要分层窗口
+     * @param direct2d 是否使用Direct2D
+     */
+    void setRenderer(bool direct2d) {
+        prefer_direct2d_ = direct2d;
+        if (!hwnd_ || direct2d == using_direct2d_) {
             return;
         }
+        if (direct2d && !d2d_factory_ && !initializeDirect2D()) {
+            return;
+        }
+        
+        LONG_PTR ex_style = GetWindowLongPtr(hwnd_, GWL_EXSTYLE);
+        if (direct2d) {
+            ex_style |= WS_EX_LAYERED;
+        } else {
+            ex_style &= ~static_cast<LONG_PTR>(WS_EX_LAYERED);
+            releaseDirect2D();
+        }
+        SetWindowLongPtr(hwnd_, GWL_EXSTYLE, ex_style);
+        using_direct2d_ = direct2d;
+        spdlog::info("Candidate window renderer: {}", direct2d ? "Direct2D" : "GDI");
+    }
+    
+    /**
+     * 重绘窗口：Direct2D直接绘制并呈现到分层窗口，GDI等待WM_PAINT
+     * Direct2D绘制失败时回退到GDI
+     */
+    void redraw() {
+        if (!hwnd_) {
+            return;
+        }
+        if (using_direct2d_) {
+            if (renderDirect2D()) {
+                return;
+            }
+            // 设备丢失时重建一次渲染目标
+            if (!render_target_ && renderDirect2D()) {
+                return;
+            }
+            spdlog::warn("Direct2D rendering failed, falling back to GDI");
+            setRenderer(false);
+        }
+        InvalidateRect(hwnd_, nullptr, FALSE);
+    }
+    
+    bool renderDirect2D() {
+        if (window_width_ <= 0 || window_height_ <= 0) {
+            return false;
+        }
+        if (!ensureRenderTarget() || !ensureBackBuffer(window_width_, window_height_)) {
+            return false;
+        }
         
-        // 计算最大文本宽度
-        HDC hdc = GetDC(hwnd_);
+        RECT bind_rect = { 0, 0, window_width_, window_height_ };
+        if (FAILED(render_target_->BindDC(memory_dc_, &bind_rect))) {
+            return false;
+        }
+        
+        const FLOAT width = toDip(window_width_);
+        const FLOAT height = toDip(window_height_);
+        
+        render_target_->BeginDraw();
+        render_target_->Clear(D2D1::ColorF(0.0f, 0.0f, 0.0f, 0.0f));
+        
+        // 背景和边框
+        brush_->SetColor(toColorF(background_color_, background_alpha_));
+        render_target_->FillRectangle(D2D1::RectF(0.0f, 0.0f, width, height), brush_);
+        brush_->SetColor(toColorF(border_color_, 255));
+        render_target_->DrawRectangle(D2D1::RectF(0.5f, 0.5f, width - 0.5f, height - 0.5f), brush_, 1.0f);
+        
+        // 绘制候选项
+        FLOAT y = static_cast<FLOAT>(margin_);
+        for (size_t i = 0; i < candidates_.candidates.size(); ++i) {
+            const bool selected = static_cast<int>(i) == selected_index_;
+            const D2D1_RECT_F item_rect = D2D1::RectF(static_cast<FLOAT>(margin_), y,
+                                                      width - margin_, y + item_height_);
+            
+            // 绘制选中背景
+            if (selected) {
+                brush_->SetColor(toColorF(selected_color_, 255));
+                render_target_->FillRectangle(item_rect, brush_);
+            }
+            
+            // 绘制候选文本
+            IDWriteTextLayout* layout = getLayout(formatCandidateText(i + 1, candidates_.candidates[i]));
+            if (layout) {
+                brush_->SetColor(toColorF(selected ? selected_text_color_ : text_color_, 255));
+                render_target_->PushAxisAlignedClip(item_rect, D2D1_ANTIALIAS_MODE_ALIASED);
+                render_target_->DrawTextLayout(D2D1::Point2F(item_rect.left + TEXT_PADDING, y), layout, brush_);
+                render_target_->PopAxisAlignedClip();
+            }
+            
+            y += item_height_;
+        }
+        
+        HRESULT hr = render_target_->EndDraw();
+        if (hr == D2DERR_RECREATE_TARGET) {
+            releaseRenderTarget();
+            return false;
+        }
+        if (FAILED(hr)) {
+            return false;
+        }
+        
+        // 后备位图是预乘alpha的BGRA，按逐像素透明呈现
+        POINT source = { 0, 0 };
+        SIZE size = { window_width_, window_height_ };
+        BLENDFUNCTION blend = { AC_SRC_OVER, 0, 255, AC_SRC_ALPHA };
+        return UpdateLayeredWindow(hwnd_, nullptr, nullptr, &size, memory_dc_, &source,
+                                   0, &blend, ULW_ALPHA) != FALSE;
+    }
+    
+    void paintGdi(HDC hdc, const RECT& window_rect) {
+        // 设置背景模式
+        SetBkMode(hdc, TRANSPARENT);
+        
+        // 选择字体
         HFONT old_font = static_cast<HFONT>(SelectObject(hdc, font_));
         
-        int max_width = 0;
+        // 填充背景
+        HBRUSH bg_brush = CreateSolidBrush(background_color_);
+        FillRect(hdc, &window_rect, bg_brush);
+        DeleteObject(bg_brush);
+        
+        // 绘制边框
+        HPEN border_pen = CreatePen(PS_SOLID, 1, border_color_);
+        HPEN old_pen = static_cast<HPEN>(SelectObject(hdc, border_pen));
+        HBRUSH old_brush = static_cast<HBRUSH>(SelectObject(hdc, GetStockObject(NULL_BRUSH)));
+        
+        Rectangle(hdc, window_rect.left, window_rect.top, window_rect.right, window_rect.bottom);
+        
+        SelectObject(hdc, old_brush);
+        SelectObject(hdc, old_pen);
+        DeleteObject(border_pen);
+        
+        // 绘制候选项
+        const int margin = scaled(margin_);
+        const int item_height = scaled(item_height_);
+        int y = margin;
         for (size_t i = 0; i < candidates_.candidates.size(); ++i) {
-            std::wstring text = formatCandidateText(i + 1, candidates_.candidates[i]);
+            const auto& candidate = candidates_.candidates[i];
+            
+            RECT item_rect = {
+                margin,
+                y,
+                window_rect.right - margin,
+                y + item_height
+            };
             
-            SIZE text_size;
-            GetTextExtentPoint32W(hdc, text.c_str(), text.length(), &text_size);
-            max_width = std::max(max_width, static_cast<int>(text_size.cx));
+            // 绘制选中背景
+            if (static_cast<int>(i) == selected_index_) {
+                HBRUSH selected_brush = CreateSolidBrush(selected_color_);
+                FillRect(hdc, &item_rect, selected_brush);
+                DeleteObject(selected_brush);
+                
+                SetTextColor(hdc, selected_text_color_);
+            } else {
+                SetTextColor(hdc, text_color_);
+            }
+            
+            // 绘制候选文本
+            std::wstring display_text = formatCandidateText(i + 1, candidate);
+            
+            RECT text_rect = item_rect;
+            text_rect.left += scaled(TEXT_PADDING);
+            text_rect.right -= scaled(TEXT_PADDING);
+            
+            DrawTextW(hdc, display_text.c_str(), -1, &text_rect,
+                     DT_LEFT | DT_VCENTER | DT_SINGLELINE | DT_END_ELLIPSIS);
+            
+            y += item_height;
         }
         
+        // 恢复字体
         SelectObject(hdc, old_font);
-        ReleaseDC(hwnd_, hdc);
+    }
+    
+    void calculateWindowSize() {
+        if (candidates_.candidates.empty()) {
+            window_width_ = scaled(100);
+            window_height_ = scaled(50);
+            return;
+        }
+        
+        // 计算最大文本宽度（DIP）
+        int max_width = 0;
+        if (using_direct2d_) {
+            for (size_t i = 0; i < candidates_.candidates.size(); ++i) {
+                IDWriteTextLayout* layout = getLayout(formatCandidateText(i + 1, candidates_.candidates[i]));
+                DWRITE_TEXT_METRICS metrics;
+                if (layout && SUCCEEDED(layout->GetMetrics(&metrics))) {
+                    max_width = std::max(max_width, static_cast<int>(metrics.widthIncludingTrailingWhitespace + 0.999f));
+                }
+            }
+        } else {
+            HDC hdc = GetDC(hwnd_);
+            HFONT old_font = static_cast<HFONT>(SelectObject(hdc, font_));
+            
+            for (size_t i = 0; i < candidates_.candidates.size(); ++i) {
+                std::wstring text = formatCandidateText(i + 1, candidates_.candidates[i]);
+                
+                SIZE text_size;
+                GetTextExtentPoint32W(hdc, text.c_str(), text.length(), &text_size);
+                max_width = std::max(max_width, MulDiv(text_size.cx, 96, dpi_));
+            }
+            
+            SelectObject(hdc, old_font);
+            ReleaseDC(hwnd_, hdc);
+        }
         
         // 设置窗口大小
-        window_width_ = max_width + margin_ * 2 + 10; // 额外的边距
-        window_height_ = static_cast<int>(candidates_.candidates.size()) * item_height_ + margin_ * 2;
+        int width = max_width + margin_ * 2 + TEXT_PADDING * 2; // 额外的边距
+        int height = static_cast<int>(candidates_.candidates.size()) * item_height_ + margin_ * 2;
         
         // 限制最大尺寸
-        window_width_ = std::min(window_width_, 400);
-        window_height_ = std::min(window_height_, 300);
+        window_width_ = scaled(std::min(width, MAX_WINDOW_WIDTH));
+        window_height_ = scaled(std::min(height, MAX_WINDOW_HEIGHT));
     }
     
     void adjustWindowPosition(int& x, int& y) {
-        // 获取屏幕尺寸
-        int screen_width = GetSystemMetrics(SM_CXSCREEN);
-        int screen_height = GetSystemMetrics(SM_CYSCREEN);
+        // 获取光标所在显示器的工作区
+        POINT point = { x, y };
+        MONITORINFO monitor_info = {};
+        monitor_info.cbSize = sizeof(MONITORINFO);
+        RECT work_area = { 0, 0, GetSystemMetrics(SM_CXSCREEN), GetSystemMetrics(SM_CYSCREEN) };
+        if (GetMonitorInfoW(MonitorFromPoint(point, MONITOR_DEFAULTTONEAREST), &monitor_info)) {
+            work_area = monitor_info.rcWork;
+        }
         
         // 确保窗口不超出屏幕边界
-        if (x + window_width_ > screen_width) {
-            x = screen_width - window_width_;
+        if (x + window_width_ > work_area.right) {
+            x = work_area.right - window_width_;
         }
-        if (x < 0) {
-            x = 0;
+        if (x < work_area.left) {
+            x = work_area.left;
         }
         
-        if (y + window_height_ > screen_height) {
-            y = y - window_height_ - 30; // 显示在光标上方
+        if (y + window_height_ > work_area.bottom) {
+            y = y - window_height_ - scaled(30); // 显示在光标上方
         }
-        if (y < 0) {
-            y = 0;
+        if (y < work_area.top) {
+            y = work_area.top;
         }
     }
     
+    /**
+     * 读取窗口所在显示器的DPI，变化时按新DPI重建字体和渲染目标的缩放
+     * 需要进程声明为Per-Monitor DPI感知，否则系统始终报告96
+     */
+    void updateDpi() {
+        UINT dpi = hwnd_ ? GetDpiForWindow(hwnd_) : 96;
+        if (dpi == 0) {
+            dpi = 96;
+        }
+        if (dpi == dpi_) {
+            return;
+        }
+        
+        dpi_ = dpi;
+        createFont();
+        if (render_target_) {
+            render_target_->SetDpi(static_cast<FLOAT>(dpi_), static_cast<FLOAT>(dpi_));
+        }
+    }
+    
+    int scaled(int value) const {
+        return MulDiv(value, static_cast<int>(dpi_), 96);
+    }
+    
+    FLOAT toDip(int pixels) const {
+        return pixels * 96.0f / static_cast<FLOAT>(dpi_);
+    }
+    
+    int hitTest(int y) const {
+        int item_height = scaled(item_height_);
+        if (item_height <= 0 || y < scaled(margin_)) {
+            return -1;
+        }
+        return (y - scaled(margin_)) / item_height;
+    }
+    
+    static D2D1_COLOR_F toColorF(COLORREF color, int alpha) {
+        return D2D1::ColorF(GetRValue(color) / 255.0f, GetGValue(color) / 255.0f,
+                            GetBValue(color) / 255.0f, alpha / 255.0f);
+    }
+    
     std::wstring formatCandidateText(int index, const core::Candidate& candidate) {
         std::wstringstream ss;
         ss << index << L". " << utf8ToWstring(candidate.text);
@@ -450,16 +935,16 @@ private:
         // 默认颜色
         return RGB(0, 0, 0);
     }
-    
+
 public:
     HWND hwnd_;
     bool visible_;
     core::CandidateList candidates_;
     int selected_index_;
     
-    int window_width_;
+    int window_width_;              // 像素
     int window_height_;
-    int item_height_;
+    int item_height_;               // DIP
     int margin_;
     int font_size_ = 14;
     
@@ -470,6 +955,25 @@ public:
     COLORREF selected_text_color_;
     COLORREF border_color_;
     
+    UINT dpi_;
+    bool prefer_direct2d_;          // 样式选择的渲染器
+    bool using_direct2d_;           // 实际使用的渲染器
+    int background_alpha_;
+    
+    // Direct2D渲染器：持久的DC渲染目标，绘制到预乘alpha的后备位图再呈现到分层窗口
+    ID2D1Factory* d2d_factory_;
+    IDWriteFactory* dwrite_factory_;
+    IDWriteTextFormat* text_format_;
+    IDWriteInlineObject* ellipsis_sign_;
+    ID2D1DCRenderTarget* render_target_;
+    ID2D1SolidColorBrush* brush_;
+    HDC memory_dc_;
+    HBITMAP back_buffer_;
+    HGDIOBJ old_bitmap_;
+    int back_buffer_width_;
+    int back_buffer_height_;
+    std::unordered_map<std::wstring, IDWriteTextLayout*> layout_cache_;
+    
     std::function<void(int)> selection_callback_;
 };
 
@@ -152,8 +152,13 @@ public:
         // 获取当前活动窗口的输入上下文
         HWND active_window = GetForegroundWindow();
         if (active_window) {
+            // 切换到其他窗口输入时通知焦点变化，前一个窗口的提交历史不再作为前文
+            const bool focus_changed = ime_window_ && ime_window_ != active_window;
             ime_window_ = active_window;
             input_context_ = ImmGetContext(active_window);
+            if (focus_changed && focus_change_callback_) {
+                focus_change_callback_(true);
+            }
         }
         
         if (state_change_callback_) {
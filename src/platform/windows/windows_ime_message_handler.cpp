@@ -2,37 +2,56 @@
 
 #include "platform/windows/windows_ime_adapter.h"
 #include <spdlog/spdlog.h>
+#include <msctf.h>
 #include <algorithm>
+#include <atomic>
+#include <functional>
+#include <iterator>
 
 namespace owcat {
 namespace platform {
 namespace windows {
 
-// 全局钩子句柄
+// OW Cat切换键（Ctrl+Space）在TSF中注册为保留键使用的GUID
+static const GUID GUID_OWCAT_PRESERVEDKEY_TOGGLE =
+    { 0x6b1f3c52, 0x8d4e, 0x4a17, { 0x9c, 0x2b, 0x51, 0xe0, 0x7a, 0x3d, 0x94, 0xc6 } };
+
+// 回退路径的线程键盘钩子
 static HHOOK g_keyboard_hook = nullptr;
-static HHOOK g_mouse_hook = nullptr;
-static WindowsImeMessageHandler* g_handler_instance = nullptr;
+static std::function<bool(const PlatformKeyEvent&, bool)> g_key_handler;
+
+/**
+ * 由虚拟键码和WM_KEYDOWN格式的lParam构造按键事件
+ * @param vk_code 虚拟键码
+ * @param lParam 重复次数、扫描码和状态位
+ * @param is_key_down 是否为按下
+ * @return 按键事件
+ */
+static PlatformKeyEvent makeKeyEvent(WPARAM vk_code, LPARAM lParam, bool is_key_down) {
+    PlatformKeyEvent event;
+    event.key_code = static_cast<uint32_t>(vk_code);
+    event.scan_code = static_cast<uint32_t>((lParam >> 16) & 0xFF);
+    event.is_key_down = is_key_down;
+    event.is_repeat = is_key_down && (lParam & (1 << 30)) != 0;
+    event.modifiers = 0;
+    
+    // 检查修饰键状态
+    if (GetKeyState(VK_CONTROL) & 0x8000) event.modifiers |= 0x01; // CTRL
+    if (GetKeyState(VK_SHIFT) & 0x8000) event.modifiers |= 0x02;   // SHIFT
+    if (GetKeyState(VK_MENU) & 0x8000) event.modifiers |= 0x04;    // ALT
+    if (GetKeyState(VK_LWIN) & 0x8000 || GetKeyState(VK_RWIN) & 0x8000) event.modifiers |= 0x08; // WIN
+    return event;
+}
 
-// 键盘钩子过程
+/**
+ * IMM32回退路径的键盘钩子过程
+ * 钩子只挂在输入法所在的线程上（WH_KEYBOARD），不经过其他应用的输入路径
+ */
 LRESULT CALLBACK KeyboardHookProc(int nCode, WPARAM wParam, LPARAM lParam) {
-    if (nCode >= 0 && g_handler_instance) {
-        KBDLLHOOKSTRUCT* kbd_struct = reinterpret_cast<KBDLLHOOKSTRUCT*>(lParam);
-        
-        PlatformKeyEvent event;
-        event.key_code = kbd_struct->vkCode;
-        event.scan_code = kbd_struct->scanCode;
-        event.is_key_down = (wParam == WM_KEYDOWN || wParam == WM_SYSKEYDOWN);
-        event.is_repeat = false; // 简化处理
-        event.modifiers = 0;
-        
-        // 检查修饰键状态
-        if (GetKeyState(VK_CONTROL) & 0x8000) event.modifiers |= 0x01; // CTRL
-        if (GetKeyState(VK_SHIFT) & 0x8000) event.modifiers |= 0x02;   // SHIFT
-        if (GetKeyState(VK_MENU) & 0x8000) event.modifiers |= 0x04;    // ALT
-        if (GetKeyState(VK_LWIN) & 0x8000 || GetKeyState(VK_RWIN) & 0x8000) event.modifiers |= 0x08; // WIN
-        
-        // 处理键盘事件
-        if (g_handler_instance->processKeyboardEvent(event)) {
+    if (nCode == HC_ACTION && g_key_handler) {
+        // lParam第31位为0表示按下
+        PlatformKeyEvent event = makeKeyEvent(wParam, lParam, (lParam & (1u << 31)) == 0);
+        if (g_key_handler(event, false)) {
             return 1; // 阻止事件传递
         }
     }
@@ -40,25 +59,128 @@ LRESULT CALLBACK KeyboardHookProc(int nCode, WPARAM wParam, LPARAM lParam) {
     return CallNextHookEx(g_keyboard_hook, nCode, wParam, lParam);
 }
 
-// 鼠标钩子过程
-LRESULT CALLBACK MouseHookProc(int nCode, WPARAM wParam, LPARAM lParam) {
-    if (nCode >= 0 && g_handler_instance) {
-        MSLLHOOKSTRUCT* mouse_struct = reinterpret_cast<MSLLHOOKSTRUCT*>(lParam);
-        
-        // 处理鼠标事件（主要用于候选窗口交互）
-        if (wParam == WM_LBUTTONDOWN || wParam == WM_RBUTTONDOWN) {
-            g_handler_instance->processMouseEvent(mouse_struct->pt.x, mouse_struct->pt.y, wParam == WM_LBUTTONDOWN);
+/**
+ * TSF按键事件接收器
+ * 只有本线程中获得焦点的文档上下文以OW Cat为当前输入法时，TSF才把按键交给它，
+ * 其他应用的按键不会经过这里；OnTestKey*只判断是否处理，不改变输入状态
+ */
+class TsfKeyEventSink : public ITfKeyEventSink {
+public:
+    /**
+     * @param handler 按键处理回调，第二个参数为true时只判断是否处理
+     */
+    explicit TsfKeyEventSink(std::function<bool(const PlatformKeyEvent&, bool)> handler)
+        : ref_count_(1), handler_(std::move(handler)) {
+        std::fill(std::begin(eaten_keys_), std::end(eaten_keys_), false);
+    }
+    
+    // IUnknown
+    STDMETHODIMP QueryInterface(REFIID riid, void** ppv) override {
+        if (!ppv) {
+            return E_INVALIDARG;
+        }
+        if (IsEqualIID(riid, IID_IUnknown) || IsEqualIID(riid, IID_ITfKeyEventSink)) {
+            *ppv = static_cast<ITfKeyEventSink*>(this);
+            AddRef();
+            return S_OK;
         }
+        *ppv = nullptr;
+        return E_NOINTERFACE;
     }
     
-    return CallNextHookEx(g_mouse_hook, nCode, wParam, lParam);
-}
+    STDMETHODIMP_(ULONG) AddRef() override {
+        return ++ref_count_;
+    }
+    
+    STDMETHODIMP_(ULONG) Release() override {
+        ULONG count = --ref_count_;
+        if (count == 0) {
+            delete this;
+        }
+        return count;
+    }
+    
+    // ITfKeyEventSink
+    STDMETHODIMP OnSetFocus(BOOL fForeground) override {
+        spdlog::debug("TSF key sink focus: {}", fForeground != FALSE);
+        return S_OK;
+    }
+    
+    STDMETHODIMP OnTestKeyDown(ITfContext* pic, WPARAM wParam, LPARAM lParam, BOOL* pfEaten) override {
+        return testKey(wParam, lParam, true, pfEaten);
+    }
+    
+    STDMETHODIMP OnKeyDown(ITfContext* pic, WPARAM wParam, LPARAM lParam, BOOL* pfEaten) override {
+        if (!pfEaten) {
+            return E_INVALIDARG;
+        }
+        bool eaten = handler_(makeKeyEvent(wParam, lParam, true), false);
+        if (wParam < 256) {
+            eaten_keys_[wParam] = eaten;
+        }
+        *pfEaten = eaten ? TRUE : FALSE;
+        return S_OK;
+    }
+    
+    STDMETHODIMP OnTestKeyUp(ITfContext* pic, WPARAM wParam, LPARAM lParam, BOOL* pfEaten) override {
+        return testKey(wParam, lParam, false, pfEaten);
+    }
+    
+    STDMETHODIMP OnKeyUp(ITfContext* pic, WPARAM wParam, LPARAM lParam, BOOL* pfEaten) override {
+        if (!pfEaten) {
+            return E_INVALIDARG;
+        }
+        // 按下时处理过的键，抬起也一并吞掉，避免应用收到不成对的WM_KEYUP
+        bool eaten = wParam < 256 && eaten_keys_[wParam];
+        if (wParam < 256) {
+            eaten_keys_[wParam] = false;
+        }
+        *pfEaten = eaten ? TRUE : FALSE;
+        return S_OK;
+    }
+    
+    STDMETHODIMP OnPreservedKey(ITfContext* pic, REFGUID rguid, BOOL* pfEaten) override {
+        if (!pfEaten) {
+            return E_INVALIDARG;
+        }
+        *pfEaten = FALSE;
+        if (IsEqualGUID(rguid, GUID_OWCAT_PRESERVEDKEY_TOGGLE)) {
+            PlatformKeyEvent event;
+            event.key_code = VK_SPACE;
+            event.scan_code = 0;
+            event.is_key_down = true;
+            event.is_repeat = false;
+            event.modifiers = 0x01; // CTRL
+            *pfEaten = handler_(event, false) ? TRUE : FALSE;
+        }
+        return S_OK;
+    }
+    
+private:
+    HRESULT testKey(WPARAM wParam, LPARAM lParam, bool is_key_down, BOOL* pfEaten) {
+        if (!pfEaten) {
+            return E_INVALIDARG;
+        }
+        if (is_key_down) {
+            *pfEaten = handler_(makeKeyEvent(wParam, lParam, true), true) ? TRUE : FALSE;
+        } else {
+            *pfEaten = (wParam < 256 && eaten_keys_[wParam]) ? TRUE : FALSE;
+        }
+        return S_OK;
+    }
+    
+    std::atomic<ULONG> ref_count_;
+    std::function<bool(const PlatformKeyEvent&, bool)> handler_;
+    bool eaten_keys_[256];
+};
 
 // WindowsImeMessageHandler::Impl 实现
 class WindowsImeMessageHandler::Impl {
 public:
     Impl(WindowsImeAdapter* adapter) 
-        : adapter_(adapter), hook_installed_(false) {
+        : adapter_(adapter), hook_installed_(false), com_initialized_(false),
+          thread_mgr_(nullptr), keystroke_mgr_(nullptr), key_sink_(nullptr),
+          client_id_(TF_CLIENTID_NULL) {
     }
     
     ~Impl() {
@@ -70,30 +192,28 @@ public:
             return true;
         }
         
-        spdlog::info("Installing Windows IME message hooks");
+        // 优先使用TSF按键接收器，只在OW Cat为当前输入法的焦点上下文中收到按键
+        if (installTsfKeySink()) {
+            hook_installed_ = true;
+            spdlog::info("Windows IME key handling via TSF key event sink");
+            return true;
+        }
         
-        // 安装键盘钩子
-        g_keyboard_hook = SetWindowsHookEx(WH_KEYBOARD_LL, KeyboardHookProc, 
-                                         GetModuleHandle(nullptr), 0);
+        // TSF不可用时回退到IMM32：WM_IME_*消息由processImeMessage()处理，
+        // 按键只在本线程上挂WH_KEYBOARD钩子，不再使用全局低级钩子
+        spdlog::warn("TSF key event sink unavailable, falling back to IMM32 thread hook");
+        g_key_handler = [this](const PlatformKeyEvent& event, bool test_only) {
+            return test_only ? wantsKeyboardEvent(event) : processKeyboardEvent(event);
+        };
+        g_keyboard_hook = SetWindowsHookEx(WH_KEYBOARD, KeyboardHookProc, nullptr, GetCurrentThreadId());
         if (!g_keyboard_hook) {
             spdlog::error("Failed to install keyboard hook: {}", GetLastError());
+            g_key_handler = nullptr;
             return false;
         }
         
-        // 安装鼠标钩子
-        g_mouse_hook = SetWindowsHookEx(WH_MOUSE_LL, MouseHookProc,
-                                      GetModuleHandle(nullptr), 0);
-        if (!g_mouse_hook) {
-            spdlog::error("Failed to install mouse hook: {}", GetLastError());
-            UnhookWindowsHookEx(g_keyboard_hook);
-            g_keyboard_hook = nullptr;
-            return false;
-        }
-        
-        g_handler_instance = this;
         hook_installed_ = true;
-        
-        spdlog::info("Windows IME message hooks installed successfully");
+        spdlog::info("Windows IME key handling via IMM32 thread hook");
         return true;
     }
     
@@ -102,22 +222,21 @@ public:
             return;
         }
         
-        spdlog::info("Uninstalling Windows IME message hooks");
+        spdlog::info("Uninstalling Windows IME key handling");
+        
+        uninstallTsfKeySink();
         
         if (g_keyboard_hook) {
             UnhookWindowsHookEx(g_keyboard_hook);
             g_keyboard_hook = nullptr;
         }
+        g_key_handler = nullptr;
         
-        if (g_mouse_hook) {
-            UnhookWindowsHookEx(g_mouse_hook);
-            g_mouse_hook = nullptr;
-        }
-        
-        g_handler_instance = nullptr;
         hook_installed_ = false;
-        
-        spdlog::info("Windows IME message hooks uninstalled");
+    }
+    
+    bool isTsfActive() const {
+        return key_sink_ != nullptr;
     }
     
     LRESULT processImeMessage(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
@@ -148,6 +267,37 @@ public:
         }
     }
     
+    /**
+     * 判断processKeyboardEvent()是否会处理该按键，不改变输入状态
+     * 供TSF的OnTestKeyDown使用
+     * @param event 按键事件
+     * @return 是否会处理
+     */
+    bool wantsKeyboardEvent(const PlatformKeyEvent& event) const {
+        if (!adapter_ || !event.is_key_down) {
+            return false;
+        }
+        if (event.key_code == VK_SPACE && (event.modifiers & 0x01)) {
+            return true;
+        }
+        if (!adapter_->isInputMethodActive()) {
+            return false;
+        }
+        
+        switch (event.key_code) {
+            case VK_ESCAPE:
+            case VK_RETURN:
+            case VK_BACK:
+            case VK_UP:
+            case VK_DOWN:
+            case VK_LEFT:
+            case VK_RIGHT:
+                return adapter_->pImpl->composing_;
+            default:
+                return isInputChar(event.key_code);
+        }
+    }
+    
     bool processKeyboardEvent(const PlatformKeyEvent& event) {
         if (!adapter_) {
             return false;
@@ -231,12 +381,97 @@ public:
         return false;
     }
     
-    void processMouseEvent(int x, int y, bool is_left_button) {
-        // 处理候选窗口的鼠标点击
-        spdlog::debug("Mouse event at ({}, {}), left button: {}", x, y, is_left_button);
+private:
+    /**
+     * 激活本线程的TSF线程管理器并注册按键接收器和切换键
+     * @return 是否注册成功，失败时已释放所有TSF对象
+     */
+    bool installTsfKeySink() {
+        HRESULT hr = CoInitializeEx(nullptr, COINIT_APARTMENTTHREADED);
+        if (FAILED(hr) && hr != RPC_E_CHANGED_MODE) {
+            spdlog::warn("CoInitializeEx failed: 0x{:x}", static_cast<unsigned long>(hr));
+            return false;
+        }
+        com_initialized_ = SUCCEEDED(hr);
+        
+        hr = CoCreateInstance(CLSID_TF_ThreadMgr, nullptr, CLSCTX_INPROC_SERVER,
+                              IID_ITfThreadMgr, reinterpret_cast<void**>(&thread_mgr_));
+        if (FAILED(hr) || !thread_mgr_) {
+            spdlog::warn("Failed to create TSF thread manager: 0x{:x}", static_cast<unsigned long>(hr));
+            uninstallTsfKeySink();
+            return false;
+        }
+        
+        hr = thread_mgr_->Activate(&client_id_);
+        if (FAILED(hr)) {
+            spdlog::warn("Failed to activate TSF thread manager: 0x{:x}", static_cast<unsigned long>(hr));
+            client_id_ = TF_CLIENTID_NULL;
+            uninstallTsfKeySink();
+            return false;
+        }
+        
+        hr = thread_mgr_->QueryInterface(IID_ITfKeystrokeMgr, reinterpret_cast<void**>(&keystroke_mgr_));
+        if (FAILED(hr) || !keystroke_mgr_) {
+            spdlog::warn("TSF keystroke manager unavailable: 0x{:x}", static_cast<unsigned long>(hr));
+            uninstallTsfKeySink();
+            return false;
+        }
+        
+        auto* sink = new TsfKeyEventSink([this](const PlatformKeyEvent& event, bool test_only) {
+            return test_only ? wantsKeyboardEvent(event) : processKeyboardEvent(event);
+        });
+        hr = keystroke_mgr_->AdviseKeyEventSink(client_id_, sink, TRUE);
+        if (FAILED(hr)) {
+            spdlog::warn("Failed to advise TSF key event sink: 0x{:x}", static_cast<unsigned long>(hr));
+            sink->Release();
+            uninstallTsfKeySink();
+            return false;
+        }
+        key_sink_ = sink;
+        
+        // 切换键注册为保留键，在TSF分发普通按键之前处理
+        static const wchar_t kToggleDescription[] = L"OW Cat";
+        TF_PRESERVEDKEY toggle_key = { VK_SPACE, TF_MOD_CONTROL };
+        hr = keystroke_mgr_->PreserveKey(client_id_, GUID_OWCAT_PRESERVEDKEY_TOGGLE, &toggle_key,
+                                         kToggleDescription, static_cast<ULONG>(wcslen(kToggleDescription)));
+        if (FAILED(hr)) {
+            // 保留键注册失败时切换键仍会经过OnKeyDown
+            spdlog::debug("Failed to preserve TSF toggle key: 0x{:x}", static_cast<unsigned long>(hr));
+        }
+        return true;
+    }
+    
+    /**
+     * 注销按键接收器并释放TSF对象，可在部分初始化后调用
+     */
+    void uninstallTsfKeySink() {
+        if (keystroke_mgr_) {
+            if (key_sink_) {
+                TF_PRESERVEDKEY toggle_key = { VK_SPACE, TF_MOD_CONTROL };
+                keystroke_mgr_->UnpreserveKey(GUID_OWCAT_PRESERVEDKEY_TOGGLE, &toggle_key);
+                keystroke_mgr_->UnadviseKeyEventSink(client_id_);
+            }
+            keystroke_mgr_->Release();
+            keystroke_mgr_ = nullptr;
+        }
+        if (key_sink_) {
+            key_sink_->Release();
+            key_sink_ = nullptr;
+        }
+        if (thread_mgr_) {
+            if (client_id_ != TF_CLIENTID_NULL) {
+                thread_mgr_->Deactivate();
+                client_id_ = TF_CLIENTID_NULL;
+            }
+            thread_mgr_->Release();
+            thread_mgr_ = nullptr;
+        }
+        if (com_initialized_) {
+            CoUninitialize();
+            com_initialized_ = false;
+        }
     }
     
-private:
     LRESULT handleStartComposition(HWND hwnd, WPARAM wParam, LPARAM lParam) {
         spdlog::debug("WM_IME_STARTCOMPOSITION");
         if (adapter_) {
@@ -397,6 +632,11 @@ private:
 private:
     WindowsImeAdapter* adapter_;
     bool hook_installed_;
+    bool com_initialized_;
+    ITfThreadMgr* thread_mgr_;
+    ITfKeystrokeMgr* keystroke_mgr_;
+    TsfKeyEventSink* key_sink_;
+    TfClientId client_id_;
 };
 
 // WindowsImeMessageHandler 实现
@@ -422,8 +662,8 @@ bool WindowsImeMessageHandler::processKeyboardEvent(const PlatformKeyEvent& even
     return pImpl->processKeyboardEvent(event);
 }
 
-void WindowsImeMessageHandler::processMouseEvent(int x, int y, bool is_left_button) {
-    pImpl->processMouseEvent(x, y, is_left_button);
+bool WindowsImeMessageHandler::isTsfActive() const {
+    return pImpl->isTsfActive();
 }
 
 } // namespace windows
@@ -3,6 +3,8 @@
 #include "platform/windows/windows_ime_adapter.h"
 #include <spdlog/spdlog.h>
 #include <sstream>
+#include <algorithm>
+#include <mutex>
 #include <iomanip>
 #include <versionhelpers.h>
 #include <psapi.h>
@@ -433,6 +435,46 @@ std::string WindowsSystemIntegration::getLastErrorString() {
     return pImpl->getLastErrorString();
 }
 
+bool WindowsSystemIntegration::getSystemLoad(core::SystemLoad& load) {
+    load = core::SystemLoad();
+    
+    FILETIME idle_time, kernel_time, user_time;
+    if (!GetSystemTimes(&idle_time, &kernel_time, &user_time)) {
+        spdlog::debug("GetSystemTimes failed: {}", GetLastError());
+        return false;
+    }
+    
+    auto to_ticks = [](const FILETIME& time) {
+        return (static_cast<unsigned long long>(time.dwHighDateTime) << 32) | time.dwLowDateTime;
+    };
+    
+    // 内核时间包含空闲时间
+    static std::mutex sample_mutex;
+    static unsigned long long previous_idle = 0;
+    static unsigned long long previous_total = 0;
+    const unsigned long long idle = to_ticks(idle_time);
+    const unsigned long long total = to_ticks(kernel_time) + to_ticks(user_time);
+    {
+        std::lock_guard<std::mutex> lock(sample_mutex);
+        if (previous_total > 0 && total > previous_total) {
+            const double total_delta = static_cast<double>(total - previous_total);
+            const double idle_delta = static_cast<double>(idle - (std::min)(idle, previous_idle));
+            load.cpu_load = (std::max)(0.0, (std::min)(1.0, 1.0 - idle_delta / total_delta));
+        }
+        previous_idle = idle;
+        previous_total = total;
+    }
+    
+    SYSTEM_POWER_STATUS power_status;
+    if (GetSystemPowerStatus(&power_status)) {
+        load.on_battery = power_status.ACLineStatus == 0;
+        if (power_status.BatteryLifePercent <= 100) {
+            load.battery_percent = power_status.BatteryLifePercent;
+        }
+    }
+    return true;
+}
+
 } // namespace windows
 } // namespace platform
 } // namespace owcat
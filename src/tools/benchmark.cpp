@@ -0,0 +1,583 @@
+// ow_cat_bench: 核心引擎的无界面基准测试
+// 回放按键语料测量引擎延迟，并测量拼音分割、词库查询与LLM推理吞吐量，结果输出为JSON
+//
+// 用法: ow_cat_bench [-l system.lex] [-c corpus.txt] [-m model.gguf] [-s 10000,100000,1000000]
+//                    [-n iterations] [-t label] [-o result.json]
+
+#include "core/engine.h"
+#include "core/lexicon.h"
+#include "core/dictionary_manager.h"
+#include "core/pinyin_converter.h"
+#include "core/llama_predictor.h"
+#include <spdlog/spdlog.h>
+#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using owcat::core::CandidateList;
+using owcat::core::DictionaryManager;
+using owcat::core::Engine;
+using owcat::core::EngineConfig;
+using owcat::core::InputEvent;
+using owcat::core::InputEventType;
+using owcat::core::Lexicon;
+using owcat::core::LexiconBuilder;
+using owcat::core::LexiconEntry;
+using owcat::core::LlamaPredictor;
+using owcat::core::LlamaThroughput;
+using owcat::core::ModelConfig;
+using owcat::core::PinyinConverter;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct BenchOptions {
+    std::string lexicon_path;
+    std::string corpus_path;
+    std::string model_path;
+    std::string output_path;
+    std::string label;
+    std::string work_dir = ".";
+    std::vector<size_t> dictionary_sizes = {10000, 100000, 1000000};
+    int iterations = 3;
+    uint32_t seed = 42;
+    ModelConfig model;
+};
+
+// 语料中的一次输入：连续按键后选择候选词
+struct CorpusPhrase {
+    std::string keys;
+    int select_index;
+};
+
+double elapsedMs(Clock::time_point start, Clock::time_point end) {
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+double elapsedUs(Clock::time_point start, Clock::time_point end) {
+    return std::chrono::duration<double, std::micro>(end - start).count();
+}
+
+/**
+ * 延迟样本的分位数摘要（微秒）
+ */
+nlohmann::json summarizeLatency(std::vector<double>& samples_us) {
+    nlohmann::json summary;
+    summary["samples"] = samples_us.size();
+    if (samples_us.empty()) {
+        return summary;
+    }
+
+    std::sort(samples_us.begin(), samples_us.end());
+    auto at = [&samples_us](double q) {
+        size_t index = static_cast<size_t>(q * static_cast<double>(samples_us.size() - 1));
+        return samples_us[index];
+    };
+
+    double total = 0.0;
+    for (double sample : samples_us) {
+        total += sample;
+    }
+
+    summary["mean_us"] = total / static_cast<double>(samples_us.size());
+    summary["p50_us"] = at(0.50);
+    summary["p90_us"] = at(0.90);
+    summary["p99_us"] = at(0.99);
+    summary["max_us"] = samples_us.back();
+    return summary;
+}
+
+void appendUtf8(std::string& out, uint32_t codepoint) {
+    if (codepoint < 0x80) {
+        out += static_cast<char>(codepoint);
+    } else if (codepoint < 0x800) {
+        out += static_cast<char>(0xc0 | (codepoint >> 6));
+        out += static_cast<char>(0x80 | (codepoint & 0x3f));
+    } else {
+        out += static_cast<char>(0xe0 | (codepoint >> 12));
+        out += static_cast<char>(0x80 | ((codepoint >> 6) & 0x3f));
+        out += static_cast<char>(0x80 | (codepoint & 0x3f));
+    }
+}
+
+/**
+ * 生成指定规模的合成词典，音节数1-4，文本为随机汉字
+ */
+bool buildSyntheticLexicon(const PinyinConverter& converter, size_t entry_count, uint32_t seed,
+                           const std::string& path, std::vector<std::string>& sample_queries) {
+    std::vector<std::string> syllables;
+    syllables.reserve(converter.getSyllableCount());
+    for (size_t id = 0; id < converter.getSyllableCount(); ++id) {
+        syllables.push_back(converter.getSyllable(static_cast<int>(id)));
+    }
+
+    LexiconBuilder builder(syllables);
+    builder.setMaxEntriesPerKey(64);
+
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<int> length_dist(1, 4);
+    std::uniform_int_distribution<int> syllable_dist(0, static_cast<int>(syllables.size()) - 1);
+    std::uniform_int_distribution<uint32_t> char_dist(0x4e00, 0x9fa5);
+    std::uniform_int_distribution<uint32_t> frequency_dist(1, 100000);
+
+    const size_t sample_stride = std::max<size_t>(1, entry_count / 4096);
+    std::vector<uint16_t> ids;
+    std::string text;
+    for (size_t i = 0; i < entry_count; ++i) {
+        const int length = length_dist(rng);
+        ids.clear();
+        text.clear();
+        for (int j = 0; j < length; ++j) {
+            ids.push_back(static_cast<uint16_t>(syllable_dist(rng)));
+            appendUtf8(text, char_dist(rng));
+        }
+        builder.addEncodedEntry(text, ids, frequency_dist(rng));
+
+        // 抽样查询：完整拼音，以及末尾音节只输入首字母的前缀查询
+        if (i % sample_stride == 0) {
+            std::string query;
+            for (size_t j = 0; j < ids.size(); ++j) {
+                if (j > 0) query += ' ';
+                query += syllables[ids[j]];
+            }
+            sample_queries.push_back(query);
+            sample_queries.push_back(query.substr(0, query.size() - syllables[ids.back()].size() + 1));
+        }
+    }
+
+    return builder.write(path);
+}
+
+/**
+ * 词库查询吞吐量：直接查询内存映射词典，以及经过DictionaryManager（含用户词库）
+ */
+nlohmann::json benchDictionary(const PinyinConverter& converter, const BenchOptions& options) {
+    nlohmann::json results = nlohmann::json::array();
+
+    for (size_t entry_count : options.dictionary_sizes) {
+        const std::string path = options.work_dir + "/ow_cat_bench_" + std::to_string(entry_count) + ".lex";
+        std::vector<std::string> queries;
+
+        auto build_start = Clock::now();
+        if (!buildSyntheticLexicon(converter, entry_count, options.seed, path, queries)) {
+            spdlog::error("Failed to build synthetic lexicon: {}", path);
+            continue;
+        }
+        double build_ms = elapsedMs(build_start, Clock::now());
+
+        nlohmann::json result;
+        result["entries"] = entry_count;
+        result["build_ms"] = build_ms;
+        result["queries"] = queries.size();
+
+        {
+            Lexicon lexicon;
+            if (lexicon.open(path)) {
+                LexiconEntry buffer[10];
+                size_t hits = 0;
+                size_t lookups = 0;
+                auto start = Clock::now();
+                for (int iteration = 0; iteration < options.iterations; ++iteration) {
+                    for (const auto& query : queries) {
+                        hits += lexicon.lookupPinyin(query, buffer, 10);
+                        ++lookups;
+                    }
+                }
+                double seconds = elapsedMs(start, Clock::now()) / 1000.0;
+                result["lexicon_qps"] = seconds > 0.0 ? static_cast<double>(lookups) / seconds : 0.0;
+                result["lexicon_avg_results"] = lookups > 0 ? static_cast<double>(hits) / static_cast<double>(lookups) : 0.0;
+            }
+        }
+
+        {
+            DictionaryManager manager(":memory:", path);
+            if (manager.initialize()) {
+                size_t lookups = 0;
+                std::vector<double> latencies;
+                latencies.reserve(queries.size() * static_cast<size_t>(options.iterations));
+                auto start = Clock::now();
+                for (int iteration = 0; iteration < options.iterations; ++iteration) {
+                    for (const auto& query : queries) {
+                        auto query_start = Clock::now();
+                        CandidateList candidates = manager.searchByPinyin(query, 9);
+                        latencies.push_back(elapsedUs(query_start, Clock::now()));
+                        ++lookups;
+                    }
+                }
+                double seconds = elapsedMs(start, Clock::now()) / 1000.0;
+                result["manager_qps"] = seconds > 0.0 ? static_cast<double>(lookups) / seconds : 0.0;
+                result["manager_latency"] = summarizeLatency(latencies);
+                manager.shutdown();
+            }
+        }
+
+        std::remove(path.c_str());
+        results.push_back(std::move(result));
+    }
+
+    return results;
+}
+
+/**
+ * 长输入的拼音分割吞吐量
+ */
+nlohmann::json benchSegmentation(PinyinConverter& converter, const BenchOptions& options) {
+    nlohmann::json results = nlohmann::json::array();
+    std::mt19937 rng(options.seed);
+    std::uniform_int_distribution<int> syllable_dist(0, static_cast<int>(converter.getSyllableCount()) - 1);
+
+    for (size_t target_length : {16u, 32u, 64u, 128u}) {
+        // 每个长度准备一组随机连写拼音
+        std::vector<std::string> inputs;
+        for (int i = 0; i < 64; ++i) {
+            std::string input;
+            while (input.size() < target_length) {
+                input += converter.getSyllable(syllable_dist(rng));
+            }
+            input.resize(target_length);
+            inputs.push_back(std::move(input));
+        }
+
+        const int rounds = std::max(1, options.iterations * 4);
+        size_t chars = 0;
+        size_t segmentations = 0;
+        std::vector<double> latencies;
+        latencies.reserve(inputs.size() * static_cast<size_t>(rounds));
+
+        auto start = Clock::now();
+        for (int round = 0; round < rounds; ++round) {
+            for (const auto& input : inputs) {
+                auto input_start = Clock::now();
+                converter.clear();
+                for (char ch : input) {
+                    converter.addChar(ch);
+                }
+                segmentations += converter.getBestSegmentations(1).size();
+                latencies.push_back(elapsedUs(input_start, Clock::now()));
+                chars += input.size();
+            }
+        }
+        double seconds = elapsedMs(start, Clock::now()) / 1000.0;
+        converter.clear();
+
+        nlohmann::json result;
+        result["input_length"] = target_length;
+        result["inputs_per_sec"] = seconds > 0.0 ? static_cast<double>(latencies.size()) / seconds : 0.0;
+        result["chars_per_sec"] = seconds > 0.0 ? static_cast<double>(chars) / seconds : 0.0;
+        result["segmented"] = segmentations;
+        result["latency"] = summarizeLatency(latencies);
+        results.push_back(std::move(result));
+    }
+
+    return results;
+}
+
+/**
+ * 读取按键语料：每行一组连写拼音，可选的第二列为选择的候选词下标，#开头为注释
+ */
+bool loadCorpus(const std::string& path, std::vector<CorpusPhrase>& corpus) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        spdlog::error("Failed to open corpus: {}", path);
+        return false;
+    }
+
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        std::istringstream iss(line);
+        CorpusPhrase phrase;
+        phrase.select_index = 0;
+        if (!(iss >> phrase.keys)) {
+            continue;
+        }
+        iss >> phrase.select_index;
+        corpus.push_back(std::move(phrase));
+    }
+
+    return !corpus.empty();
+}
+
+/**
+ * 未提供语料时从词典中抽取多音节词作为输入
+ */
+void synthesizeCorpus(const std::string& lexicon_path, size_t max_phrases, std::vector<CorpusPhrase>& corpus) {
+    Lexicon lexicon;
+    if (!lexicon.open(lexicon_path)) {
+        return;
+    }
+
+    const size_t stride = std::max<size_t>(1, lexicon.getEntryCount() / max_phrases);
+    size_t index = 0;
+    lexicon.forEachEntry([&](const LexiconEntry& entry) {
+        if (index++ % stride != 0 || corpus.size() >= max_phrases || entry.syllable_count < 2) {
+            return;
+        }
+        CorpusPhrase phrase;
+        phrase.select_index = 0;
+        for (uint16_t i = 0; i < entry.syllable_count; ++i) {
+            phrase.keys += std::string(lexicon.getSyllable(entry.syllable_ids[i]));
+        }
+        corpus.push_back(std::move(phrase));
+    });
+}
+
+/**
+ * 通过Engine::processInput回放语料，测量每次按键到候选词发布的延迟
+ */
+nlohmann::json benchEngine(const BenchOptions& options, const std::vector<CorpusPhrase>& corpus) {
+    nlohmann::json result;
+
+    EngineConfig config;
+    config.dictionary_path = ":memory:";
+    config.lexicon_path = options.lexicon_path;
+    config.model_path = options.model_path;
+    config.enable_prediction = !options.model_path.empty();
+    config.enable_learning = false;
+    config.model = options.model;
+
+    Engine engine(config);
+    if (!engine.initialize()) {
+        spdlog::error("Failed to initialize engine");
+        result["error"] = "engine initialization failed";
+        return result;
+    }
+
+    // 每次按键只统计最先发布的一批候选词（预测结果可能来自后台线程）
+    Clock::time_point key_start;
+    std::atomic<bool> waiting(false);
+    std::vector<double> candidate_latencies;
+    engine.setCandidateCallback([&](const CandidateList&) {
+        if (waiting.exchange(false, std::memory_order_acquire)) {
+            candidate_latencies.push_back(elapsedUs(key_start, Clock::now()));
+        }
+    });
+
+    std::vector<double> key_latencies;
+    size_t keystrokes = 0;
+    size_t commits = 0;
+
+    auto start = Clock::now();
+    for (int iteration = 0; iteration < options.iterations; ++iteration) {
+        for (const auto& phrase : corpus) {
+            for (char ch : phrase.keys) {
+                key_start = Clock::now();
+                waiting.store(true, std::memory_order_release);
+                engine.processInput(InputEvent(InputEventType::KEY_PRESS, "", ch));
+                key_latencies.push_back(elapsedUs(key_start, Clock::now()));
+                waiting.store(false, std::memory_order_relaxed);
+                ++keystrokes;
+            }
+
+            const size_t candidate_count = engine.getCandidates().size();
+            if (candidate_count > 0) {
+                int index = std::min(phrase.select_index, static_cast<int>(candidate_count) - 1);
+                engine.processInput(InputEvent(InputEventType::CANDIDATE_SELECT, std::to_string(index)));
+                ++commits;
+            }
+            engine.processInput(InputEvent(InputEventType::CLEAR_COMPOSITION));
+        }
+    }
+    double seconds = elapsedMs(start, Clock::now()) / 1000.0;
+
+    result["phrases"] = corpus.size();
+    result["keystrokes"] = keystrokes;
+    result["commits"] = commits;
+    result["keystrokes_per_sec"] = seconds > 0.0 ? static_cast<double>(keystrokes) / seconds : 0.0;
+    result["key_latency"] = summarizeLatency(key_latencies);
+    result["candidate_latency"] = summarizeLatency(candidate_latencies);
+
+    engine.shutdown();
+    return result;
+}
+
+/**
+ * LLM prompt评估与解码吞吐量
+ */
+nlohmann::json benchLlm(const BenchOptions& options) {
+    nlohmann::json result;
+
+    LlamaPredictor predictor(options.model_path, options.model);
+    if (!predictor.initialize() || !predictor.isLoaded()) {
+        result["error"] = "model not loaded";
+        return result;
+    }
+    if (options.model.auto_tune) {
+        result["auto_tuned"] = predictor.autoTune(options.model.tune_cache_path);
+    }
+    result["model_info"] = predictor.getModelInfo();
+
+    const std::string prompt =
+        "输入法根据用户输入的拼音预测最可能的汉字序列。今天天气很好，我们一起去公园散步，"
+        "然后在湖边的咖啡馆坐一会儿，聊聊最近读过的书和看过的电影。";
+    const int decode_tokens = 32;
+
+    double prefill_ms = 0.0;
+    double decode_ms = 0.0;
+    int prompt_tokens = 0;
+    int generated_tokens = 0;
+    for (int iteration = 0; iteration < options.iterations; ++iteration) {
+        LlamaThroughput throughput;
+        if (!predictor.measureThroughput(prompt, decode_tokens, throughput)) {
+            result["error"] = "throughput measurement failed";
+            break;
+        }
+        prefill_ms += throughput.prefill_ms;
+        decode_ms += throughput.decode_ms;
+        prompt_tokens += throughput.prompt_tokens;
+        generated_tokens += throughput.generated_tokens;
+    }
+
+    result["prompt_tokens"] = prompt_tokens;
+    result["generated_tokens"] = generated_tokens;
+    result["prefill_tokens_per_sec"] = prefill_ms > 0.0 ? prompt_tokens * 1000.0 / prefill_ms : 0.0;
+    result["decode_tokens_per_sec"] = decode_ms > 0.0 ? generated_tokens * 1000.0 / decode_ms : 0.0;
+
+    predictor.shutdown();
+    return result;
+}
+
+bool parseSizes(const std::string& text, std::vector<size_t>& sizes) {
+    sizes.clear();
+    std::istringstream iss(text);
+    std::string item;
+    while (std::getline(iss, item, ',')) {
+        try {
+            sizes.push_back(static_cast<size_t>(std::stoull(item)));
+        } catch (const std::exception&) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void printUsage(const char* program) {
+    std::cerr << "Usage: " << program << " [options]\n"
+              << "  -l  system lexicon used for engine replay\n"
+              << "  -c  keystroke corpus (one pinyin phrase per line, optional candidate index)\n"
+              << "  -m  GGUF model for prediction and LLM throughput\n"
+              << "  -s  comma separated synthetic dictionary sizes (default: 10000,100000,1000000, 0 to skip)\n"
+              << "  -n  iterations per benchmark (default: 3)\n"
+              << "  -j  prefill,decode thread counts (default: auto)\n"
+              << "  -g  model layers offloaded to GPU (-1 for all, default: 0)\n"
+              << "  -a  auto-tune thread counts before measuring LLM throughput\n"
+              << "  -w  directory for temporary lexicon files (default: .)\n"
+              << "  -t  label recorded in the output, e.g. a commit hash\n"
+              << "  -o  output JSON path (default: stdout)\n"
+              << "  -v  verbose logging\n";
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    BenchOptions options;
+    options.model.tune_cache_path.clear();     // 不使用调优缓存，每次都重新测量
+    bool verbose = false;
+
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "-l") == 0 && i + 1 < argc) {
+            options.lexicon_path = argv[++i];
+        } else if (std::strcmp(argv[i], "-c") == 0 && i + 1 < argc) {
+            options.corpus_path = argv[++i];
+        } else if (std::strcmp(argv[i], "-m") == 0 && i + 1 < argc) {
+            options.model_path = argv[++i];
+        } else if (std::strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+            if (!parseSizes(argv[++i], options.dictionary_sizes)) {
+                printUsage(argv[0]);
+                return 1;
+            }
+        } else if (std::strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            options.iterations = std::max(1, std::atoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            std::vector<size_t> threads;
+            if (!parseSizes(argv[++i], threads) || threads.size() != 2) {
+                printUsage(argv[0]);
+                return 1;
+            }
+            options.model.prefill_threads = static_cast<int>(threads[0]);
+            options.model.decode_threads = static_cast<int>(threads[1]);
+        } else if (std::strcmp(argv[i], "-g") == 0 && i + 1 < argc) {
+            options.model.gpu_layers = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "-a") == 0) {
+            options.model.auto_tune = true;
+        } else if (std::strcmp(argv[i], "-w") == 0 && i + 1 < argc) {
+            options.work_dir = argv[++i];
+        } else if (std::strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+            options.label = argv[++i];
+        } else if (std::strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            options.output_path = argv[++i];
+        } else if (std::strcmp(argv[i], "-v") == 0) {
+            verbose = true;
+        } else {
+            printUsage(argv[0]);
+            return std::strcmp(argv[i], "-h") == 0 || std::strcmp(argv[i], "--help") == 0 ? 0 : 1;
+        }
+    }
+
+    // 日志默认输出到stdout，避免混入JSON结果
+    spdlog::set_level(verbose ? spdlog::level::info : spdlog::level::err);
+    options.dictionary_sizes.erase(std::remove(options.dictionary_sizes.begin(), options.dictionary_sizes.end(), 0u),
+                                   options.dictionary_sizes.end());
+
+    PinyinConverter converter;
+    if (!converter.initialize()) {
+        spdlog::error("Failed to initialize pinyin converter");
+        return 1;
+    }
+
+    nlohmann::json report;
+    report["benchmark"] = "ow_cat_bench";
+    report["format_version"] = 1;
+    report["label"] = options.label;
+    report["timestamp"] = static_cast<int64_t>(std::time(nullptr));
+    report["iterations"] = options.iterations;
+
+    report["segmentation"] = benchSegmentation(converter, options);
+    report["dictionary"] = benchDictionary(converter, options);
+
+    if (!options.lexicon_path.empty()) {
+        std::vector<CorpusPhrase> corpus;
+        if (!options.corpus_path.empty()) {
+            loadCorpus(options.corpus_path, corpus);
+        } else {
+            synthesizeCorpus(options.lexicon_path, 2000, corpus);
+        }
+
+        if (corpus.empty()) {
+            spdlog::error("No corpus phrases available for engine replay");
+        } else {
+            report["engine"] = benchEngine(options, corpus);
+        }
+    }
+
+    if (!options.model_path.empty()) {
+        report["llm"] = benchLlm(options);
+    }
+
+    const std::string output = report.dump(2);
+    if (options.output_path.empty()) {
+        std::cout << output << std::endl;
+    } else {
+        std::ofstream file(options.output_path);
+        if (!file.is_open()) {
+            spdlog::error("Failed to open output file: {}", options.output_path);
+            return 1;
+        }
+        file << output << "\n";
+    }
+
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,537 @@
+// owcat-dictc: 离线词典编译器
+// 将txt/csv/json词表编译为内存映射的二进制系统词典（Lexicon格式）
+// 可选地从语料统计n-gram词语言模型，供无AI模型时的整句解码使用
+//
+// 用法: owcat-dictc [-f txt|csv|json] [-k 每个音节序列的最大词数] [-n output.ngram [-c corpus.txt]...]
+//                   -o output.lex input...
+
+#include "core/lexicon.h"
+#include "core/ngram_model.h"
+#include "core/pinyin_converter.h"
+#include <spdlog/spdlog.h>
+#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+using owcat::core::LexiconBuilder;
+using owcat::core::NgramModelBuilder;
+using owcat::core::PinyinConverter;
+
+namespace {
+
+struct CompileStats {
+    size_t lines = 0;
+    size_t accepted = 0;
+    size_t rejected = 0;
+};
+
+/**
+ * 词条编码器：规范化拼音并写入构建器
+ */
+class EntryEncoder {
+public:
+    EntryEncoder(PinyinConverter& converter, LexiconBuilder& builder, CompileStats& stats,
+                 NgramModelBuilder* ngram_builder)
+        : converter_(converter), builder_(builder), stats_(stats), ngram_builder_(ngram_builder) {
+        syllables_.reserve(16);
+    }
+
+    void add(const std::string& word, const std::string& pinyin, uint32_t frequency) {
+        if (word.empty() || !encodePinyin(pinyin)) {
+            ++stats_.rejected;
+            return;
+        }
+
+        if (builder_.addEntry(word, syllables_, frequency)) {
+            ++stats_.accepted;
+            // 词典中的词即语言模型的词表，词典频率作为一元概率的先验
+            if (ngram_builder_) {
+                ngram_builder_->addWord(word, frequency);
+            }
+        } else {
+            ++stats_.rejected;
+        }
+    }
+
+private:
+    /**
+     * 将原始拼音转换为音节序列
+     * 支持空格、撇号、声调数字分隔，以及未分隔的连写拼音（通过分割网格切分）
+     */
+    bool encodePinyin(const std::string& raw) {
+        syllables_.clear();
+
+        // ü 和 u: 统一写作 v
+        std::string text;
+        text.reserve(raw.size());
+        for (size_t i = 0; i < raw.size(); ++i) {
+            if (raw.compare(i, 2, "\xc3\xbc") == 0 || raw.compare(i, 2, "u:") == 0) {
+                text += 'v';
+                ++i;
+            } else {
+                text += raw[i];
+            }
+        }
+
+        size_t pos = 0;
+        while (pos < text.size()) {
+            while (pos < text.size() && !std::isalpha(static_cast<unsigned char>(text[pos]))) {
+                ++pos;
+            }
+            size_t end = pos;
+            while (end < text.size() && std::isalpha(static_cast<unsigned char>(text[end]))) {
+                ++end;
+            }
+            if (end == pos) {
+                break;
+            }
+
+            std::string token = converter_.normalizePinyin(text.substr(pos, end - pos));
+            pos = end;
+
+            if (converter_.isValidPinyin(token)) {
+                syllables_.push_back(token);
+                continue;
+            }
+
+            // 连写拼音按最优分割切分
+            converter_.clear();
+            for (char ch : token) {
+                if (!converter_.addChar(ch)) {
+                    return false;
+                }
+            }
+
+            auto segmentations = converter_.getBestSegmentations(1);
+            if (segmentations.empty() || !segmentations.front().complete) {
+                return false;
+            }
+            for (auto& syllable : segmentations.front().syllables) {
+                syllables_.push_back(std::move(syllable));
+            }
+        }
+
+        return !syllables_.empty();
+    }
+
+private:
+    PinyinConverter& converter_;
+    LexiconBuilder& builder_;
+    CompileStats& stats_;
+    NgramModelBuilder* ngram_builder_;
+    std::vector<std::string> syllables_;
+};
+
+bool isNumber(const std::string& text) {
+    return !text.empty() && std::all_of(text.begin(), text.end(),
+                                        [](char c) { return c >= '0' && c <= '9'; });
+}
+
+bool isAsciiWord(const std::string& text) {
+    return !text.empty() && std::all_of(text.begin(), text.end(), [](char c) {
+        return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '\'';
+    });
+}
+
+uint32_t parseFrequency(const std::string& text) {
+    try {
+        unsigned long long value = std::stoull(text);
+        return static_cast<uint32_t>(std::min<unsigned long long>(value, 0xffffffffull));
+    } catch (const std::exception&) {
+        return 1;
+    }
+}
+
+/**
+ * txt格式：每行 "词 拼音... [频率]"，也接受 "拼音 词 [频率]"
+ */
+bool compileTxt(std::istream& input, EntryEncoder& encoder, CompileStats& stats) {
+    std::string line;
+    std::vector<std::string> tokens;
+
+    while (std::getline(input, line)) {
+        ++stats.lines;
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+
+        tokens.clear();
+        size_t pos = 0;
+        while (pos < line.size()) {
+            size_t begin = line.find_first_not_of(" \t\r", pos);
+            if (begin == std::string::npos) {
+                break;
+            }
+            size_t end = line.find_first_of(" \t\r", begin);
+            if (end == std::string::npos) {
+                end = line.size();
+            }
+            tokens.emplace_back(line, begin, end - begin);
+            pos = end;
+        }
+
+        if (tokens.size() < 2) {
+            ++stats.rejected;
+            continue;
+        }
+
+        uint32_t frequency = 1;
+        if (tokens.size() > 2 && isNumber(tokens.back())) {
+            frequency = parseFrequency(tokens.back());
+            tokens.pop_back();
+        }
+
+        // "拼音 词" 的顺序
+        if (isAsciiWord(tokens.front()) && !isAsciiWord(tokens.back())) {
+            std::rotate(tokens.begin(), tokens.end() - 1, tokens.end());
+        }
+
+        std::string pinyin;
+        for (size_t i = 1; i < tokens.size(); ++i) {
+            if (i > 1) pinyin += ' ';
+            pinyin += tokens[i];
+        }
+
+        encoder.add(tokens.front(), pinyin, frequency);
+    }
+
+    return true;
+}
+
+/**
+ * 解析一行CSV，支持双引号字段
+ */
+void splitCsvLine(const std::string& line, std::vector<std::string>& fields) {
+    fields.clear();
+    std::string field;
+    bool quoted = false;
+
+    for (size_t i = 0; i < line.size(); ++i) {
+        char c = line[i];
+        if (quoted) {
+            if (c == '"' && i + 1 < line.size() && line[i + 1] == '"') {
+                field += '"';
+                ++i;
+            } else if (c == '"') {
+                quoted = false;
+            } else {
+                field += c;
+            }
+        } else if (c == '"') {
+            quoted = true;
+        } else if (c == ',') {
+            fields.push_back(std::move(field));
+            field.clear();
+        } else if (c != '\r') {
+            field += c;
+        }
+    }
+    fields.push_back(std::move(field));
+}
+
+/**
+ * csv格式：word,pinyin[,frequency]，可带表头
+ */
+bool compileCsv(std::istream& input, EntryEncoder& encoder, CompileStats& stats) {
+    std::string line;
+    std::vector<std::string> fields;
+    bool first_line = true;
+
+    while (std::getline(input, line)) {
+        ++stats.lines;
+        if (line.empty()) {
+            continue;
+        }
+
+        splitCsvLine(line, fields);
+        if (fields.size() < 2) {
+            ++stats.rejected;
+            continue;
+        }
+
+        // 跳过表头
+        bool header = first_line && (fields[0] == "word" || fields[1] == "pinyin");
+        first_line = false;
+        if (header) {
+            continue;
+        }
+
+        uint32_t frequency = fields.size() > 2 && isNumber(fields[2]) ? parseFrequency(fields[2]) : 1;
+        encoder.add(fields[0], fields[1], frequency);
+    }
+
+    return true;
+}
+
+/**
+ * json格式：对象数组 [{"word": "...", "pinyin": "..." 或 [...], "frequency": n}, ...]
+ * 使用SAX解析，内存占用与文件大小无关
+ */
+class JsonEntryHandler : public nlohmann::json_sax<nlohmann::json> {
+public:
+    JsonEntryHandler(EntryEncoder& encoder, CompileStats& stats)
+        : encoder_(encoder), stats_(stats), frequency_(1), in_pinyin_array_(false) {}
+
+    bool null() override { return true; }
+    bool boolean(bool) override { return true; }
+
+    bool number_integer(number_integer_t value) override {
+        if (key_ == "frequency" || key_ == "freq") {
+            frequency_ = static_cast<uint32_t>(std::max<number_integer_t>(0, std::min<number_integer_t>(value, 0xffffffffll)));
+        }
+        return true;
+    }
+
+    bool number_unsigned(number_unsigned_t value) override {
+        if (key_ == "frequency" || key_ == "freq") {
+            frequency_ = static_cast<uint32_t>(std::min<number_unsigned_t>(value, 0xffffffffull));
+        }
+        return true;
+    }
+
+    bool number_float(number_float_t value, const string_t&) override {
+        if (key_ == "frequency" || key_ == "freq") {
+            frequency_ = static_cast<uint32_t>(std::max(0.0, std::min(value, 4294967295.0)));
+        }
+        return true;
+    }
+
+    bool string(string_t& value) override {
+        if (in_pinyin_array_) {
+            if (!pinyin_.empty()) pinyin_ += ' ';
+            pinyin_ += value;
+        } else if (key_ == "word" || key_ == "text") {
+            word_ = value;
+        } else if (key_ == "pinyin") {
+            pinyin_ = value;
+        } else if (key_ == "frequency" || key_ == "freq") {
+            frequency_ = parseFrequency(value);
+        }
+        return true;
+    }
+
+    bool binary(binary_t&) override { return true; }
+
+    bool start_object(std::size_t) override {
+        word_.clear();
+        pinyin_.clear();
+        frequency_ = 1;
+        key_.clear();
+        return true;
+    }
+
+    bool key(string_t& value) override {
+        key_ = value;
+        return true;
+    }
+
+    bool end_object() override {
+        if (!word_.empty() || !pinyin_.empty()) {
+            ++stats_.lines;
+            encoder_.add(word_, pinyin_, frequency_);
+        }
+        word_.clear();
+        pinyin_.clear();
+        key_.clear();
+        return true;
+    }
+
+    bool start_array(std::size_t) override {
+        in_pinyin_array_ = key_ == "pinyin";
+        return true;
+    }
+
+    bool end_array() override {
+        in_pinyin_array_ = false;
+        key_.clear();
+        return true;
+    }
+
+    bool parse_error(std::size_t position, const std::string&, const nlohmann::detail::exception& ex) override {
+        spdlog::error("JSON parse error at byte {}: {}", position, ex.what());
+        return false;
+    }
+
+private:
+    EntryEncoder& encoder_;
+    CompileStats& stats_;
+    std::string key_;
+    std::string word_;
+    std::string pinyin_;
+    uint32_t frequency_;
+    bool in_pinyin_array_;
+};
+
+bool compileJson(std::istream& input, EntryEncoder& encoder, CompileStats& stats) {
+    JsonEntryHandler handler(encoder, stats);
+    return nlohmann::json::sax_parse(input, &handler);
+}
+
+std::string detectFormat(const std::string& path) {
+    auto dot = path.find_last_of('.');
+    if (dot == std::string::npos) {
+        return "txt";
+    }
+    std::string ext = path.substr(dot + 1);
+    std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return std::tolower(c); });
+    return ext == "csv" || ext == "json" ? ext : "txt";
+}
+
+/**
+ * 逐行统计语料，每行一句，可以已分词（空格分隔）或未分词
+ */
+bool compileCorpus(const std::string& path, NgramModelBuilder& builder) {
+    std::ifstream input(path, std::ios::binary);
+    if (!input.is_open()) {
+        spdlog::error("Failed to open corpus file: {}", path);
+        return false;
+    }
+
+    std::string line;
+    size_t lines = 0;
+    size_t tokens = 0;
+    while (std::getline(input, line)) {
+        ++lines;
+        tokens += builder.addText(line);
+    }
+
+    spdlog::info("Counted {} tokens in {} lines of {}", tokens, lines, path);
+    return true;
+}
+
+void printUsage(const char* program) {
+    std::cerr << "Usage: " << program << " [-f txt|csv|json] [-k max_entries_per_key] [-a max_entries_per_abbreviation]\n"
+              << "       [-n output.ngram [-c corpus.txt]...]\n"
+              << "       -o output.lex input...\n"
+              << "  -f  input format (default: detected from file extension)\n"
+              << "  -k  maximum entries kept per syllable sequence (default: 64)\n"
+              << "  -a  maximum entries kept per initials sequence, e.g. \"zgr\" (default: 32)\n"
+              << "  -n  also write an n-gram language model for sentence decoding\n"
+              << "  -c  corpus for the n-gram model, one sentence per line (repeatable;\n"
+              << "      without a corpus the model only holds dictionary frequencies)\n"
+              << "  -o  output lexicon path\n";
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::string format;
+    std::string output;
+    std::string ngram_output;
+    size_t max_entries_per_key = 64;
+    size_t max_entries_per_abbreviation = 32;
+    std::vector<std::string> inputs;
+    std::vector<std::string> corpora;
+
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "-f") == 0 && i + 1 < argc) {
+            format = argv[++i];
+        } else if (std::strcmp(argv[i], "-k") == 0 && i + 1 < argc) {
+            max_entries_per_key = static_cast<size_t>(std::max(1, std::atoi(argv[++i])));
+        } else if (std::strcmp(argv[i], "-a") == 0 && i + 1 < argc) {
+            max_entries_per_abbreviation = static_cast<size_t>(std::max(1, std::atoi(argv[++i])));
+        } else if (std::strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            output = argv[++i];
+        } else if (std::strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            ngram_output = argv[++i];
+        } else if (std::strcmp(argv[i], "-c") == 0 && i + 1 < argc) {
+            corpora.emplace_back(argv[++i]);
+        } else if (std::strcmp(argv[i], "-h") == 0 || std::strcmp(argv[i], "--help") == 0) {
+            printUsage(argv[0]);
+            return 0;
+        } else {
+            inputs.emplace_back(argv[i]);
+        }
+    }
+
+    if (output.empty() || inputs.empty() || (!corpora.empty() && ngram_output.empty())) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    PinyinConverter converter;
+    if (!converter.initialize()) {
+        spdlog::error("Failed to initialize pinyin converter");
+        return 1;
+    }
+
+    std::vector<std::string> syllables;
+    syllables.reserve(converter.getSyllableCount());
+    for (size_t id = 0; id < converter.getSyllableCount(); ++id) {
+        syllables.push_back(converter.getSyllable(static_cast<int>(id)));
+    }
+
+    LexiconBuilder builder(syllables);
+    builder.setMaxEntriesPerKey(max_entries_per_key);
+    builder.setMaxEntriesPerAbbreviation(max_entries_per_abbreviation);
+
+    std::unique_ptr<NgramModelBuilder> ngram_builder;
+    if (!ngram_output.empty()) {
+        ngram_builder = std::make_unique<NgramModelBuilder>();
+    }
+
+    CompileStats stats;
+    EntryEncoder encoder(converter, builder, stats, ngram_builder.get());
+
+    for (const auto& input_path : inputs) {
+        std::ifstream input(input_path, std::ios::binary);
+        if (!input.is_open()) {
+            spdlog::error("Failed to open input file: {}", input_path);
+            return 1;
+        }
+
+        std::string input_format = format.empty() ? detectFormat(input_path) : format;
+        spdlog::info("Compiling {} ({})", input_path, input_format);
+
+        bool ok;
+        if (input_format == "txt") {
+            ok = compileTxt(input, encoder, stats);
+        } else if (input_format == "csv") {
+            ok = compileCsv(input, encoder, stats);
+        } else if (input_format == "json") {
+            ok = compileJson(input, encoder, stats);
+        } else {
+            spdlog::error("Unsupported dictionary format: {}", input_format);
+            return 1;
+        }
+
+        if (!ok) {
+            spdlog::error("Failed to compile {}", input_path);
+            return 1;
+        }
+    }
+
+    if (stats.accepted == 0) {
+        spdlog::error("No valid entries found");
+        return 1;
+    }
+
+    if (!builder.write(output)) {
+        return 1;
+    }
+
+    // 词表完整后再统计语料
+    if (ngram_builder) {
+        for (const auto& corpus_path : corpora) {
+            if (!compileCorpus(corpus_path, *ngram_builder)) {
+                return 1;
+            }
+        }
+        if (!ngram_builder->write(ngram_output)) {
+            return 1;
+        }
+    }
+
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    spdlog::info("Compiled {} entries ({} rejected, {} lines) in {:.2f}s",
+                 stats.accepted, stats.rejected, stats.lines, elapsed);
+    return 0;
+}
\ No newline at end of file
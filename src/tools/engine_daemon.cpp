@@ -0,0 +1,73 @@
+// owcat-engined: 引擎守护进程
+// 持有唯一的词库和预测模型，各输入法前端通过共享内存通道连接，内存占用不随前端进程数量增长
+//
+// 用法: owcat-engined [-d dictionary.db] [-l system.lex] [-m model.gguf] [--auto-tune] [--no-prediction]
+
+#include "core/engine_service.h"
+#include <spdlog/spdlog.h>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <iostream>
+#include <thread>
+
+using owcat::core::EngineConfig;
+using owcat::core::EngineServer;
+
+namespace {
+
+std::atomic<bool> g_stop_requested(false);
+
+void handleSignal(int) {
+    g_stop_requested = true;
+}
+
+void printUsage(const char* program) {
+    std::cerr << "Usage: " << program
+              << " [-d dictionary.db] [-l system.lex] [-m model.gguf] [--auto-tune] [--no-prediction]\n"
+              << "  -d  user dictionary database (default: data/dictionary.db)\n"
+              << "  -l  system lexicon (default: data/system.lex)\n"
+              << "  -m  GGUF model shared by all sessions (default: models/qwen0.6b.gguf)\n"
+              << "  --auto-tune  pick the fastest thread counts for this machine on first start\n"
+              << "  --no-prediction  disable AI prediction\n";
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    EngineConfig config;
+
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "-d") == 0 && i + 1 < argc) {
+            config.dictionary_path = argv[++i];
+        } else if (std::strcmp(argv[i], "-l") == 0 && i + 1 < argc) {
+            config.lexicon_path = argv[++i];
+        } else if (std::strcmp(argv[i], "-m") == 0 && i + 1 < argc) {
+            config.model_path = argv[++i];
+        } else if (std::strcmp(argv[i], "--auto-tune") == 0) {
+            config.model.auto_tune = true;
+        } else if (std::strcmp(argv[i], "--no-prediction") == 0) {
+            config.enable_prediction = false;
+        } else {
+            printUsage(argv[0]);
+            return std::strcmp(argv[i], "-h") == 0 || std::strcmp(argv[i], "--help") == 0 ? 0 : 1;
+        }
+    }
+
+    std::signal(SIGINT, handleSignal);
+    std::signal(SIGTERM, handleSignal);
+
+    EngineServer server(config);
+    if (!server.start()) {
+        spdlog::error("Failed to start engine server");
+        return 1;
+    }
+
+    while (!g_stop_requested && server.isRunning()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    }
+
+    server.stop();
+    return 0;
+}
\ No newline at end of file
@@ -1,4 +1,5 @@
 #include "ui/gtk_ui.h"
+#include "core/latency_tracker.h"
 #include <memory>
 #include <string>
 #include <vector>
@@ -246,6 +247,11 @@ void GtkMainWindow::updateStatus(const std::string& status) {
 void GtkMainWindow::updateStatistics(const std::map<std::string, std::string>& stats) {
     pImpl->statistics = stats;
     
+    // 附加按键延迟统计，调用方已提供的同名项优先
+    for (const auto& latency : core::LatencyTracker::instance().getSummary()) {
+        pImpl->statistics.insert(latency);
+    }
+    
 #ifdef OWCAT_USE_GTK
     if (pImpl->statisticsGrid) {
         // Clear existing statistics
@@ -257,7 +263,7 @@ void GtkMainWindow::updateStatistics(const std::map<std::string, std::string>& s
         
         // Add new statistics
         int row = 0;
-        for (const auto& stat : stats) {
+        for (const auto& stat : pImpl->statistics) {
             GtkWidget* keyLabel = gtk_label_new(stat.first.c_str());
             GtkWidget* valueLabel = gtk_label_new(stat.second.c_str());
             
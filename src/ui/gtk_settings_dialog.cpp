@@ -1,4 +1,6 @@
 #include "ui/gtk_ui.h"
+#include "core/dictionary_manager.h"
+#include <algorithm>
 #include <memory>
 #include <string>
 #include <vector>
@@ -58,6 +60,10 @@ struct GtkSettingsDialog::Impl {
     GtkWidget* browseDictionaryButton;
     GtkWidget* userDictionaryPathEntry;
     GtkWidget* browseUserDictionaryButton;
+    GtkWidget* importDictionaryButton;
+    GtkWidget* exportDictionaryButton;
+    GtkWidget* cancelTransferButton;
+    GtkWidget* transferProgressBar;
     GtkWidget* logLevelComboBox;
     GtkWidget* enableLoggingCheckButton;
     GtkWidget* maxHistorySpinButton;
@@ -81,6 +87,12 @@ struct GtkSettingsDialog::Impl {
     std::function<void()> onDialogClosed;
     std::function<void()> onResetRequested;
     
+    // Dictionary import/export; the task holds a pointer into the manager, so it is declared after it
+    std::shared_ptr<core::DictionaryManager> dictionaryManager;
+    std::unique_ptr<core::DictionaryTask> transferTask;
+    std::string transferVerb;
+    unsigned int transferTimer;
+    
     Impl() {
 #ifdef OWCAT_USE_GTK
         dialog = nullptr;
@@ -119,6 +131,10 @@ struct GtkSettingsDialog::Impl {
         browseDictionaryButton = nullptr;
         userDictionaryPathEntry = nullptr;
         browseUserDictionaryButton = nullptr;
+        importDictionaryButton = nullptr;
+        exportDictionaryButton = nullptr;
+        cancelTransferButton = nullptr;
+        transferProgressBar = nullptr;
         logLevelComboBox = nullptr;
         enableLoggingCheckButton = nullptr;
         maxHistorySpinButton = nullptr;
@@ -132,7 +148,109 @@ struct GtkSettingsDialog::Impl {
 #endif
         
         isVisible = false;
+        transferTimer = 0;
+    }
+    
+    ~Impl() {
+#ifdef OWCAT_USE_GTK
+        if (transferTimer) {
+            g_source_remove(transferTimer);
+        }
+#endif
+        // Cancels and joins a running import/export before the manager can go away
+        transferTask.reset();
+    }
+    
+#ifdef OWCAT_USE_GTK
+    void startTransfer(std::unique_ptr<core::DictionaryTask> task, const char* verb) {
+        if (!task) {
+            gtk_progress_bar_set_text(GTK_PROGRESS_BAR(transferProgressBar), "Unsupported dictionary format");
+            return;
+        }
+        
+        transferTask = std::move(task);
+        transferVerb = verb;
+        gtk_widget_set_sensitive(importDictionaryButton, FALSE);
+        gtk_widget_set_sensitive(exportDictionaryButton, FALSE);
+        gtk_widget_set_sensitive(cancelTransferButton, TRUE);
+        gtk_progress_bar_set_fraction(GTK_PROGRESS_BAR(transferProgressBar), 0.0);
+        gtk_progress_bar_set_text(GTK_PROGRESS_BAR(transferProgressBar), (transferVerb + "...").c_str());
+        
+        // Poll instead of posting from the worker so no callback can outlive the dialog
+        transferTimer = g_timeout_add(100, +[](gpointer userData) -> gboolean {
+            return static_cast<Impl*>(userData)->pollTransfer();
+        }, this);
+    }
+    
+    gboolean pollTransfer() {
+        const core::DictionaryProgress progress = transferTask->getProgress();
+        if (progress.total > 0) {
+            gtk_progress_bar_set_fraction(GTK_PROGRESS_BAR(transferProgressBar),
+                                          std::min(1.0, static_cast<double>(progress.processed) / progress.total));
+        }
+        
+        std::ostringstream text;
+        if (!transferTask->isFinished()) {
+            text << transferVerb << "... " << progress.entries << " words";
+            gtk_progress_bar_set_text(GTK_PROGRESS_BAR(transferProgressBar), text.str().c_str());
+            return G_SOURCE_CONTINUE;
+        }
+        
+        switch (transferTask->wait()) {
+            case core::DictionaryIoStatus::OK:
+                gtk_progress_bar_set_fraction(GTK_PROGRESS_BAR(transferProgressBar), 1.0);
+                text << transferVerb << " finished: " << progress.entries << " words";
+                if (progress.rejected > 0) {
+                    text << ", " << progress.rejected << " skipped";
+                }
+                break;
+            case core::DictionaryIoStatus::CANCELLED:
+                text << transferVerb << " cancelled after " << progress.entries << " words";
+                break;
+            case core::DictionaryIoStatus::FAILED:
+                text << transferVerb << " failed";
+                break;
+        }
+        gtk_progress_bar_set_text(GTK_PROGRESS_BAR(transferProgressBar), text.str().c_str());
+        
+        transferTask.reset();
+        transferTimer = 0;
+        gtk_widget_set_sensitive(importDictionaryButton, TRUE);
+        gtk_widget_set_sensitive(exportDictionaryButton, TRUE);
+        gtk_widget_set_sensitive(cancelTransferButton, FALSE);
+        return G_SOURCE_REMOVE;
+    }
+    
+    std::string chooseDictionaryFile(const char* title, bool save) {
+        GtkWidget* fileChooser = gtk_file_chooser_dialog_new(title,
+                                                             GTK_WINDOW(dialog),
+                                                             save ? GTK_FILE_CHOOSER_ACTION_SAVE : GTK_FILE_CHOOSER_ACTION_OPEN,
+                                                             "Cancel", GTK_RESPONSE_CANCEL,
+                                                             save ? "Save" : "Open", GTK_RESPONSE_ACCEPT,
+                                                             nullptr);
+        
+        // The format is detected from the file extension
+        GtkFileFilter* filter = gtk_file_filter_new();
+        gtk_file_filter_set_name(filter, "Dictionary Files (txt, csv, json, lex)");
+        gtk_file_filter_add_pattern(filter, "*.txt");
+        gtk_file_filter_add_pattern(filter, "*.csv");
+        gtk_file_filter_add_pattern(filter, "*.json");
+        gtk_file_filter_add_pattern(filter, "*.lex");
+        gtk_file_chooser_add_filter(GTK_FILE_CHOOSER(fileChooser), filter);
+        
+        std::string path;
+        if (gtk_dialog_run(GTK_DIALOG(fileChooser)) == GTK_RESPONSE_ACCEPT) {
+            gchar* filename = gtk_file_chooser_get_filename(GTK_FILE_CHOOSER(fileChooser));
+            if (filename) {
+                path = filename;
+                g_free(filename);
+            }
+        }
+        
+        gtk_widget_destroy(fileChooser);
+        return path;
     }
+#endif
 };
 
 GtkSettingsDialog::GtkSettingsDialog() : pImpl(std::make_unique<Impl>()) {}
@@ -182,6 +300,13 @@ bool GtkSettingsDialog::create(GtkWindow* parent) {
 
 void GtkSettingsDialog::destroy() {
 #ifdef OWCAT_USE_GTK
+    // The progress timer touches the dialog's widgets
+    if (pImpl->transferTimer) {
+        g_source_remove(pImpl->transferTimer);
+        pImpl->transferTimer = 0;
+    }
+    pImpl->transferTask.reset();
+    
     if (pImpl->dialog) {
         // GTK4: Use gtk_window_destroy instead of gtk_widget_destroy
         gtk_window_destroy(GTK_WINDOW(pImpl->dialog));
@@ -291,6 +416,25 @@ void GtkSettingsDialog::setOnResetRequested(std::function<void()> callback) {
     pImpl->onResetRequested = callback;
 }
 
+void GtkSettingsDialog::setDictionaryManager(std::shared_ptr<core::DictionaryManager> manager) {
+#ifdef OWCAT_USE_GTK
+    if (pImpl->transferTimer) {
+        g_source_remove(pImpl->transferTimer);
+        pImpl->transferTimer = 0;
+    }
+#endif
+    // A running transfer belongs to the previous manager
+    pImpl->transferTask.reset();
+    pImpl->dictionaryManager = std::move(manager);
+#ifdef OWCAT_USE_GTK
+    if (pImpl->importDictionaryButton) {
+        gtk_widget_set_sensitive(pImpl->cancelTransferButton, FALSE);
+        gtk_widget_set_sensitive(pImpl->importDictionaryButton, pImpl->dictionaryManager != nullptr);
+        gtk_widget_set_sensitive(pImpl->exportDictionaryButton, pImpl->dictionaryManager != nullptr);
+    }
+#endif
+}
+
 // Widget access
 GtkWidget* GtkSettingsDialog::getWidget() const {
 #ifdef OWCAT_USE_GTK
@@ -535,6 +679,32 @@ void GtkSettingsDialog::createAdvancedPage() {
     gtk_box_pack_start(GTK_BOX(userDictionaryBox), pImpl->browseUserDictionaryButton, FALSE, FALSE, 0);
     gtk_grid_attach(GTK_GRID(pImpl->advancedPage), userDictionaryBox, 1, row++, 1, 1);
     
+    // Dictionary import/export
+    GtkWidget* transferLabel = gtk_label_new("User Words:");
+    gtk_widget_set_halign(transferLabel, GTK_ALIGN_START);
+    gtk_grid_attach(GTK_GRID(pImpl->advancedPage), transferLabel, 0, row, 1, 1);
+    
+    GtkWidget* transferBox = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 5);
+    pImpl->importDictionaryButton = gtk_button_new_with_label("Import...");
+    gtk_box_pack_start(GTK_BOX(transferBox), pImpl->importDictionaryButton, FALSE, FALSE, 0);
+    
+    pImpl->exportDictionaryButton = gtk_button_new_with_label("Export...");
+    gtk_box_pack_start(GTK_BOX(transferBox), pImpl->exportDictionaryButton, FALSE, FALSE, 0);
+    
+    pImpl->cancelTransferButton = gtk_button_new_with_label("Cancel");
+    gtk_widget_set_sensitive(pImpl->cancelTransferButton, FALSE);
+    gtk_box_pack_start(GTK_BOX(transferBox), pImpl->cancelTransferButton, FALSE, FALSE, 0);
+    gtk_grid_attach(GTK_GRID(pImpl->advancedPage), transferBox, 1, row++, 1, 1);
+    
+    pImpl->transferProgressBar = gtk_progress_bar_new();
+    gtk_progress_bar_set_show_text(GTK_PROGRESS_BAR(pImpl->transferProgressBar), TRUE);
+    gtk_progress_bar_set_text(GTK_PROGRESS_BAR(pImpl->transferProgressBar), "");
+    gtk_grid_attach(GTK_GRID(pImpl->advancedPage), pImpl->transferProgressBar, 1, row++, 1, 1);
+    
+    const bool hasManager = pImpl->dictionaryManager != nullptr;
+    gtk_widget_set_sensitive(pImpl->importDictionaryButton, hasManager);
+    gtk_widget_set_sensitive(pImpl->exportDictionaryButton, hasManager);
+    
     // Log level
     GtkWidget* logLevelLabel = gtk_label_new("Log Level:");
     gtk_widget_set_halign(logLevelLabel, GTK_ALIGN_START);
@@ -703,6 +873,34 @@ void GtkSettingsDialog::connectSignals() {
         dialog->browseUserDictionaryPath();
     }), this);
     
+    // Import dictionary button
+    g_signal_connect(pImpl->importDictionaryButton, "clicked", G_CALLBACK(+[](GtkButton* button, gpointer userData) {
+        GtkSettingsDialog* dialog = static_cast<GtkSettingsDialog*>(userData);
+        Impl* impl = dialog->pImpl.get();
+        std::string path = impl->chooseDictionaryFile("Import Dictionary", false);
+        if (!path.empty() && impl->dictionaryManager && !impl->transferTask) {
+            impl->startTransfer(impl->dictionaryManager->importDictionaryAsync(path), "Importing");
+        }
+    }), this);
+    
+    // Export user dictionary button
+    g_signal_connect(pImpl->exportDictionaryButton, "clicked", G_CALLBACK(+[](GtkButton* button, gpointer userData) {
+        GtkSettingsDialog* dialog = static_cast<GtkSettingsDialog*>(userData);
+        Impl* impl = dialog->pImpl.get();
+        std::string path = impl->chooseDictionaryFile("Export User Dictionary", true);
+        if (!path.empty() && impl->dictionaryManager && !impl->transferTask) {
+            impl->startTransfer(impl->dictionaryManager->exportUserDictionaryAsync(path), "Exporting");
+        }
+    }), this);
+    
+    // Cancel import/export button; the task stops at its next progress report
+    g_signal_connect(pImpl->cancelTransferButton, "clicked", G_CALLBACK(+[](GtkButton* button, gpointer userData) {
+        GtkSettingsDialog* dialog = static_cast<GtkSettingsDialog*>(userData);
+        if (dialog->pImpl->transferTask) {
+            dialog->pImpl->transferTask->cancel();
+        }
+    }), this);
+    
     // Dialog close signal
     g_signal_connect(pImpl->dialog, "delete-event", G_CALLBACK(+[](GtkWidget* widget, GdkEvent* event, gpointer userData) -> gboolean {
         GtkSettingsDialog* dialog = static_cast<GtkSettingsDialog*>(userData);
@@ -0,0 +1,144 @@
+#include "core/candidate_merger.h"
+#include "test_support.h"
+#include <algorithm>
+#include <random>
+#include <string>
+#include <unordered_map>
+
+using namespace owcat::core;
+
+namespace {
+
+// 参考实现：按文本去重保留最高分，再按得分降序取前k个
+CandidateList referenceTopK(const std::vector<Candidate>& inputs, size_t k) {
+    std::unordered_map<std::string, Candidate> best;
+    for (const auto& candidate : inputs) {
+        auto it = best.find(candidate.text);
+        if (it == best.end() || it->second.score < candidate.score) {
+            best[candidate.text] = candidate;
+        }
+    }
+    CandidateList result;
+    for (auto& [text, candidate] : best) {
+        result.push_back(candidate);
+    }
+    std::sort(result.begin(), result.end(), [](const Candidate& a, const Candidate& b) {
+        return a.score > b.score;
+    });
+    if (result.size() > k) {
+        result.resize(k);
+    }
+    return result;
+}
+
+bool sameResult(const CandidateList& a, const CandidateList& b) {
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (a[i].text != b[i].text || a[i].score != b[i].score || a[i].pinyin != b[i].pinyin) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void testBasicMerge() {
+    // 视图引用来源中的字符串，来源在合并期间保持有效
+    const CandidateList sources = {
+        Candidate("你", "ni", 1.0), Candidate("好", "hao", 3.0), Candidate("呢", "ne", 2.0),
+        Candidate("拟", "ni", 0.5), Candidate("号", "hao", 2.5), Candidate("好", "hao", 0.1),
+        Candidate("呢", "ne", 4.0)
+    };
+    
+    CandidateMerger merger(4);
+    merger.reset(3);
+    OWCAT_CHECK(merger.add(CandidateView(sources[0])));
+    OWCAT_CHECK(merger.add(CandidateView(sources[1])));
+    OWCAT_CHECK(merger.add(CandidateView(sources[2])));
+    OWCAT_CHECK(merger.size() == 3);
+    
+    // 低于堆顶的不进入，高于堆顶的淘汰最差者
+    OWCAT_CHECK(!merger.add(CandidateView(sources[3])));
+    OWCAT_CHECK(merger.add(CandidateView(sources[4])));
+    
+    // 重复文本保留得分较高者
+    OWCAT_CHECK(!merger.add(CandidateView(sources[5])));
+    OWCAT_CHECK(merger.add(CandidateView(sources[6])));
+    OWCAT_CHECK(merger.size() == 3);
+    
+    CandidateList out;
+    merger.finish(out);
+    OWCAT_CHECK(out.size() == 3);
+    if (out.size() == 3) {
+        OWCAT_CHECK(out[0].text == "呢" && out[0].score == 4.0);
+        OWCAT_CHECK(out[1].text == "好");
+        OWCAT_CHECK(out[2].text == "号");
+    }
+}
+
+// 同分时按加入顺序输出
+void testStableTies() {
+    CandidateMerger merger(8);
+    merger.reset(8);
+    const char* texts[] = {"甲", "乙", "丙", "丁"};
+    CandidateList sources;
+    for (const char* text : texts) {
+        sources.emplace_back(text, "", 1.0);
+    }
+    merger.addAll(sources);
+    CandidateList out;
+    merger.finish(out);
+    OWCAT_CHECK(out.size() == 4);
+    for (size_t i = 0; i < out.size() && i < 4; ++i) {
+        OWCAT_CHECK(out[i].text == texts[i]);
+    }
+}
+
+// 随机输入（大量重复和替换）与参考实现一致，多轮复用同一个合并器
+void testRandomAgainstReference() {
+    std::mt19937 rng(12345);
+    std::uniform_int_distribution<int> text_id(0, 60);
+    std::uniform_real_distribution<double> score(0.0, 100.0);
+    
+    CandidateMerger merger(32);
+    CandidateList out;
+    for (int round = 0; round < 200; ++round) {
+        const size_t k = 1 + static_cast<size_t>(round % 32);
+        std::vector<Candidate> inputs;
+        for (int i = 0; i < 300; ++i) {
+            const std::string text = "w" + std::to_string(text_id(rng));
+            inputs.emplace_back(text, "p" + text, score(rng), i);
+        }
+        
+        merger.reset(k);
+        merger.addAll(inputs);
+        merger.finish(out);
+        OWCAT_CHECK(sameResult(out, referenceTopK(inputs, k)));
+    }
+}
+
+void testAddAllCount() {
+    CandidateList inputs;
+    for (int i = 0; i < 10; ++i) {
+        inputs.emplace_back("w" + std::to_string(i), "", static_cast<double>(i));
+    }
+    CandidateMerger merger(10);
+    merger.reset(10);
+    merger.addAll(inputs, 4);
+    CandidateList out;
+    merger.finish(out);
+    OWCAT_CHECK(out.size() == 4);
+    OWCAT_CHECK(!out.empty() && out.front().text == "w3");
+}
+
+} // namespace
+
+int main() {
+    testBasicMerge();
+    testStableTies();
+    testRandomAgainstReference();
+    testAddAllCount();
+    
+    return owcat::test::exitCode();
+}
\ No newline at end of file
@@ -0,0 +1,242 @@
+#include "core/dictionary_io.h"
+#include "core/dictionary_manager.h"
+#include "test_support.h"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace owcat::core;
+namespace fs = std::filesystem;
+
+namespace {
+
+struct Entry {
+    std::string word;
+    std::string pinyin;
+    uint32_t frequency;
+
+    bool operator==(const Entry& other) const {
+        return word == other.word && pinyin == other.pinyin && frequency == other.frequency;
+    }
+};
+
+class TempDir {
+public:
+    explicit TempDir(const std::string& name)
+        : path_(fs::temp_directory_path() / ("owcat_" + name)) {
+        fs::remove_all(path_);
+        fs::create_directories(path_);
+    }
+    ~TempDir() {
+        std::error_code error;
+        fs::remove_all(path_, error);
+    }
+    std::string file(const std::string& name) const { return (path_ / name).string(); }
+
+private:
+    fs::path path_;
+};
+
+const std::vector<Entry> ENTRIES = {
+    {"中国", "zhong guo", 800},
+    {"中国人", "zhong guo ren", 500},
+    {"你好", "ni hao", 1200},
+    {"西安", "xi an", 30},
+    {"一", "yi", 1},
+};
+
+bool writeEntries(const std::string& path, DictionaryFormat format, const std::vector<Entry>& entries) {
+    DictionaryWriter writer(path, format);
+    if (!writer.open()) {
+        return false;
+    }
+    for (const Entry& entry : entries) {
+        if (!writer.write(entry.word, entry.pinyin, entry.frequency)) {
+            return false;
+        }
+    }
+    return writer.commit();
+}
+
+DictionaryIoStatus readEntries(const std::string& path, DictionaryFormat format, std::vector<Entry>& entries,
+                               DictionaryProgress& stats, const DictionaryProgressCallback& progress = nullptr) {
+    entries.clear();
+    return readDictionary(path, format, [&](const DictionaryRecord& record) {
+        entries.push_back({std::string(record.word), std::string(record.pinyin), record.frequency});
+        return true;
+    }, progress, stats);
+}
+
+void writeText(const std::string& path, const std::string& text) {
+    std::ofstream file(path, std::ios::binary);
+    file << text;
+}
+
+// 文本格式写出后读回完全一致
+void testTextRoundTrip(const TempDir& dir) {
+    std::vector<Entry> entries = ENTRIES;
+    std::vector<Entry> quoted = entries;
+    quoted.push_back({"逗,号", "dou hao", 2});
+    quoted.push_back({"引\"号\\", "yin hao", 3});
+    
+    struct Case {
+        DictionaryFormat format;
+        const char* file;
+        const std::vector<Entry>* entries;
+    };
+    const Case cases[] = {
+        {DictionaryFormat::TXT, "round.txt", &entries},
+        {DictionaryFormat::CSV, "round.csv", &quoted},
+        {DictionaryFormat::JSON, "round.json", &quoted},
+    };
+    for (const Case& item : cases) {
+        const std::string path = dir.file(item.file);
+        OWCAT_CHECK(writeEntries(path, item.format, *item.entries));
+        OWCAT_CHECK(!fs::exists(path + ".tmp"));
+        
+        std::vector<Entry> read;
+        DictionaryProgress stats;
+        OWCAT_CHECK(readEntries(path, item.format, read, stats) == DictionaryIoStatus::OK);
+        OWCAT_CHECK(read == *item.entries);
+        OWCAT_CHECK(stats.entries == item.entries->size());
+        OWCAT_CHECK(stats.rejected == 0);
+        OWCAT_CHECK(stats.processed == stats.total);
+    }
+}
+
+// 二进制词典的频率是量化的，只比较词和拼音
+void testLexiconRoundTrip(const TempDir& dir) {
+    const std::string path = dir.file("round.lex");
+    OWCAT_CHECK(writeEntries(path, DictionaryFormat::LEXICON, ENTRIES));
+    
+    std::vector<Entry> read;
+    DictionaryProgress stats;
+    OWCAT_CHECK(readEntries(path, DictionaryFormat::LEXICON, read, stats) == DictionaryIoStatus::OK);
+    OWCAT_CHECK(read.size() == ENTRIES.size());
+    for (const Entry& entry : ENTRIES) {
+        OWCAT_CHECK(std::any_of(read.begin(), read.end(), [&](const Entry& other) {
+            return other.word == entry.word && other.pinyin == entry.pinyin && other.frequency > 0;
+        }));
+    }
+    
+    // 损坏的二进制词典被拒绝
+    std::string bytes;
+    {
+        std::ifstream file(path, std::ios::binary);
+        bytes.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+    const std::string truncated = dir.file("truncated.lex");
+    writeText(truncated, bytes.substr(0, bytes.size() / 2));
+    OWCAT_CHECK(readEntries(truncated, DictionaryFormat::LEXICON, read, stats) == DictionaryIoStatus::FAILED);
+}
+
+// 宽松解析：两种列顺序、缺省频率、表头，无法解析的行计入rejected
+void testLenientParsing(const TempDir& dir) {
+    const std::string txt = dir.file("loose.txt");
+    writeText(txt, "你好 ni hao 12\nzhong guo 中国 7\n西安 xi an\n\n???\n");
+    std::vector<Entry> read;
+    DictionaryProgress stats;
+    OWCAT_CHECK(readEntries(txt, DictionaryFormat::TXT, read, stats) == DictionaryIoStatus::OK);
+    OWCAT_CHECK(read == (std::vector<Entry>{{"你好", "ni hao", 12}, {"中国", "zhong guo", 7}, {"西安", "xi an", 1}}));
+    OWCAT_CHECK(stats.rejected == 1);
+    
+    const std::string csv = dir.file("loose.csv");
+    writeText(csv, "word,pinyin,frequency\r\n\"你好\",ni hao,5\r\n中国,zhongguo\r\n");
+    OWCAT_CHECK(readEntries(csv, DictionaryFormat::CSV, read, stats) == DictionaryIoStatus::OK);
+    OWCAT_CHECK(read.size() >= 1 && read[0] == (Entry{"你好", "ni hao", 5}));
+    
+    const std::string json = dir.file("array.json");
+    writeText(json, "[{\"word\": \"你好\", \"pinyin\": [\"ni\", \"hao\"], \"frequency\": 9}]");
+    OWCAT_CHECK(readEntries(json, DictionaryFormat::JSON, read, stats) == DictionaryIoStatus::OK);
+    OWCAT_CHECK(read == (std::vector<Entry>{{"你好", "ni hao", 9}}));
+    
+    const std::string broken = dir.file("broken.json");
+    writeText(broken, "[{\"word\": \"你好\", \"pinyin\": ");
+    OWCAT_CHECK(readEntries(broken, DictionaryFormat::JSON, read, stats) == DictionaryIoStatus::FAILED);
+    OWCAT_CHECK(readEntries(dir.file("missing.txt"), DictionaryFormat::TXT, read, stats) ==
+                DictionaryIoStatus::FAILED);
+}
+
+void testFormatNames() {
+    DictionaryFormat format = DictionaryFormat::TXT;
+    OWCAT_CHECK(parseDictionaryFormat("", "words.CSV", format) && format == DictionaryFormat::CSV);
+    OWCAT_CHECK(parseDictionaryFormat("auto", "words.json", format) && format == DictionaryFormat::JSON);
+    OWCAT_CHECK(parseDictionaryFormat("lex", "words.txt", format) && format == DictionaryFormat::LEXICON);
+    OWCAT_CHECK(!parseDictionaryFormat("xml", "words.xml", format));
+    OWCAT_CHECK(std::string(dictionaryFormatName(DictionaryFormat::JSON)) == "json");
+}
+
+// 取消读取；未提交的写出不改动目标文件
+void testCancelAndAbort(const TempDir& dir) {
+    const std::string path = dir.file("cancel.txt");
+    OWCAT_CHECK(writeEntries(path, DictionaryFormat::TXT, ENTRIES));
+    
+    std::vector<Entry> read;
+    DictionaryProgress stats;
+    OWCAT_CHECK(readEntries(path, DictionaryFormat::TXT, read, stats, [](const DictionaryProgress&) {
+        return false;
+    }) == DictionaryIoStatus::CANCELLED);
+    
+    {
+        DictionaryWriter writer(path, DictionaryFormat::TXT);
+        OWCAT_CHECK(writer.open());
+        OWCAT_CHECK(writer.write("残缺", "can que", 1));
+    }
+    OWCAT_CHECK(!fs::exists(path + ".tmp"));
+    OWCAT_CHECK(readEntries(path, DictionaryFormat::TXT, read, stats) == DictionaryIoStatus::OK);
+    OWCAT_CHECK(read == ENTRIES);
+}
+
+// 导入到用户层后立即可查（没有系统词典时也能按简拼查到），修订号递增；导出后读回包含导入的词
+void testManagerImportExport(const TempDir& dir) {
+    const std::string source = dir.file("import.csv");
+    OWCAT_CHECK(writeEntries(source, DictionaryFormat::CSV, ENTRIES));
+    
+    DictionaryManager manager(":memory:");
+    OWCAT_CHECK(manager.initialize());
+    const uint64_t revision = manager.getUserRevision();
+    
+    std::unique_ptr<DictionaryTask> task = manager.importDictionaryAsync(source);
+    OWCAT_CHECK(task != nullptr);
+    OWCAT_CHECK(task && task->wait() == DictionaryIoStatus::OK);
+    OWCAT_CHECK(task && task->getProgress().entries == ENTRIES.size());
+    OWCAT_CHECK(manager.getUserRevision() > revision);
+    
+    CandidateList candidates = manager.searchByPinyin("xi an", 10);
+    OWCAT_CHECK(std::any_of(candidates.begin(), candidates.end(), [](const Candidate& candidate) {
+        return candidate.text == "西安";
+    }));
+    candidates = manager.searchByPinyin("x a", 10);
+    OWCAT_CHECK(std::any_of(candidates.begin(), candidates.end(), [](const Candidate& candidate) {
+        return candidate.text == "西安";
+    }));
+    
+    const std::string exported = dir.file("export.json");
+    OWCAT_CHECK(manager.exportUserDictionary(exported, "json"));
+    std::vector<Entry> read;
+    DictionaryProgress stats;
+    OWCAT_CHECK(readEntries(exported, DictionaryFormat::JSON, read, stats) == DictionaryIoStatus::OK);
+    for (const Entry& entry : ENTRIES) {
+        OWCAT_CHECK(std::find(read.begin(), read.end(), entry) != read.end());
+    }
+    
+    OWCAT_CHECK(!manager.importDictionary(source, "xml"));
+    manager.shutdown();
+}
+
+} // namespace
+
+int main() {
+    TempDir dir("dictionary_io");
+    
+    testTextRoundTrip(dir);
+    testLexiconRoundTrip(dir);
+    testLenientParsing(dir);
+    testFormatNames();
+    testCancelAndAbort(dir);
+    testManagerImportExport(dir);
+    
+    return owcat::test::exitCode();
+}
\ No newline at end of file
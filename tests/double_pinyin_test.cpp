@@ -0,0 +1,132 @@
+#include "core/double_pinyin.h"
+#include "core/pinyin_converter.h"
+#include "test_support.h"
+#include <set>
+#include <string>
+#include <vector>
+
+using namespace owcat::core;
+
+namespace {
+
+const char SECOND_KEYS[] = "abcdefghijklmnopqrstuvwxyz;";
+
+std::string decoded(const DoublePinyin& table, const std::vector<std::string>& syllables, const char* keys) {
+    int id = table.decode(keys[0], keys[1]);
+    return id < 0 ? std::string() : syllables[id];
+}
+
+// 每个方案都能输入音节表中的全部音节
+void testCoverage(const std::vector<std::string>& syllables) {
+    for (const std::string& scheme : DoublePinyin::getSchemeNames()) {
+        DoublePinyin table;
+        OWCAT_CHECK(table.load(scheme, syllables));
+        OWCAT_CHECK(table.isLoaded());
+        OWCAT_CHECK(table.getName() == scheme);
+        
+        std::set<int> covered;
+        for (char first = 'a'; first <= 'z'; ++first) {
+            for (const char* second = SECOND_KEYS; *second; ++second) {
+                int id = table.decode(first, *second);
+                OWCAT_CHECK(id < static_cast<int>(syllables.size()));
+                if (id >= 0) {
+                    OWCAT_CHECK(table.isFirstKey(first));
+                    covered.insert(id);
+                }
+            }
+        }
+        OWCAT_CHECK(covered.size() == syllables.size());
+        OWCAT_CHECK(!table.isFirstKey(';'));
+        OWCAT_CHECK(table.decode(';', 'a') == -1);
+    }
+    
+    DoublePinyin table;
+    OWCAT_CHECK(!table.load("unknown", syllables));
+    OWCAT_CHECK(!table.isLoaded());
+}
+
+// 各方案的代表性键位
+void testKnownKeys(const std::vector<std::string>& syllables) {
+    struct Case {
+        const char* scheme;
+        const char* keys;
+        const char* syllable;
+    };
+    const Case cases[] = {
+        {"microsoft", "vs", "zhong"}, {"microsoft", "ii", "chi"}, {"microsoft", "uu", "shu"},
+        {"microsoft", "d;", "ding"}, {"microsoft", "xm", "xian"}, {"microsoft", "oj", "an"},
+        {"microsoft", "ol", "ai"}, {"microsoft", "oo", "o"},
+        {"xiaohe", "vs", "zhong"}, {"xiaohe", "dk", "ding"}, {"xiaohe", "ll", "liang"},
+        {"xiaohe", "hc", "hao"}, {"xiaohe", "dy", "dun"}, {"xiaohe", "aa", "a"},
+        {"xiaohe", "an", "an"}, {"xiaohe", "er", "er"},
+        {"ziranma", "vs", "zhong"}, {"ziranma", "dy", "ding"}, {"ziranma", "nc", "niao"},
+        {"ziranma", "lz", "lei"}, {"ziranma", "ee", "e"},
+    };
+    for (const Case& item : cases) {
+        DoublePinyin table;
+        OWCAT_CHECK(table.load(item.scheme, syllables));
+        OWCAT_CHECK(decoded(table, syllables, item.keys) == item.syllable);
+    }
+    
+    DoublePinyin xiaohe;
+    OWCAT_CHECK(xiaohe.load("xiaohe", syllables));
+    OWCAT_CHECK(xiaohe.getPrefix('v') == "zh");
+    OWCAT_CHECK(xiaohe.getPrefix('i') == "ch");
+    OWCAT_CHECK(xiaohe.getPrefix('u') == "sh");
+    OWCAT_CHECK(xiaohe.getPrefix('b') == "b");
+    OWCAT_CHECK(xiaohe.getPrefix(';').empty());
+}
+
+// 转换器中每两个键解码为一个音节，分割唯一
+void testConverter() {
+    PinyinConverter converter;
+    OWCAT_CHECK(converter.initialize());
+    OWCAT_CHECK(converter.setDoublePinyinScheme("xiaohe"));
+    OWCAT_CHECK(converter.isDoublePinyin());
+    
+    for (char ch : std::string("nihc")) {
+        OWCAT_CHECK(converter.addChar(ch));
+    }
+    OWCAT_CHECK(converter.getCurrentPinyin() == "nihao");
+    std::vector<PinyinSegmentation> paths = converter.getBestSegmentations(4);
+    OWCAT_CHECK(paths.size() == 1);
+    OWCAT_CHECK(!paths.empty() && paths[0].complete);
+    OWCAT_CHECK(!paths.empty() && paths[0].syllables == (std::vector<std::string>{"ni", "hao"}));
+    
+    // 只输入第一个键时给出声母
+    OWCAT_CHECK(converter.addChar('v'));
+    OWCAT_CHECK(converter.getCurrentPinyin() == "nihaozh");
+    paths = converter.getBestSegmentations(1);
+    OWCAT_CHECK(!paths.empty() && !paths[0].complete);
+    
+    // 删除按键按键位回退
+    OWCAT_CHECK(converter.removeLastChar());
+    OWCAT_CHECK(converter.getCurrentPinyin() == "nihao");
+    OWCAT_CHECK(converter.removeLastChar());
+    OWCAT_CHECK(converter.getCurrentPinyin() == "nih");
+    
+    // 无法解码的键被拒绝，不存在的方案保持原方案，切回全拼清空输入
+    OWCAT_CHECK(!converter.addChar(';'));
+    OWCAT_CHECK(!converter.setDoublePinyinScheme("unknown"));
+    OWCAT_CHECK(converter.isDoublePinyin());
+    OWCAT_CHECK(converter.setDoublePinyinScheme(""));
+    OWCAT_CHECK(!converter.isDoublePinyin());
+    OWCAT_CHECK(converter.getCurrentPinyin().empty());
+}
+
+} // namespace
+
+int main() {
+    PinyinConverter converter;
+    OWCAT_CHECK(converter.initialize());
+    std::vector<std::string> syllables;
+    for (size_t i = 0; i < converter.getSyllableCount(); ++i) {
+        syllables.push_back(converter.getSyllable(static_cast<int>(i)));
+    }
+    
+    testCoverage(syllables);
+    testKnownKeys(syllables);
+    testConverter();
+    
+    return owcat::test::exitCode();
+}
\ No newline at end of file
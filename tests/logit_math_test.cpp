@@ -0,0 +1,122 @@
+#include "core/logit_math.h"
+#include "test_support.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <random>
+#include <vector>
+
+using namespace owcat::core;
+
+namespace {
+
+// 覆盖SIMD主循环、尾部和Qwen词表大小
+const size_t SIZES[] = {1, 2, 3, 7, 8, 9, 15, 16, 17, 33, 1000, 151936};
+
+std::vector<float> randomLogits(size_t size, std::mt19937& rng, float spread) {
+    std::normal_distribution<float> distribution(0.0f, spread);
+    std::vector<float> logits(size);
+    for (float& logit : logits) {
+        logit = distribution(rng);
+    }
+    return logits;
+}
+
+// 以双精度逐项计算的参考值
+double referenceLogSumExp(const std::vector<float>& logits) {
+    double max = *std::max_element(logits.begin(), logits.end());
+    double sum = 0.0;
+    for (float logit : logits) {
+        sum += std::exp(static_cast<double>(logit) - max);
+    }
+    return max + std::log(sum);
+}
+
+void testMaxAndLogSumExp() {
+    std::mt19937 rng(7);
+    for (size_t size : SIZES) {
+        for (float spread : {1.0f, 8.0f, 40.0f}) {
+            std::vector<float> logits = randomLogits(size, rng, spread);
+            OWCAT_CHECK(maxLogit(logits.data(), size) == *std::max_element(logits.begin(), logits.end()));
+            
+            const double expected = referenceLogSumExp(logits);
+            const double actual = logSumExp(logits.data(), size);
+            OWCAT_CHECK(std::fabs(actual - expected) <= 1e-4 * std::max(1.0, std::fabs(expected)));
+        }
+    }
+    
+    // 末尾元素最大时同样能被SIMD尾部处理找到
+    std::vector<float> logits(17, -5.0f);
+    logits.back() = 3.0f;
+    OWCAT_CHECK(maxLogit(logits.data(), logits.size()) == 3.0f);
+    
+    // 被屏蔽的token（-inf）不影响结果，极大的logit不溢出
+    logits.assign(9, -std::numeric_limits<float>::infinity());
+    logits[4] = 1000.0f;
+    OWCAT_CHECK(std::fabs(logSumExp(logits.data(), logits.size()) - 1000.0f) < 1e-3f);
+}
+
+// 与完全排序的结果比较logit序列；大词表中有重复值，同分token的先后不确定，只检查下标对应的logit且不重复
+void testSelectTopK() {
+    std::mt19937 rng(11);
+    std::vector<TokenLogit> out;
+    for (size_t size : SIZES) {
+        std::vector<float> logits = randomLogits(size, rng, 4.0f);
+        std::vector<TokenLogit> sorted(size);
+        for (size_t i = 0; i < size; ++i) {
+            sorted[i] = {static_cast<int32_t>(i), logits[i]};
+        }
+        std::sort(sorted.begin(), sorted.end(), [](const TokenLogit& a, const TokenLogit& b) {
+            return a.logit > b.logit;
+        });
+        
+        for (size_t k : {size_t(1), size_t(5), size_t(40), size / 2}) {
+            if (k == 0 || k >= size) {
+                continue;
+            }
+            OWCAT_CHECK(selectTopK(logits.data(), size, k, out) == k);
+            bool same = out.size() == k;
+            std::vector<bool> seen(size, false);
+            for (size_t i = 0; same && i < k; ++i) {
+                const size_t id = static_cast<size_t>(out[i].id);
+                same = out[i].logit == sorted[i].logit && id < size && logits[id] == out[i].logit && !seen[id];
+                if (same) {
+                    seen[id] = true;
+                }
+            }
+            OWCAT_CHECK(same);
+        }
+        
+        // k为0或不小于size时按下标顺序返回全部
+        OWCAT_CHECK(selectTopK(logits.data(), size, 0, out) == size);
+        OWCAT_CHECK(selectTopK(logits.data(), size, size, out) == size);
+        bool in_order = out.size() == size;
+        for (size_t i = 0; in_order && i < size; ++i) {
+            in_order = out[i].id == static_cast<int32_t>(i);
+        }
+        OWCAT_CHECK(in_order);
+    }
+}
+
+void testSelectTopKItems() {
+    std::vector<TokenLogit> items = {{0, 0.5f}, {1, 2.0f}, {2, -1.0f}, {3, 3.0f}, {4, 1.0f}};
+    OWCAT_CHECK(selectTopK(items, 3) == 3);
+    OWCAT_CHECK(items.size() == 3);
+    if (items.size() == 3) {
+        OWCAT_CHECK(items[0].id == 3 && items[1].id == 1 && items[2].id == 4);
+    }
+    
+    items = {{0, 0.5f}, {1, 2.0f}, {2, -1.0f}};
+    OWCAT_CHECK(selectTopK(items, 0) == 3);
+    OWCAT_CHECK(items[0].id == 1 && items[2].id == 2);
+}
+
+} // namespace
+
+int main() {
+    testMaxAndLogSumExp();
+    testSelectTopK();
+    testSelectTopKItems();
+    
+    return owcat::test::exitCode();
+}
\ No newline at end of file
@@ -0,0 +1,127 @@
+#include "core/pinyin_converter.h"
+#include "test_support.h"
+#include <string>
+#include <vector>
+
+using namespace owcat::core;
+
+namespace {
+
+using Syllables = std::vector<std::string>;
+
+void type(PinyinConverter& converter, const std::string& input) {
+    converter.clear();
+    for (char ch : input) {
+        converter.addChar(ch);
+    }
+}
+
+Syllables best(const PinyinConverter& converter) {
+    std::vector<PinyinSegmentation> paths = converter.getBestSegmentations(1);
+    return paths.empty() ? Syllables() : paths.front().syllables;
+}
+
+// 完整输入的最优路径音节最少，次优路径按得分降序给出
+void testCompleteInput(PinyinConverter& converter) {
+    type(converter, "nihao");
+    std::vector<PinyinSegmentation> paths = converter.getBestSegmentations(PinyinConverter::kMaxLatticePaths);
+    OWCAT_CHECK(!paths.empty());
+    OWCAT_CHECK(paths.front().syllables == (Syllables{"ni", "hao"}));
+    OWCAT_CHECK(paths.front().complete);
+    OWCAT_CHECK(paths.front().syllable_ids[0] == converter.getSyllableId("ni"));
+    for (size_t i = 1; i < paths.size(); ++i) {
+        OWCAT_CHECK(paths[i - 1].score >= paths[i].score);
+    }
+    
+    std::vector<Syllables> segments = converter.getPinyinSegments();
+    OWCAT_CHECK(segments.size() == 2);
+    OWCAT_CHECK(segments[0] == (Syllables{"ni", "hao"}));
+    OWCAT_CHECK(segments[1] == (Syllables{"ni", "ha", "o"}));
+    
+    type(converter, "xian");
+    segments = converter.getPinyinSegments();
+    OWCAT_CHECK(segments.size() == 2);
+    OWCAT_CHECK(segments[0] == (Syllables{"xian"}));
+    OWCAT_CHECK(segments[1] == (Syllables{"xi", "an"}));
+    
+    type(converter, "zhongguoren");
+    OWCAT_CHECK(best(converter) == (Syllables{"zhong", "guo", "ren"}));
+}
+
+// 未输入完整的末尾音节以前缀给出，只有完整路径出现在getPinyinSegments中
+void testIncompleteInput(PinyinConverter& converter) {
+    type(converter, "nih");
+    std::vector<PinyinSegmentation> paths = converter.getBestSegmentations(1);
+    OWCAT_CHECK(paths.size() == 1);
+    OWCAT_CHECK(paths[0].syllables == (Syllables{"ni", "h"}));
+    OWCAT_CHECK(paths[0].syllable_ids[1] == -1);
+    OWCAT_CHECK(!paths[0].complete);
+    OWCAT_CHECK(converter.getPinyinSegments().empty());
+}
+
+// 删除按键后网格回到之前的状态
+void testRemoveLastChar(PinyinConverter& converter) {
+    type(converter, "nihao");
+    OWCAT_CHECK(converter.removeLastChar());
+    OWCAT_CHECK(best(converter) == (Syllables{"ni", "ha"}));
+    OWCAT_CHECK(converter.addChar('o'));
+    OWCAT_CHECK(best(converter) == (Syllables{"ni", "hao"}));
+}
+
+void testAbbreviation(PinyinConverter& converter) {
+    converter.setAbbreviationEnabled(true);
+    type(converter, "zgr");
+    OWCAT_CHECK(converter.getCurrentPinyin() == "zgr");
+    std::vector<PinyinSegmentation> paths = converter.getBestSegmentations(1);
+    OWCAT_CHECK(paths.size() == 1);
+    OWCAT_CHECK(paths[0].syllables == (Syllables{"z", "g", "r"}));
+    OWCAT_CHECK(!paths[0].complete);
+    
+    // 关闭简拼后不能再分割的按键被丢弃
+    converter.setAbbreviationEnabled(false);
+    OWCAT_CHECK(converter.getCurrentPinyin() == "z");
+    OWCAT_CHECK(!converter.addChar('g'));
+}
+
+// 音节概率决定歧义输入的最优路径
+void testSyllableLogProbs(PinyinConverter& converter) {
+    std::vector<float> log_probs(converter.getSyllableCount(), -12.0f);
+    log_probs[converter.getSyllableId("xi")] = -1.0f;
+    log_probs[converter.getSyllableId("an")] = -1.0f;
+    converter.setSyllableLogProbs(log_probs);
+    
+    type(converter, "xian");
+    OWCAT_CHECK(best(converter) == (Syllables{"xi", "an"}));
+    
+    converter.setSyllableLogProbs(std::vector<float>());
+    OWCAT_CHECK(best(converter) == (Syllables{"xian"}));
+}
+
+// 网格按键增量扩展，长输入不会因路径组合爆炸
+void testLongInput(PinyinConverter& converter) {
+    std::string input;
+    for (int i = 0; i < 16; ++i) {
+        input += "xian";
+    }
+    type(converter, input);
+    OWCAT_CHECK(converter.getCurrentPinyin() == input);
+    std::vector<PinyinSegmentation> paths = converter.getBestSegmentations(PinyinConverter::kMaxLatticePaths);
+    OWCAT_CHECK(paths.size() == PinyinConverter::kMaxLatticePaths);
+    OWCAT_CHECK(paths.front().syllables.size() == 16);
+}
+
+} // namespace
+
+int main() {
+    PinyinConverter converter;
+    OWCAT_CHECK(converter.initialize());
+    
+    testCompleteInput(converter);
+    testIncompleteInput(converter);
+    testRemoveLastChar(converter);
+    testAbbreviation(converter);
+    testSyllableLogProbs(converter);
+    testLongInput(converter);
+    
+    return owcat::test::exitCode();
+}
\ No newline at end of file
@@ -0,0 +1,93 @@
+#include "core/pinyin_converter.h"
+#include "test_support.h"
+#include <string>
+
+using namespace owcat::core;
+
+namespace {
+
+// 音节ID是有序音节表中的下标，与音节互相转换
+void testSyllableIds(const PinyinConverter& converter) {
+    OWCAT_CHECK(converter.getSyllableCount() > 300);
+    for (size_t i = 0; i < converter.getSyllableCount(); ++i) {
+        const std::string& syllable = converter.getSyllable(static_cast<int>(i));
+        OWCAT_CHECK(converter.getSyllableId(syllable) == static_cast<int>(i));
+        if (i > 0) {
+            OWCAT_CHECK(converter.getSyllable(static_cast<int>(i) - 1) < syllable);
+        }
+    }
+    
+    OWCAT_CHECK(converter.getSyllableId("") == -1);
+    OWCAT_CHECK(converter.getSyllableId("zh") == -1);
+    OWCAT_CHECK(converter.getSyllable(-1).empty());
+    OWCAT_CHECK(converter.getSyllable(static_cast<int>(converter.getSyllableCount())).empty());
+}
+
+void testValidPinyin(const PinyinConverter& converter) {
+    OWCAT_CHECK(converter.isValidPinyin("a"));
+    OWCAT_CHECK(converter.isValidPinyin("zhuan"));
+    OWCAT_CHECK(converter.isValidPinyin("zhuang"));
+    OWCAT_CHECK(!converter.isValidPinyin("zhuangg"));
+    OWCAT_CHECK(!converter.isValidPinyin("zh"));
+    OWCAT_CHECK(!converter.isValidPinyin("nihao"));
+    OWCAT_CHECK(!converter.isValidPinyin(""));
+}
+
+// 前缀查询返回子树中的全部音节，按音节表顺序
+void testPrefixes(const PinyinConverter& converter) {
+    std::vector<std::string> prefixes = converter.getPinyinPrefixes("zhu");
+    OWCAT_CHECK(!prefixes.empty());
+    OWCAT_CHECK(prefixes.front() == "zhu");
+    bool has_zhuang = false;
+    for (size_t i = 0; i < prefixes.size(); ++i) {
+        OWCAT_CHECK(prefixes[i].compare(0, 3, "zhu") == 0);
+        OWCAT_CHECK(i == 0 || prefixes[i - 1] < prefixes[i]);
+        has_zhuang = has_zhuang || prefixes[i] == "zhuang";
+    }
+    OWCAT_CHECK(has_zhuang);
+    
+    size_t expected = 0;
+    for (size_t i = 0; i < converter.getSyllableCount(); ++i) {
+        if (converter.getSyllable(static_cast<int>(i))[0] == 'x') {
+            ++expected;
+        }
+    }
+    OWCAT_CHECK(converter.getPinyinPrefixes("x").size() == expected);
+    
+    OWCAT_CHECK(converter.getPinyinPrefixes("zhuangg").empty());
+    OWCAT_CHECK(converter.getPinyinPrefixes("v").empty());
+}
+
+// 逐键输入可以跨越多个音节，不能构成音节序列的按键被拒绝
+void testIncrementalInput(PinyinConverter& converter) {
+    converter.clear();
+    for (char ch : std::string("nihao")) {
+        OWCAT_CHECK(converter.addChar(ch));
+    }
+    OWCAT_CHECK(converter.getCurrentPinyin() == "nihao");
+    
+    OWCAT_CHECK(converter.removeLastChar());
+    OWCAT_CHECK(converter.getCurrentPinyin() == "niha");
+    OWCAT_CHECK(converter.addChar('o'));
+    OWCAT_CHECK(converter.getCurrentPinyin() == "nihao");
+    
+    converter.clear();
+    OWCAT_CHECK(converter.getCurrentPinyin().empty());
+    OWCAT_CHECK(!converter.removeLastChar());
+    OWCAT_CHECK(!converter.addChar('1'));
+    OWCAT_CHECK(converter.getCurrentPinyin().empty());
+}
+
+} // namespace
+
+int main() {
+    PinyinConverter converter;
+    OWCAT_CHECK(converter.initialize());
+    
+    testSyllableIds(converter);
+    testValidPinyin(converter);
+    testPrefixes(converter);
+    testIncrementalInput(converter);
+    
+    return owcat::test::exitCode();
+}
\ No newline at end of file
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdio>
+
+namespace owcat {
+namespace test {
+
+/**
+ * 当前测试程序中失败的检查数
+ */
+inline int& failureCount() {
+    static int count = 0;
+    return count;
+}
+
+/**
+ * 测试程序的返回值：有失败的检查时为1
+ */
+inline int exitCode() {
+    if (failureCount() > 0) {
+        std::fprintf(stderr, "%d check(s) failed\n", failureCount());
+        return 1;
+    }
+    return 0;
+}
+
+} // namespace test
+} // namespace owcat
+
+// 检查失败时打印位置并继续执行，由exitCode()汇总结果
+#define OWCAT_CHECK(condition)                                                          \
+    do {                                                                                \
+        if (!(condition)) {                                                             \
+            std::fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            ++::owcat::test::failureCount();                                            \
+        }                                                                               \
+    } while (false)
@@ -0,0 +1,178 @@
+#include "core/user_dictionary.h"
+#include "test_support.h"
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+using namespace owcat::core;
+namespace fs = std::filesystem;
+
+namespace {
+
+// 每个测试使用独立的临时目录
+class TempDir {
+public:
+    explicit TempDir(const std::string& name)
+        : path_(fs::temp_directory_path() / ("owcat_" + name)) {
+        fs::remove_all(path_);
+        fs::create_directories(path_);
+    }
+    ~TempDir() {
+        std::error_code error;
+        fs::remove_all(path_, error);
+    }
+    std::string file(const std::string& name) const { return (path_ / name).string(); }
+
+private:
+    fs::path path_;
+};
+
+// 复制快照和日志，模拟进程在未压缩时退出
+void copyFiles(const std::string& from, const std::string& to) {
+    for (const char* suffix : {"", ".journal"}) {
+        if (fs::exists(from + suffix)) {
+            fs::copy_file(from + suffix, to + suffix, fs::copy_options::overwrite_existing);
+        }
+    }
+}
+
+int frequencyOf(const UserDictionary& dictionary, const std::string& word, const std::string& pinyin) {
+    UserWord entry;
+    return dictionary.find(word, pinyin, entry) ? entry.frequency : -1;
+}
+
+void fill(UserDictionary& dictionary) {
+    dictionary.setHalfLife(0);
+    OWCAT_CHECK(dictionary.addWord("中国人", "zhong guo ren", 50));
+    OWCAT_CHECK(dictionary.addWord("中国", "zhong guo", 80));
+    OWCAT_CHECK(dictionary.addWord("张国荣", "zhang guo rong", 30));
+    OWCAT_CHECK(dictionary.addWord("临时", "lin shi", 5));
+    OWCAT_CHECK(dictionary.addFrequency("中国", "zhong guo", 3));
+    OWCAT_CHECK(dictionary.addFrequency("你好", "ni hao", 7));
+    OWCAT_CHECK(dictionary.removeWord("临时", "lin shi"));
+    
+    // 日志字段以制表符分隔，含有分隔符的词被拒绝
+    OWCAT_CHECK(!dictionary.addWord("坏\t词", "huai ci", 1));
+    OWCAT_CHECK(!dictionary.addWord("", "kong", 1));
+}
+
+void checkContents(const UserDictionary& dictionary) {
+    OWCAT_CHECK(frequencyOf(dictionary, "中国人", "zhong guo ren") == 50);
+    OWCAT_CHECK(frequencyOf(dictionary, "中国", "zhong guo") == 83);
+    OWCAT_CHECK(frequencyOf(dictionary, "张国荣", "zhang guo rong") == 30);
+    OWCAT_CHECK(frequencyOf(dictionary, "临时", "lin shi") == -1);
+    
+    // 系统词的学习加权不是用户词
+    UserWord boost;
+    OWCAT_CHECK(dictionary.find("你好", "ni hao", boost));
+    OWCAT_CHECK(!boost.user_word && boost.frequency == 7);
+    
+    std::vector<UserWord> words = dictionary.getUserWords();
+    OWCAT_CHECK(words.size() == 3);
+    OWCAT_CHECK(!words.empty() && words.front().word == "中国");
+}
+
+// 前缀查询和简拼查询
+void testSearch() {
+    UserDictionary dictionary("");
+    OWCAT_CHECK(dictionary.open());
+    fill(dictionary);
+    
+    std::vector<UserWord> out;
+    OWCAT_CHECK(dictionary.search("zhong g", 10, out) == 2);
+    OWCAT_CHECK(out.size() == 2 && out[0].word == "中国" && out[1].word == "中国人");
+    OWCAT_CHECK(dictionary.search("zhong g", 1, out) == 1);
+    OWCAT_CHECK(dictionary.search("ni", 10, out) == 0);
+    
+    auto any = [](const std::string&) { return true; };
+    OWCAT_CHECK(dictionary.searchAbbreviated("zgr", 10, any, out) == 2);
+    OWCAT_CHECK(out.size() == 2 && out[0].word == "中国人" && out[1].word == "张国荣");
+    OWCAT_CHECK(dictionary.searchAbbreviated("zg", 10, any, out) == 3);
+    
+    auto zhong = [](const std::string& pinyin) { return pinyin.compare(0, 5, "zhong") == 0; };
+    OWCAT_CHECK(dictionary.searchAbbreviated("zgr", 10, zhong, out) == 1);
+    
+    // 删除后不再出现在首字母索引中
+    OWCAT_CHECK(dictionary.removeWord("张国荣", "zhang guo rong"));
+    OWCAT_CHECK(dictionary.searchAbbreviated("zgr", 10, any, out) == 1);
+    OWCAT_CHECK(dictionary.prune(60) == 1);
+    OWCAT_CHECK(dictionary.searchAbbreviated("zg", 10, any, out) == 1);
+}
+
+// 未压缩时重放日志，残缺的末行被忽略
+void testJournalReplay() {
+    TempDir dir("user_journal");
+    const std::string path = dir.file("user.dict");
+    const std::string replay = dir.file("replay.dict");
+    
+    UserDictionary dictionary(path);
+    OWCAT_CHECK(dictionary.open());
+    OWCAT_CHECK(!dictionary.existedOnDisk());
+    fill(dictionary);
+    OWCAT_CHECK(dictionary.sync());
+    OWCAT_CHECK(dictionary.getStats().journal_records > 0);
+    
+    copyFiles(path, replay);
+    if (std::FILE* journal = std::fopen((replay + ".journal").c_str(), "ab")) {
+        std::fputs("999999\tA\t残缺", journal);
+        std::fclose(journal);
+    }
+    
+    UserDictionary replayed(replay);
+    OWCAT_CHECK(replayed.open());
+    OWCAT_CHECK(replayed.existedOnDisk());
+    replayed.setHalfLife(0);
+    checkContents(replayed);
+    OWCAT_CHECK(frequencyOf(replayed, "残缺", "") == -1);
+}
+
+// 压缩为快照后截断日志，关闭并重新打开内容不变
+void testCompaction() {
+    TempDir dir("user_compact");
+    const std::string path = dir.file("user.dict");
+    
+    {
+        UserDictionary dictionary(path);
+        OWCAT_CHECK(dictionary.open());
+        fill(dictionary);
+        OWCAT_CHECK(dictionary.compact());
+        
+        UserDictionaryStats stats = dictionary.getStats();
+        OWCAT_CHECK(stats.compactions == 1);
+        OWCAT_CHECK(stats.journal_records == 0);
+        OWCAT_CHECK(stats.words == 3);
+        OWCAT_CHECK(stats.boosts == 1);
+        
+        // 压缩之后的修改只在日志中
+        OWCAT_CHECK(dictionary.addFrequency("中国人", "zhong guo ren", 10));
+        OWCAT_CHECK(dictionary.sync());
+        
+        const std::string copy = dir.file("copy.dict");
+        copyFiles(path, copy);
+        UserDictionary replayed(copy);
+        OWCAT_CHECK(replayed.open());
+        replayed.setHalfLife(0);
+        OWCAT_CHECK(frequencyOf(replayed, "中国人", "zhong guo ren") == 60);
+        OWCAT_CHECK(frequencyOf(replayed, "中国", "zhong guo") == 83);
+        dictionary.close();
+    }
+    
+    UserDictionary reopened(path);
+    OWCAT_CHECK(reopened.open());
+    OWCAT_CHECK(reopened.existedOnDisk());
+    reopened.setHalfLife(0);
+    OWCAT_CHECK(frequencyOf(reopened, "中国人", "zhong guo ren") == 60);
+    OWCAT_CHECK(frequencyOf(reopened, "张国荣", "zhang guo rong") == 30);
+    OWCAT_CHECK(reopened.getUserWords().size() == 3);
+}
+
+} // namespace
+
+int main() {
+    testSearch();
+    testJournalReplay();
+    testCompaction();
+    
+    return owcat::test::exitCode();
+}
\ No newline at end of file